@@ -6,6 +6,7 @@
 #include "config.h"
 #include "nucleus/filesystem/filesystem_host.h"
 
+#include <cstdlib>
 #include <cstring>
 
 // Global configuration object
@@ -19,8 +20,14 @@ Config::Config() {
     language = LANGUAGE_DEFAULT;
     ppuTranslator = CPU_TRANSLATOR_FUNCTION;
     spuTranslator = CPU_TRANSLATOR_FUNCTION;
+    spuThreads = 0;
     graphicsBackend = GRAPHICS_BACKEND_DIRECT3D12;
+    pipelineCompilation = PIPELINE_COMPILATION_BLOCK;
+    nullCounters = false;
+    softwareThreads = 0;
     audioBackend = AUDIO_BACKEND_XAUDIO2;
+    cachePath = "cache";
+    selfCache = false;
 }
 
 void Config::parseArguments(int argc, char** argv) {
@@ -32,6 +39,36 @@ void Config::parseArguments(int argc, char** argv) {
         if (!strcmp(argv[i], "--debugger")) {
             debugger = true;
         }
+        if (!strncmp(argv[i], "--spu-threads=", 14)) {
+            spuThreads = atoi(argv[i] + 14);
+        }
+        if (!strcmp(argv[i], "--graphics=null")) {
+            graphicsBackend = GRAPHICS_BACKEND_NULL;
+        }
+        if (!strcmp(argv[i], "--graphics=software")) {
+            graphicsBackend = GRAPHICS_BACKEND_SOFTWARE;
+        }
+        if (!strncmp(argv[i], "--software-threads=", 19)) {
+            softwareThreads = atoi(argv[i] + 19);
+        }
+        if (!strcmp(argv[i], "--null-counters")) {
+            nullCounters = true;
+        }
+        if (!strncmp(argv[i], "--null-trace=", 13)) {
+            nullTrace = argv[i] + 13;
+        }
+        if (!strcmp(argv[i], "--self-cache")) {
+            selfCache = true;
+        }
+        if (!strcmp(argv[i], "--pipelines=block")) {
+            pipelineCompilation = PIPELINE_COMPILATION_BLOCK;
+        }
+        if (!strcmp(argv[i], "--pipelines=skip")) {
+            pipelineCompilation = PIPELINE_COMPILATION_SKIP;
+        }
+        if (!strcmp(argv[i], "--pipelines=fallback")) {
+            pipelineCompilation = PIPELINE_COMPILATION_BLOCK;
+        }
     }
 
     // Check if booting an executable was requested
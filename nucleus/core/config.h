@@ -41,6 +41,12 @@ enum ConfigGraphicsBackend {
     GRAPHICS_BACKEND_VULKAN,
 };
 
+enum ConfigPipelineCompilation {
+    PIPELINE_COMPILATION_BLOCK,     // Wait for the pipeline to be built
+    PIPELINE_COMPILATION_SKIP,      // Skip draws until the pipeline is built
+    PIPELINE_COMPILATION_FALLBACK,  // Draw with a pipeline built for the same vertex layout, otherwise skip
+};
+
 // Audio Settings
 enum ConfigAudioBackend {
     AUDIO_BACKEND_COREAUDIO,
@@ -59,8 +65,15 @@ public:
     ConfigLanguage language;
     ConfigCpuTranslator ppuTranslator;
     ConfigCpuTranslator spuTranslator;
+    int spuThreads;         // SPU threads executing at once, or 0 to use one per host core
     ConfigGraphicsBackend graphicsBackend;
+    ConfigPipelineCompilation pipelineCompilation;
+    bool nullCounters;      // Count the commands received by the null graphics backend
+    std::string nullTrace;  // File where the null graphics backend writes the commands it received
+    int softwareThreads;    // Threads used by the software graphics backend, or 0 to use one per host core
     ConfigAudioBackend audioBackend;
+    std::string cachePath;  // Directory where persistent caches are stored
+    bool selfCache;         // Store decrypted SELF files in the cache directory
 
     // Constructor
     Config();
@@ -0,0 +1,32 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/common.h"
+
+namespace core {
+
+// Initial value of the 64-bit FNV-1a hash (offset basis)
+constexpr U64 HASH_SEED = 0xCBF29CE484222325ULL;
+
+/**
+ * Hash an arbitrary buffer.
+ * This uses the 64-bit Fowler/Noll/Vo FNV-1a hash code.
+ * @param[in]  data  Pointer to the first byte to hash
+ * @param[in]  size  Number of bytes to hash
+ * @param[in]  hash  Initial hash value, used to chain multiple buffers
+ * @return           Hash of the buffer
+ */
+inline U64 hashBytes(const void* data, Size size, U64 hash = HASH_SEED) {
+    const U08* bytes = static_cast<const U08*>(data);
+    for (Size i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash += (hash << 1) + (hash << 4) + (hash << 5) + (hash << 7) + (hash << 8) + (hash << 40);
+    }
+    return hash;
+}
+
+}  // namespace core
@@ -5,13 +5,85 @@
 
 #include "host.h"
 
+#ifdef NUCLEUS_ARCH_X86
+#ifdef NUCLEUS_COMPILER_MSVC
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
 #ifdef NUCLEUS_TARGET_WINDOWS
 #include <Windows.h>
 #include <VersionHelpers.h>
 #endif
 
+#include <cstring>
+
 namespace core {
 
+#ifdef NUCLEUS_ARCH_X86
+// Query a CPUID leaf of the host processor as {eax, ebx, ecx, edx}
+static void getCpuid(U32 data[4], U32 leaf, U32 subleaf = 0) {
+#ifdef NUCLEUS_COMPILER_MSVC
+    __cpuidex(reinterpret_cast<int*>(data), leaf, subleaf);
+#else
+    __cpuid_count(leaf, subleaf, data[0], data[1], data[2], data[3]);
+#endif
+}
+
+// Read the extended control register XCR0, holding the register states enabled by the OS
+static U64 getXcr0() {
+#ifdef NUCLEUS_COMPILER_MSVC
+    return _xgetbv(0);
+#else
+    U32 eax, edx;
+    __asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (U64(edx) << 32) | eax;
+#endif
+}
+
+static U32 detectHostFeatures() {
+    U32 features = 0;
+    U32 data[4];
+    getCpuid(data, 0x00000000);
+    const U32 maxLeaf = data[0];
+    getCpuid(data, 0x80000000);
+    const U32 maxLeafExt = data[0];
+
+    // AVX registers are only usable if the OS saves the XMM and YMM states
+    getCpuid(data, 0x00000001);
+    const bool hasXsave = (data[2] >> 27) & 1;
+    const bool hasYmmState = hasXsave && (getXcr0() & 0x6) == 0x6;
+    const bool hasZmmState = hasXsave && (getXcr0() & 0xE6) == 0xE6;
+    features |= ((data[2] >>  9) & 1) ? HOST_FEATURE_SSSE3 : 0;
+    features |= ((data[2] >> 19) & 1) ? HOST_FEATURE_SSE41 : 0;
+    features |= ((data[2] >> 22) & 1) ? HOST_FEATURE_MOVBE : 0;
+    features |= ((data[2] >> 25) & 1) ? HOST_FEATURE_AESNI : 0;
+    features |= ((data[2] >> 28) & 1) && hasYmmState ? HOST_FEATURE_AVX : 0;
+    if (maxLeaf >= 0x00000007) {
+        getCpuid(data, 0x00000007, 0);
+        features |= ((data[1] >>  5) & 1) && hasYmmState ? HOST_FEATURE_AVX2 : 0;
+        features |= ((data[1] >> 16) & 1) && hasZmmState ? HOST_FEATURE_AVX512 : 0;
+        features |= ((data[1] >>  8) & 1) ? HOST_FEATURE_BMI2 : 0;
+    }
+    if (maxLeafExt >= 0x80000001) {
+        getCpuid(data, 0x80000001);
+        features |= ((data[2] >>  5) & 1) ? HOST_FEATURE_LZCNT : 0;
+    }
+    return features;
+}
+#endif
+
+U32 getHostFeatures() {
+#ifdef NUCLEUS_ARCH_X86
+    static const U32 features = detectHostFeatures();
+    return features;
+#else
+    return 0;
+#endif
+}
+
 Host::Host() {
     initialize();
 }
@@ -23,6 +95,22 @@ void Host::initialize() {
 }
 
 void Host::initCPU() {
+    cpu.features = getHostFeatures();
+#ifdef NUCLEUS_ARCH_X86
+    // Processor brand string, padded with spaces by some vendors
+    U32 data[4];
+    getCpuid(data, 0x80000000);
+    if (data[0] >= 0x80000004) {
+        char brand[49] = {};
+        for (U32 i = 0; i < 3; i++) {
+            getCpuid(data, 0x80000002 + i);
+            std::memcpy(brand + 16 * i, data, 16);
+        }
+        cpu.name = brand;
+        cpu.name.erase(0, cpu.name.find_first_not_of(' '));
+        cpu.name.erase(cpu.name.find_last_not_of(' ') + 1);
+    }
+#endif
 }
 
 void Host::initGPU() {
@@ -11,6 +11,35 @@
 
 namespace core {
 
+// Features of the host CPU checked by specialized code paths
+enum HostFeature {
+    HOST_FEATURE_SSSE3  = (1 << 0),  // Supplemental Streaming SIMD Extensions 3
+    HOST_FEATURE_SSE41  = (1 << 1),  // Streaming SIMD Extensions 4.1
+    HOST_FEATURE_AVX    = (1 << 2),  // Advanced Vector Extensions
+    HOST_FEATURE_AVX2   = (1 << 3),  // Advanced Vector Extensions 2
+    HOST_FEATURE_AVX512 = (1 << 4),  // Advanced Vector Extensions 512 (Foundation)
+    HOST_FEATURE_BMI2   = (1 << 5),  // Bit Manipulation Instructions 2
+    HOST_FEATURE_LZCNT  = (1 << 6),  // Leading Zeros Count
+    HOST_FEATURE_MOVBE  = (1 << 7),  // Move Data After Swapping Bytes
+    HOST_FEATURE_AESNI  = (1 << 8),  // AES New Instructions
+};
+
+/**
+ * Get the features supported by the host CPU, detected once on the first call.
+ * AVX-class features are only reported if the OS saves their register state.
+ * @return  Mask of HostFeature values
+ */
+U32 getHostFeatures();
+
+/**
+ * Check whether the host CPU supports a feature
+ * @param[in]  feature  Feature to check
+ * @return              True if supported
+ */
+inline bool hasHostFeature(HostFeature feature) {
+    return (getHostFeatures() & feature) != 0;
+}
+
 /**
  * Host
  * ====
@@ -30,6 +59,7 @@ public:
     // CPU Information
     struct CPU {
         std::string name;
+        U32 features;  // Mask of HostFeature values
     };
 
     // GPU Information
@@ -0,0 +1,70 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#include "worker_pool.h"
+
+namespace core {
+
+WorkerPool::WorkerPool(Size threadCount) {
+    if (threadCount == 0) {
+        threadCount = std::thread::hardware_concurrency();
+    }
+    if (threadCount == 0) {
+        threadCount = 1;
+    }
+    for (Size i = 0; i < threadCount; i++) {
+        workers.emplace_back(&WorkerPool::work, this);
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        pending -= tasks.size();
+        tasks.clear();
+    }
+    cvTask.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void WorkerPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+        pending += 1;
+    }
+    cvTask.notify_one();
+}
+
+void WorkerPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    cvIdle.wait(lock, [this] { return pending == 0; });
+}
+
+void WorkerPool::work() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cvTask.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (stopping) {
+                return;
+            }
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending -= 1;
+        }
+        cvIdle.notify_all();
+    }
+}
+
+}  // namespace core
@@ -0,0 +1,64 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/common.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace core {
+
+/**
+ * Worker Pool
+ * ===========
+ * Fixed set of host threads running queued tasks in submission order.
+ * Destroying the pool discards the queued tasks and waits for the running ones.
+ */
+class WorkerPool {
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable cvTask;
+    std::condition_variable cvIdle;
+
+    // Number of tasks queued or running
+    Size pending = 0;
+    bool stopping = false;
+
+    // Worker thread entry point
+    void work();
+
+public:
+    /**
+     * Constructor
+     * @param[in]  threadCount  Number of worker threads, or 0 to use one per host core
+     */
+    WorkerPool(Size threadCount = 0);
+    ~WorkerPool();
+
+    /**
+     * Queue a task to be run by any worker
+     * @param[in]  task  Function to run
+     */
+    void submit(std::function<void()> task);
+
+    /**
+     * Block until every submitted task has finished
+     */
+    void wait();
+
+    // Get the number of worker threads
+    Size getThreadCount() const {
+        return workers.size();
+    }
+};
+
+}  // namespace core
@@ -0,0 +1,369 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#include "cache.h"
+#include "nucleus/core/hash.h"
+#include "nucleus/logger/logger.h"
+#include "nucleus/cpu/backend/compiler.h"
+#include "nucleus/cpu/frontend/frontend_function.h"
+#include "nucleus/cpu/hir/block.h"
+#include "nucleus/cpu/hir/instruction.h"
+#include "nucleus/filesystem/filesystem_host.h"
+#include "nucleus/memory/guest_virtual/guest_virtual_memory.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+#if defined(NUCLEUS_TARGET_WINDOWS)
+#include <Windows.h>
+#elif defined(NUCLEUS_TARGET_LINUX)
+#include <sys/stat.h>
+#elif defined(NUCLEUS_TARGET_OSX)
+#include <mach-o/dyld.h>
+#include <sys/stat.h>
+#endif
+
+namespace cpu {
+namespace backend {
+
+using namespace cpu::hir;
+
+// Cache file format
+enum : U32 {
+    CACHE_MAGIC    = 0x48434E4E,  // "NNCH"
+    CACHE_VERSION  = 3,
+};
+
+struct CacheHeader {
+    U32 magic;
+    U32 version;
+    U64 targetKey;    // Compiler settings and host extensions used to generate the code
+    U64 imageKey;     // Identifies the executable whose addresses were used as relocation anchor
+};
+
+struct CacheRecord {
+    U32 address;
+    U32 rangeCount;
+    U64 hash;
+    U32 codeSize;
+    U32 relocCount;
+};
+
+// Host addresses of the executable image are stored relative to this anchor
+static U64 getImageAnchor() {
+    return reinterpret_cast<U64>(&getImageAnchor);
+}
+
+// Fingerprint of the running executable, since relocations only survive within the same binary
+static U64 getImageKey() {
+    U64 fileSize = 0;
+    U64 fileTime = 0;
+#if defined(NUCLEUS_TARGET_WINDOWS)
+    char path[MAX_PATH];
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (GetModuleFileNameA(NULL, path, sizeof(path)) && GetFileAttributesExA(path, GetFileExInfoStandard, &data)) {
+        fileSize = (U64(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+        fileTime = (U64(data.ftLastWriteTime.dwHighDateTime) << 32) | data.ftLastWriteTime.dwLowDateTime;
+    }
+#elif defined(NUCLEUS_TARGET_LINUX)
+    struct stat info;
+    if (stat("/proc/self/exe", &info) == 0) {
+        fileSize = info.st_size;
+        fileTime = info.st_mtime;
+    }
+#elif defined(NUCLEUS_TARGET_OSX)
+    char path[4096];
+    uint32_t pathSize = sizeof(path);
+    struct stat info;
+    if (_NSGetExecutablePath(path, &pathSize) == 0 && stat(path, &info) == 0) {
+        fileSize = info.st_size;
+        fileTime = info.st_mtime;
+    }
+#endif
+    CacheHash hash = core::hashBytes(&fileSize, sizeof(fileSize));
+    return core::hashBytes(&fileTime, sizeof(fileTime), hash);
+}
+
+CodeCache::CodeCache(Compiler* compiler, const std::string& directory, const std::string& name) : compiler(compiler) {
+    if (!fs::HostFileSystem::createDirectory(directory)) {
+        logger.warning(LOG_CPU, "Could not create cache directory: %s", directory.c_str());
+    }
+    path = directory + "/" + name + ".cache";
+    writable = load();
+}
+
+bool CodeCache::load() {
+    CacheHeader header;
+    if (fs::HostFileSystem::existsFile(path)) {
+        auto file = fs::HostFileSystem::openFile(path, fs::Read);
+        if (!file) {
+            logger.warning(LOG_CPU, "Could not open code cache: %s", path.c_str());
+            return false;
+        }
+
+        // Validate header
+        const auto fileSize = file->attributes().size;
+        if (file->read(&header, sizeof(header)) == sizeof(header) &&
+            header.magic == CACHE_MAGIC &&
+            header.version == CACHE_VERSION &&
+            header.targetKey == compiler->getTargetKey() &&
+            header.imageKey == getImageKey()) {
+            // Read records until the end of the file or the first truncated record
+            CacheRecord record;
+            while (Size(file->tell()) + sizeof(record) <= fileSize) {
+                if (file->read(&record, sizeof(record)) != sizeof(record)) {
+                    break;
+                }
+                CacheEntry entry;
+                entry.address = record.address;
+                entry.hash = record.hash;
+                entry.ranges.resize(record.rangeCount);
+                entry.code.resize(record.codeSize);
+                entry.relocations.resize(record.relocCount);
+                const Size rangesSize = record.rangeCount * sizeof(CodeRange);
+                const Size relocsSize = record.relocCount * sizeof(Relocation);
+                if (Size(file->tell()) + rangesSize + record.codeSize + relocsSize > fileSize) {
+                    logger.warning(LOG_CPU, "Code cache is truncated: %s", path.c_str());
+                    break;
+                }
+                file->read(entry.ranges.data(), rangesSize);
+                file->read(entry.code.data(), record.codeSize);
+                file->read(entry.relocations.data(), relocsSize);
+                entries.emplace(entry.address, std::move(entry));
+            }
+            logger.notice(LOG_CPU, "Loaded %d entries from code cache: %s", U32(entries.size()), path.c_str());
+            return true;
+        }
+        logger.notice(LOG_CPU, "Discarding outdated code cache: %s", path.c_str());
+    }
+
+    // Create a new cache file
+    auto file = fs::HostFileSystem::openFile(path, fs::Write);
+    if (!file) {
+        logger.warning(LOG_CPU, "Could not create code cache: %s", path.c_str());
+        return false;
+    }
+    header.magic = CACHE_MAGIC;
+    header.version = CACHE_VERSION;
+    header.targetKey = compiler->getTargetKey();
+    header.imageKey = getImageKey();
+    return file->write(&header, sizeof(header)) == sizeof(header);
+}
+
+bool CodeCache::append(const CacheEntry& entry) {
+    auto file = fs::HostFileSystem::openFile(path, fs::WriteAppend);
+    if (!file) {
+        return false;
+    }
+    CacheRecord record;
+    record.address = entry.address;
+    record.rangeCount = entry.ranges.size();
+    record.hash = entry.hash;
+    record.codeSize = entry.code.size();
+    record.relocCount = entry.relocations.size();
+    file->write(&record, sizeof(record));
+    file->write(entry.ranges.data(), entry.ranges.size() * sizeof(CodeRange));
+    file->write(entry.code.data(), entry.code.size());
+    file->write(entry.relocations.data(), entry.relocations.size() * sizeof(Relocation));
+    return true;
+}
+
+bool CodeCache::findRelocation(U64 value, const std::function<bool(hir::Function*, U32&)>& resolveGuest,
+        const std::vector<hir::Function*>& guestCallees, Relocation& reloc) const {
+    for (auto* callee : guestCallees) {
+        U32 address;
+        if (reinterpret_cast<U64>(callee) == value && resolveGuest(callee, address)) {
+            reloc.type = RELOCATION_GUEST;
+            reloc.target = address;
+            return true;
+        }
+        if (reinterpret_cast<U64>(callee->nativeAddress) == value && resolveGuest(callee, address)) {
+            reloc.type = RELOCATION_LINK;
+            reloc.target = address;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CodeCache::lookup(hir::Function* function, U32 address, const U08* guestBase,
+        const std::function<hir::Function*(U32)>& resolveGuest) {
+    std::unique_lock<std::mutex> lock(mutex);
+    auto range = entries.equal_range(address);
+    for (auto it = range.first; it != range.second; it++) {
+        const auto& entry = it->second;
+
+        // Validate guest code
+        CacheHash hash = core::HASH_SEED;
+        for (const auto& codeRange : entry.ranges) {
+            hash = core::hashBytes(guestBase + codeRange.address, codeRange.size, hash);
+        }
+        if (hash != entry.hash) {
+            continue;
+        }
+
+        // Resolve host relocations
+        std::vector<U08> code = entry.code;
+        std::vector<Relocation> guestRelocations;
+        for (const auto& reloc : entry.relocations) {
+            U64 value = 0;
+            switch (reloc.type) {
+            case RELOCATION_HOST:
+                value = getImageAnchor() + reloc.target;
+                break;
+            case RELOCATION_GUEST:
+            case RELOCATION_LINK:
+                guestRelocations.push_back(reloc);
+                continue;
+            default:
+                logger.error(LOG_CPU, "Unknown relocation type in code cache");
+                return false;
+            }
+            if (!value || reloc.offset + sizeof(U64) > code.size()) {
+                return false;
+            }
+            memcpy(&code[reloc.offset], &value, sizeof(U64));
+        }
+
+        // Resolve guest relocations without holding the lock, since declaring callees might compile code
+        lock.unlock();
+        std::vector<std::pair<U32, hir::Function*>> links;
+        for (const auto& reloc : guestRelocations) {
+            hir::Function* callee = resolveGuest(U32(reloc.target));
+            if (!callee || reloc.offset + sizeof(U64) > code.size()) {
+                return false;
+            }
+            U64 value = reinterpret_cast<U64>(callee);
+            if (reloc.type == RELOCATION_LINK) {
+                value = reinterpret_cast<U64>(callee->nativeAddress);
+                links.emplace_back(reloc.offset, callee);
+            }
+            memcpy(&code[reloc.offset], &value, sizeof(U64));
+        }
+
+        // Install compiled code
+        void* nativeAddress = compiler->allocCode(code.size());
+        if (!nativeAddress) {
+            return false;
+        }
+        compiler->writeCode(nativeAddress, code.data(), code.size());
+        std::atomic_thread_fence(std::memory_order_release);
+        function->nativeSize = code.size();
+        function->nativeAddress = nativeAddress;
+        for (const auto& link : links) {
+            compiler->addLink(static_cast<U08*>(nativeAddress) + link.first, link.second);
+        }
+        compiler->updateLinks(function);
+        function->flags |= FUNCTION_IS_COMPILED;
+        return true;
+    }
+    return false;
+}
+
+bool CodeCache::store(hir::Function* function, U32 address, const std::vector<CodeRange>& ranges, const U08* guestBase,
+        const std::function<bool(hir::Function*, U32&)>& resolveGuest) {
+    // Only JIT code reaches guest callees through relocatable links
+    if (!writable || !compiler->settings.isJIT || !(function->flags & FUNCTION_IS_COMPILED)) {
+        return false;
+    }
+
+    // Gather the absolute host addresses that the compiled code might embed
+    std::vector<U64> externAddresses;
+    std::vector<hir::Function*> guestCallees;
+    for (const auto* block : function->blocks) {
+        for (const auto* instr : block->instructions) {
+            const auto& info = opcodeInfo[instr->opcode];
+            const U08 sigs[] = { info.getSignatureSrc1(), info.getSignatureSrc2(), info.getSignatureSrc3() };
+            const Instruction::Operand* srcs[] = { &instr->src1, &instr->src2, &instr->src3 };
+            for (Size i = 0; i < 3; i++) {
+                if (sigs[i] == OPCODE_SIG_TYPE_F) {
+                    auto* callee = srcs[i]->function;
+                    if (callee->flags & FUNCTION_IS_EXTERN) {
+                        externAddresses.push_back(reinterpret_cast<U64>(callee->nativeAddress));
+                    } else {
+                        guestCallees.push_back(callee);
+                    }
+                }
+            }
+        }
+    }
+
+    // Build the entry, turning every embedded address into a relocation
+    CacheEntry entry;
+    entry.address = address;
+    entry.ranges = ranges;
+    entry.hash = core::HASH_SEED;
+    for (const auto& codeRange : ranges) {
+        entry.hash = core::hashBytes(guestBase + codeRange.address, codeRange.size, entry.hash);
+    }
+    const U08* code = static_cast<const U08*>(function->nativeAddress);
+    entry.code.assign(code, code + function->nativeSize);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (U32 offset = 0; offset + sizeof(U64) <= entry.code.size(); offset++) {
+        U64 value;
+        memcpy(&value, &entry.code[offset], sizeof(U64));
+        Relocation reloc;
+        reloc.offset = offset;
+        if (std::find(externAddresses.begin(), externAddresses.end(), value) != externAddresses.end()) {
+            reloc.type = RELOCATION_HOST;
+            reloc.target = value - getImageAnchor();
+        } else if (!findRelocation(value, resolveGuest, guestCallees, reloc)) {
+            continue;
+        }
+        // Zero the immediate so stale addresses never leak into the file
+        memset(&entry.code[offset], 0, sizeof(U64));
+        entry.relocations.push_back(reloc);
+        offset += sizeof(U64) - 1;
+    }
+
+    if (!append(entry)) {
+        logger.warning(LOG_CPU, "Could not write to code cache: %s", path.c_str());
+        writable = false;
+        return false;
+    }
+    entries.emplace(address, std::move(entry));
+    return true;
+}
+
+// Get the host pointer to the guest address 0 of the memory where a frontend function lives
+static const U08* getGuestBase(const frontend::Function* function) {
+    auto* memory = dynamic_cast<mem::GuestVirtualMemory*>(function->parent->parent->getMemory());
+    return memory ? static_cast<const U08*>(memory->getBaseAddr()) : nullptr;
+}
+
+bool CodeCache::lookup(frontend::Function* function, const std::function<hir::Function*(U32)>& resolveGuest) {
+    const U08* guestBase = getGuestBase(function);
+    if (!guestBase) {
+        return false;
+    }
+    return lookup(function->hirFunction, U32(function->address), guestBase, resolveGuest);
+}
+
+bool CodeCache::store(frontend::Function* function, std::mutex* functionsMutex) {
+    const U08* guestBase = getGuestBase(function);
+    if (!guestBase) {
+        return false;
+    }
+    const auto* module = function->parent;
+    return store(function->hirFunction, U32(function->address), function->getCodeRanges(), guestBase,
+        [module, functionsMutex](hir::Function* callee, U32& addr) {
+            std::unique_lock<std::mutex> lock;
+            if (functionsMutex) {
+                lock = std::unique_lock<std::mutex>(*functionsMutex);
+            }
+            for (const auto& item : module->functions) {
+                if (item.second->hirFunction == callee) {
+                    addr = U32(item.first);
+                    return true;
+                }
+            }
+            return false;
+        });
+}
+
+}  // namespace backend
+}  // namespace cpu
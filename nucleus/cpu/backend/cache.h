@@ -0,0 +1,134 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/common.h"
+#include "nucleus/cpu/hir/function.h"
+
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// Forward declarations
+namespace cpu { namespace frontend { class Function; }}
+
+namespace cpu {
+namespace backend {
+
+// Forward declarations
+class Compiler;
+
+using CacheHash = U64;
+
+enum RelocationType : U32 {
+    RELOCATION_HOST = 1,    // Address inside the host executable image, relative to the image anchor
+    RELOCATION_GUEST,       // Address of the hir::Function translated from the given guest address
+    RELOCATION_LINK,        // Direct call to the native code of the function at the given guest address
+};
+
+struct Relocation {
+    RelocationType type;
+    U32 offset;             // Offset of the 64-bit immediate inside the compiled code
+    U64 target;             // Image offset or guest address depending on the type
+};
+
+struct CodeRange {
+    U32 address;            // Guest address of the range
+    U32 size;               // Size in bytes of the range
+};
+
+struct CacheEntry {
+    U32 address;                        // Guest address of the function entry
+    CacheHash hash;                     // Hash of the guest bytes covered by the ranges
+    std::vector<CodeRange> ranges;      // Guest code this entry was translated from
+    std::vector<U08> code;              // Position-independent compiled code
+    std::vector<Relocation> relocations;
+};
+
+/**
+ * Code Cache
+ * ==========
+ * Persistent on-disk storage of compiled guest functions. Entries are keyed by the guest
+ * entry address and validated against a hash of the guest code they were generated from,
+ * so that modified or self-modifying code never reuses stale translations. Absolute host
+ * addresses embedded in the compiled code are stored as relocations and patched on load.
+ * Runtime addresses such as the guest memory base are never embedded: translated code
+ * loads them from the thread state.
+ */
+class CodeCache {
+    Compiler* compiler;
+    std::mutex mutex;
+
+    // Path to the cache file and whether it can be appended to
+    std::string path;
+    bool writable = false;
+
+    // Entries indexed by guest address (multiple versions may coexist)
+    std::multimap<U32, CacheEntry> entries;
+
+    // Parse the cache file, discarding it if it was created by a different build or host
+    bool load();
+
+    // Append a single entry to the cache file
+    bool append(const CacheEntry& entry);
+
+    // Find the relocation required by an absolute host address, if any
+    bool findRelocation(U64 value, const std::function<bool(hir::Function*, U32&)>& resolveGuest,
+        const std::vector<hir::Function*>& guestCallees, Relocation& reloc) const;
+
+public:
+    /**
+     * Open or create a code cache file
+     * @param[in]  compiler   Compiler whose output is cached, used to build the target key
+     * @param[in]  directory  Directory where the cache file is stored
+     * @param[in]  name       Name identifying the cached code (e.g. "ppu", "spu")
+     */
+    CodeCache(Compiler* compiler, const std::string& directory, const std::string& name);
+
+    /**
+     * Load a compiled function from the cache
+     * @param[in]  function      HIR function that will receive the compiled code
+     * @param[in]  address       Guest address of the function entry
+     * @param[in]  guestBase     Host pointer to the guest address 0
+     * @param[in]  resolveGuest  Callback that returns the HIR function for a guest address
+     * @return                   True if a valid entry was found and installed
+     */
+    bool lookup(hir::Function* function, U32 address, const U08* guestBase,
+        const std::function<hir::Function*(U32)>& resolveGuest);
+
+    /**
+     * Store a compiled function in the cache
+     * @param[in]  function      HIR function already compiled
+     * @param[in]  address       Guest address of the function entry
+     * @param[in]  ranges        Guest code ranges the function was translated from
+     * @param[in]  guestBase     Host pointer to the guest address 0
+     * @param[in]  resolveGuest  Callback that returns the guest address of a HIR function
+     * @return                   True if the function could be cached
+     */
+    bool store(hir::Function* function, U32 address, const std::vector<CodeRange>& ranges, const U08* guestBase,
+        const std::function<bool(hir::Function*, U32&)>& resolveGuest);
+
+    /**
+     * Load a translated guest function from the cache
+     * @param[in]  function      Frontend function whose HIR function receives the compiled code
+     * @param[in]  resolveGuest  Callback that returns the HIR function for a guest address
+     * @return                   True if a valid entry was found and installed
+     */
+    bool lookup(frontend::Function* function, const std::function<hir::Function*(U32)>& resolveGuest);
+
+    /**
+     * Store a translated guest function in the cache
+     * @param[in]  function        Frontend function already compiled
+     * @param[in]  functionsMutex  Mutex guarding the functions of its module, if any
+     * @return                     True if the function could be cached
+     */
+    bool store(frontend::Function* function, std::mutex* functionsMutex = nullptr);
+};
+
+}  // namespace backend
+}  // namespace cpu
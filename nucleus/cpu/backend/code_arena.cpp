@@ -0,0 +1,203 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#include "code_arena.h"
+#include "nucleus/logger/logger.h"
+
+#include <atomic>
+#include <cstring>
+#include <string>
+
+#if defined(NUCLEUS_TARGET_WINDOWS)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+#if defined(NUCLEUS_TARGET_OSX)
+#define MAP_ANONYMOUS MAP_ANON
+#endif
+
+namespace cpu {
+namespace backend {
+
+CodeArena::CodeArena(Size regionSize, bool dualMapping)
+    : regionSize(regionSize), dualMapping(dualMapping) {
+}
+
+CodeArena::~CodeArena() {
+    for (auto& region : regions) {
+        unmapRegion(region);
+    }
+}
+
+bool CodeArena::mapRegion(Region& region, Size size) {
+    region.size = size;
+    region.used = 0;
+    region.handle = nullptr;
+#if defined(NUCLEUS_TARGET_WINDOWS)
+    if (dualMapping) {
+        HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_EXECUTE_READWRITE,
+            DWORD(U64(size) >> 32), DWORD(size), NULL);
+        if (!mapping) {
+            return false;
+        }
+        region.write = static_cast<U08*>(MapViewOfFile(mapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, size));
+        region.exec = static_cast<U08*>(MapViewOfFile(mapping, FILE_MAP_READ | FILE_MAP_EXECUTE, 0, 0, size));
+        region.handle = mapping;
+    } else {
+        region.exec = static_cast<U08*>(VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_EXECUTE_READWRITE));
+        region.write = region.exec;
+    }
+#else
+    if (dualMapping) {
+        // Create an anonymous shared memory object and map it twice
+        static std::atomic<U32> counter;
+        const std::string name = "/nucleus-code-" + std::to_string(getpid()) + "-" + std::to_string(counter++);
+        int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+        if (fd < 0) {
+            return false;
+        }
+        shm_unlink(name.c_str());
+        if (ftruncate(fd, size) != 0) {
+            close(fd);
+            return false;
+        }
+        void* write = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        void* exec = mmap(nullptr, size, PROT_READ | PROT_EXEC, MAP_SHARED, fd, 0);
+        close(fd);
+        region.write = (write == MAP_FAILED) ? nullptr : static_cast<U08*>(write);
+        region.exec = (exec == MAP_FAILED) ? nullptr : static_cast<U08*>(exec);
+    } else {
+        void* addr = mmap(nullptr, size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        region.exec = (addr == MAP_FAILED) ? nullptr : static_cast<U08*>(addr);
+        region.write = region.exec;
+    }
+#endif
+    if (!region.exec || !region.write) {
+        unmapRegion(region);
+        return false;
+    }
+    return true;
+}
+
+void CodeArena::unmapRegion(Region& region) {
+#if defined(NUCLEUS_TARGET_WINDOWS)
+    if (region.handle) {
+        if (region.write) UnmapViewOfFile(region.write);
+        if (region.exec) UnmapViewOfFile(region.exec);
+        CloseHandle(region.handle);
+    } else if (region.exec) {
+        VirtualFree(region.exec, 0, MEM_RELEASE);
+    }
+#else
+    if (region.write && region.write != region.exec) {
+        munmap(region.write, region.size);
+    }
+    if (region.exec) {
+        munmap(region.exec, region.size);
+    }
+#endif
+    region.exec = nullptr;
+    region.write = nullptr;
+}
+
+const CodeArena::Region* CodeArena::findRegion(const void* addr) const {
+    const U08* ptr = static_cast<const U08*>(addr);
+    for (const auto& region : regions) {
+        if (region.exec <= ptr && ptr < region.exec + region.size) {
+            return &region;
+        }
+    }
+    return nullptr;
+}
+
+void* CodeArena::alloc(Size size) {
+    std::lock_guard<std::mutex> lock(mutex);
+    size = (size + CODE_ALIGNMENT - 1) & ~(CODE_ALIGNMENT - 1);
+
+    // Reuse the smallest freed block that fits
+    auto it = freeList.lower_bound(size);
+    if (it != freeList.end()) {
+        U08* addr = it->second;
+        allocations[addr] = it->first;
+        freeList.erase(it);
+        return addr;
+    }
+
+    // Bump-allocate in the last region, mapping a new one if required
+    if (regions.empty() || regions.back().used + size > regions.back().size) {
+        const Size mapSize = (size > regionSize) ? size : regionSize;
+        Region region;
+        if (!mapRegion(region, mapSize)) {
+            logger.error(LOG_CPU, "Could not map %d bytes of executable memory", U32(mapSize));
+            return nullptr;
+        }
+        regions.push_back(region);
+    }
+    auto& region = regions.back();
+    U08* addr = region.exec + region.used;
+    region.used += size;
+    allocations[addr] = size;
+    return addr;
+}
+
+Size CodeArena::free(void* addr) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = allocations.find(static_cast<U08*>(addr));
+    if (it == allocations.end()) {
+        logger.error(LOG_CPU, "Freeing memory not owned by the code arena");
+        return 0;
+    }
+    const Size size = it->second;
+    freeList.emplace(size, it->first);
+    allocations.erase(it);
+    return size;
+}
+
+void* CodeArena::getWritable(void* addr) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const Region* region = findRegion(addr);
+    if (!region) {
+        return nullptr;
+    }
+    return region->write + (static_cast<U08*>(addr) - region->exec);
+}
+
+void CodeArena::write(void* dst, const void* src, Size size) {
+    void* writable = getWritable(dst);
+    if (!writable) {
+        logger.error(LOG_CPU, "Writing memory not owned by the code arena");
+        return;
+    }
+    memcpy(writable, src, size);
+#if defined(NUCLEUS_TARGET_WINDOWS)
+    FlushInstructionCache(GetCurrentProcess(), dst, size);
+#elif !defined(NUCLEUS_ARCH_X86)
+    __builtin___clear_cache(static_cast<char*>(dst), static_cast<char*>(dst) + size);
+#endif
+}
+
+CodeArenaStats CodeArena::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    CodeArenaStats stats = {};
+    stats.regions = regions.size();
+    for (const auto& region : regions) {
+        stats.capacity += region.size;
+        stats.used += region.used;
+    }
+    for (const auto& item : allocations) {
+        stats.live += item.second;
+    }
+    for (const auto& item : freeList) {
+        stats.available += item.first;
+    }
+    stats.allocations = allocations.size();
+    return stats;
+}
+
+}  // namespace backend
+}  // namespace cpu
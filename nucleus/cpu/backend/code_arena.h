@@ -0,0 +1,108 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/common.h"
+#include "nucleus/literals.h"
+
+#include <map>
+#include <mutex>
+#include <vector>
+
+namespace cpu {
+namespace backend {
+
+// Alignment of every allocation, matching the instruction fetch block size
+constexpr Size CODE_ALIGNMENT = 16;
+
+struct CodeArenaStats {
+    Size regions;      // Number of mapped regions
+    Size capacity;     // Bytes mapped across all regions
+    Size used;         // Bytes consumed by the bump allocator
+    Size live;         // Bytes currently owned by allocations
+    Size available;    // Bytes held in the free list, ready for reuse
+    Size allocations;  // Number of live allocations
+};
+
+/**
+ * Code Arena
+ * ==========
+ * Allocator for compiled host code. Code is placed in large regions mapped once with
+ * execution permissions, using bump-pointer allocation so that functions compiled
+ * together stay close in memory. Freed blocks are recycled through a size-indexed
+ * free list. Optionally, each region is mapped twice (writable and executable views
+ * of the same pages) so that no page is ever both writable and executable.
+ */
+class CodeArena {
+    struct Region {
+        U08* exec;       // Executable view
+        U08* write;      // Writable view (equal to exec without dual mapping)
+        Size size;
+        Size used;
+        void* handle;    // Shared memory object backing both views
+    };
+
+    std::mutex mutex;
+    std::vector<Region> regions;
+
+    // Live allocations (executable address to size) and free blocks (size to address)
+    std::map<U08*, Size> allocations;
+    std::multimap<Size, U08*> freeList;
+
+    const Size regionSize;
+    const bool dualMapping;
+
+    bool mapRegion(Region& region, Size size);
+    void unmapRegion(Region& region);
+    const Region* findRegion(const void* addr) const;
+
+public:
+    /**
+     * Constructor
+     * @param[in]  regionSize   Size of each mapped region
+     * @param[in]  dualMapping  Use separate writable and executable views (W^X)
+     */
+    CodeArena(Size regionSize = 32_MB, bool dualMapping = false);
+    ~CodeArena();
+
+    /**
+     * Allocate executable memory
+     * @param[in]  size  Number of bytes to allocate
+     * @return           Executable address of the block, or nullptr on failure
+     */
+    void* alloc(Size size);
+
+    /**
+     * Return a block to the free list
+     * @param[in]  addr  Executable address returned by alloc
+     * @return           Size of the block, or 0 if it is not owned by the arena
+     */
+    Size free(void* addr);
+
+    /**
+     * Copy code into a block
+     * @param[in]  dst   Executable address inside a block returned by alloc
+     * @param[in]  src   Host buffer containing the code
+     * @param[in]  size  Number of bytes to copy
+     */
+    void write(void* dst, const void* src, Size size);
+
+    /**
+     * Get the writable view of an executable address
+     * @param[in]  addr  Executable address inside a block returned by alloc
+     * @return           Writable address aliasing the same memory
+     */
+    void* getWritable(void* addr);
+
+    /**
+     * Get the current occupancy of the arena
+     * @return  Snapshot of the mapped, used and free bytes
+     */
+    CodeArenaStats getStats();
+};
+
+}  // namespace backend
+}  // namespace cpu
@@ -6,17 +6,7 @@
 #include "compiler.h"
 #include "nucleus/logger/logger.h"
 
-#ifdef NUCLEUS_TARGET_WINDOWS
-#include <Windows.h>
-#endif
-#ifdef NUCLEUS_TARGET_LINUX
-#include <unistd.h>
-#include <sys/mman.h>
-#endif
-#ifdef NUCLEUS_TARGET_OSX
-#include <sys/mman.h>
-#define MAP_ANONYMOUS MAP_ANON
-#endif
+#include <algorithm>
 
 namespace cpu {
 namespace backend {
@@ -28,14 +18,17 @@ Compiler::Compiler() {
     settings.isCached = true;
     settings.isJIT = true;
     settings.isAOT = false;
+    settings.isWXEnforced = false;
+
+    codeArena = std::make_unique<CodeArena>(32_MB, settings.isWXEnforced);
 }
 
 Compiler::Compiler(const Settings& settings) : settings(settings) {
+    codeArena = std::make_unique<CodeArena>(32_MB, settings.isWXEnforced);
 }
 
 bool Compiler::optimize(Function* function) {
-    // TODO: Run passes in parallel
-    std::lock_guard<std::mutex> lock(pass_mutex);
+    // Passes keep no state, so different functions can be optimized concurrently
     for (auto& pass : passes) {
         if (!pass->run(function)) {
             logger.error(LOG_CPU, "Could not run pass: %s", pass->name());
@@ -49,31 +42,57 @@ void Compiler::addPass(std::unique_ptr<Pass> pass) {
     passes.push_back(std::move(pass));
 }
 
-void* Compiler::allocRWXMemory(Size size) {
-    void* addr = malloc(size);
+U64 Compiler::getTargetKey() const {
+    U64 key = 0;
+    key |= settings.isJIT ? (1 << 0) : 0;
+    key |= settings.isAOT ? (1 << 1) : 0;
+    return key;
+}
 
-    // Enable execution permissions
-#ifdef NUCLEUS_TARGET_WINDOWS
-    DWORD oldProtect;
-    if (!VirtualProtect(addr, size, PAGE_EXECUTE_READWRITE, &oldProtect)) {
-        logger.error(LOG_CPU, "Could not allocate %d bytes of RWX memory", size);
-        return nullptr;
+void* Compiler::allocCode(Size size) {
+    void* addr = codeArena->alloc(size);
+    if (!addr) {
+        logger.error(LOG_CPU, "Could not allocate %d bytes of executable memory", U32(size));
     }
-#endif
-#ifdef NUCLEUS_TARGET_LINUX
-    size_t pageSize = sysconf(_SC_PAGESIZE);
-    size_t iaddr = reinterpret_cast<size_t>(addr);
-    size_t roundedAddr = iaddr & ~(pageSize - 1);
-    if (!mprotect(reinterpret_cast<void*>(roundedAddr), size + (iaddr - roundedAddr), PROT_READ | PROT_WRITE | PROT_EXEC)) {
-        logger.error(LOG_CPU, "Could not allocate %d bytes of RWX memory", size);
-        return nullptr;
-    }
-#endif
     return addr;
 }
 
-void Compiler::freeRWXMemory(void* addr) {
-    free(addr);
+void Compiler::freeCode(void* addr) {
+    const Size size = codeArena->free(addr);
+
+    // Forget the call sites inside the block, otherwise relinking would patch reused memory
+    std::lock_guard<std::mutex> lock(link_mutex);
+    const auto* begin = static_cast<const U08*>(addr);
+    for (auto& item : links) {
+        auto& sites = item.second;
+        sites.erase(std::remove_if(sites.begin(), sites.end(), [&](const void* site) {
+            return begin <= site && site < begin + size;
+        }), sites.end());
+    }
+}
+
+void Compiler::writeCode(void* dst, const void* src, Size size) {
+    codeArena->write(dst, src, size);
+}
+
+void Compiler::addLink(void* site, const hir::Function* target) {
+    std::lock_guard<std::mutex> lock(link_mutex);
+    auto* writable = static_cast<volatile U64*>(codeArena->getWritable(site));
+    *writable = reinterpret_cast<U64>(target->nativeAddress);
+    links[target].push_back(site);
+}
+
+void Compiler::updateLinks(const hir::Function* target) {
+    std::lock_guard<std::mutex> lock(link_mutex);
+    auto it = links.find(target);
+    if (it == links.end()) {
+        return;
+    }
+    // Aligned 8-byte stores are atomic, so threads running the caller see either target
+    for (void* site : it->second) {
+        auto* writable = static_cast<volatile U64*>(codeArena->getWritable(site));
+        *writable = reinterpret_cast<U64>(target->nativeAddress);
+    }
 }
 
 }  // namespace backend
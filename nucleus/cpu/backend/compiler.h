@@ -6,6 +6,7 @@
 #pragma once
 
 #include "nucleus/common.h"
+#include "nucleus/cpu/backend/code_arena.h"
 #include "nucleus/cpu/backend/settings.h"
 #include "nucleus/cpu/backend/target.h"
 #include "nucleus/cpu/hir/block.h"
@@ -16,6 +17,7 @@
 
 #include <memory>
 #include <mutex>
+#include <unordered_map>
 #include <vector>
 
 namespace cpu {
@@ -24,7 +26,10 @@ namespace backend {
 class Compiler {
     // Compiler passes
     std::vector<std::unique_ptr<hir::Pass>> passes;
-    std::mutex pass_mutex;
+
+    // Executable addresses of the 64-bit call targets pointing to each function
+    std::unordered_map<const hir::Function*, std::vector<void*>> links;
+    std::mutex link_mutex;
 
 protected:
     // Optimize HIR
@@ -37,6 +42,9 @@ public:
     // Generic target information
     TargetInfo targetInfo;
 
+    // Executable memory holding the compiled code
+    std::unique_ptr<CodeArena> codeArena;
+
     // Constructor
     Compiler();
     Compiler(const Settings& settings);
@@ -57,9 +65,30 @@ public:
      */
     virtual bool call(hir::Function* function, void* state, const std::vector<hir::Value*>& args = {}) = 0;
 
-    // Manage RWX memory
-    void* allocRWXMemory(Size size);
-    void freeRWXMemory(void* addr);
+    /**
+     * Identifies the code generated by this compiler, so that cached code is only reused
+     * by compilers with the same settings running on hosts with the same capabilities
+     * @return  Key of the current compiler configuration
+     */
+    virtual U64 getTargetKey() const;
+
+    // Manage executable memory
+    void* allocCode(Size size);
+    void freeCode(void* addr);
+    void writeCode(void* dst, const void* src, Size size);
+
+    /**
+     * Register a direct call site, making it point to the current code of the target
+     * @param[in]  site    Executable address of the 8-byte aligned call target
+     * @param[in]  target  Function being called
+     */
+    void addLink(void* site, const hir::Function* target);
+
+    /**
+     * Patch every call site of a function after its code was replaced
+     * @param[in]  target  Function whose native address changed
+     */
+    void updateLinks(const hir::Function* target);
 };
 
 }  // namespace backend
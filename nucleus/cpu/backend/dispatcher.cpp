@@ -0,0 +1,51 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#include "dispatcher.h"
+
+namespace cpu {
+namespace backend {
+
+Dispatcher::Dispatcher() {
+    directory = std::make_unique<std::atomic<Page*>[]>(DIRECTORY_ENTRIES);
+    for (Size i = 0; i < DIRECTORY_ENTRIES; i++) {
+        directory[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+Dispatcher::~Dispatcher() {
+    for (Size i = 0; i < DIRECTORY_ENTRIES; i++) {
+        delete directory[i].load(std::memory_order_relaxed);
+    }
+}
+
+void Dispatcher::insert(U32 addr, hir::Function* function) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& entry = directory[addr >> PAGE_BITS];
+    Page* page = entry.load(std::memory_order_relaxed);
+    if (!page) {
+        page = new Page();
+        for (auto& item : *page) {
+            item.store(nullptr, std::memory_order_relaxed);
+        }
+        entry.store(page, std::memory_order_release);
+    }
+    (*page)[(addr & ((1 << PAGE_BITS) - 1)) >> 2].store(function, std::memory_order_release);
+}
+
+void Dispatcher::clear() {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (Size i = 0; i < DIRECTORY_ENTRIES; i++) {
+        Page* page = directory[i].load(std::memory_order_relaxed);
+        if (page) {
+            for (auto& item : *page) {
+                item.store(nullptr, std::memory_order_release);
+            }
+        }
+    }
+}
+
+}  // namespace backend
+}  // namespace cpu
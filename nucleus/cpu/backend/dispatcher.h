@@ -0,0 +1,67 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/common.h"
+#include "nucleus/cpu/hir/function.h"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <mutex>
+
+namespace cpu {
+namespace backend {
+
+/**
+ * Dispatcher
+ * ==========
+ * Two-level table mapping 32-bit guest addresses of 4-byte aligned instructions to the
+ * HIR functions whose entry is at that address. Lookups are lock-free and take two loads,
+ * replacing the linear search through the guest modules on every dispatch.
+ */
+class Dispatcher {
+    static constexpr Size PAGE_BITS = 16;
+    static constexpr Size PAGE_ENTRIES = (1 << PAGE_BITS) / 4;
+    static constexpr Size DIRECTORY_ENTRIES = (1ULL << 32) >> PAGE_BITS;
+
+    using Page = std::array<std::atomic<hir::Function*>, PAGE_ENTRIES>;
+
+    std::unique_ptr<std::atomic<Page*>[]> directory;
+    std::mutex mutex;
+
+public:
+    Dispatcher();
+    ~Dispatcher();
+
+    /**
+     * Find the function starting at a guest address
+     * @param[in]  addr  Guest address
+     * @return           HIR function, or nullptr if it has not been declared yet
+     */
+    hir::Function* lookup(U32 addr) const {
+        const Page* page = directory[addr >> PAGE_BITS].load(std::memory_order_acquire);
+        if (!page) {
+            return nullptr;
+        }
+        return (*page)[(addr & ((1 << PAGE_BITS) - 1)) >> 2].load(std::memory_order_acquire);
+    }
+
+    /**
+     * Register the function starting at a guest address
+     * @param[in]  addr      Guest address
+     * @param[in]  function  HIR function
+     */
+    void insert(U32 addr, hir::Function* function);
+
+    /**
+     * Remove every registered function
+     */
+    void clear();
+};
+
+}  // namespace backend
+}  // namespace cpu
@@ -14,6 +14,7 @@ struct Settings {
     bool isCached;
     bool isJIT;
     bool isAOT;
+    bool isWXEnforced;  // Never map code memory as writable and executable at the same time
 };
 
 }  // namespace backend
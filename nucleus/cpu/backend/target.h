@@ -22,6 +22,7 @@ struct RegisterSet {
     U32 types;
 
     std::vector<int> valueIndex;
+    std::vector<int> volatileIndex;  // Value registers not preserved across calls
     std::vector<int> argIndex;
     int retIndex;
 };
@@ -8,14 +8,8 @@
 #include "nucleus/logger/logger.h"
 #include "nucleus/cpu/backend/x86/x86_sequences.h"
 
-#ifdef NUCLEUS_ARCH_X86
-#ifdef NUCLEUS_COMPILER_MSVC
-#include <intrin.h>
-#else
-#include <x86intrin.h>
-#endif
-#endif
-
+#include <algorithm>
+#include <atomic>
 #include <cstring>
 #include <queue>
 
@@ -34,40 +28,51 @@ X86Compiler::X86Compiler(const Settings& settings) : Compiler(settings) {
 }
 
 void X86Compiler::setExtensionsHost() {
-#ifdef NUCLEUS_ARCH_X86
+    const U32 features = core::getHostFeatures();
     extensions = 0;
-#ifdef NUCLEUS_COMPILER_MSVC
-    int data[4];
-    __cpuid(data, 0x00000001);
-    extensions |= ((data[2] >>  9) & 1) ? X86Extension::SSSE3 : 0;
-    extensions |= ((data[2] >> 28) & 1) ? X86Extension::AVX   : 0;
-    extensions |= 0 ? X86Extension::AVX2 : 0;
-    extensions |= 0 ? X86Extension::BMI2 : 0;
-    __cpuid(data, 0x80000001);
-    extensions |= ((data[2] >>  5) & 1) ? X86Extension::LZCNT : 0;
-    extensions |= 0 ? X86Extension::MOVBE : 0;
-#endif
-#endif
+    extensions |= (features & core::HOST_FEATURE_AVX) ? X86Extension::AVX : 0;
+    extensions |= (features & core::HOST_FEATURE_AVX2) ? X86Extension::AVX2 : 0;
+    extensions |= (features & core::HOST_FEATURE_AVX512) ? X86Extension::AVX512 : 0;
+    extensions |= (features & core::HOST_FEATURE_BMI2) ? X86Extension::BMI2 : 0;
+    extensions |= (features & core::HOST_FEATURE_LZCNT) ? X86Extension::LZCNT : 0;
+    extensions |= (features & core::HOST_FEATURE_MOVBE) ? X86Extension::MOVBE : 0;
+    extensions |= (features & core::HOST_FEATURE_SSSE3) ? X86Extension::SSSE3 : 0;
 }
 
 void X86Compiler::init() {
     // Initialize sequences
     X86Sequences::init();
+    initEntryThunk();
 
     // Set target information
     setExtensionsHost();
+    if (!(extensions & X86Extension::AVX)) {
+        logger.error(LOG_CPU, "The x86 backend requires a host with AVX support");
+    }
 #if defined(NUCLEUS_TARGET_WINDOWS)
     targetInfo.regSets.resize(2);
     targetInfo.regSets[0].types = RegisterSet::TYPE_INT;
     targetInfo.regSets[0].valueIndex = {10, 11, 12, 13, 14, 15}; // {r10, r11, r12, r13, r14, r15}
+    targetInfo.regSets[0].volatileIndex = {10, 11}; // {r10, r11}
     targetInfo.regSets[0].argIndex = {1, 2, 8, 9}; // {rcx, rdx, r8, r9}
     targetInfo.regSets[0].retIndex = 0; // rax
     targetInfo.regSets[1].types = RegisterSet::TYPE_FLOAT | RegisterSet::TYPE_VECTOR;
     targetInfo.regSets[1].valueIndex = {6, 7, 8, 9, 10, 11, 12, 13, 14, 15}; // {xmm6, ...,  xmm15}
     targetInfo.regSets[1].argIndex = {0, 1, 2, 3}; // {xmm0, ..., xmm3}
     targetInfo.regSets[1].retIndex = 0; // xmm0
-#elif defined(NUCLEUS_TARGET_LINUX)
-#elif defined(NUCLEUS_TARGET_OSX)
+#elif defined(NUCLEUS_TARGET_LINUX) || defined(NUCLEUS_TARGET_OSX)
+    // System V AMD64 ABI: No XMM register is preserved across calls
+    targetInfo.regSets.resize(2);
+    targetInfo.regSets[0].types = RegisterSet::TYPE_INT;
+    targetInfo.regSets[0].valueIndex = {10, 11, 12, 13, 14, 15}; // {r10, r11, r12, r13, r14, r15}
+    targetInfo.regSets[0].volatileIndex = {10, 11}; // {r10, r11}
+    targetInfo.regSets[0].argIndex = {7, 6, 2, 1, 8, 9}; // {rdi, rsi, rdx, rcx, r8, r9}
+    targetInfo.regSets[0].retIndex = 0; // rax
+    targetInfo.regSets[1].types = RegisterSet::TYPE_FLOAT | RegisterSet::TYPE_VECTOR;
+    targetInfo.regSets[1].valueIndex = {6, 7, 8, 9, 10, 11, 12, 13, 14, 15}; // {xmm6, ...,  xmm15}
+    targetInfo.regSets[1].volatileIndex = {6, 7, 8, 9, 10, 11, 12, 13, 14, 15}; // {xmm6, ...,  xmm15}
+    targetInfo.regSets[1].argIndex = {0, 1, 2, 3, 4, 5, 6, 7}; // {xmm0, ..., xmm7}
+    targetInfo.regSets[1].retIndex = 0; // xmm0
 #endif
 }
 
@@ -94,9 +99,40 @@ bool X86Compiler::compile(Function* function) {
     logger.error(LOG_CPU, "Unsupported variant of the x86 architecture");
 #endif
 
-    // Prolog block
+    // Compiled functions call each other directly, so they must preserve the registers
+    // that the ABI (and thus the register allocator) considers preserved across calls
+    std::vector<int> savedRegs[2];
+    for (const auto& block : function->blocks) {
+        for (const auto& instr : block->instructions) {
+            const auto* value = instr->dest;
+            if (!value || value->isConstant() || instr->opcode == OPCODE_ARG) {
+                continue;
+            }
+            const int set = value->isTypeInteger() ? 0 : 1;
+            const int reg = value->reg;
+            const auto& regs = targetInfo.regSets[set].valueIndex;
+            const auto& vols = targetInfo.regSets[set].volatileIndex;
+            auto& saved = savedRegs[set];
+            if (std::find(regs.begin(), regs.end(), reg) != regs.end() &&
+                std::find(vols.begin(), vols.end(), reg) == vols.end() &&
+                std::find(saved.begin(), saved.end(), reg) == saved.end()) {
+                saved.push_back(reg);
+            }
+        }
+    }
+
+    // Prolog block: Pushed registers, followed by the frame with the saved vector registers
+    // after the spill slots. The frame size keeps the stack aligned to 16 bytes.
+    const U32 savedOffset = X86_SPILL_OFFSET + function->stackSize;
+    const U32 frameSize = savedOffset + 16 * U32(savedRegs[1].size()) + ((savedRegs[0].size() % 2) ? 0 : 8);
     e.L(e.labelProlog);
-    e.sub(e.rsp, 0x28);
+    for (const auto reg : savedRegs[0]) {
+        e.push(Xbyak::Reg64(reg));
+    }
+    e.sub(e.rsp, frameSize);
+    for (Size i = 0; i < savedRegs[1].size(); i++) {
+        e.vmovdqu(e.ptr[e.rsp + U32(savedOffset + 16 * i)], Xbyak::Xmm(savedRegs[1][i]));
+    }
     if (!(function->blocks[0]->flags & BLOCK_IS_ENTRY)) {
         e.jmp(e.labelEntry, e.T_NEAR);
     }
@@ -122,14 +158,32 @@ bool X86Compiler::compile(Function* function) {
 
     // Epilog block
     e.L(e.labelEpilog);
-    e.add(e.rsp, 0x28);
+    for (Size i = 0; i < savedRegs[1].size(); i++) {
+        e.vmovdqu(Xbyak::Xmm(savedRegs[1][i]), e.ptr[e.rsp + U32(savedOffset + 16 * i)]);
+    }
+    e.add(e.rsp, frameSize);
+    for (auto it = savedRegs[0].rbegin(); it != savedRegs[0].rend(); it++) {
+        e.pop(Xbyak::Reg64(*it));
+    }
     e.ret();
+    e.emitConstants();
 
     // Copy emitted code
     const auto codeSize = e.getSize();
+    auto* nativeCode = static_cast<U08*>(allocCode(codeSize));
+    if (!nativeCode) {
+        return false;
+    }
+    writeCode(nativeCode, e.getCode(), codeSize);
+    for (const auto& link : e.links) {
+        addLink(nativeCode + link.offset, link.target);
+    }
+
+    // Publish the code only once complete, since other threads might be running the previous one
+    std::atomic_thread_fence(std::memory_order_release);
     function->nativeSize = codeSize;
-    function->nativeAddress = allocRWXMemory(codeSize);
-    memcpy(function->nativeAddress, e.getCode(), codeSize);
+    function->nativeAddress = nativeCode;
+    updateLinks(function);
 
     function->flags |= FUNCTION_IS_COMPILED;
     return true;
@@ -146,13 +200,24 @@ bool X86Compiler::compile(Module* module) {
 }
 
 bool X86Compiler::call(hir::Function* function, void* state, const std::vector<hir::Value*>& args) {
-    if (!(function->flags & FUNCTION_IS_COMPILED)) {
+    if (!function->nativeAddress) {
         logger.error(LOG_CPU, "Function is not ready");
         return false;
     }
 
-    // Generate code for caller
+    entryThunk(state, function->nativeAddress);
+    return true;
+}
+
+void X86Compiler::initEntryThunk() {
     X86Emitter e(this);
+#if defined(NUCLEUS_TARGET_WINDOWS)
+    const auto& argState = e.rcx;
+    const auto& argCode = e.rdx;
+#else
+    const auto& argState = e.rdi;
+    const auto& argCode = e.rsi;
+#endif
     e.push(e.rbx);
     e.push(e.r10);
     e.push(e.r11);
@@ -160,9 +225,8 @@ bool X86Compiler::call(hir::Function* function, void* state, const std::vector<h
     e.push(e.r13);
     e.push(e.r14);
     e.push(e.r15);
-    e.mov(e.rbx, reinterpret_cast<size_t>(state));
-    e.mov(e.rax, reinterpret_cast<size_t>(function->nativeAddress));
-    e.call(e.rax);
+    e.mov(e.rbx, argState);
+    e.call(argCode);
     e.pop(e.r15);
     e.pop(e.r14);
     e.pop(e.r13);
@@ -172,10 +236,13 @@ bool X86Compiler::call(hir::Function* function, void* state, const std::vector<h
     e.pop(e.rbx);
     e.ret();
 
-    // Execute caller
-    auto callerFunc = reinterpret_cast<void(*)()>(e.getCode());
-    callerFunc();
-    return true;
+    void* thunk = allocCode(e.getSize());
+    writeCode(thunk, e.getCode(), e.getSize());
+    entryThunk = reinterpret_cast<EntryThunk>(thunk);
+}
+
+U64 X86Compiler::getTargetKey() const {
+    return Compiler::getTargetKey() | (U64(extensions) << 32);
 }
 
 }  // namespace x86
@@ -30,6 +30,11 @@ private:
     // Initialize compiler
     void init();
 
+    // Reusable trampoline that sets up the guest state and jumps into compiled code
+    using EntryThunk = void(*)(void* state, void* code);
+    EntryThunk entryThunk = nullptr;
+    void initEntryThunk();
+
 public:
     // Available x86 extensions
     U32 extensions = 0;
@@ -44,6 +49,8 @@ public:
     virtual bool compile(hir::Module* module) override;
 
     virtual bool call(hir::Function* function, void* state, const std::vector<hir::Value*>& args = {}) override;
+
+    virtual U64 getTargetKey() const override;
 };
 
 }  // namespace x86
@@ -52,11 +52,7 @@ void getXmmConstant(X86Emitter& e, Xbyak::Xmm dest, const V128& constant) {
     } else if (constant.u64[0] == ~0ULL && constant.u64[1] == ~0ULL) {
         e.vpcmpeqd(dest, dest);
     } else {
-        e.mov(e.rax, constant.u64[0]);
-        e.mov(e.qword[e.rsp + 0], e.rax);
-        e.mov(e.rax, constant.u64[1]);
-        e.mov(e.qword[e.rsp + 8], e.rax);
-        e.vmovdqa(dest, e.ptr[e.rsp]);
+        e.vmovdqu(dest, e.ptr[e.rip + e.getConstant(constant)]);
     }
 }
 
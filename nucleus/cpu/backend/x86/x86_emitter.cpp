@@ -24,6 +24,29 @@ bool X86Emitter::isExtensionAvailable(U32 queriedExtension) const {
     return (compiler->extensions & queriedExtension);
 }
 
+Xbyak::Label& X86Emitter::getConstant(const V128& value) {
+    for (auto& constant : constants) {
+        if (constant.value == value) {
+            return constant.label;
+        }
+    }
+    constants.emplace_back();
+    constants.back().value = value;
+    return constants.back().label;
+}
+
+void X86Emitter::emitConstants() {
+    if (constants.empty()) {
+        return;
+    }
+    align(16);
+    for (auto& constant : constants) {
+        L(constant.label);
+        dq(constant.value.u64[0]);
+        dq(constant.value.u64[1]);
+    }
+}
+
 const Settings& X86Emitter::settings() const {
     return compiler->settings;
 }
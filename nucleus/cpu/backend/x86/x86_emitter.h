@@ -10,7 +10,9 @@
 #include "nucleus/cpu/backend/settings.h"
 #include "nucleus/cpu/backend/x86/x86_assembler.h"
 
+#include <deque>
 #include <unordered_map>
+#include <vector>
 
 namespace cpu {
 namespace backend {
@@ -19,6 +21,9 @@ namespace x86 {
 // Forward declarations
 class X86Compiler;
 
+// Frame layout: Shadow space for callees, followed by the spill slots and the saved vector registers
+constexpr U32 X86_SPILL_OFFSET = 0x20;
+
 enum X86Mode {
     X86_MODE_32BITS = (1 << 0),
     X86_MODE_64BITS = (1 << 1),
@@ -39,6 +44,20 @@ public:
     Xbyak::Label labelProlog;
     Xbyak::Label labelEpilog;
 
+    // Direct calls to other compiled functions, patched once the callee is compiled
+    struct Link {
+        Size offset;                  // Offset of the 64-bit target address
+        const hir::Function* target;  // Callee
+    };
+    std::vector<Link> links;
+
+    // Vector constants read with RIP-relative addressing, placed after the function code
+    struct Constant {
+        V128 value;
+        Xbyak::Label label;
+    };
+    std::deque<Constant> constants;
+
     // Constructor
     X86Emitter(const X86Compiler* compiler);
     X86Emitter(const X86Compiler* compiler, void* address, U64 size);
@@ -49,6 +68,18 @@ public:
      */
     bool isExtensionAvailable(U32 queriedExtension) const;
 
+    /**
+     * Get the label of a vector constant, adding it to the constant pool if required
+     * @param[in]  value  128-bit constant
+     * @return            Label to be used as [rip + label]
+     */
+    Xbyak::Label& getConstant(const V128& value);
+
+    /**
+     * Emit the constant pool, after the last instruction of the function
+     */
+    void emitConstants();
+
     /**
      * Return global generic compiler settings
      * @return Compiler settings member
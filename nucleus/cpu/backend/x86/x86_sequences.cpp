@@ -48,7 +48,8 @@ struct Sequence : SequenceBase<S, I> {
 
 public:
     static void select(X86Emitter& emitter, const hir::Instruction* instr) {
-        S::emit(emitter, I(instr));
+        I i(instr);
+        S::emit(emitter, i);
     }
 
     template <typename FuncType>
@@ -823,10 +824,12 @@ struct SHR_I32 : Sequence<SHR_I32, I<OPCODE_SHR, I32Op, I32Op, I8Op>> {
     static void emit(X86Emitter& e, InstrType& i) {
         emitAssociativeBinaryOp(e, i,
             [](X86Emitter& e, auto dest, auto srcReg) {
-                // TODO: Use BMI2's shrx to avoid the mov
-                e.mov(e.cl, srcReg);
-                e.shr(dest, e.cl);
-                // TODO: Restore cl
+                if (e.isExtensionAvailable(X86Extension::BMI2)) {
+                    e.shrx(dest.cvt32(), dest.cvt32(), srcReg.cvt32());
+                } else {
+                    e.mov(e.cl, srcReg);
+                    e.shr(dest, e.cl);
+                }
             },
             [](X86Emitter& e, auto dest, auto srcConst) {
                 e.shr(dest, srcConst);
@@ -838,10 +841,12 @@ struct SHR_I64 : Sequence<SHR_I64, I<OPCODE_SHR, I64Op, I64Op, I8Op>> {
     static void emit(X86Emitter& e, InstrType& i) {
         emitAssociativeBinaryOp(e, i,
             [](X86Emitter& e, auto dest, auto srcReg) {
-                // TODO: Use BMI2's shrx to avoid the mov
-                e.mov(e.cl, srcReg);
-                e.shr(dest, e.cl);
-                // TODO: Restore cl
+                if (e.isExtensionAvailable(X86Extension::BMI2)) {
+                    e.shrx(dest.cvt64(), dest.cvt64(), srcReg.cvt64());
+                } else {
+                    e.mov(e.cl, srcReg);
+                    e.shr(dest, e.cl);
+                }
             },
             [](X86Emitter& e, auto dest, auto srcConst) {
                 e.shr(dest, srcConst);
@@ -887,10 +892,12 @@ struct SHRA_I32 : Sequence<SHRA_I32, I<OPCODE_SHRA, I32Op, I32Op, I8Op>> {
     static void emit(X86Emitter& e, InstrType& i) {
         emitAssociativeBinaryOp(e, i,
             [](X86Emitter& e, auto dest, auto srcReg) {
-                // TODO: Use BMI2's sarx to avoid the mov
-                e.mov(e.cl, srcReg);
-                e.sar(dest, e.cl);
-                // TODO: Restore cl
+                if (e.isExtensionAvailable(X86Extension::BMI2)) {
+                    e.sarx(dest.cvt32(), dest.cvt32(), srcReg.cvt32());
+                } else {
+                    e.mov(e.cl, srcReg);
+                    e.sar(dest, e.cl);
+                }
             },
             [](X86Emitter& e, auto dest, auto srcConst) {
                 e.sar(dest, srcConst);
@@ -902,10 +909,12 @@ struct SHRA_I64 : Sequence<SHRA_I64, I<OPCODE_SHRA, I64Op, I64Op, I8Op>> {
     static void emit(X86Emitter& e, InstrType& i) {
         emitAssociativeBinaryOp(e, i,
             [](X86Emitter& e, auto dest, auto srcReg) {
-                // TODO: Use BMI2's sarx to avoid the mov
-                e.mov(e.cl, srcReg);
-                e.sar(dest, e.cl);
-                // TODO: Restore cl
+                if (e.isExtensionAvailable(X86Extension::BMI2)) {
+                    e.sarx(dest.cvt64(), dest.cvt64(), srcReg.cvt64());
+                } else {
+                    e.mov(e.cl, srcReg);
+                    e.sar(dest, e.cl);
+                }
             },
             [](X86Emitter& e, auto dest, auto srcConst) {
                 e.sar(dest, srcConst);
@@ -914,6 +923,72 @@ struct SHRA_I64 : Sequence<SHRA_I64, I<OPCODE_SHRA, I64Op, I64Op, I8Op>> {
     }
 };
 
+/**
+ * Opcode: ROL
+ */
+struct ROL_I8 : Sequence<ROL_I8, I<OPCODE_ROL, I8Op, I8Op, I8Op>> {
+    static void emit(X86Emitter& e, InstrType& i) {
+        emitAssociativeBinaryOp(e, i,
+            [](X86Emitter& e, auto dest, auto srcReg) {
+                e.mov(e.cl, srcReg);
+                e.rol(dest, e.cl);
+            },
+            [](X86Emitter& e, auto dest, auto srcConst) {
+                e.rol(dest, srcConst);
+            }
+        );
+    }
+};
+struct ROL_I16 : Sequence<ROL_I16, I<OPCODE_ROL, I16Op, I16Op, I8Op>> {
+    static void emit(X86Emitter& e, InstrType& i) {
+        emitAssociativeBinaryOp(e, i,
+            [](X86Emitter& e, auto dest, auto srcReg) {
+                e.mov(e.cl, srcReg);
+                e.rol(dest, e.cl);
+            },
+            [](X86Emitter& e, auto dest, auto srcConst) {
+                e.rol(dest, srcConst);
+            }
+        );
+    }
+};
+struct ROL_I32 : Sequence<ROL_I32, I<OPCODE_ROL, I32Op, I32Op, I8Op>> {
+    static void emit(X86Emitter& e, InstrType& i) {
+        // BMI2's rorx takes a separate source, saving the copy to the destination
+        if (e.isExtensionAvailable(X86Extension::BMI2) && !i.src1.isConstant && i.src2.isConstant) {
+            e.rorx(i.dest.reg, i.src1.reg, (32 - i.src2.constant()) & 0x1F);
+            return;
+        }
+        emitAssociativeBinaryOp(e, i,
+            [](X86Emitter& e, auto dest, auto srcReg) {
+                e.mov(e.cl, srcReg);
+                e.rol(dest, e.cl);
+            },
+            [](X86Emitter& e, auto dest, auto srcConst) {
+                e.rol(dest, srcConst);
+            }
+        );
+    }
+};
+struct ROL_I64 : Sequence<ROL_I64, I<OPCODE_ROL, I64Op, I64Op, I8Op>> {
+    static void emit(X86Emitter& e, InstrType& i) {
+        // BMI2's rorx takes a separate source, saving the copy to the destination
+        if (e.isExtensionAvailable(X86Extension::BMI2) && !i.src1.isConstant && i.src2.isConstant) {
+            e.rorx(i.dest.reg, i.src1.reg, (64 - i.src2.constant()) & 0x3F);
+            return;
+        }
+        emitAssociativeBinaryOp(e, i,
+            [](X86Emitter& e, auto dest, auto srcReg) {
+                e.mov(e.cl, srcReg);
+                e.rol(dest, e.cl);
+            },
+            [](X86Emitter& e, auto dest, auto srcConst) {
+                e.rol(dest, srcConst);
+            }
+        );
+    }
+};
+
 /**
  * Opcode: ZEXT
  */
@@ -1094,9 +1169,10 @@ struct CONVERT_F64_F32 : Sequence<CONVERT_F64_F32, I<OPCODE_CONVERT, F64Op, F32O
 struct CTLZ_I8 : Sequence<CTLZ_I8, I<OPCODE_CTLZ, I8Op, I8Op>> {
     static void emit(X86Emitter& e, InstrType& i) {
         if (e.isExtensionAvailable(X86Extension::LZCNT)) {
-            e.xor_(e.ax, e.ax);
-            e.mov(e.al, i.src1);
-            e.lzcnt(i.dest.reg.cvt16(), e.ax);
+            e.movzx(e.eax, i.src1.reg);
+            e.lzcnt(e.eax, e.eax);
+            e.sub(e.eax, 24);
+            e.mov(i.dest, e.al);
         } else {
             EMIT_CTLZ(8);
         }
@@ -1189,12 +1265,12 @@ struct LOAD_F32 : Sequence<LOAD_F32, I<OPCODE_LOAD, F32Op, PtrOp>> {
         auto addr = i.src1.reg;
         if (i.instr->flags & ENDIAN_BIG) {
             if (e.isExtensionAvailable(X86Extension::MOVBE)) {
-                assert_always("Unimplemented");
+                e.movbe(e.eax, e.dword[addr]);
             } else {
                 e.mov(e.eax, e.dword[addr]);
                 e.bswap(e.eax);
-                e.vmovd(i.dest, e.eax);
             }
+            e.vmovd(i.dest, e.eax);
         } else {
             e.vmovss(i.dest, e.dword[addr]);
         }
@@ -1205,12 +1281,12 @@ struct LOAD_F64 : Sequence<LOAD_F64, I<OPCODE_LOAD, F64Op, PtrOp>> {
         auto addr = i.src1.reg;
         if (i.instr->flags & ENDIAN_BIG) {
             if (e.isExtensionAvailable(X86Extension::MOVBE)) {
-                assert_always("Unimplemented");
+                e.movbe(e.rax, e.qword[addr]);
             } else {
-                e.mov(e.rax, e.dword[addr]);
+                e.mov(e.rax, e.qword[addr]);
                 e.bswap(e.rax);
-                e.vmovq(i.dest, e.rax);
             }
+            e.vmovq(i.dest, e.rax);
         } else {
             e.vmovsd(i.dest, e.qword[addr]);
         }
@@ -1228,8 +1304,7 @@ struct LOAD_V128 : Sequence<LOAD_V128, I<OPCODE_LOAD, V128Op, PtrOp>> {
             V128 byteSwapMask;
             byteSwapMask.u64[0] = 0x08090A0B0C0D0E0FULL;
             byteSwapMask.u64[1] = 0x0001020304050607ULL;
-            getXmmConstant(e, e.xmm0, byteSwapMask);
-            e.vpshufb(i.dest, i.dest, e.xmm0);
+            e.vpshufb(i.dest, i.dest, e.ptr[e.rip + e.getConstant(byteSwapMask)]);
         }
     }
 };
@@ -1315,10 +1390,10 @@ struct STORE_F32 : Sequence<STORE_F32, I<OPCODE_STORE, VoidOp, PtrOp, F32Op>> {
         auto addr = i.src1.reg;
         if (i.instr->flags & ENDIAN_BIG) {
             assert_false(i.src2.isConstant);
+            e.vmovd(e.eax, i.src2);
             if (e.isExtensionAvailable(X86Extension::MOVBE)) {
-                assert_always("Unimplemented");
+                e.movbe(e.dword[addr], e.eax);
             } else {
-                e.vmovd(e.eax, i.src2);
                 e.bswap(e.eax);
                 e.mov(e.dword[addr], e.eax);
             }
@@ -1336,10 +1411,10 @@ struct STORE_F64 : Sequence<STORE_F64, I<OPCODE_STORE, VoidOp, PtrOp, F64Op>> {
         auto addr = i.src1.reg;
         if (i.instr->flags & ENDIAN_BIG) {
             assert_false(i.src2.isConstant);
+            e.vmovq(e.rax, i.src2);
             if (e.isExtensionAvailable(X86Extension::MOVBE)) {
-                assert_always("Unimplemented");
+                e.movbe(e.qword[addr], e.rax);
             } else {
-                e.vmovq(e.rax, i.src2);
                 e.bswap(e.rax);
                 e.mov(e.qword[addr], e.rax);
             }
@@ -1366,8 +1441,7 @@ struct STORE_V128 : Sequence<STORE_V128, I<OPCODE_STORE, VoidOp, PtrOp, V128Op>>
             V128 byteSwapMask;
             byteSwapMask.u64[0] = 0x08090A0B0C0D0E0FULL;
             byteSwapMask.u64[1] = 0x0001020304050607ULL;
-            getXmmConstant(e, e.xmm0, byteSwapMask);
-            e.vpshufb(e.xmm0, i.src2, e.xmm0);
+            e.vpshufb(e.xmm0, i.src2, e.ptr[e.rip + e.getConstant(byteSwapMask)]);
             e.vmovaps(e.ptr[addr], e.xmm0);
         } else {
             if (i.src2.isConstant) {
@@ -1504,6 +1578,98 @@ struct CTXSTORE_V128 : Sequence<CTXSTORE_V128, I<OPCODE_CTXSTORE, VoidOp, Immedi
     }
 };
 
+/**
+ * Opcode: STACKLOAD
+ */
+struct STACKLOAD_I8 : Sequence<STACKLOAD_I8, I<OPCODE_STACKLOAD, I8Op, ImmediateOp>> {
+    static void emit(X86Emitter& e, InstrType& i) {
+        auto addr = e.rsp + (X86_SPILL_OFFSET + i.src1.immediate);
+        e.mov(i.dest, e.byte[addr]);
+    }
+};
+struct STACKLOAD_I16 : Sequence<STACKLOAD_I16, I<OPCODE_STACKLOAD, I16Op, ImmediateOp>> {
+    static void emit(X86Emitter& e, InstrType& i) {
+        auto addr = e.rsp + (X86_SPILL_OFFSET + i.src1.immediate);
+        e.mov(i.dest, e.word[addr]);
+    }
+};
+struct STACKLOAD_I32 : Sequence<STACKLOAD_I32, I<OPCODE_STACKLOAD, I32Op, ImmediateOp>> {
+    static void emit(X86Emitter& e, InstrType& i) {
+        auto addr = e.rsp + (X86_SPILL_OFFSET + i.src1.immediate);
+        e.mov(i.dest, e.dword[addr]);
+    }
+};
+struct STACKLOAD_I64 : Sequence<STACKLOAD_I64, I<OPCODE_STACKLOAD, I64Op, ImmediateOp>> {
+    static void emit(X86Emitter& e, InstrType& i) {
+        auto addr = e.rsp + (X86_SPILL_OFFSET + i.src1.immediate);
+        e.mov(i.dest, e.qword[addr]);
+    }
+};
+struct STACKLOAD_F32 : Sequence<STACKLOAD_F32, I<OPCODE_STACKLOAD, F32Op, ImmediateOp>> {
+    static void emit(X86Emitter& e, InstrType& i) {
+        auto addr = e.rsp + (X86_SPILL_OFFSET + i.src1.immediate);
+        e.vmovss(i.dest, e.dword[addr]);
+    }
+};
+struct STACKLOAD_F64 : Sequence<STACKLOAD_F64, I<OPCODE_STACKLOAD, F64Op, ImmediateOp>> {
+    static void emit(X86Emitter& e, InstrType& i) {
+        auto addr = e.rsp + (X86_SPILL_OFFSET + i.src1.immediate);
+        e.vmovsd(i.dest, e.qword[addr]);
+    }
+};
+struct STACKLOAD_V128 : Sequence<STACKLOAD_V128, I<OPCODE_STACKLOAD, V128Op, ImmediateOp>> {
+    static void emit(X86Emitter& e, InstrType& i) {
+        auto addr = e.rsp + (X86_SPILL_OFFSET + i.src1.immediate);
+        e.vmovaps(i.dest, e.ptr[addr]);
+    }
+};
+
+/**
+ * Opcode: STACKSTORE
+ */
+struct STACKSTORE_I8 : Sequence<STACKSTORE_I8, I<OPCODE_STACKSTORE, VoidOp, ImmediateOp, I8Op>> {
+    static void emit(X86Emitter& e, InstrType& i) {
+        auto addr = e.rsp + (X86_SPILL_OFFSET + i.src1.immediate);
+        e.mov(e.byte[addr], i.src2);
+    }
+};
+struct STACKSTORE_I16 : Sequence<STACKSTORE_I16, I<OPCODE_STACKSTORE, VoidOp, ImmediateOp, I16Op>> {
+    static void emit(X86Emitter& e, InstrType& i) {
+        auto addr = e.rsp + (X86_SPILL_OFFSET + i.src1.immediate);
+        e.mov(e.word[addr], i.src2);
+    }
+};
+struct STACKSTORE_I32 : Sequence<STACKSTORE_I32, I<OPCODE_STACKSTORE, VoidOp, ImmediateOp, I32Op>> {
+    static void emit(X86Emitter& e, InstrType& i) {
+        auto addr = e.rsp + (X86_SPILL_OFFSET + i.src1.immediate);
+        e.mov(e.dword[addr], i.src2);
+    }
+};
+struct STACKSTORE_I64 : Sequence<STACKSTORE_I64, I<OPCODE_STACKSTORE, VoidOp, ImmediateOp, I64Op>> {
+    static void emit(X86Emitter& e, InstrType& i) {
+        auto addr = e.rsp + (X86_SPILL_OFFSET + i.src1.immediate);
+        e.mov(e.qword[addr], i.src2);
+    }
+};
+struct STACKSTORE_F32 : Sequence<STACKSTORE_F32, I<OPCODE_STACKSTORE, VoidOp, ImmediateOp, F32Op>> {
+    static void emit(X86Emitter& e, InstrType& i) {
+        auto addr = e.rsp + (X86_SPILL_OFFSET + i.src1.immediate);
+        e.vmovss(e.dword[addr], i.src2);
+    }
+};
+struct STACKSTORE_F64 : Sequence<STACKSTORE_F64, I<OPCODE_STACKSTORE, VoidOp, ImmediateOp, F64Op>> {
+    static void emit(X86Emitter& e, InstrType& i) {
+        auto addr = e.rsp + (X86_SPILL_OFFSET + i.src1.immediate);
+        e.vmovsd(e.qword[addr], i.src2);
+    }
+};
+struct STACKSTORE_V128 : Sequence<STACKSTORE_V128, I<OPCODE_STACKSTORE, VoidOp, ImmediateOp, V128Op>> {
+    static void emit(X86Emitter& e, InstrType& i) {
+        auto addr = e.rsp + (X86_SPILL_OFFSET + i.src1.immediate);
+        e.vmovaps(e.ptr[addr], i.src2);
+    }
+};
+
 /**
  * Opcode: MEMFENCE
  */
@@ -1513,6 +1679,54 @@ struct MEMFENCE : Sequence<MEMFENCE, I<OPCODE_MEMFENCE>> {
     }
 };
 
+/**
+ * Opcode: CMPXCHG
+ */
+struct CMPXCHG_I32 : Sequence<CMPXCHG_I32, I<OPCODE_CMPXCHG, I8Op, PtrOp, I32Op, I32Op>> {
+    static void emit(X86Emitter& e, InstrType& i) {
+        auto addr = i.src1.reg;
+        if (i.src2.isConstant) {
+            e.mov(e.eax, i.src2.constant());
+        } else {
+            e.mov(e.eax, i.src2);
+        }
+        if (i.src3.isConstant) {
+            e.mov(e.ecx, i.src3.constant());
+        } else {
+            e.mov(e.ecx, i.src3);
+        }
+        if (i.instr->flags & ENDIAN_BIG) {
+            e.bswap(e.eax);
+            e.bswap(e.ecx);
+        }
+        e.lock();
+        e.cmpxchg(e.dword[addr], e.ecx);
+        e.sete(i.dest);
+    }
+};
+struct CMPXCHG_I64 : Sequence<CMPXCHG_I64, I<OPCODE_CMPXCHG, I8Op, PtrOp, I64Op, I64Op>> {
+    static void emit(X86Emitter& e, InstrType& i) {
+        auto addr = i.src1.reg;
+        if (i.src2.isConstant) {
+            e.mov(e.rax, i.src2.constant());
+        } else {
+            e.mov(e.rax, i.src2);
+        }
+        if (i.src3.isConstant) {
+            e.mov(e.rcx, i.src3.constant());
+        } else {
+            e.mov(e.rcx, i.src3);
+        }
+        if (i.instr->flags & ENDIAN_BIG) {
+            e.bswap(e.rax);
+            e.bswap(e.rcx);
+        }
+        e.lock();
+        e.cmpxchg(e.qword[addr], e.rcx);
+        e.sete(i.dest);
+    }
+};
+
 /**
  * Opcode: SELECT
  */
@@ -1825,100 +2039,53 @@ struct ARG_I64 : Sequence<ARG_I64, I<OPCODE_ARG, I64Op, ImmediateOp, I64Op>> {
 /**
  * Opcode: CALL
  */
+void emitCall(X86Emitter& e, const Instruction* instr, const Function* target) {
+    if ((instr->flags & CALL_EXTERN) || !e.settings().isJIT) {
+        e.mov(e.rax, reinterpret_cast<size_t>(target->nativeAddress));
+        e.call(e.rax);
+        return;
+    }
+
+    // JIT calls are linked directly to the current code of the callee, and patched whenever
+    // it gets (re)compiled. Align the immediate so that it can be replaced with a single store.
+    while ((e.getSize() + 2) % 8) {
+        e.nop();
+    }
+    e.db(0x48); e.db(0xB8); // mov rax, imm64
+    e.links.push_back({ e.getSize(), target });
+    e.dq(reinterpret_cast<U64>(target->nativeAddress));
+    e.call(e.rax);
+}
+
 struct CALL_VOID : Sequence<CALL_VOID, I<OPCODE_CALL, VoidOp, FunctionOp>> {
     static void emit(X86Emitter& e, InstrType& i) {
-        const Function* target = i.src1.function;
-        if (i.instr->flags & CALL_EXTERN) {
-            e.mov(e.rax, reinterpret_cast<size_t>(target->nativeAddress));
-            e.call(e.rax);
-        } else {
-            if (e.settings().isJIT) {
-                e.mov(e.rax, reinterpret_cast<size_t>(target));
-                e.mov(e.rax, e.qword[e.rax + offsetof(hir::Function, nativeAddress)]);
-                e.call(e.rax);
-            } else {
-                e.mov(e.rax, reinterpret_cast<size_t>(target->nativeAddress));
-                e.call(e.rax);
-            }
-        }
+        emitCall(e, i.instr, i.src1.function);
     }
 };
 struct CALL_I8 : Sequence<CALL_I8, I<OPCODE_CALL, I8Op, FunctionOp>> {
     static void emit(X86Emitter& e, InstrType& i) {
-        const Function* target = i.src1.function;
-        if (i.instr->flags & CALL_EXTERN) {
-            e.mov(e.rax, reinterpret_cast<size_t>(target->nativeAddress));
-            e.call(e.rax);
-        } else {
-            if (e.settings().isJIT) {
-                e.mov(e.rax, reinterpret_cast<size_t>(target));
-                e.mov(e.rax, e.qword[e.rax + offsetof(hir::Function, nativeAddress)]);
-                e.call(e.rax);
-            } else {
-                e.mov(e.rax, reinterpret_cast<size_t>(target->nativeAddress));
-                e.call(e.rax);
-            }
-        }
+        emitCall(e, i.instr, i.src1.function);
         // Save return value
         e.mov(i.dest, e.al);
     }
 };
 struct CALL_I16 : Sequence<CALL_I16, I<OPCODE_CALL, I16Op, FunctionOp>> {
     static void emit(X86Emitter& e, InstrType& i) {
-        const Function* target = i.src1.function;
-        if (i.instr->flags & CALL_EXTERN) {
-            e.mov(e.rax, reinterpret_cast<size_t>(target->nativeAddress));
-            e.call(e.rax);
-        } else {
-            if (e.settings().isJIT) {
-                e.mov(e.rax, reinterpret_cast<size_t>(target));
-                e.mov(e.rax, e.qword[e.rax + offsetof(hir::Function, nativeAddress)]);
-                e.call(e.rax);
-            } else {
-                e.mov(e.rax, reinterpret_cast<size_t>(target->nativeAddress));
-                e.call(e.rax);
-            }
-        }
+        emitCall(e, i.instr, i.src1.function);
         // Save return value
         e.mov(i.dest, e.ax);
     }
 };
 struct CALL_I32 : Sequence<CALL_I32, I<OPCODE_CALL, I32Op, FunctionOp>> {
     static void emit(X86Emitter& e, InstrType& i) {
-        const Function* target = i.src1.function;
-        if (i.instr->flags & CALL_EXTERN) {
-            e.mov(e.rax, reinterpret_cast<size_t>(target->nativeAddress));
-            e.call(e.rax);
-        } else {
-            if (e.settings().isJIT) {
-                e.mov(e.rax, reinterpret_cast<size_t>(target));
-                e.mov(e.rax, e.qword[e.rax + offsetof(hir::Function, nativeAddress)]);
-                e.call(e.rax);
-            } else {
-                e.mov(e.rax, reinterpret_cast<size_t>(target->nativeAddress));
-                e.call(e.rax);
-            }
-        }
+        emitCall(e, i.instr, i.src1.function);
         // Save return value
         e.mov(i.dest, e.eax);
     }
 };
 struct CALL_I64 : Sequence<CALL_I64, I<OPCODE_CALL, I64Op, FunctionOp>> {
     static void emit(X86Emitter& e, InstrType& i) {
-        const Function* target = i.src1.function;
-        if (i.instr->flags & CALL_EXTERN) {
-            e.mov(e.rax, reinterpret_cast<size_t>(target->nativeAddress));
-            e.call(e.rax);
-        } else {
-            if (e.settings().isJIT) {
-                e.mov(e.rax, reinterpret_cast<size_t>(target));
-                e.mov(e.rax, e.qword[e.rax + offsetof(hir::Function, nativeAddress)]);
-                e.call(e.rax);
-            } else {
-                e.mov(e.rax, reinterpret_cast<size_t>(target->nativeAddress));
-                e.call(e.rax);
-            }
-        }
+        emitCall(e, i.instr, i.src1.function);
         // Save return value
         e.mov(i.dest, e.rax);
     }
@@ -2519,15 +2686,21 @@ struct SHUFFLE_V128 : Sequence<SHUFFLE_V128, I<OPCODE_SHUFFLE, V128Op, V128Op, V
         Xbyak::Xmm mask = e.xmm2;
         Xbyak::Xmm temp = e.xmm3;
 
-        getXmmConstant(e, temp, V128::from_u8(0x03));
+        // Constant masks are converted to host byte indices at compile time
+        V128 selector;
         if (i.src1.isConstant) {
-            getXmmConstant(e, mask, i.src1.constant());
-            e.vxorps(mask, mask, temp);
+            V128 indices = i.src1.constant();
+            for (Size k = 0; k < 16; k++) {
+                indices.u8[k] = (indices.u8[k] ^ 0x03) & 0x1F;
+                selector.u8[k] = (indices.u8[k] > 0x0F) ? 0xFF : 0x00;
+            }
+            getXmmConstant(e, mask, indices);
         } else {
+            getXmmConstant(e, temp, V128::from_u8(0x03));
             e.vxorps(mask, i.src1, temp);
+            getXmmConstant(e, temp, V128::from_u8(0x1F));
+            e.vpand(mask, temp);
         }
-        getXmmConstant(e, temp, V128::from_u8(0x1F));
-        e.vpand(mask, temp);
 
         if (i.src2.isConstant) {
             getXmmConstant(e, iV1, i.src2.constant());
@@ -2542,8 +2715,12 @@ struct SHUFFLE_V128 : Sequence<SHUFFLE_V128, I<OPCODE_SHUFFLE, V128Op, V128Op, V
             e.vpshufb(iV2, i.src3, mask);
         }
 
-        getXmmConstant(e, temp, V128::from_u8(0x0F));
-        e.vpcmpgtb(i.dest, mask, temp);
+        if (i.src1.isConstant) {
+            getXmmConstant(e, i.dest, selector);
+        } else {
+            getXmmConstant(e, temp, V128::from_u8(0x0F));
+            e.vpcmpgtb(i.dest, mask, temp);
+        }
         e.vpblendvb(i.dest, iV1, iV2, i.dest);
     }
 };
@@ -2556,8 +2733,6 @@ std::unordered_map<InstrKey::Value, X86Sequences::SelectFunction> X86Sequences::
 void X86Sequences::init() {
     // Initialize sequences if necessary
     if (sequences.empty()) {
-        // TODO: Other compilers fail here
-#ifdef NUCLEUS_COMPILER_MSVC
         registerSequence<ADD_I8, ADD_I16, ADD_I32, ADD_I64>();
         registerSequence<SUB_I8, SUB_I16, SUB_I32, SUB_I64>();
         registerSequence<MUL_I8, MUL_I16, MUL_I32, MUL_I64>();
@@ -2573,6 +2748,7 @@ void X86Sequences::init() {
         registerSequence<SHL_I8, SHL_I16, SHL_I32, SHL_I64>();
         registerSequence<SHR_I8, SHR_I16, SHR_I32, SHR_I64>();
         registerSequence<SHRA_I8, SHRA_I16, SHRA_I32, SHRA_I64>();
+        registerSequence<ROL_I8, ROL_I16, ROL_I32, ROL_I64>();
         registerSequence<ZEXT_I16_I8, ZEXT_I32_I8, ZEXT_I64_I8, ZEXT_I32_I16, ZEXT_I64_I16, ZEXT_I64_I32>();
         registerSequence<SEXT_I16_I8, SEXT_I32_I8, SEXT_I64_I8, SEXT_I32_I16, SEXT_I64_I16, SEXT_I64_I32>();
         registerSequence<TRUNC_I8_I16, TRUNC_I8_I32, TRUNC_I8_I64, TRUNC_I16_I32, TRUNC_I16_I64, TRUNC_I32_I64>();
@@ -2583,7 +2759,10 @@ void X86Sequences::init() {
         registerSequence<STORE_I8, STORE_I16, STORE_I32, STORE_I64, STORE_F32, STORE_F64, STORE_V128>();
         registerSequence<CTXLOAD_I8, CTXLOAD_I16, CTXLOAD_I32, CTXLOAD_I64, CTXLOAD_F32, CTXLOAD_F64, CTXLOAD_V128>();
         registerSequence<CTXSTORE_I8, CTXSTORE_I16, CTXSTORE_I32, CTXSTORE_I64, CTXSTORE_F32, CTXSTORE_F64, CTXSTORE_V128>();
+        registerSequence<STACKLOAD_I8, STACKLOAD_I16, STACKLOAD_I32, STACKLOAD_I64, STACKLOAD_F32, STACKLOAD_F64, STACKLOAD_V128>();
+        registerSequence<STACKSTORE_I8, STACKSTORE_I16, STACKSTORE_I32, STACKSTORE_I64, STACKSTORE_F32, STACKSTORE_F64, STACKSTORE_V128>();
         registerSequence<MEMFENCE>();
+        registerSequence<CMPXCHG_I32, CMPXCHG_I64>();
         registerSequence<SELECT_I8, SELECT_I16, SELECT_I32, SELECT_I64, SELECT_F32, SELECT_F64>();
         registerSequence<CMP_I8, CMP_I16, CMP_I32, CMP_I64, CMP_F32, CMP_F64>();
         registerSequence<ARG_I8, ARG_I16, ARG_I32, ARG_I64>();
@@ -2608,7 +2787,6 @@ void X86Sequences::init() {
         registerSequence<EXTRACT_I8_V128, EXTRACT_I16_V128, EXTRACT_I32_V128>();
         registerSequence<INSERT_V128_I8, INSERT_V128_I16, INSERT_V128_I32, INSERT_V128_I64>();
         registerSequence<SHUFFLE_V128>();
-#endif
     }
 }
 
@@ -6,7 +6,9 @@
 #include "cpu_guest.h"
 #include "nucleus/cpu/thread.h"
 #include "nucleus/cpu/hir/passes.h"
+#include "nucleus/core/config.h"
 #include "nucleus/logger/logger.h"
+#include "nucleus/memory/guest_virtual/guest_virtual_memory.h"
 
 // Backends
 #include "nucleus/cpu/backend/x86/x86_compiler.h"
@@ -31,7 +33,27 @@ GuestCPU::GuestCPU(Emulator* emulator, mem::Memory* memory)
 #endif
 
     // Compiler passes
+    compiler->addPass(std::make_unique<hir::passes::ContextPromotionPass>());
+    compiler->addPass(std::make_unique<hir::passes::CopyPropagationPass>());
+    compiler->addPass(std::make_unique<hir::passes::ConstantFoldingPass>());
+    compiler->addPass(std::make_unique<hir::passes::CommonSubexpressionEliminationPass>());
+    compiler->addPass(std::make_unique<hir::passes::DeadCodeEliminationPass>());
     compiler->addPass(std::make_unique<hir::passes::RegisterAllocationPass>(compiler->targetInfo));
+
+    // Compiled code caches
+    auto* guestMemory = dynamic_cast<mem::GuestVirtualMemory*>(memory);
+    if (compiler->settings.isCached && guestMemory && !config.cachePath.empty()) {
+        ppuCache = std::make_unique<backend::CodeCache>(compiler.get(), config.cachePath, "ppu");
+        spuCache = std::make_unique<backend::CodeCache>(compiler.get(), config.cachePath, "spu");
+    }
+
+    // Ahead-of-time translation workers
+    if (config.ppuTranslator & CPU_TRANSLATOR_MODULE) {
+        ppuCompilePool = std::make_unique<core::WorkerPool>();
+    }
+
+    // SPU scheduling
+    spuScheduler = std::make_unique<frontend::spu::SPUScheduler>(std::max(config.spuThreads, 0));
 }
 
 Thread* GuestCPU::addThread(ThreadType type) {
@@ -66,6 +88,22 @@ void GuestCPU::removeThread(Thread* thread) {
         threads.end());
 }
 
+void GuestCPU::addSpuModule(frontend::spu::Module* module) {
+    std::lock_guard<std::mutex> lock(spu_modules_mutex);
+    spu_modules.push_back(module);
+    spu_modules_version += 1;
+}
+
+U32 GuestCPU::getSpuModulesVersion() const {
+    return spu_modules_version.load(std::memory_order_acquire);
+}
+
+std::vector<frontend::spu::Module*> GuestCPU::getSpuModules(U32& version) {
+    std::lock_guard<std::mutex> lock(spu_modules_mutex);
+    version = spu_modules_version.load(std::memory_order_relaxed);
+    return spu_modules;
+}
+
 void GuestCPU::run() {
     std::lock_guard<std::mutex> lock(mutex);
 
@@ -88,6 +126,11 @@ void GuestCPU::stop() {
     for (Thread* thread : threads) {
         thread->stop();
     }
+
+    const auto stats = compiler->codeArena->getStats();
+    logger.notice(LOG_CPU, "Code arena: %d KB mapped, %d KB used, %d KB live, %d KB free (%d allocations)",
+        U32(stats.capacity >> 10), U32(stats.used >> 10), U32(stats.live >> 10),
+        U32(stats.available >> 10), U32(stats.allocations));
 }
 
 }  // namespace cpu
@@ -6,11 +6,18 @@
 #pragma once
 
 #include "nucleus/common.h"
+#include "nucleus/core/worker_pool.h"
 #include "nucleus/cpu/cpu.h"
+#include "nucleus/cpu/reservation.h"
 #include "nucleus/cpu/thread.h"
+#include "nucleus/cpu/backend/cache.h"
 #include "nucleus/cpu/backend/compiler.h"
+#include "nucleus/cpu/backend/dispatcher.h"
+#include "nucleus/cpu/frontend/spu/spu_scheduler.h"
 
+#include <atomic>
 #include <mutex>
+#include <vector>
 
 // Forward declarations
 namespace cpu::frontend::ppu { class Module; }
@@ -21,13 +28,34 @@ namespace cpu {
 class GuestCPU : public CPU {
     std::mutex mutex;
 
+    // SPU modules can be created while SPU threads run, so they are only accessed under
+    // this lock and every change bumps the version that threads check before reusing a copy
+    std::vector<frontend::spu::Module*> spu_modules;
+    std::mutex spu_modules_mutex;
+    std::atomic<U32> spu_modules_version{ 0 };
+
 public:
     std::unique_ptr<backend::Compiler> compiler;
 
+    // Persistent caches of compiled guest code (null if caching is disabled)
+    std::unique_ptr<backend::CodeCache> ppuCache;
+    std::unique_ptr<backend::CodeCache> spuCache;
+
     std::vector<Thread*> threads;
 
     std::vector<frontend::ppu::Module*> ppu_modules;
-    std::vector<frontend::spu::Module*> spu_modules;
+
+    // Functions declared in any PPU module, indexed by guest address
+    backend::Dispatcher ppuDispatcher;
+
+    // Reservations shared by PPU atomic instructions and SPU lock-line commands
+    ReservationTable reservations;
+
+    // Workers translating PPU modules ahead of time (null unless CPU_TRANSLATOR_MODULE is enabled)
+    std::unique_ptr<core::WorkerPool> ppuCompilePool;
+
+    // Run slots shared by all SPU threads
+    std::unique_ptr<frontend::spu::SPUScheduler> spuScheduler;
 
     // Constructor
     GuestCPU(Emulator* emulator, mem::Memory* memory);
@@ -36,6 +64,11 @@ public:
     Thread* addThread(ThreadType type);
     void removeThread(Thread* thread);
 
+    // Manage SPU modules
+    void addSpuModule(frontend::spu::Module* module);
+    U32 getSpuModulesVersion() const;
+    std::vector<frontend::spu::Module*> getSpuModules(U32& version);
+
     // Thread management
     virtual void run() override;
     virtual void pause() override;
@@ -6,11 +6,13 @@
 #pragma once
 
 #include "nucleus/common.h"
+#include "nucleus/cpu/backend/cache.h"
 #include "nucleus/cpu/frontend/frontend_block.h"
 #include "nucleus/cpu/frontend/frontend_module.h"
 
 #include <map>
 #include <string>
+#include <vector>
 
 namespace cpu {
 namespace frontend {
@@ -24,7 +26,7 @@ public:
     Module* parent;
 
     // HIR Function
-    hir::Function* hirFunction;
+    hir::Function* hirFunction = nullptr;
 
     // Starting address of the entry block
     U64 address = 0;
@@ -48,6 +50,16 @@ public:
         }
         return false;
     }
+
+    // Get the guest code ranges covered by all CFG blocks
+    std::vector<backend::CodeRange> getCodeRanges() const {
+        std::vector<backend::CodeRange> ranges;
+        for (const auto& item : blocks) {
+            const auto& block = item.second;
+            ranges.push_back({ U32(block->address), U32(block->size) });
+        }
+        return ranges;
+    }
 };
 
 }  // namespace frontend
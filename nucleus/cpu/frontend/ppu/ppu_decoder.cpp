@@ -5,6 +5,7 @@
 
 #include "ppu_decoder.h"
 #include "nucleus/memory/memory.h"
+#include "nucleus/memory/guest_virtual/guest_virtual_memory.h"
 #include "nucleus/cpu/cpu_guest.h"
 #include "nucleus/cpu/util.h"
 #include "nucleus/cpu/hir/builder.h"
@@ -312,6 +313,47 @@ void Function::createPlaceholder()
     builder.createRet();
 }
 
+void Function::translate()
+{
+    if (translated) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(translateMutex);
+    if (translated) {
+        return;
+    }
+
+    auto* cpu = dynamic_cast<GuestCPU*>(parent->parent);
+    if (!loadCache()) {
+        analyze_cfg();
+        recompile();
+        cpu->compiler->compile(hirFunction);
+        saveCache();
+    }
+    translated = true;
+}
+
+bool Function::loadCache()
+{
+    auto* cpu = dynamic_cast<GuestCPU*>(parent->parent);
+    if (!cpu->ppuCache) {
+        return false;
+    }
+
+    auto* module = static_cast<Module*>(parent);
+    return cpu->ppuCache->lookup(this, [module](U32 addr) {
+        return module->addFunction(addr)->hirFunction;
+    });
+}
+
+void Function::saveCache()
+{
+    auto* cpu = dynamic_cast<GuestCPU*>(parent->parent);
+    if (cpu->ppuCache) {
+        cpu->ppuCache->store(this, &static_cast<Module*>(parent)->mutex);
+    }
+}
+
 /**
  * PPU Module methods
  */
@@ -321,22 +363,31 @@ Module::Module(CPU* parent) : frontend::Module(parent) {
 Function* Module::addFunction(U32 addr)
 {
     auto* cpu = dynamic_cast<GuestCPU*>(parent);
-
-    // Return function if already present
-    if (functions.find(addr) != functions.end()) {
-        return static_cast<Function*>(functions[addr]);
+    std::lock_guard<std::mutex> lock(mutex);
+
+    // Return function if already declared
+    Function* function;
+    auto it = functions.find(addr);
+    if (it != functions.end()) {
+        function = static_cast<Function*>(it->second);
+        if (function->hirFunction) {
+            return function;
+        }
     }
 
     // Create the function otherwise
-    Function* function = new Function(this);
-    function->name = format("func_%08X", addr);
-    function->address = addr;
+    else {
+        function = new Function(this);
+        function->name = format("func_%08X", addr);
+        function->address = addr;
+        functions[addr] = function;
+    }
     function->declare();
     function->createPlaceholder();
     cpu->compiler->compile(function->hirFunction);
 
-    // Save and return the function
-    functions[addr] = function;
+    // Make the function reachable by the dispatcher
+    cpu->ppuDispatcher.insert(addr, function->hirFunction);
     return function;
 }
 
@@ -390,11 +441,13 @@ void Module::analyze()
     // List the functions and get their CFG
     for (const auto& label : labelFunctions) {
         if (this->contains(label)) {
-            Function function(this);
-            function.name = format("func_%X", label);
-            function.address = label;
-            if (function.analyze_cfg()) {
-                functions[label] = new Function(function);
+            auto* function = new Function(this);
+            function->name = format("func_%X", label);
+            function->address = label;
+            if (function->analyze_cfg()) {
+                functions[label] = function;
+            } else {
+                delete function;
             }
         }
     }
@@ -407,132 +460,62 @@ void Module::analyze()
 
 void Module::recompile()
 {
-    //module = hir::Module::Create(name);
-
-    // Optimization passes
-    /*auto fpm = new llvm::legacy::FunctionPassManager(module.module);
-    fpm->add(llvm::createPromoteMemoryToRegisterPass());  // Promote allocas to registers
-    fpm->add(llvm::createInstructionCombiningPass());     // Simple peephole and bit-twiddling optimizations
-    fpm->add(llvm::createReassociatePass());              // Reassociate expressions
-    fpm->add(llvm::createGVNPass());                      // Eliminate Common SubExpressions
-    fpm->add(llvm::createCFGSimplificationPass());        // Simplify the Control Flow Graph (e.g.: deleting unreachable blocks)
-    fpm->doInitialization();*/
-
-    // Global variables
-    /*memoryBase = module.getOrInsertGlobal<hir::I64>("memoryBase");
-    funcGetState = hir::Function::Create(
-        llvm::FunctionType::get(hir::Pointer<StateType>::getType().type, false),
-        llvm::Function::ExternalLinkage, "nucleusGetState", module);
-    funcLogState = hir::Function::Create(
-        llvm::FunctionType::get(hir::Void::getType().type, { hir::I64::getType().type }, false),
-        llvm::Function::ExternalLinkage, "nucleusLogState", module);
-    funcDebugState = hir::Function::Create(
-        llvm::FunctionType::get(hir::Void::getType().type, { hir::I64::getType().type }, false),
-        llvm::Function::ExternalLinkage, "nucleusDebugState", module);
-    funcIntermodularCall = hir::Function::Create(
-        llvm::FunctionType::get(hir::Void::getType().type, { hir::I64::getType().type }, false),
-        llvm::Function::ExternalLinkage, "nucleusIntermodularCall", module);
-    funcSystemCall = hir::Function::Create(
-        llvm::FunctionType::get(hir::Void::getType().type, false),
-        llvm::Function::ExternalLinkage, "nucleusSystemCall", module);*/
-    /*
-    // Declare all functions
-    for (auto& item : functions) {
-        auto& function = static_cast<Function&>(*item.second);
-        function.declare(module);
-    }
+    auto* cpu = dynamic_cast<GuestCPU*>(parent);
 
-    // Recompile and optimize all functions
-    for (auto& item : functions) {
-        auto& function = static_cast<Function&>(*item.second);
-        function.recompile();
-        fpm->run(*function.function.function); // TODO: This is unreadable
+    std::vector<U32> addresses;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (const auto& item : functions) {
+            addresses.push_back(U32(item.first));
+        }
     }
 
-    // Add function caller
-    llvm::FunctionType* callerType = llvm::FunctionType::get(
-        llvm::Type::getVoidTy(llvm::getGlobalContext()),
-        llvm::Type::getInt32Ty(llvm::getGlobalContext()),
-        false);
-    hir::Function callerFunction = hir::Function::Create(callerType, llvm::Function::InternalLinkage, "caller", module);
-    hir::Block entryBlock = hir::Block::Create("entry", callerFunction);
-    hir::Block defaultBlock = hir::Block::Create("caller", callerFunction);
-
-    hir::Builder builder;
-    builder.setInsertPoint(entryBlock);
-    hir::Value* state = builder.createCall(funcGetState);
-    auto switchInst = builder.createSwitch(hir::Value<hir::I32>{ callerFunction.function->arg_begin() }, defaultBlock);
-
-    for (auto& item : functions) {
-        auto& function = static_cast<Function&>(*item.second);
-
-        // Declare block
-        hir::Block callerBlock = hir::Block::Create(function.name + "_caller", callerFunction);
-        switchInst->addCase(llvm::ConstantInt::get(
-            llvm::IntegerType::getInt32Ty(llvm::getGlobalContext()), function.address),
-            callerBlock.bb);
-
-        // Proxy
-        int index = 0;
-        builder.setInsertPoint(callerBlock);
-        std::vector<hir::Value*> args;
-        for (auto& type : function.type_in) {
-            switch (type) {
-            case FUNCTION_IN_INTEGER:
-                args.push_back(builder.createLoad<hir::I64>(
-                    builder.createInBoundsGEP(state, {
-                        builder.get<hir::I32>(0),
-                        builder.get<hir::I32>(0),
-                        builder.get<hir::I32>(3 + index++)
-                    })
-                ));
-                break;
-
-            case FUNCTION_IN_FLOAT: {
-                args.push_back(builder.createLoad<hir::I64>(
-                    builder.createInBoundsGEP(state, {
-                        builder.get<hir::I32>(0),
-                        builder.get<hir::I32>(1),
-                        builder.get<hir::I32>(1 + index++)
-                    })
-                ));
-                break;
-            }
-            case FUNCTION_IN_VECTOR: {
-                // TODO
-                break;
-            }
-            default:
-                break;
-            }
+    // Declare every function first, so guest threads can run before the workers are done.
+    // Functions keep the state-based calling convention of the function translator, since
+    // their placeholders are interchangeable with the compiled code.
+    std::vector<Function*> pending;
+    for (U32 addr : addresses) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto* function = static_cast<Function*>(functions.at(addr));
+            function->type_in.clear();
+            function->type_out = FUNCTION_OUT_VOID;
         }
-
-        hir::Value* value = builder.createCall(function.function, args);
-
-        // TODO: ?
-
-        builder.createRetVoid();
+        pending.push_back(addFunction(addr));
     }
 
-    builder.SetInsertPoint(defaultBlock);
-    builder.createRetVoid();
-
-    // NOTE: Debugging purposes
-    module.dump();
-
-    // Compile
-    backend::Generate(static_cast<frontend::Module<U32>*>(this));*/
+    // Callers are redirected to the compiled code as each function finishes
+    for (auto* function : pending) {
+        cpu->ppuCompilePool->submit([function] {
+            function->translate();
+        });
+    }
 }
 
 void Module::hook(U32 funcAddr, U32 fnid) {
     auto* cpu = dynamic_cast<GuestCPU*>(parent);
 
-    if (functions.find(funcAddr) == functions.end()) {
-        auto* func = new Function(this);
-        func->declare();
-        functions[funcAddr] = func;
+    Function* func;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = functions.find(funcAddr);
+        if (it == functions.end()) {
+            func = new Function(this);
+            functions[funcAddr] = func;
+        } else {
+            func = static_cast<Function*>(it->second);
+        }
+        if (!func->hirFunction) {
+            func->declare();
+            cpu->ppuDispatcher.insert(funcAddr, func->hirFunction);
+        }
     }
-    auto* hirFunc = functions[funcAddr]->hirFunction;
+
+    // Prevent guest threads and AOT workers from translating the original code
+    std::lock_guard<std::mutex> lock(func->translateMutex);
+    func->translated = true;
+
+    auto* hirFunc = func->hirFunction;
     hirFunc->reset();
 
     hir::Builder builder;
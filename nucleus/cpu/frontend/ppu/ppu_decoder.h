@@ -16,7 +16,9 @@
 #include "nucleus/cpu/frontend/frontend_module.h"
 #include "nucleus/cpu/frontend/ppu/analyzer/ppu_analyzer.h"
 
+#include <atomic>
 #include <map>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -68,9 +70,13 @@ class Function : public frontend::Function {
 
 public:
     // Return/Arguments type
-    FunctionTypeOut type_out;
+    FunctionTypeOut type_out = FUNCTION_OUT_VOID;
     std::vector<FunctionTypeIn> type_in;
 
+    // Serializes translations requested by guest threads and by the AOT workers
+    std::mutex translateMutex;
+    std::atomic<bool> translated{false};
+
     Function(Module* seg) {
         parent = reinterpret_cast<frontend::Module*>(seg);
     }
@@ -87,10 +93,23 @@ public:
 
     // Recompile function
     void recompile();
+
+    // Analyze, recompile and compile this function unless this was already done
+    void translate();
+
+    // Install the compiled code from the persistent cache if the guest code did not change
+    bool loadCache();
+
+    // Save the compiled code into the persistent cache
+    void saveCache();
 };
 
 class Module : public frontend::Module {
 public:
+    // Guards the list of functions against concurrent translations
+    std::mutex mutex;
+
+    // Declare a function (if needed) and make it callable through a placeholder
     Function* addFunction(U32 addr);
 
     // Constructor
@@ -99,7 +118,7 @@ public:
     // Generate a list of functions and analyze them
     void analyze();
 
-    // Recompile each of the functions
+    // Declare each of the functions and translate them in the background
     void recompile();
 
     // Replace a function with a HLE hook
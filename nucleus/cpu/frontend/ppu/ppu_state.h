@@ -293,10 +293,15 @@ public:
     // Reservation Registers
     U64 reserve_addr;
     U64 reserve_value;
+    U64 reserve_version;  // Version of the granule in ReservationTable when reserved
 
     // Program Counter
     U32 pc;
 
+    // Host addresses, loaded by translated code so that it stays position-independent
+    U64 memoryBase;       // Host address of the guest memory
+    U64 reservationBase;  // Host address of the ReservationTable entries
+
 public:
     // Register read
     U32 getCR();
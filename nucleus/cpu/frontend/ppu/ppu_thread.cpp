@@ -8,6 +8,7 @@
 #include "nucleus/cpu/cpu_guest.h"
 #include "nucleus/cpu/frontend/ppu/ppu_state.h"
 #include "nucleus/cpu/frontend/ppu/ppu_decoder.h"
+#include "nucleus/memory/guest_virtual/guest_virtual_memory.h"
 
 namespace cpu {
 namespace frontend {
@@ -15,6 +16,11 @@ namespace ppu {
 
 PPUThread::PPUThread(CPU* parent) : Thread(parent) {
     state = std::make_unique<PPUState>();
+
+    auto* cpu = dynamic_cast<GuestCPU*>(parent);
+    auto* memory = dynamic_cast<mem::GuestVirtualMemory*>(parent->getMemory());
+    state->memoryBase = memory ? reinterpret_cast<U64>(memory->getBaseAddr()) : 0;
+    state->reservationBase = cpu ? reinterpret_cast<U64>(cpu->reservations.getBase()) : 0;
 }
 
 void PPUThread::start() {
@@ -62,31 +68,26 @@ void PPUThread::task()
         }
     }
 
-    if (config.ppuTranslator & CPU_TRANSLATOR_FUNCTION) {
-        for (auto* ppu_segment : cpu->ppu_modules) {
-            if (!ppu_segment->contains(state->pc)) {
-                continue;
+    // Modules translated ahead of time run through the same dispatch until their workers finish
+    if (config.ppuTranslator & (CPU_TRANSLATOR_FUNCTION | CPU_TRANSLATOR_MODULE)) {
+        // Fast path: Function was already declared
+        auto* hirFunction = cpu->ppuDispatcher.lookup(state->pc);
+        if (!hirFunction) {
+            for (auto* ppu_segment : cpu->ppu_modules) {
+                if (ppu_segment->contains(state->pc)) {
+                    hirFunction = ppu_segment->addFunction(state->pc)->hirFunction;
+                    break;
+                }
             }
-
-            auto* function = ppu_segment->addFunction(state->pc);
-            auto* hirFunction = function->hirFunction;
-            if (!(hirFunction->flags & hir::FUNCTION_IS_COMPILED)) {
+        }
+        if (hirFunction) {
+            if (!hirFunction->nativeAddress) {
                 cpu->compiler->compile(hirFunction);
             }
             cpu->compiler->call(hirFunction, state.get());
             return;
         }
     }
-
-    if (config.ppuTranslator & CPU_TRANSLATOR_MODULE) {
-        for (auto* ppu_segment : cpu->ppu_modules) {
-            if (!ppu_segment->contains(state->pc)) {
-                continue;
-            }
-
-            // TODO: ?
-        }
-    }
 }
 
 void PPUThread::run()
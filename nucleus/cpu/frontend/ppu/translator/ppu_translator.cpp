@@ -4,9 +4,8 @@
  */
 
 #include "ppu_translator.h"
-#include "nucleus/cpu/cpu.h"
+#include "nucleus/cpu/cpu_guest.h"
 #include "nucleus/cpu/frontend/ppu/ppu_state.h"
-#include "nucleus/memory/guest_virtual/guest_virtual_memory.h"
 #include "nucleus/core/config.h"
 #include "nucleus/logger/logger.h"
 #include "nucleus/assert.h"
@@ -98,9 +97,6 @@ void Translator::createEpilog() {
 Value* Translator::getGPR(int index, Type type) {
     const U32 offset = offsetof(PPUState, r[index]);
 
-    // TODO: Use volatility information?
-    // Return+Parameter registers and nonvolatile registers are 3 to 10 and 14 onwards respectively
-
     Value* value = builder.createCtxLoad(offset, TYPE_I64);
     if (type != TYPE_I64) {
         return builder.createTrunc(value, type);
@@ -111,9 +107,6 @@ Value* Translator::getGPR(int index, Type type) {
 Value* Translator::getFPR(int index, Type type) {
     const U32 offset = offsetof(PPUState, f[index]);
 
-    // TODO: Use volatility information?
-    // Return+Parameter registers and nonvolatile registers are 1 to 13 and 14 onwards respectively
-
     Value* value = builder.createCtxLoad(offset, TYPE_F64);
     if (type != TYPE_F64) {
         return builder.createConvert(value, type);
@@ -124,14 +117,10 @@ Value* Translator::getFPR(int index, Type type) {
 Value* Translator::getVR(int index) {
     const U32 offset = offsetof(PPUState, v[index]);
 
-    // TODO: Use volatility information?
-
     return builder.createCtxLoad(offset, TYPE_V128);
 }
 
 Value* Translator::getCRField(int index) {
-    // TODO: Use volatility information?
-
     Value* field = builder.createShl(builder.createCtxLoad(
         offsetof(PPUState, cr.field[index].bit[0]), TYPE_I8), U08(3));
     field = builder.createOr(field, builder.createShl(builder.createCtxLoad(
@@ -147,8 +136,6 @@ Value* Translator::getCRField(int index) {
 Value* Translator::getCRBit(int index) {
     const U32 offset = offsetof(PPUState, cr.field[index >> 2].bit[index & 0b11]);
 
-     // TODO: Use volatility information?
-
     return builder.createCtxLoad(offset, TYPE_I8);
 }
 
@@ -211,9 +198,6 @@ Value* Translator::getFPSCR() {
 void Translator::setGPR(int index, Value* value) {
     const U32 offset = offsetof(PPUState, r[index]);
 
-    // TODO: Use volatility information?
-    // Return+Parameter registers and nonvolatile registers are 3 to 10 and 14 onwards respectively
-
     Value* value_i64;
     if (value->type != TYPE_I64) {
         value_i64 = builder.createZExt(value, TYPE_I64);
@@ -227,9 +211,6 @@ void Translator::setGPR(int index, Value* value) {
 void Translator::setFPR(int index, Value* value) {
     const U32 offset = offsetof(PPUState, f[index]);
 
-    // TODO: Use volatility information?
-    // Return+Parameter registers and nonvolatile registers are 1 to 13 and 14 onwards respectively
-
     Value* value_f64;
     if (value->type != TYPE_F64) {
         value_f64 = builder.createConvert(value, TYPE_F64);
@@ -243,14 +224,10 @@ void Translator::setFPR(int index, Value* value) {
 void Translator::setVR(int index, Value* value) {
     const U32 offset = offsetof(PPUState, v[index]);
 
-    // TODO: Use volatility information?
-
     builder.createCtxStore(offset, value);
 }
 
 void Translator::setCRField(int index, Value* value) {
-    // TODO: Use volatility information?
-
     switch (value->type) {
     // Unpack and store the value bits
     case TYPE_I8:
@@ -277,8 +254,6 @@ void Translator::setCRField(int index, Value* value) {
 void Translator::setCRBit(int index, Value* value) {
     const U32 offset = offsetof(PPUState, cr.field[index >> 2].bit[index & 0b11]);
 
-     // TODO: Use volatility information?
-
     builder.createCtxStore(offset, value);
 }
 
@@ -372,8 +347,7 @@ void Translator::setFPSCR(Value* value) {
  */
 Value* Translator::readMemory(hir::Value* addr, hir::Type type) {
     // Get host address
-    void* baseAddress = dynamic_cast<mem::GuestVirtualMemory*>(parent->getMemory())->getBaseAddr();
-    addr = builder.createAdd(addr, builder.getConstantPointer(baseAddress));
+    addr = builder.createAdd(addr, getMemoryBase());
 
     if (type == TYPE_I8) {
         return builder.createLoad(addr, type);
@@ -384,8 +358,7 @@ Value* Translator::readMemory(hir::Value* addr, hir::Type type) {
 
 void Translator::writeMemory(Value* addr, Value* value) {
     // Get host address
-    void* baseAddress = dynamic_cast<mem::GuestVirtualMemory*>(parent->getMemory())->getBaseAddr();
-    addr = builder.createAdd(addr, builder.getConstantPointer(baseAddress));
+    addr = builder.createAdd(addr, getMemoryBase());
 
     if (value->type == TYPE_I8) {
         builder.createStore(addr, value);
@@ -394,6 +367,72 @@ void Translator::writeMemory(Value* addr, Value* value) {
     }
 }
 
+Value* Translator::getMemoryBase() {
+    return builder.createCtxLoad(offsetof(PPUState, memoryBase), TYPE_PTR);
+}
+
+Value* Translator::getReservationVersion(Value* addr) {
+    Value* tableBase = builder.createCtxLoad(offsetof(PPUState, reservationBase), TYPE_PTR);
+    Value* index = builder.createAnd(builder.createShr(addr, U08(ReservationTable::GRANULE_BITS)),
+        builder.getConstantI64(ReservationTable::ENTRY_MASK));
+    return builder.createAdd(builder.createShl(index, U08(3)), tableBase);
+}
+
+Value* Translator::readMemoryReserve(Value* addr, Type type) {
+    // Version is observed before the data, a writer bumps it before and after changing the data
+    Value* version = builder.createLoad(getReservationVersion(addr), TYPE_I64);
+    Value* value = readMemory(addr, type);
+
+    builder.createCtxStore(offsetof(PPUState, reserve_addr), addr);
+    builder.createCtxStore(offsetof(PPUState, reserve_version), version);
+    builder.createCtxStore(offsetof(PPUState, reserve_value),
+        (type == TYPE_I64) ? value : builder.createZExt(value, TYPE_I64));
+    return value;
+}
+
+Value* Translator::writeMemoryConditional(Value* addr, Value* value) {
+    Value* hostAddr = builder.createAdd(addr, getMemoryBase());
+    Value* versionAddr = getReservationVersion(addr);
+
+    // Lock the granule, unless the reservation is lost or was taken while another writer held it
+    Value* reserveAddr = builder.createCtxLoad(offsetof(PPUState, reserve_addr), TYPE_I64);
+    Value* reserveVersion = builder.createCtxLoad(offsetof(PPUState, reserve_version), TYPE_I64);
+    Value* isReserved = builder.createAnd(
+        builder.createCmpEQ(reserveAddr, addr),
+        builder.createCmpEQ(builder.createAnd(reserveVersion, builder.getConstantI64(1)), builder.getConstantI64(0)));
+    Value* version = builder.createSelect(isReserved, reserveVersion,
+        builder.getConstantI64(ReservationTable::VERSION_INVALID));
+    Value* versionLocked = builder.createAdd(version, builder.getConstantI64(1));
+    Value* isLocked = builder.createCmpXchg(versionAddr, version, versionLocked);
+
+    // Plain stores do not update the version, so the reserved data is compared as well.
+    // Without the lock, the reserved value is exchanged with itself, leaving memory untouched.
+    Value* reserveValue = builder.createCtxLoad(offsetof(PPUState, reserve_value), TYPE_I64);
+    if (value->type != TYPE_I64) {
+        reserveValue = builder.createTrunc(reserveValue, value->type);
+    }
+    Value* isStored = builder.createCmpXchg(hostAddr, reserveValue,
+        builder.createSelect(isLocked, value, reserveValue), ENDIAN_BIG);
+
+    // Release the granule, which invalidates every other reservation on it
+    builder.createCmpXchg(versionAddr,
+        builder.createSelect(isLocked, versionLocked, builder.getConstantI64(ReservationTable::VERSION_INVALID)),
+        builder.createAdd(version, builder.getConstantI64(2)));
+
+    // Conditional stores always clear the reservation
+    builder.createCtxStore(offsetof(PPUState, reserve_addr), builder.getConstantI64(~0ULL));
+    return builder.createAnd(isLocked, isStored);
+}
+
+/**
+ * Rotations
+ */
+Value* Translator::rotateWord(Value* value, Value* amount) {
+    // Word rotations replicate the rotated word on both halves of the result
+    Value* word = builder.createZExt(builder.createRol(value, amount), TYPE_I64);
+    return builder.createOr(word, builder.createShl(word, 32));
+}
+
 /**
  * Operation flags
  */
@@ -429,8 +468,8 @@ void Translator::updateCR6(Value* value) {
  * Branching
  */
 void Translator::createFunctionCall(U32 nia, Value* condition) {
-    auto* module = function->parent;
-    auto& targetFunc = static_cast<Function&>(*module->functions.at(nia));
+    auto* module = static_cast<Module*>(function->parent);
+    auto& targetFunc = *module->addFunction(nia);
 
     // Generate array of arguments
     int index = 0;
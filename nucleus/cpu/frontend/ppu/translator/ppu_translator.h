@@ -55,6 +55,13 @@ private:
     // Memory access
     hir::Value* readMemory(hir::Value* addr, hir::Type type);
     void writeMemory(hir::Value* addr, hir::Value* value);
+    hir::Value* readMemoryReserve(hir::Value* addr, hir::Type type);
+    hir::Value* writeMemoryConditional(hir::Value* addr, hir::Value* value);
+    hir::Value* getMemoryBase();
+    hir::Value* getReservationVersion(hir::Value* addr);
+
+    // Rotations
+    hir::Value* rotateWord(hir::Value* value, hir::Value* amount);
 
     // Operation flags
     void updateCR(int field, hir::Value* lhs, hir::Value* rhs, bool logicalComparison);
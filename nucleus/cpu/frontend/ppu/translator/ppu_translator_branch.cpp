@@ -25,10 +25,6 @@ void Translator::bx(Instruction code)
 
     // Unconditional call
     if (code.lk) {
-        if (config.ppuTranslator & CPU_TRANSLATOR_IS_JIT) {
-            auto* module = static_cast<Module*>(function->parent);
-            module->addFunction(targetAddr);
-        }
         createFunctionCall(targetAddr);
     }
 
@@ -82,10 +78,6 @@ void Translator::bcx(Instruction code)
 
     // Unconditional/conditional call
     if (code.lk) {
-        if (config.ppuTranslator & CPU_TRANSLATOR_IS_JIT) {
-            auto* module = static_cast<Module*>(function->parent);
-            module->addFunction(targetAddr);
-        }
         createFunctionCall(targetAddr, cond);
     }
 
@@ -115,7 +107,7 @@ void Translator::bcctrx(Instruction code)
 
     // Conditional function call
     if (code.lk) {
-        if (config.ppuTranslator & CPU_TRANSLATOR_IS_JIT) {
+        if (config.ppuTranslator & (CPU_TRANSLATOR_IS_JIT | CPU_TRANSLATOR_IS_AOT)) {
             hir::Function* proxyFunc = builder.getExternFunction(reinterpret_cast<void*>(nucleusCall));
             if (cond_ok) {
                 builder.createCallCond(cond_ok, proxyFunc, {targetAddr}, hir::CALL_EXTERN);
@@ -127,7 +119,7 @@ void Translator::bcctrx(Instruction code)
 
     // Simple conditional branch
     else {
-        if (config.ppuTranslator & CPU_TRANSLATOR_IS_JIT) {
+        if (config.ppuTranslator & (CPU_TRANSLATOR_IS_JIT | CPU_TRANSLATOR_IS_AOT)) {
             hir::Function* proxyFunc = builder.getExternFunction(reinterpret_cast<void*>(nucleusCall));
             if (cond_ok) {
                 builder.createCallCond(cond_ok, proxyFunc, {targetAddr}, hir::CALL_EXTERN);
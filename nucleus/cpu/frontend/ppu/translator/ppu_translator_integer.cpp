@@ -704,9 +704,7 @@ void Translator::rldicx(Instruction code)
     const U32 sh = code.sh | (code.sh_ << 5);
     const U32 mb = code.mb | (code.mb_ << 5);
     if (sh) {
-        auto resl = builder.createShr(rs, 64 - sh);
-        auto resh = builder.createShl(rs, sh);
-        ra = builder.createOr(resh, resl);
+        ra = builder.createRol(rs, sh);
     }
 
     ra = builder.createAnd(ra, builder.getConstantI64(rotateMask[mb][63 - sh]));
@@ -725,9 +723,7 @@ void Translator::rldiclx(Instruction code)
     const U32 sh = code.sh | (code.sh_ << 5);
     const U32 mb = code.mb | (code.mb_ << 5);
     if (sh) {
-        auto resl = builder.createShr(rs, 64 - sh);
-        auto resh = builder.createShl(rs, sh);
-        ra = builder.createOr(resh, resl);
+        ra = builder.createRol(rs, sh);
     }
 
     ra = builder.createAnd(ra, builder.getConstantI64(rotateMask[mb][63]));
@@ -746,9 +742,7 @@ void Translator::rldicrx(Instruction code)
     const U32 sh = code.sh | (code.sh_ << 5);
     const U32 me = code.me_ | (code.me__ << 5);
     if (sh) {
-        auto resl = builder.createShr(rs, 64 - sh);
-        auto resh = builder.createShl(rs, sh);
-        ra = builder.createOr(resh, resl);
+        ra = builder.createRol(rs, sh);
     }
 
     ra = builder.createAnd(ra, builder.getConstantI64(rotateMask[0][me]));
@@ -768,9 +762,7 @@ void Translator::rldimix(Instruction code)
     const U32 sh = code.sh | (code.sh_ << 5);
     const U32 mb = code.mb | (code.mb_ << 5);
     if (sh) {
-        auto resl = builder.createShr(rs, 64 - sh);
-        auto resh = builder.createShl(rs, sh);
-        temp = builder.createOr(resh, resl);
+        temp = builder.createRol(rs, sh);
     }
 
     const U64 mask = rotateMask[mb][63 - sh];
@@ -786,18 +778,11 @@ void Translator::rldimix(Instruction code)
 
 void Translator::rlwimix(Instruction code)
 {
-    Value* rs_trunc = builder.createZExt(getGPR(code.rs, TYPE_I32), TYPE_I64);
-    Value* rs_shift = builder.createShl(rs_trunc, 32);
-
-    Value* rs = builder.createOr(rs_trunc, rs_shift);
+    Value* rs = getGPR(code.rs, TYPE_I32);
     Value* ra = getGPR(code.ra);
-    Value* temp = rs;
+    Value* temp;
 
-    if (code.sh) {
-        auto resl = builder.createShr(rs, 64 - code.sh);
-        auto resh = builder.createShl(rs, code.sh);
-        temp = builder.createOr(resh, resl);
-    }
+    temp = rotateWord(rs, builder.getConstantI8(code.sh));
 
     const U64 mask = rotateMask[32 + code.mb][32 + code.me];
     temp = builder.createAnd(temp, builder.getConstantI64(mask));
@@ -812,18 +797,10 @@ void Translator::rlwimix(Instruction code)
 
 void Translator::rlwinmx(Instruction code)
 {
-    Value* rs_trunc = builder.createZExt(getGPR(code.rs, TYPE_I32), TYPE_I64);
-    Value* rs_shift = builder.createShl(rs_trunc, 32);
-
-    Value* rs = builder.createOr(rs_trunc, rs_shift);
-    Value* ra = rs;
-
-    if (code.sh) {
-        auto resl = builder.createShr(rs, 64 - code.sh);
-        auto resh = builder.createShl(rs, code.sh);
-        ra = builder.createOr(resh, resl);
-    }
+    Value* rs = getGPR(code.rs, TYPE_I32);
+    Value* ra;
 
+    ra = rotateWord(rs, builder.getConstantI8(code.sh));
     ra = builder.createAnd(ra, builder.getConstantI64(rotateMask[32 + code.mb][32 + code.me]));
     if (code.rc) {
         updateCR0(ra);
@@ -834,18 +811,12 @@ void Translator::rlwinmx(Instruction code)
 
 void Translator::rlwnmx(Instruction code)
 {
-    Value* rs_trunc = builder.createZExt(getGPR(code.rs, TYPE_I32), TYPE_I64);
-    Value* rs_shift = builder.createShl(rs_trunc, 32);
-
-    Value* rs = builder.createOr(rs_trunc, rs_shift);
-    Value* rb = getGPR(code.rb);
+    Value* rs = getGPR(code.rs, TYPE_I32);
+    Value* rb = getGPR(code.rb, TYPE_I8);
     Value* ra;
 
-    auto shl = builder.createAnd(rb, builder.getConstantI64(0x1F));
-    auto shr = builder.createSub(builder.getConstantI64(32), shl);
-    auto resl = builder.createShr(rs, shr);
-    auto resh = builder.createShl(rs, shl);
-    ra = builder.createOr(resh, resl);
+    rb = builder.createAnd(rb, builder.getConstantI8(0x1F));
+    ra = rotateWord(rs, rb);
     ra = builder.createAnd(ra, builder.getConstantI64(rotateMask[32 + code.mb][32 + code.me]));
     if (code.rc) {
         updateCR0(ra);
@@ -101,9 +101,7 @@ void Translator::ldarx(Instruction code)
         addr = builder.createAdd(addr, ra);
     }
 
-    // TODO: Reservation
-
-    rd = readMemory(addr, TYPE_I64);
+    rd = readMemoryReserve(addr, TYPE_I64);
     setGPR(code.rd, rd);
 }
 
@@ -410,9 +408,7 @@ void Translator::lwarx(Instruction code)
         addr = builder.createAdd(addr, ra);
     }
 
-    // TODO: Reservation
-
-    rd = readMemory(addr, TYPE_I32);
+    rd = readMemoryReserve(addr, TYPE_I32);
     setGPR(code.rd, rd);
 }
 
@@ -570,12 +566,11 @@ void Translator::stdcx_(Instruction code)
         addr = builder.createAdd(addr, ra);
     }
 
-    // TODO: Reservation
-
-    // TODO: Is this correct?
-    setCRField(0, builder.getConstantI8(2));
-
-    writeMemory(addr, rs);
+    Value* success = writeMemoryConditional(addr, rs);
+    setCRBit(0, builder.getConstantI8(0));
+    setCRBit(1, builder.getConstantI8(0));
+    setCRBit(2, success);
+    setCRBit(3, getXER_SO());
 }
 
 void Translator::stdu(Instruction code)
@@ -812,12 +807,11 @@ void Translator::stwcx_(Instruction code)
         addr = builder.createAdd(addr, ra);
     }
 
-    // TODO: Reservation
-
-    // TODO: Is this correct?
-    setCRField(0, builder.getConstantI8(2));
-
-    writeMemory(addr, rs);
+    Value* success = writeMemoryConditional(addr, rs);
+    setCRBit(0, builder.getConstantI8(0));
+    setCRBit(1, builder.getConstantI8(0));
+    setCRBit(2, success);
+    setCRBit(3, getXER_SO());
 }
 
 void Translator::stwu(Instruction code)
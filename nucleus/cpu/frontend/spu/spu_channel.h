@@ -7,6 +7,10 @@
 
 #include "nucleus/common.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+
 namespace cpu {
 namespace frontend {
 namespace spu {
@@ -50,32 +54,153 @@ enum ChannelName {
  * =======
  * Represents a SPU channel. While its properties are implementation-defined,
  * at userland they always remain constant. So we set them at compile time.
+ * Entries are passed through a lock-free ring with a single consumer, and the mutex is
+ * only taken when one of the sides has to sleep. Several producers are only allowed to
+ * write through Channel::overwrite, which serializes them.
  * @tparam  N  Channel entries
  * @tparam  B  Blocking channel
  */
 template <Size N, bool B>
 class Channel {
     static_assert(N > 0, "Channels need at least one entry");
+    static_assert((N & (N - 1)) == 0, "Channel entries must be a power of two");
     using Entry = U32;
 
-    Entry data[N];
-    Size index;
+    // Set on ring slots holding an entry, and cleared by the consumer as it takes it
+    static constexpr U64 SLOT_FULL = 1ULL << 32;
+
+    std::atomic<U64> data[N] = {};
+    std::atomic<U32> readCount{ 0 };
+    std::atomic<U32> writeCount{ 0 };
+
+    // Sides sleeping on the channel
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::atomic<U32> sleeping{ 0 };
+
+    // Serializes producers overwriting entries
+    std::mutex producerMutex;
+
+    // Wake the other side if it is sleeping
+    void notify() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(mutex);
+            cv.notify_all();
+        }
+    }
+
+    // Sleep until the condition is satisfied, and wake the other side afterwards
+    template <typename F>
+    void sleep(F condition) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            sleeping += 1;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            cv.wait(lock, condition);
+            sleeping -= 1;
+        }
+        notify();
+    }
+
+    bool pop(Entry& entry) {
+        const U32 index = readCount.load(std::memory_order_relaxed);
+        if (index == writeCount.load(std::memory_order_acquire)) {
+            return false;
+        }
+        entry = Entry(data[index % N].exchange(0, std::memory_order_acq_rel));
+        readCount.store(index + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool push(Entry entry) {
+        const U32 index = writeCount.load(std::memory_order_relaxed);
+        if (index - readCount.load(std::memory_order_acquire) == N) {
+            return false;
+        }
+        data[index % N].store(SLOT_FULL | entry, std::memory_order_relaxed);
+        writeCount.store(index + 1, std::memory_order_release);
+        return true;
+    }
 
 public:
+    // Get the number of entries that can be read
     Size getCount() const {
-        return index + 1;
+        return writeCount.load() - readCount.load();
+    }
+
+    // Get the number of entries that can be written
+    Size getSpace() const {
+        return N - getCount();
+    }
+
+    /**
+     * Read the oldest entry if there is any
+     * @param[out]  entry  Entry read
+     * @return             True if an entry was read
+     */
+    bool tryRead(Entry& entry) {
+        if (!pop(entry)) {
+            return false;
+        }
+        notify();
+        return true;
+    }
+
+    /**
+     * Write an entry if there is space for it
+     * @param[in]  entry  Entry to write
+     * @return            True if the entry was written
+     */
+    bool tryWrite(Entry entry) {
+        if (!push(entry)) {
+            return false;
+        }
+        notify();
+        return true;
     }
 
+    /**
+     * Read the oldest entry, waiting for one on blocking channels.
+     * Non-blocking channels return 0 if they are empty.
+     */
     Entry read() {
-        // TODO: Return data
-        return 0;
+        Entry entry = 0;
+        if (!tryRead(entry) && B) {
+            sleep([&] { return pop(entry); });
+        }
+        return entry;
     }
 
+    /**
+     * Write an entry, waiting for space on blocking channels.
+     * Non-blocking channels replace the newest entry if they are full.
+     */
     void write(Entry entry) {
-        // TODO: Blocking
-        data[index] == entry;
-        if (index < N - 1) {
-            index += 1;
+        if (tryWrite(entry)) {
+            return;
+        }
+        if (B) {
+            sleep([&] { return push(entry); });
+        } else {
+            overwrite(entry);
+        }
+    }
+
+    /**
+     * Write an entry without waiting, replacing the newest entry if the channel is full,
+     * as done by the PPU on the inbound mailbox and the signal notification registers
+     * @param[in]  entry  Entry to write
+     */
+    void overwrite(Entry entry) {
+        std::lock_guard<std::mutex> lock(producerMutex);
+        while (!tryWrite(entry)) {
+            // The newest entry is only replaced if the consumer did not take it meanwhile,
+            // otherwise there is space again and the entry is pushed
+            const U32 index = writeCount.load(std::memory_order_relaxed);
+            if (data[(index - 1) % N].exchange(SLOT_FULL | entry, std::memory_order_acq_rel) & SLOT_FULL) {
+                return;
+            }
         }
     }
 };
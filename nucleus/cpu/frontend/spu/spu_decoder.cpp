@@ -4,7 +4,9 @@
  */
 
 #include "spu_decoder.h"
+#include "nucleus/core/hash.h"
 #include "nucleus/memory/memory.h"
+#include "nucleus/memory/guest_virtual/guest_virtual_memory.h"
 #include "nucleus/cpu/cpu_guest.h"
 #include "nucleus/cpu/util.h"
 #include "nucleus/cpu/hir/builder.h"
@@ -15,6 +17,7 @@
 #include "nucleus/cpu/frontend/spu/spu_thread.h"
 
 #include <algorithm>
+#include <cstring>
 #include <iterator>
 #include <queue>
 #include <set>
@@ -25,13 +28,18 @@ namespace spu {
 
 void nucleusTranslateSPU(void* guestFunc, U64 guestAddr) {
     auto* function = static_cast<frontend::spu::Function*>(guestFunc);
-    function->analyze_cfg();
-    function->recompile();
-
     auto* hirFunction = function->hirFunction;
     auto* cpu = dynamic_cast<GuestCPU*>(CPU::getCurrentThread()->parent);
     auto* state = static_cast<frontend::spu::SPUThread*>(CPU::getCurrentThread())->state.get();
-    cpu->compiler->compile(hirFunction);
+    if (!function->selectVersion()) {
+        function->analyze_cfg();
+        if (!function->loadCache()) {
+            function->recompile();
+            cpu->compiler->compile(hirFunction);
+            function->saveCache();
+        }
+        function->addVersion();
+    }
     cpu->compiler->call(hirFunction, state);
 }
 
@@ -163,7 +171,7 @@ bool Function::analyze_cfg()
             current.branch_a = target_a;
             current.branch_b = target_b;
         }
-        if (code.is_branch_unconditional() && !code.is_call()) {
+        if (code.is_branch_unconditional() && !code.is_call() && !code.is_return()) {
             const U32 target = code.get_target(addr);
             if (!parent->contains(target)) {
                 return false;
@@ -282,7 +290,6 @@ void Function::recompile() {
     }
 
     // Generate prolog/epilog blocks
-    recompiler.blocks[address]->flags |= hir::BLOCK_IS_ENTRY;
     recompiler.createProlog();
     recompiler.createEpilog();
 
@@ -334,6 +341,137 @@ void Function::createPlaceholder() {
     builder.createRet();
 }
 
+bool Function::loadCache() {
+    auto* cpu = dynamic_cast<GuestCPU*>(parent->parent);
+    if (!cpu->spuCache) {
+        return false;
+    }
+
+    auto* module = static_cast<Module*>(parent);
+    return cpu->spuCache->lookup(this, [module](U32 addr) {
+        return module->addFunction(addr)->hirFunction;
+    });
+}
+
+void Function::saveCache() {
+    auto* cpu = dynamic_cast<GuestCPU*>(parent->parent);
+    if (cpu->spuCache) {
+        cpu->spuCache->store(this);
+    }
+}
+
+bool Function::matches(const FunctionVersion& version) const {
+    auto* memory = dynamic_cast<mem::GuestVirtualMemory*>(parent->parent->getMemory());
+    const auto* guestBase = static_cast<const U08*>(memory->getBaseAddr());
+    const U08* code = version.code.data();
+    for (const auto& range : version.ranges) {
+        if (std::memcmp(guestBase + range.address, code, range.size) != 0) {
+            return false;
+        }
+        code += range.size;
+    }
+    return true;
+}
+
+bool Function::matchesEntry(const FunctionVersion& version) const {
+    auto* memory = dynamic_cast<mem::GuestVirtualMemory*>(parent->parent->getMemory());
+    const auto* guestBase = static_cast<const U08*>(memory->getBaseAddr());
+    return core::hashBytes(guestBase + address, version.entrySize) == version.entryHash;
+}
+
+void Function::install(void* nativeAddress, U64 nativeSize) {
+    auto* cpu = dynamic_cast<GuestCPU*>(parent->parent);
+    hirFunction->nativeSize = nativeSize;
+    hirFunction->nativeAddress = nativeAddress;
+    cpu->compiler->updateLinks(hirFunction);
+}
+
+bool Function::selectVersion() {
+    for (auto it = versions.begin(); it != versions.end(); it++) {
+        if (matches(*it)) {
+            std::rotate(versions.begin(), it, it + 1);
+            install(versions.front().nativeAddress, versions.front().nativeSize);
+            installed = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+void Function::addVersion() {
+    auto* cpu = dynamic_cast<GuestCPU*>(parent->parent);
+    auto* memory = dynamic_cast<mem::GuestVirtualMemory*>(parent->parent->getMemory());
+    const auto* guestBase = static_cast<const U08*>(memory->getBaseAddr());
+
+    FunctionVersion version;
+    version.ranges = getCodeRanges();
+    version.hash = core::HASH_SEED;
+    for (const auto& range : version.ranges) {
+        const U08* code = guestBase + range.address;
+        version.hash = core::hashBytes(code, range.size, version.hash);
+        version.code.insert(version.code.end(), code, code + range.size);
+    }
+    auto entry = blocks.find(address);
+    version.entrySize = (entry != blocks.end()) ? U32(entry->second->size) : 0;
+    version.entryHash = core::hashBytes(guestBase + address, version.entrySize);
+    version.nativeAddress = hirFunction->nativeAddress;
+    version.nativeSize = hirFunction->nativeSize;
+
+    // Replace a version of the same code, otherwise forget the least recently used one.
+    // Modules are private to the SPU owning the local storage, and no call site links to
+    // a version that is not installed, so the forgotten code can be released.
+    auto it = std::find_if(versions.begin(), versions.end(), [&](const FunctionVersion& v) {
+        return v.hash == version.hash && v.code == version.code;
+    });
+    if (it == versions.end() && versions.size() >= SPU_MAX_FUNCTION_VERSIONS) {
+        it = versions.end() - 1;
+    }
+    if (it != versions.end()) {
+        if (it->nativeAddress != version.nativeAddress) {
+            cpu->compiler->freeCode(it->nativeAddress);
+        }
+        versions.erase(it);
+    }
+    versions.insert(versions.begin(), std::move(version));
+    installed = true;
+}
+
+void Function::invalidate() {
+    if (installed) {
+        install(placeholderAddress, placeholderSize);
+        installed = false;
+    }
+}
+
+void Function::verify() {
+    if (installed && !matchesEntry(versions.front())) {
+        invalidate();
+    }
+}
+
+void Function::verify(U64 pages) {
+    // DMA transfers often reload identical code, which keeps the installed version
+    if (overlaps(pages) && !matches(versions.front())) {
+        invalidate();
+    }
+}
+
+bool Function::overlaps(U64 pages) const {
+    if (!installed) {
+        return false;
+    }
+    for (const auto& range : versions.front().ranges) {
+        const U32 first = (range.address & 0x3FFFF) / MFCEngine::LS_PAGE_SIZE;
+        const U32 last = ((range.address & 0x3FFFF) + range.size - 1) / MFCEngine::LS_PAGE_SIZE;
+        for (U32 page = first; page <= last && page < 64; page++) {
+            if (pages & (1ULL << page)) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
 /**
  * SPU Module methods
  */
@@ -355,6 +493,8 @@ Function* Module::addFunction(U32 addr) {
     function->declare();
     function->createPlaceholder();
     cpu->compiler->compile(function->hirFunction);
+    function->placeholderAddress = function->hirFunction->nativeAddress;
+    function->placeholderSize = function->hirFunction->nativeSize;
 
     // Save and return the function
     functions[addr] = function;
@@ -428,6 +568,12 @@ void Module::analyze() {
 void Module::recompile() {
 }
 
+void Module::verify(U64 pages) {
+    for (auto& item : functions) {
+        static_cast<Function&>(*item.second).verify(pages);
+    }
+}
+
 void Module::hook(U32 funcAddr, U32 fnid) {
     auto* cpu = dynamic_cast<GuestCPU*>(CPU::getCurrentThread()->parent);
 
@@ -436,7 +582,14 @@ void Module::hook(U32 funcAddr, U32 fnid) {
         func->declare();
         functions[funcAddr] = func;
     }
-    auto* hirFunc = functions[funcAddr]->hirFunction;
+
+    // Hooks replace any translated code for good
+    auto* function = static_cast<Function*>(functions[funcAddr]);
+    function->versions.clear();
+    function->installed = false;
+    function->placeholderAddress = nullptr;
+
+    auto* hirFunc = function->hirFunction;
     hirFunc->reset();
 
     hir::Builder builder;
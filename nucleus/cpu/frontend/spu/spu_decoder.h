@@ -48,6 +48,20 @@ enum FunctionTypeOut {
     FUNCTION_OUT_VOID,        // Nothing is returned
 };
 
+// Maximum number of compiled versions remembered for each function entry
+constexpr Size SPU_MAX_FUNCTION_VERSIONS = 16;
+
+// Compiled code of a function for one particular content of the local storage
+struct FunctionVersion {
+    backend::CacheHash hash;                 // Hash of the guest bytes covered by the ranges
+    std::vector<backend::CodeRange> ranges;  // Guest code the version was translated from
+    std::vector<U08> code;                   // Copy of that guest code, compared after DMA transfers into it
+    U32 entrySize;                           // Size in bytes of the entry block
+    U64 entryHash;                           // Hash of the entry block, compared on entry
+    void* nativeAddress;
+    U64 nativeSize;
+};
+
 class Block : public frontend::Block {
 public:
     bool initial;                   // Is this a function entry block?
@@ -71,6 +85,13 @@ public:
     FunctionTypeOut type_out;
     std::vector<FunctionTypeIn> type_in;
 
+    // Versions compiled so far, most recently used first, and whether the first one is installed.
+    // Otherwise the placeholder is installed, which selects or translates a version when called.
+    std::vector<FunctionVersion> versions;
+    bool installed = false;
+    void* placeholderAddress = nullptr;
+    U64 placeholderSize = 0;
+
     Function(Module* seg) {
         parent = reinterpret_cast<frontend::Module*>(seg);
     }
@@ -87,6 +108,41 @@ public:
 
     // Recompile function
     void recompile();
+
+    // Install the compiled code from the persistent cache if the guest code did not change
+    bool loadCache();
+
+    // Save the compiled code into the persistent cache
+    void saveCache();
+
+    // Install a compiled version matching the current guest code, if any
+    bool selectVersion();
+
+    // Record the compiled code of the function as a new version, and install it
+    void addVersion();
+
+    // Install the placeholder, so that the next call selects or translates a version
+    void invalidate();
+
+    // Install the placeholder if the entry block changed since the installed version was translated
+    void verify();
+
+    // Install the placeholder if the installed version was translated from any of the given
+    // local storage pages and its guest code changed
+    void verify(U64 pages);
+
+    // Check whether the installed version was translated from any of the given local storage pages
+    bool overlaps(U64 pages) const;
+
+private:
+    // Check whether the guest code still matches a version
+    bool matches(const FunctionVersion& version) const;
+
+    // Check whether the entry block still matches a version
+    bool matchesEntry(const FunctionVersion& version) const;
+
+    // Point the function and its call sites to the given code
+    void install(void* nativeAddress, U64 nativeSize);
 };
 
 class Module : public frontend::Module {
@@ -102,6 +158,9 @@ public:
     // Recompile each of the functions
     void recompile();
 
+    // Revalidate the functions translated from the given local storage pages
+    void verify(U64 pages);
+
     // Replace a function with a HLE hook
     void hook(U32 funcAddr, U32 fnid);
 };
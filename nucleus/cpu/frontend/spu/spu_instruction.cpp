@@ -87,6 +87,14 @@ bool Instruction::is_call() const {
     return false;
 }
 
+bool Instruction::is_return() const {
+    // Functions return with an indirect branch through the link register
+    if (op11 == 0x1A8) { // bi
+        return true;
+    }
+    return false;
+}
+
 U32 Instruction::get_target(U32 currentAddr) const {
     // Absolute branches
     if ((op9  == 0x060) || // bra
@@ -0,0 +1,212 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#include "spu_mfc.h"
+#include "nucleus/cpu/frontend/spu/spu_state.h"
+#include "nucleus/memory/guest_virtual/guest_virtual_memory.h"
+#include "nucleus/assert.h"
+
+#include <algorithm>
+
+namespace cpu {
+namespace frontend {
+namespace spu {
+
+MFCEngine::MFCEngine(mem::GuestVirtualMemory* memory) : memory(memory) {
+    worker = std::thread(&MFCEngine::work, this);
+}
+
+MFCEngine::~MFCEngine() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    cvQueue.notify_all();
+    cvTags.notify_all();
+    worker.join();
+}
+
+void MFCEngine::enqueue(const MFCQueueEntry& command) {
+    const U32 tag = command.tag % TAG_COUNT;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cvSpace.wait(lock, [this] { return queue.size() < QUEUE_SIZE; });
+        queue.push_back(command);
+        queue.back().tag = tag;
+        pending[tag] += 1;
+    }
+    cvQueue.notify_one();
+}
+
+U32 MFCEngine::getQueueSpace() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return U32(QUEUE_SIZE - queue.size());
+}
+
+U32 MFCEngine::getCompletedTags(U32 mask) const {
+    U32 completed = 0;
+    for (U32 tag = 0; tag < TAG_COUNT; tag++) {
+        if ((mask & (1 << tag)) && pending[tag] == 0) {
+            completed |= (1 << tag);
+        }
+    }
+    return completed;
+}
+
+bool MFCEngine::isTagStatusReady(U32 mask, U32 update) {
+    std::lock_guard<std::mutex> lock(mutex);
+    const U32 completed = getCompletedTags(mask);
+    switch (update) {
+    case MFC_TAG_UPDATE_ANY:
+        return completed != 0 || mask == 0;
+    case MFC_TAG_UPDATE_ALL:
+        return completed == mask;
+    default:
+        return true;
+    }
+}
+
+U32 MFCEngine::readTagStatus(U32 mask, U32 update) {
+    std::unique_lock<std::mutex> lock(mutex);
+    switch (update) {
+    case MFC_TAG_UPDATE_ANY:
+        cvTags.wait(lock, [&] { return getCompletedTags(mask) != 0 || mask == 0 || stopping; });
+        break;
+    case MFC_TAG_UPDATE_ALL:
+        cvTags.wait(lock, [&] { return getCompletedTags(mask) == mask || stopping; });
+        break;
+    }
+    return getCompletedTags(mask);
+}
+
+bool MFCEngine::isStallStatusReady() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stallNotified != 0;
+}
+
+U32 MFCEngine::readStallStatus() {
+    std::unique_lock<std::mutex> lock(mutex);
+    cvTags.wait(lock, [this] { return stallNotified != 0 || stopping; });
+    const U32 status = stallNotified;
+    stallNotified = 0;
+    return status;
+}
+
+void MFCEngine::acknowledgeStall(U32 tag) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stallWaiting &= ~(1 << (tag % TAG_COUNT));
+    }
+    cvTags.notify_all();
+}
+
+void MFCEngine::markWritten(U32 lsa, U32 size) {
+    if (!size) {
+        return;
+    }
+    const U32 first = (lsa & 0x3FFFF) / LS_PAGE_SIZE;
+    const U32 last = std::min<U32>(((lsa & 0x3FFFF) + size - 1) / LS_PAGE_SIZE, 63);
+    U64 pages = 0;
+    for (U32 page = first; page <= last; page++) {
+        pages |= 1ULL << page;
+    }
+    writtenPages.fetch_or(pages, std::memory_order_release);
+}
+
+U64 MFCEngine::takeWrittenPages() {
+    // Cheap check first, since this is polled on every dispatch
+    if (!writtenPages.load(std::memory_order_relaxed)) {
+        return 0;
+    }
+    return writtenPages.exchange(0, std::memory_order_acquire);
+}
+
+void MFCEngine::stall(U32 tag) {
+    std::unique_lock<std::mutex> lock(mutex);
+    stallNotified |= (1 << tag);
+    stallWaiting |= (1 << tag);
+    cvTags.notify_all();
+    cvTags.wait(lock, [&] { return !(stallWaiting & (1 << tag)) || stopping; });
+}
+
+void MFCEngine::work() {
+    while (true) {
+        MFCQueueEntry command;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cvQueue.wait(lock, [this] { return stopping || !queue.empty(); });
+            if (stopping) {
+                return;
+            }
+            command = queue.front();
+        }
+
+        // Keep the entry queued while running, so that the queue depth stays accurate
+        execute(command);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queue.pop_front();
+            pending[command.tag] -= 1;
+        }
+        cvSpace.notify_one();
+        cvTags.notify_all();
+    }
+}
+
+void MFCEngine::execute(const MFCQueueEntry& command) {
+    if (command.cmd & MFC_LIST_ENABLE) {
+        transferList(command);
+    } else {
+        transfer(command.cmd, command.eal, command.lsa, command.size);
+    }
+}
+
+void MFCEngine::transfer(U32 cmd, U32 eal, U32 lsa, U32 size) {
+    if (cmd & MFC_GET_CMD) {
+        memory->memcpy_g2g(lsa, eal, size);
+        markWritten(lsa, size);
+    } else {
+        memory->memcpy_g2g(eal, lsa, size);
+    }
+}
+
+void MFCEngine::transferList(const MFCQueueEntry& command) {
+    const auto* list = memory->ptr<MFCListElement>(command.eal);
+    const U32 listSize = command.size / sizeof(MFCListElement);
+
+    // Elements continuing the previous one in guest memory extend the current copy
+    U32 eal = 0;
+    U32 lsa = command.lsa;
+    U32 size = 0;
+    for (U32 i = 0; i < listSize; i++) {
+        const auto& entry = list[i];
+        const U32 entryEal = entry.leal;
+        const U32 entrySize = entry.lts;
+        const U16 entryStall = entry.s;
+        if (size && entryEal != eal + size) {
+            transfer(command.cmd, eal, lsa, size);
+            lsa += size;
+            size = 0;
+        }
+        if (!size) {
+            eal = entryEal;
+        }
+        size += entrySize;
+
+        if (entryStall & 0x8000) {
+            transfer(command.cmd, eal, lsa, size);
+            lsa += size;
+            size = 0;
+            stall(command.tag);
+        }
+    }
+    if (size) {
+        transfer(command.cmd, eal, lsa, size);
+    }
+}
+
+}  // namespace spu
+}  // namespace frontend
+}  // namespace cpu
@@ -0,0 +1,151 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/common.h"
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// Forward declarations
+namespace mem { class GuestVirtualMemory; }
+
+namespace cpu {
+namespace frontend {
+namespace spu {
+
+struct MFCQueueEntry {
+    U32 cmd;   // Command opcode, including the barrier, fence and list flags
+    U32 eal;   // Effective address (or list address in local storage)
+    U32 lsa;   // Guest address of the local storage buffer
+    U32 size;  // Transfer size (or list size)
+    U32 tag;   // Tag group
+};
+
+/**
+ * MFC Engine
+ * ==========
+ * Executes the DMA commands issued by a SPU on a helper thread, so that transfers overlap
+ * with the execution of the SPU. Commands wait in a queue of QUEUE_SIZE entries and are
+ * processed in issue order, which satisfies the fence and barrier flags of every tag group
+ * without host memory fences. Completion is tracked for each of the TAG_COUNT tag groups.
+ *
+ * Notes:
+ * - Contiguous list elements are coalesced into a single copy.
+ * - A list element with the stall-and-notify bit stalls the queue until the SPU acknowledges
+ *   it through MFC_WrListStallAck.
+ */
+class MFCEngine {
+public:
+    static constexpr Size QUEUE_SIZE = 16;
+    static constexpr Size TAG_COUNT = 32;
+
+    // Granularity of the local storage write tracking
+    static constexpr U32 LS_PAGE_SIZE = 0x1000;
+
+private:
+    mem::GuestVirtualMemory* memory;
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable cvQueue;  // Command enqueued or engine stopping
+    std::condition_variable cvSpace;  // Queue entry released
+    std::condition_variable cvTags;   // Tag group completed or list stall changed
+
+    std::deque<MFCQueueEntry> queue;
+    std::array<U32, TAG_COUNT> pending = {};  // Commands queued or running on each tag group
+    U32 stallNotified = 0;  // Stalled tag groups not read yet from MFC_RdListStallStat
+    U32 stallWaiting = 0;   // Stalled tag groups not acknowledged yet
+    bool stopping = false;
+
+    // Local storage pages written since the last call to takeWrittenPages, one bit per LS_PAGE_SIZE bytes
+    std::atomic<U64> writtenPages{ 0 };
+
+    // Helper thread entry point
+    void work();
+
+    // Perform the transfers of a command
+    void execute(const MFCQueueEntry& command);
+    void transfer(U32 cmd, U32 eal, U32 lsa, U32 size);
+    void transferList(const MFCQueueEntry& command);
+
+    // Stop the list of a tag group until it is acknowledged
+    void stall(U32 tag);
+
+    // Get the tag groups of the mask without pending commands
+    U32 getCompletedTags(U32 mask) const;
+
+public:
+    MFCEngine(mem::GuestVirtualMemory* memory);
+    ~MFCEngine();
+
+    /**
+     * Queue a command, waiting if the queue is full
+     * @param[in]  command  DMA command
+     */
+    void enqueue(const MFCQueueEntry& command);
+
+    /**
+     * Get the number of free queue entries, as read by rchcnt on MFC_Cmd
+     * @return  Free entries
+     */
+    U32 getQueueSpace();
+
+    /**
+     * Get the tag group status, as read from MFC_RdTagStat
+     * @param[in]  mask    Tag groups to query
+     * @param[in]  update  Condition to wait for, as written to MFC_WrTagUpdate
+     * @return             Tag groups of the mask with all their commands completed
+     */
+    U32 readTagStatus(U32 mask, U32 update);
+
+    /**
+     * Check whether reading the tag group status would not block
+     * @param[in]  mask    Tag groups to query
+     * @param[in]  update  Condition to wait for, as written to MFC_WrTagUpdate
+     * @return             True if the condition is satisfied
+     */
+    bool isTagStatusReady(U32 mask, U32 update);
+
+    /**
+     * Get and clear the stalled tag groups, as read from MFC_RdListStallStat
+     * @return  Tag groups stalled since the previous read
+     */
+    U32 readStallStatus();
+
+    /**
+     * Check whether reading the list stall status would not block
+     * @return  True if any stalled tag group was not read yet
+     */
+    bool isStallStatusReady();
+
+    /**
+     * Resume a stalled list, as written to MFC_WrListStallAck
+     * @param[in]  tag  Tag group
+     */
+    void acknowledgeStall(U32 tag);
+
+    /**
+     * Record a write to local storage, so that code translated from it can be revalidated
+     * @param[in]  lsa   Guest address of the written local storage bytes
+     * @param[in]  size  Number of bytes written
+     */
+    void markWritten(U32 lsa, U32 size);
+
+    /**
+     * Get and clear the local storage pages written by transfers
+     * @return  Mask of written pages, bit i covering the bytes at i * LS_PAGE_SIZE
+     */
+    U64 takeWrittenPages();
+};
+
+}  // namespace spu
+}  // namespace frontend
+}  // namespace cpu
@@ -0,0 +1,130 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#include "spu_scheduler.h"
+#include "nucleus/cpu/frontend/spu/spu_thread.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#if defined(NUCLEUS_TARGET_WINDOWS)
+#include <Windows.h>
+#elif defined(NUCLEUS_TARGET_LINUX)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace cpu {
+namespace frontend {
+namespace spu {
+
+SPUScheduler::SPUScheduler(Size slotCount) {
+    hostCores = std::max<Size>(std::thread::hardware_concurrency(), 1);
+    if (slotCount == 0) {
+        slotCount = hostCores;
+    }
+    busy.resize(slotCount, false);
+}
+
+SPUScheduler::Waiter* SPUScheduler::first() const {
+    Waiter* result = nullptr;
+    for (auto* waiter : waiters) {
+        if (!result || waiter->priority < result->priority ||
+            (waiter->priority == result->priority && waiter->arrival < result->arrival)) {
+            result = waiter;
+        }
+    }
+    return result;
+}
+
+S32 SPUScheduler::take(std::unique_lock<std::mutex>& lock, S32 priority) {
+    // Free slots are only taken if nobody is queued, otherwise they would already be granted
+    if (waiters.empty()) {
+        const auto it = std::find(busy.begin(), busy.end(), false);
+        if (it != busy.end()) {
+            *it = true;
+            return S32(it - busy.begin());
+        }
+    }
+
+    Waiter waiter;
+    waiter.priority = priority;
+    waiter.arrival = arrivals++;
+    waiter.slot = -1;
+    waiters.push_back(&waiter);
+    waiter.cv.wait(lock, [&] { return waiter.slot >= 0; });
+    return waiter.slot;
+}
+
+void SPUScheduler::grant(S32 slot) {
+    auto* waiter = first();
+    if (!waiter) {
+        busy[slot] = false;
+        return;
+    }
+    waiters.erase(std::find(waiters.begin(), waiters.end(), waiter));
+    waiter->slot = slot;
+    waiter->cv.notify_one();
+}
+
+void SPUScheduler::pin(S32 slot) {
+    const Size core = Size(slot) % hostCores;
+#if defined(NUCLEUS_TARGET_WINDOWS)
+    if (core < 64) {
+        SetThreadAffinityMask(GetCurrentThread(), DWORD_PTR(1) << core);
+    }
+#elif defined(NUCLEUS_TARGET_LINUX)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+}
+
+void SPUScheduler::acquire(SPUThread* thread) {
+    const S32 previous = thread->slot;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        thread->slot = take(lock, thread->priority.load());
+    }
+    if (thread->slot != previous) {
+        pin(thread->slot);
+    }
+    thread->sliceStart = std::chrono::steady_clock::now();
+}
+
+void SPUScheduler::release(SPUThread* thread) {
+    std::lock_guard<std::mutex> lock(mutex);
+    grant(thread->slot);
+}
+
+void SPUScheduler::yield(SPUThread* thread) {
+    const auto elapsed = std::chrono::steady_clock::now() - thread->sliceStart;
+    if (elapsed < std::chrono::microseconds(SPU_SCHEDULER_QUANTUM_US)) {
+        return;
+    }
+
+    const S32 previous = thread->slot;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        const auto* waiter = first();
+        const S32 priority = thread->priority.load();
+        if (!waiter || waiter->priority > priority) {
+            thread->sliceStart = std::chrono::steady_clock::now();
+            return;
+        }
+        grant(thread->slot);
+        thread->slot = take(lock, priority);
+    }
+    if (thread->slot != previous) {
+        pin(thread->slot);
+    }
+    thread->sliceStart = std::chrono::steady_clock::now();
+}
+
+}  // namespace spu
+}  // namespace frontend
+}  // namespace cpu
@@ -0,0 +1,93 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/common.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+
+namespace cpu {
+namespace frontend {
+namespace spu {
+
+// Forward declarations
+class SPUThread;
+
+// Time an SPU thread may keep its slot while other threads are waiting for one
+constexpr U32 SPU_SCHEDULER_QUANTUM_US = 2000;
+
+/**
+ * SPU Scheduler
+ * =============
+ * Bounds the number of SPU threads executing guest code at once. Each thread must hold
+ * one of the run slots while it executes, and gives it up while blocked on channels or DMA
+ * completion, so that blocked threads sleep without occupying a host core. Slot k runs on
+ * host core k. Waiting threads receive slots in order of their thread group priority (lower
+ * values first), and in order of arrival within the same priority.
+ */
+class SPUScheduler {
+    struct Waiter {
+        S32 priority;
+        U64 arrival;
+        S32 slot;
+        std::condition_variable cv;
+    };
+
+    std::mutex mutex;
+    std::vector<bool> busy;
+    std::vector<Waiter*> waiters;
+    U64 arrivals = 0;
+    Size hostCores;
+
+    // Take a free slot, or wait for one to be granted
+    S32 take(std::unique_lock<std::mutex>& lock, S32 priority);
+
+    // Hand a slot over to the first waiter, or mark it as free if there is none
+    void grant(S32 slot);
+
+    // Get the first waiter, if any
+    Waiter* first() const;
+
+    // Bind the calling host thread to the core of a slot
+    void pin(S32 slot);
+
+public:
+    /**
+     * Constructor
+     * @param[in]  slotCount  Number of SPU threads executing at once, or 0 to use one per host core
+     */
+    SPUScheduler(Size slotCount = 0);
+
+    /**
+     * Block until the thread holds a run slot
+     * @param[in]  thread  Calling SPU thread
+     */
+    void acquire(SPUThread* thread);
+
+    /**
+     * Give up the run slot held by the thread
+     * @param[in]  thread  Calling SPU thread
+     */
+    void release(SPUThread* thread);
+
+    /**
+     * Give up the run slot if a thread of the same or higher priority is waiting and the
+     * quantum of the thread expired, then block until it holds a slot again
+     * @param[in]  thread  Calling SPU thread
+     */
+    void yield(SPUThread* thread);
+
+    // Get the number of run slots
+    Size getSlotCount() const {
+        return busy.size();
+    }
+};
+
+}  // namespace spu
+}  // namespace frontend
+}  // namespace cpu
@@ -63,6 +63,19 @@ enum MFCCommand {
     MFC_PUTQLLUC_CMD    = 0x00B8,  // SPU Only
 };
 
+enum MFCTagUpdate : U32 {
+    MFC_TAG_UPDATE_IMMEDIATE = 0x0000,
+    MFC_TAG_UPDATE_ANY       = 0x0001,
+    MFC_TAG_UPDATE_ALL       = 0x0002,
+};
+
+enum MFCAtomicStatus : U32 {
+    MFC_PUTLLC_SUCCESS  = 0x0000,
+    MFC_PUTLLC_FAILURE  = 0x0001,
+    MFC_PUTLLUC_SUCCESS = 0x0002,
+    MFC_GETLLAR_SUCCESS = 0x0004,
+};
+
 struct MFCListElement {
     BE<U16> s;     // Stall-and-notify bit (0x8000)
     BE<U16> lts;   // List element transfer size (LTS)
@@ -87,6 +100,10 @@ public:
         };
     };
     U32 lsa;
+
+    // Tag group query
+    U32 tagMask;
+    U32 tagUpdate;
 };
 
 class alignas(16) SPUState {
@@ -97,9 +114,17 @@ public:
     // Program Counter
     U32 pc;
 
+    // Host address of the guest memory, loaded by translated code so that it stays position-independent
+    U64 memoryBase;
+
     // Memory Flow Controller
     MFC mfc;
 
+    // Lock-line reservation
+    U32 reserve_addr;
+    U64 reserve_version;  // Version of the granule in ReservationTable when reserved
+    U08 reserve_data[128];
+
     // Channels
     Channel<1, false> chTagStat;       // MFC Tag Group Status
     Channel<1, false> chListStallStat; // MFC List Stall-and-Notify Tag Acknowledgment
@@ -11,14 +11,7 @@
 #include "nucleus/memory/guest_virtual/guest_virtual_memory.h"
 #include "nucleus/assert.h"
 
-#ifdef NUCLEUS_ARCH_X86
-#ifdef NUCLEUS_COMPILER_MSVC
-#include <intrin.h>
-#else
-#include <x86intrin.h>
-#endif
-#endif
-
+#include <atomic>
 #include <cstring>
 
 namespace cpu {
@@ -26,25 +19,35 @@ namespace frontend {
 namespace spu {
 
 SPUThread::SPUThread(CPU* parent) : Thread(parent) {
+    auto* memory = dynamic_cast<mem::GuestVirtualMemory*>(parent->getMemory());
     state = std::make_unique<SPUState>();
+    state->memoryBase = memory ? reinterpret_cast<U64>(memory->getBaseAddr()) : 0;
+    mfcEngine = std::make_unique<MFCEngine>(memory);
+}
+
+SPUThread::~SPUThread() {
 }
 
 void SPUThread::start() {
     m_thread = std::thread([&](){
+        auto* scheduler = dynamic_cast<GuestCPU*>(parent)->spuScheduler.get();
         parent->setCurrentThread(this);
+        scheduler->acquire(this);
         task();
+        scheduler->release(this);
     });
 }
 
 void SPUThread::task() {
     auto* cpu = dynamic_cast<GuestCPU*>(parent);
 
-     if (config.spuTranslator & CPU_TRANSLATOR_FUNCTION) {
-        for (auto* spu_segment : cpu->spu_modules) {
+    if (config.spuTranslator & CPU_TRANSLATOR_FUNCTION) {
+        for (auto* spu_segment : getModules()) {
             if (!spu_segment->contains(state->pc)) {
                 continue;
             }
 
+            // Translated code is revalidated by the function prolog
             auto* function = spu_segment->addFunction(state->pc);
             auto* hirFunction = function->hirFunction;
             if (!(hirFunction->flags & hir::FUNCTION_IS_COMPILED)) {
@@ -56,6 +59,46 @@ void SPUThread::task() {
     }
 }
 
+const std::vector<Module*>& SPUThread::getModules() {
+    auto* cpu = dynamic_cast<GuestCPU*>(parent);
+    if (cpu->getSpuModulesVersion() != modulesVersion) {
+        modules = cpu->getSpuModules(modulesVersion);
+    }
+    return modules;
+}
+
+bool SPUThread::enterFunction(U32 addr) {
+    const U32 lsBase = addr & ~0x3FFFF;
+
+    // Function entries are reached periodically, letting waiting threads run
+    yield();
+
+    // Code translated from local storage overwritten by DMA transfers is compared in full
+    const U64 writtenPages = mfcEngine->takeWrittenPages();
+    if (writtenPages) {
+        for (auto* spu_segment : getModules()) {
+            if ((spu_segment->address & ~0x3FFFF) == lsBase) {
+                spu_segment->verify(writtenPages);
+            }
+        }
+    }
+
+    // Checking the entry block of the entered function also catches code modified by the SPU itself
+    for (auto* spu_segment : getModules()) {
+        if (!spu_segment->contains(addr)) {
+            continue;
+        }
+        auto it = spu_segment->functions.find(addr);
+        if (it == spu_segment->functions.end()) {
+            return false;
+        }
+        auto* function = static_cast<Function*>(it->second);
+        function->verify();
+        return !function->installed;
+    }
+    return false;
+}
+
 void SPUThread::run() {
     std::lock_guard<std::mutex> lock(m_mutex);
     m_event = NUCLEUS_EVENT_RUN;
@@ -72,8 +115,44 @@ void SPUThread::stop() {
     m_event = NUCLEUS_EVENT_STOP;
 }
 
+void SPUThread::beginWait() {
+    dynamic_cast<GuestCPU*>(parent)->spuScheduler->release(this);
+}
+
+void SPUThread::endWait() {
+    dynamic_cast<GuestCPU*>(parent)->spuScheduler->acquire(this);
+}
+
+void SPUThread::yield() {
+    dynamic_cast<GuestCPU*>(parent)->spuScheduler->yield(this);
+}
+
+U32 SPUThread::getLocalStorageBase() const {
+    // Local storage is the 256 KB region of guest memory containing the program counter
+    return state->pc & ~0x3FFFF;
+}
+
+U32 SPUThread::getMailboxStatus() const {
+    // Layout of SPU_Mbox_Stat: Outbound count, inbound space and outbound interrupt count
+    U32 status = 0;
+    status |= U32(state->chOutMbox.getCount()) << 0;
+    status |= U32(state->chInMbox.getSpace()) << 8;
+    status |= U32(state->chOutIntrMbox.getCount()) << 16;
+    return status;
+}
+
+bool SPUThread::readOutMbox(U32& value) {
+    // Reading an outbound mailbox frees its entry, resuming the SPU if it stalled writing another one
+    return state->chOutMbox.tryRead(value);
+}
+
+bool SPUThread::readOutIntrMbox(U32& value) {
+    return state->chOutIntrMbox.tryRead(value);
+}
+
 void SPUThread::mfcCommand(U32 cmd) {
     const auto& mfc = state->mfc;
+    const U32 lsBase = getLocalStorageBase();
     switch (cmd) {
     case MFC_PUT_CMD:
     case MFC_PUTB_CMD:
@@ -84,7 +163,7 @@ void SPUThread::mfcCommand(U32 cmd) {
     case MFC_GET_CMD:
     case MFC_GETB_CMD:
     case MFC_GETF_CMD:
-        dmaTransfer(cmd, mfc.eal, mfc.lsa, mfc.size);
+        mfcEngine->enqueue({ cmd, mfc.eal, lsBase + mfc.lsa, mfc.size, mfc.tag });
         break;
 
     case MFC_PUTL_CMD:
@@ -96,50 +175,78 @@ void SPUThread::mfcCommand(U32 cmd) {
     case MFC_GETL_CMD:
     case MFC_GETLB_CMD:
     case MFC_GETLF_CMD:
-        dmaTransferList(cmd, mfc.eal, mfc.lsa, mfc.size);
+        mfcEngine->enqueue({ cmd, lsBase + (mfc.eal & 0x3FFFF), lsBase + mfc.lsa, mfc.size, mfc.tag });
         break;
 
-    default:
-        assert_always("Unimplemented");
-    }
-}
-
-void SPUThread::dmaTransfer(U32 cmd, U32 eal, U32 lsa, U32 size) {
-    if (cmd & (MFC_BARRIER_ENABLE | MFC_FENCE_ENABLE)) {
-#ifdef NUCLEUS_ARCH_X86
-        _mm_mfence();
-#endif
-    }
-
-    auto* memory = parent->getMemory();
-    switch (cmd & ~(MFC_BARRIER_ENABLE | MFC_FENCE_ENABLE)) {
-    case MFC_PUT_CMD:
-    case MFC_PUTR_CMD:
-        memory->memcpy_g2g(eal, lsa, size);
+    // Queued commands are already processed in issue order
+    case MFC_BARRIER_CMD:
+    case MFC_EIEIO_CMD:
+    case MFC_SYNC_CMD:
         break;
-    case MFC_GET_CMD:
-        memory->memcpy_g2g(lsa, eal, size);
+
+    case MFC_GETLLAR_CMD:
+    case MFC_PUTLLC_CMD:
+    case MFC_PUTLLUC_CMD:
+    case MFC_PUTQLLUC_CMD:
+        atomicTransfer(cmd, mfc.eal, lsBase + mfc.lsa);
         break;
+
     default:
-        assert_true("Unexpected");
+        assert_always("Unimplemented");
     }
 }
 
-void SPUThread::dmaTransferList(U32 cmd, U32 eal, U32 lsa, U32 size) {
-    const U32 listAddr = eal & 0x3ffff;
-    const U32 listSize = size / 8;
+void SPUThread::atomicTransfer(U32 cmd, U32 eal, U32 lsa) {
+    constexpr U32 lineSize = ReservationTable::GRANULE_SIZE;
+    const U32 line = eal & ~(lineSize - 1);
 
+    auto& reservations = dynamic_cast<GuestCPU*>(parent)->reservations;
     auto* memory = dynamic_cast<mem::GuestVirtualMemory*>(parent->getMemory());
-    auto* list = memory->ptr<MFCListElement>(listAddr);
+    auto* lineData = memory->ptr<U08>(line);
+    auto* localData = memory->ptr<U08>(lsa & ~(lineSize - 1));
 
-    for (Size i = 0; i < listSize; i++) {
-        const auto& entry = list[i];
-        if (entry.lts) {
-            dmaTransfer(cmd, entry.leal, lsa, entry.lts);
+    switch (cmd) {
+    case MFC_GETLLAR_CMD: {
+        // Retry until the line is copied without any writer modifying it meanwhile
+        U64 version;
+        do {
+            version = reservations.acquire(line);
+            std::memcpy(state->reserve_data, lineData, lineSize);
+            std::atomic_thread_fence(std::memory_order_acquire);
+        } while (reservations.getVersion(line).load(std::memory_order_relaxed) != version);
+
+        std::memcpy(localData, state->reserve_data, lineSize);
+        mfcEngine->markWritten(lsa & ~(lineSize - 1), lineSize);
+        state->reserve_addr = line;
+        state->reserve_version = version;
+        state->chAtomicStat.write(MFC_GETLLAR_SUCCESS);
+        break;
+    }
+    case MFC_PUTLLC_CMD: {
+        // Plain stores do not update the version, so the reserved data is compared as well
+        bool success = false;
+        if (state->reserve_addr == line && reservations.lock(line, state->reserve_version)) {
+            success = std::memcmp(lineData, state->reserve_data, lineSize) == 0;
+            if (success) {
+                std::memcpy(lineData, localData, lineSize);
+            }
+            reservations.unlock(line);
         }
-        if (entry.s) {
-            assert_always("Unimplemented");
+        state->reserve_addr = ~0U;
+        state->chAtomicStat.write(success ? MFC_PUTLLC_SUCCESS : MFC_PUTLLC_FAILURE);
+        break;
+    }
+    case MFC_PUTLLUC_CMD:
+    case MFC_PUTQLLUC_CMD:
+        reservations.lockAlways(line);
+        std::memcpy(lineData, localData, lineSize);
+        reservations.unlock(line);
+        if (cmd == MFC_PUTLLUC_CMD) {
+            state->chAtomicStat.write(MFC_PUTLLUC_SUCCESS);
         }
+        break;
+    default:
+        assert_always("Unexpected");
     }
 }
 
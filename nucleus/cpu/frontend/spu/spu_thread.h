@@ -7,17 +7,36 @@
 
 #include "nucleus/common.h"
 #include "nucleus/cpu/thread.h"
+#include "nucleus/cpu/frontend/spu/spu_mfc.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <vector>
 
 namespace cpu {
 namespace frontend {
 namespace spu {
 
 // Forward declarations
+class Module;
 class SPUState;
 
 class SPUThread : public Thread {
+    // Copy of the SPU modules of the parent CPU, refreshed whenever their version changes
+    std::vector<Module*> modules;
+    U32 modulesVersion = ~0U;
+
+    const std::vector<Module*>& getModules();
+
 public:
     std::unique_ptr<SPUState> state;
+    std::unique_ptr<MFCEngine> mfcEngine;
+
+    // Scheduling state, managed by the SPU scheduler
+    std::atomic<S32> priority{ 0 };
+    S32 slot = -1;
+    std::chrono::steady_clock::time_point sliceStart;
 
     SPUThread(CPU* parent = nullptr);
     ~SPUThread();
@@ -30,9 +49,30 @@ public:
     virtual void pause() override;
     virtual void stop() override;
 
+    // Get the guest address where the local storage of this SPU is mapped
+    U32 getLocalStorageBase() const;
+
+    /**
+     * Revalidate the translated code of a function as it is entered
+     * @param[in]  addr  Guest address of the function entry
+     * @return           True if the running code is stale and the function has to be entered again
+     */
+    bool enterFunction(U32 addr);
+
+    // Give up the run slot before blocking, and take it back afterwards
+    void beginWait();
+    void endWait();
+
+    // Let waiting threads run if the quantum of this thread expired
+    void yield();
+
+    // Problem state mailbox registers, accessed by the PPU
+    U32 getMailboxStatus() const;
+    bool readOutMbox(U32& value);
+    bool readOutIntrMbox(U32& value);
+
     void mfcCommand(U32 cmd);
-    void dmaTransfer(U32 cmd, U32 eal, U32 lsa, U32 size);
-    void dmaTransferList(U32 cmd, U32 eal, U32 lsa, U32 size);
+    void atomicTransfer(U32 cmd, U32 eal, U32 lsa);
 };
 
 }  // namespace ppu
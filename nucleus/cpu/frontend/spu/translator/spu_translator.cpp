@@ -5,9 +5,9 @@
 
 #include "spu_translator.h"
 #include "nucleus/cpu/frontend/spu/spu_state.h"
+#include "nucleus/cpu/frontend/spu/spu_thread.h"
 #include "nucleus/cpu/thread.h"
 #include "nucleus/core/config.h"
-#include "nucleus/memory/guest_virtual/guest_virtual_memory.h"
 #include "nucleus/assert.h"
 
 namespace cpu {
@@ -16,6 +16,16 @@ namespace spu {
 
 using namespace cpu::hir;
 
+U32 nucleusEnterSPU(U64 guestAddr) {
+    auto* thread = static_cast<frontend::spu::SPUThread*>(CPU::getCurrentThread());
+    return thread->enterFunction(U32(guestAddr)) ? 1 : 0;
+}
+
+void nucleusYieldSPU() {
+    auto* thread = static_cast<frontend::spu::SPUThread*>(CPU::getCurrentThread());
+    thread->yield();
+}
+
 Translator::Translator(CPU* parent, spu::Function* function) : parent(parent), IRecompiler(function) {
 }
 
@@ -54,10 +64,8 @@ Value* Translator::readMemory(hir::Value* addr, hir::Type type) {
     assert_true(type == TYPE_V128);
 
     // Get host address
-    auto* memory = dynamic_cast<mem::GuestVirtualMemory*>(CPU::getCurrentThread()->getMemory());
-    void* baseAddress = memory->getBaseAddr();
     addr = builder.createZExt(addr, TYPE_PTR);
-    addr = builder.createAdd(addr, builder.getConstantPointer(baseAddress));
+    addr = builder.createAdd(addr, builder.createCtxLoad(offsetof(SPUState, memoryBase), TYPE_PTR));
     return builder.createLoad(addr, type, ENDIAN_BIG);
 }
 
@@ -65,14 +73,40 @@ void Translator::writeMemory(Value* addr, Value* value) {
     assert_true(value->type == TYPE_V128);
 
     // Get host address
-    auto* memory = dynamic_cast<mem::GuestVirtualMemory*>(CPU::getCurrentThread()->getMemory());
-    void* baseAddress = memory->getBaseAddr();
     addr = builder.createZExt(addr, TYPE_PTR);
-    addr = builder.createAdd(addr, builder.getConstantPointer(baseAddress));
+    addr = builder.createAdd(addr, builder.createCtxLoad(offsetof(SPUState, memoryBase), TYPE_PTR));
     builder.createStore(addr, value, ENDIAN_BIG);
 }
 
+/**
+ * Scheduling
+ */
+void Translator::createBackEdgeYield(U32 targetAddr) {
+    // Loops might never enter another function, so their back-edges let waiting threads run
+    if (targetAddr > currentAddress) {
+        return;
+    }
+    hir::Function* yieldFunc = builder.getExternFunction(reinterpret_cast<void*>(nucleusYieldSPU));
+    builder.createCall(yieldFunc, {}, hir::CALL_EXTERN);
+}
+
 void Translator::createProlog() {
+    assert_true(prolog == nullptr, "The frontend prolog block was already declared");
+
+    // Every entry revalidates the code, and enters the function again if it became stale.
+    // Conditional branches fall through to the next block, so the reentry follows the prolog.
+    prolog = new hir::Block(function->hirFunction);
+    prolog->flags |= BLOCK_IS_ENTRY;
+    hir::Block* reenter = new hir::Block(function->hirFunction);
+
+    builder.setInsertPoint(prolog);
+    hir::Function* enterFunc = builder.getExternFunction(reinterpret_cast<void*>(nucleusEnterSPU), TYPE_I32, { TYPE_I64 });
+    Value* stale = builder.createCall(enterFunc, { builder.getConstantI64(function->address) }, hir::CALL_EXTERN);
+    builder.createBrCond(builder.createCmpEQ(stale, builder.getConstantI32(0)), blocks.at(function->address), reenter);
+
+    builder.setInsertPoint(reenter);
+    builder.createCall(function->hirFunction);
+    builder.createRet();
 }
 
 void Translator::createEpilog() {
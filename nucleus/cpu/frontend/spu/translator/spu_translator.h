@@ -32,6 +32,9 @@ private:
     hir::Value* readMemory(hir::Value* addr, hir::Type type);
     void writeMemory(hir::Value* addr, hir::Value* value);
 
+    // Scheduling
+    void createBackEdgeYield(U32 targetAddr);
+
 public:
     hir::Builder builder;
 
@@ -99,6 +99,7 @@ void Translator::brhnz(Instruction code)
 {
     const U32 targetAddr = currentAddress + (code.i16 << 2);
     const U32 nextAddr = currentAddress + 4;
+    createBackEdgeYield(targetAddr);
 
     Value* ps = builder.createExtract(getGPR(code.rt), builder.getConstantI8(7), TYPE_I16);
     Value* zero = builder.getConstantI16(0);
@@ -111,6 +112,7 @@ void Translator::brhz(Instruction code)
 {
     const U32 targetAddr = currentAddress + (code.i16 << 2);
     const U32 nextAddr = currentAddress + 4;
+    createBackEdgeYield(targetAddr);
 
     Value* ps = builder.createExtract(getGPR(code.rt), builder.getConstantI8(7), TYPE_I16);
     Value* zero = builder.getConstantI16(0);
@@ -123,6 +125,7 @@ void Translator::brnz(Instruction code)
 {
     const U32 targetAddr = currentAddress + (code.i16 << 2);
     const U32 nextAddr = currentAddress + 4;
+    createBackEdgeYield(targetAddr);
 
     Value* ps = builder.createExtract(getGPR(code.rt), builder.getConstantI8(3), TYPE_I32);
     Value* zero = builder.getConstantI32(0);
@@ -150,6 +153,7 @@ void Translator::brz(Instruction code)
 {
     const U32 targetAddr = currentAddress + (code.i16 << 2);
     const U32 nextAddr = currentAddress + 4;
+    createBackEdgeYield(targetAddr);
 
     Value* ps = builder.createExtract(getGPR(code.rt), builder.getConstantI8(3), TYPE_I32);
     Value* zero = builder.getConstantI32(0);
@@ -25,6 +25,28 @@ namespace spu {
 
 using namespace cpu::hir;
 
+// Read a blocking channel, giving up the run slot of the thread while it waits
+template <Size N>
+static U32 readChannel(SPUThread& thread, Channel<N, true>& channel) {
+    U32 entry;
+    if (!channel.tryRead(entry)) {
+        thread.beginWait();
+        entry = channel.read();
+        thread.endWait();
+    }
+    return entry;
+}
+
+// Write a blocking channel, giving up the run slot of the thread while it waits
+template <Size N>
+static void writeChannel(SPUThread& thread, Channel<N, true>& channel, U32 entry) {
+    if (!channel.tryWrite(entry)) {
+        thread.beginWait();
+        channel.write(entry);
+        thread.endWait();
+    }
+}
+
 /**
  * SPU Instructions:
  *  - Channel Instructions (Chapter 11)
@@ -36,17 +58,23 @@ void Translator::rchcnt(Instruction code)
     INTERPRET({
         U32& rt = state.r[i.rt].u32[3];
         switch (i.ca) {
-        case SPU_WrOutMbox:        rt = state.chOutMbox.getCount();       break;
-        case SPU_WrOutIntrMbox:    rt = state.chOutIntrMbox.getCount();   break;
+        case SPU_WrOutMbox:        rt = state.chOutMbox.getSpace();       break;
+        case SPU_WrOutIntrMbox:    rt = state.chOutIntrMbox.getSpace();   break;
         case SPU_RdInMbox:         rt = state.chInMbox.getCount();        break;
-        case MFC_RdTagStat:        rt = state.chTagStat.getCount();       break;
-        case MFC_RdListStallStat:  rt = state.chListStallStat.getCount(); break;
+        case MFC_Cmd:              rt = thread.mfcEngine->getQueueSpace(); break;
+        case MFC_RdTagStat:        rt = thread.mfcEngine->isTagStatusReady(state.mfc.tagMask, state.mfc.tagUpdate); break;
+        case MFC_RdListStallStat:  rt = thread.mfcEngine->isStallStatusReady(); break;
         case SPU_RdSigNotify1:     rt = state.chSigNotify1.getCount();    break;
         case SPU_RdSigNotify2:     rt = state.chSigNotify2.getCount();    break;
         case MFC_RdAtomicStat:     rt = state.chAtomicStat.getCount();    break;
         default:
             assert_always("Unimplemented");
         }
+
+        // Channels are polled by loops on the count, letting waiting threads run meanwhile
+        if (rt == 0) {
+            thread.yield();
+        }
     });
 }
 
@@ -55,6 +83,15 @@ void Translator::rdch(Instruction code)
     INTERPRET({
         U32& result = state.r[i.rt].u32[3];
         switch (i.ca) {
+        case SPU_RdInMbox:
+            result = readChannel(thread, state.chInMbox);
+            break;
+        case SPU_RdSigNotify1:
+            result = readChannel(thread, state.chSigNotify1);
+            break;
+        case SPU_RdSigNotify2:
+            result = readChannel(thread, state.chSigNotify2);
+            break;
         case MFC_LSA:
             result = state.mfc.lsa;
             break;
@@ -67,6 +104,32 @@ void Translator::rdch(Instruction code)
         case MFC_Size:
             result = state.mfc.size;
             break;
+        case MFC_RdTagMask:
+            result = state.mfc.tagMask;
+            break;
+        case MFC_RdTagStat:
+            if (thread.mfcEngine->isTagStatusReady(state.mfc.tagMask, state.mfc.tagUpdate)) {
+                result = thread.mfcEngine->readTagStatus(state.mfc.tagMask, state.mfc.tagUpdate);
+            } else {
+                thread.beginWait();
+                result = thread.mfcEngine->readTagStatus(state.mfc.tagMask, state.mfc.tagUpdate);
+                thread.endWait();
+            }
+            break;
+        case MFC_RdListStallStat:
+            if (thread.mfcEngine->isStallStatusReady()) {
+                result = thread.mfcEngine->readStallStatus();
+            } else {
+                thread.beginWait();
+                result = thread.mfcEngine->readStallStatus();
+                thread.endWait();
+            }
+            break;
+        case MFC_RdAtomicStat:
+            // Lock-line reservation loops poll the atomic status, letting waiting threads run meanwhile
+            thread.yield();
+            result = state.chAtomicStat.read();
+            break;
         default:
             assert_always("Unimplemented");
         }
@@ -78,6 +141,12 @@ void Translator::wrch(Instruction code)
     INTERPRET({
         U32 value = state.r[i.rt].u32[3];
         switch (i.ca) {
+        case SPU_WrOutMbox:
+            writeChannel(thread, state.chOutMbox, value);
+            break;
+        case SPU_WrOutIntrMbox:
+            writeChannel(thread, state.chOutIntrMbox, value);
+            break;
         case MFC_LSA:
             assert_true(value < 0x40000);
             state.mfc.lsa = value;
@@ -96,12 +165,24 @@ void Translator::wrch(Instruction code)
             state.mfc.tag = value;
             break;
         case MFC_Cmd:
-            thread.mfcCommand(value);
+            if (thread.mfcEngine->getQueueSpace() == 0) {
+                thread.beginWait();
+                thread.mfcCommand(value);
+                thread.endWait();
+            } else {
+                thread.mfcCommand(value);
+            }
             break;
         case MFC_WrTagMask:
-            assert_always("Unimplemented");
+            state.mfc.tagMask = value;
             break;
         case MFC_WrTagUpdate:
+            assert_true(value <= MFC_TAG_UPDATE_ALL);
+            state.mfc.tagUpdate = value;
+            break;
+        case MFC_WrListStallAck:
+            thread.mfcEngine->acknowledgeStall(value);
+            break;
         default:
             assert_always("Unimplemented");
         }
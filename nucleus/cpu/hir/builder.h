@@ -86,13 +86,18 @@ public:
     Value* createShr(Value* value, U08 rhs);
     Value* createShrA(Value* value, Value* amount);
     Value* createShrA(Value* value, U08 rhs);
+    Value* createRol(Value* value, Value* amount);
+    Value* createRol(Value* value, U08 rhs);
 
     // Memory access and context operations
     Value* createLoad(Value* address, Type type, MemoryFlags flags = ENDIAN_DEFAULT);
     void createStore(Value* address, Value* value, MemoryFlags flags = ENDIAN_DEFAULT);
     Value* createCtxLoad(U32 offset, Type type);
     void createCtxStore(U32 offset, Value* value);
+    Value* createStackLoad(U32 offset, Type type);
+    void createStackStore(U32 offset, Value* value);
     void createMemFence();
+    Value* createCmpXchg(Value* address, Value* expected, Value* desired, MemoryFlags flags = ENDIAN_DEFAULT);
 
     // Comparison operations
     Value* createCmp(Value* lhs, Value* rhs, CompareFlags flags);
@@ -524,6 +524,32 @@ Value* Builder::createShrA(Value* value, U08 rhs) {
     return createShrA(value, getConstantI8(rhs));
 }
 
+Value* Builder::createRol(Value* value, Value* amount) {
+    ASSERT_TYPE_INTEGER(value);
+    ASSERT_TYPE_INTEGER(amount);
+
+    if (amount->isConstantZero()) {
+        return value;
+    }
+    if (value->isConstant() && amount->isConstant()) {
+        Value* dest = cloneValue(value);
+        dest->doRol(amount);
+        return dest;
+    }
+    if (amount->type != TYPE_I8) {
+        amount = createTrunc(amount, TYPE_I8);
+    }
+
+    Instruction* i = appendInstr(OPCODE_ROL, 0, allocValue(value->type));
+    i->src1.setValue(value);
+    i->src2.setValue(amount);
+    return i->dest;
+}
+
+Value* Builder::createRol(Value* value, U08 rhs) {
+    return createRol(value, getConstantI8(rhs));
+}
+
 // Memory access operations
 Value* Builder::createLoad(Value* address, Type type, MemoryFlags flags) {
     Instruction* i = appendInstr(OPCODE_LOAD, flags, allocValue(type));
@@ -549,10 +575,32 @@ void Builder::createCtxStore(U32 offset, Value* value) {
     i->src2.setValue(value);
 }
 
+Value* Builder::createStackLoad(U32 offset, Type type) {
+    Instruction* i = appendInstr(OPCODE_STACKLOAD, 0, allocValue(type));
+    i->src1.immediate = offset;
+    return i->dest;
+}
+
+void Builder::createStackStore(U32 offset, Value* value) {
+    Instruction* i = appendInstr(OPCODE_STACKSTORE, 0);
+    i->src1.immediate = offset;
+    i->src2.setValue(value);
+}
+
 void Builder::createMemFence() {
     Instruction* i = appendInstr(OPCODE_MEMFENCE, 0);
 }
 
+Value* Builder::createCmpXchg(Value* address, Value* expected, Value* desired, MemoryFlags flags) {
+    ASSERT_TYPE_EQUAL(expected, desired);
+
+    Instruction* i = appendInstr(OPCODE_CMPXCHG, flags, allocValue(TYPE_I8));
+    i->src1.setValue(address);
+    i->src2.setValue(expected);
+    i->src3.setValue(desired);
+    return i->dest;
+}
+
 // Comparison operations
 Value* Builder::createCmp(Value* lhs, Value* rhs, CompareFlags flags) {
     ASSERT_TYPE_EQUAL(lhs, rhs);
@@ -11,7 +11,7 @@ namespace cpu {
 namespace hir {
 
 Function::Function(Module* parent, TypeOut tOut, TypeIn tIn)
-    : parent(parent), typeOut(tOut), typeIn(tIn), flags(0), nativeAddress(nullptr) {
+    : parent(parent), typeOut(tOut), typeIn(tIn), flags(0), stackSize(0), nativeAddress(nullptr) {
     // Set flags
     flags |= FUNCTION_IS_DECLARED;
 
@@ -41,6 +41,7 @@ S32 Function::getId() {
 
 void Function::reset() {
     flags = FUNCTION_IS_DECLARED;
+    stackSize = 0;
     blocks.clear();
 }
 
@@ -55,6 +55,33 @@ std::string Instruction::Operand::dump(U08 sigType) const {
     return output;
 }
 
+void Instruction::replaceValues(const std::unordered_map<Value*, Value*>& replacements) {
+    const auto& opInfo = opcodeInfo[opcode];
+    const U08 sigs[] = { opInfo.getSignatureSrc1(), opInfo.getSignatureSrc2(), opInfo.getSignatureSrc3() };
+    Operand* srcs[] = { &src1, &src2, &src3 };
+    for (int i = 0; i < 3; i++) {
+        if (sigs[i] != OPCODE_SIG_TYPE_V && !(sigs[i] == OPCODE_SIG_TYPE_M && srcs[i]->value)) {
+            continue;
+        }
+        auto it = replacements.find(srcs[i]->value);
+        if (it != replacements.end()) {
+            srcs[i]->value->usage -= 1;
+            srcs[i]->setValue(it->second);
+        }
+    }
+}
+
+void Instruction::releaseValues() {
+    const auto& opInfo = opcodeInfo[opcode];
+    const U08 sigs[] = { opInfo.getSignatureSrc1(), opInfo.getSignatureSrc2(), opInfo.getSignatureSrc3() };
+    Operand* srcs[] = { &src1, &src2, &src3 };
+    for (int i = 0; i < 3; i++) {
+        if (sigs[i] == OPCODE_SIG_TYPE_V || (sigs[i] == OPCODE_SIG_TYPE_M && srcs[i]->value)) {
+            srcs[i]->value->usage -= 1;
+        }
+    }
+}
+
 std::string Instruction::dump() const {
     std::string output;
     const auto& opInfo = opcodeInfo[opcode];
@@ -107,6 +134,7 @@ std::string Instruction::dump() const {
         // Memory flags
         case OPCODE_LOAD:
         case OPCODE_STORE:
+        case OPCODE_CMPXCHG:
             if (flags == ENDIAN_BIG) { output += "be"; }
             if (flags == ENDIAN_LITTLE) { output += "le"; }
             break;
@@ -10,6 +10,7 @@ namespace cpu {
 namespace hir {
 
 bool Module::addFunction(Function* function) {
+    std::lock_guard<std::mutex> lock(mutex);
     functions.push_back(function);
     return true;
 }
@@ -53,6 +53,9 @@ public:
     // Arguments
     std::vector<Value*> args;
 
+    // Bytes of stack reserved for values spilled by the register allocator
+    U32 stackSize;
+
     // Pointer to the compiled function
     void* nativeAddress;
     U64 nativeSize;
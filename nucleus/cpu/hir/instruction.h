@@ -11,6 +11,8 @@
 
 #include <vector>
 #include <map>
+#include <string>
+#include <unordered_map>
 
 namespace cpu {
 namespace hir {
@@ -59,6 +61,17 @@ public:
     Operand src2;
     Operand src3;
 
+    /**
+     * Replace the source values of this instruction, updating their usage counters
+     * @param[in]  replacements  Map from previous values to the values replacing them
+     */
+    void replaceValues(const std::unordered_map<Value*, Value*>& replacements);
+
+    /**
+     * Decrement the usage counters of the source values, before removing this instruction
+     */
+    void releaseValues();
+
     /**
      * Save a human-readable version of this HIR instruction
      * @return String containing the readable version of this HIR instruction
@@ -7,6 +7,7 @@
 
 #include "nucleus/common.h"
 
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -17,6 +18,9 @@ namespace hir {
 class Function;
 
 class Module {
+    // Functions can be declared by several translation threads at once
+    std::mutex mutex;
+
 public:
     std::vector<Function*> functions;
 
@@ -30,7 +30,10 @@ OPCODE(LOAD,      "load",      OPCODE_SIG_V_V)     // Load from memory
 OPCODE(STORE,     "store",     OPCODE_SIG_X_V_V)   // Store to memory
 OPCODE(CTXLOAD,   "ctxload",   OPCODE_SIG_V_I)     // Context load
 OPCODE(CTXSTORE,  "ctxstore",  OPCODE_SIG_X_I_V)   // Context store
+OPCODE(STACKLOAD, "stackload", OPCODE_SIG_V_I)     // Stack load (spill slot)
+OPCODE(STACKSTORE,"stackstore",OPCODE_SIG_X_I_V)   // Stack store (spill slot)
 OPCODE(MEMFENCE,  "memfence",  OPCODE_SIG_X)       // Memory fence
+OPCODE(CMPXCHG,   "cmpxchg",   OPCODE_SIG_V_V_V_V) // Atomic compare and exchange
 OPCODE(SELECT,    "select",    OPCODE_SIG_V_V_V_V) // Select
 OPCODE(CMP,       "cmp",       OPCODE_SIG_V_V_V)   // Compare
 OPCODE(BR,        "br",        OPCODE_SIG_X_B)     // Branch
@@ -11,6 +11,12 @@
 namespace cpu {
 namespace hir {
 
+/**
+ * Pass
+ * ====
+ * Transformation applied to HIR functions before compiling them. Passes must not keep
+ * any state between runs, since the compiler applies them to different functions concurrently.
+ */
 class Pass {
 public:
     /**
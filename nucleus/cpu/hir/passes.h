@@ -6,6 +6,10 @@
 #pragma once
 
 // Optimization passes
+#include "nucleus/cpu/hir/passes/common_subexpression_elimination_pass.h"
+#include "nucleus/cpu/hir/passes/constant_folding_pass.h"
+#include "nucleus/cpu/hir/passes/context_promotion_pass.h"
+#include "nucleus/cpu/hir/passes/copy_propagation_pass.h"
 #include "nucleus/cpu/hir/passes/dead_code_elimination_pass.h"
 
 // Mandatory passes
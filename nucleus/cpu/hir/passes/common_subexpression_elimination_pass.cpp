@@ -0,0 +1,110 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#include "common_subexpression_elimination_pass.h"
+#include "nucleus/cpu/hir/block.h"
+#include "nucleus/cpu/hir/instruction.h"
+
+#include <map>
+#include <tuple>
+#include <unordered_map>
+
+namespace cpu {
+namespace hir {
+namespace passes {
+
+// Check whether the result of an instruction only depends on its operands
+static bool isPure(Opcode opcode) {
+    switch (opcode) {
+    case OPCODE_ADD:
+    case OPCODE_SUB:
+    case OPCODE_MUL:
+    case OPCODE_MULH:
+    case OPCODE_NEG:
+    case OPCODE_ZEXT:
+    case OPCODE_SEXT:
+    case OPCODE_TRUNC:
+    case OPCODE_CAST:
+    case OPCODE_CONVERT:
+    case OPCODE_CTLZ:
+    case OPCODE_NOT:
+    case OPCODE_AND:
+    case OPCODE_OR:
+    case OPCODE_XOR:
+    case OPCODE_SHL:
+    case OPCODE_SHR:
+    case OPCODE_SHRA:
+    case OPCODE_ROL:
+    case OPCODE_ROR:
+    case OPCODE_SQRT:
+    case OPCODE_ABS:
+    case OPCODE_SELECT:
+    case OPCODE_CMP:
+    case OPCODE_FADD:
+    case OPCODE_FSUB:
+    case OPCODE_FMUL:
+    case OPCODE_FDIV:
+    case OPCODE_FNEG:
+    case OPCODE_VADD:
+    case OPCODE_VSUB:
+    case OPCODE_VABS:
+    case OPCODE_VAVG:
+    case OPCODE_VCMP:
+    case OPCODE_EXTRACT:
+    case OPCODE_INSERT:
+    case OPCODE_SHUFFLE:
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool CommonSubexpressionEliminationPass::run(Function* function) {
+    if (!function) {
+        return false;
+    }
+
+    // Expressions are identified by opcode, flags, result type and operands
+    using Expression = std::tuple<Opcode, OpcodeFlags, Type, Instruction::Immediate, Instruction::Immediate, Instruction::Immediate>;
+
+    std::unordered_map<Value*, Value*> replacements;
+    for (auto* block : function->blocks) {
+        std::map<Expression, Value*> expressions;
+        auto& instructions = block->instructions;
+        for (auto it = instructions.begin(); it != instructions.end();) {
+            Instruction* instr = *it;
+            instr->replaceValues(replacements);
+            if (!instr->dest || !isPure(instr->opcode)) {
+                it++;
+                continue;
+            }
+
+            const Expression expr(instr->opcode, instr->flags, instr->dest->type,
+                instr->src1.immediate, instr->src2.immediate, instr->src3.immediate);
+            auto match = expressions.find(expr);
+            if (match != expressions.end()) {
+                replacements[instr->dest] = match->second;
+                instr->releaseValues();
+                it = instructions.erase(it);
+                delete instr;
+                continue;
+            }
+            expressions[expr] = instr->dest;
+            it++;
+        }
+    }
+
+    // Replace uses preceding their definition in the block layout
+    for (auto* block : function->blocks) {
+        for (auto* instr : block->instructions) {
+            instr->replaceValues(replacements);
+        }
+    }
+    return true;
+}
+
+}  // namespace passes
+}  // namespace hir
+}  // namespace cpu
@@ -0,0 +1,35 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/common.h"
+#include "nucleus/cpu/hir/pass.h"
+
+namespace cpu {
+namespace hir {
+namespace passes {
+
+/**
+ * Common Subexpression Elimination Pass
+ * =====================================
+ * Reuses the result of a previous instruction within the same block that applies the same
+ * operation on the same operands. Only instructions without side effects and not reading
+ * memory are considered.
+ */
+class CommonSubexpressionEliminationPass : public Pass {
+public:
+    // Get the name of this pass
+    const char* name() override {
+        return "Common Subexpression Elimination";
+    }
+
+    // Apply this pass on a function
+    bool run(Function* function) override;
+};
+
+}  // namespace passes
+}  // namespace hir
+}  // namespace cpu
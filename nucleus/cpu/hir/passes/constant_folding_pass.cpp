@@ -0,0 +1,200 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#include "constant_folding_pass.h"
+#include "nucleus/cpu/hir/block.h"
+#include "nucleus/cpu/hir/builder.h"
+#include "nucleus/cpu/hir/instruction.h"
+
+#include <unordered_map>
+
+namespace cpu {
+namespace hir {
+namespace passes {
+
+// Get the number of bits of an integer type
+static U32 getTypeBits(Type type) {
+    switch (type) {
+    case TYPE_I8:   return 8;
+    case TYPE_I16:  return 16;
+    case TYPE_I32:  return 32;
+    case TYPE_I64:  return 64;
+    default:
+        return 0;
+    }
+}
+
+// Get the bits of an integer constant, zero-extended to 64 bits
+static U64 getConstantBits(const Value* value) {
+    switch (value->type) {
+    case TYPE_I8:   return U08(value->constant.i8);
+    case TYPE_I16:  return U16(value->constant.i16);
+    case TYPE_I32:  return U32(value->constant.i32);
+    case TYPE_I64:  return U64(value->constant.i64);
+    default:
+        return 0;
+    }
+}
+
+// Check whether all source values of an instruction are integer constants
+static bool hasConstantSources(const Instruction* instr) {
+    const auto& opInfo = opcodeInfo[instr->opcode];
+    const U08 sigs[] = { opInfo.getSignatureSrc1(), opInfo.getSignatureSrc2(), opInfo.getSignatureSrc3() };
+    const Instruction::Operand* srcs[] = { &instr->src1, &instr->src2, &instr->src3 };
+    for (int i = 0; i < 3; i++) {
+        if (sigs[i] == OPCODE_SIG_TYPE_V) {
+            if (!srcs[i]->value->isConstant() || !srcs[i]->value->isTypeInteger()) {
+                return false;
+            }
+        } else if (sigs[i] != OPCODE_SIG_TYPE_X) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * Compute the constant result of an instruction
+ * @param[in]  builder  Builder used to create the constant
+ * @param[in]  instr    Instruction with constant integer operands
+ * @return              Constant value, or nullptr if the instruction cannot be folded
+ */
+static Value* foldInstruction(Builder& builder, const Instruction* instr) {
+    if (!instr->dest || !instr->dest->isTypeInteger() || !hasConstantSources(instr)) {
+        return nullptr;
+    }
+
+    Value* lhs = instr->src1.value;
+    Value* rhs = instr->src2.value;
+    Value* result = nullptr;
+    switch (instr->opcode) {
+    case OPCODE_ADD:
+        result = builder.cloneValue(lhs);
+        result->doAdd(rhs);
+        break;
+    case OPCODE_SUB:
+        result = builder.cloneValue(lhs);
+        result->doSub(rhs);
+        break;
+    case OPCODE_MUL:
+        result = builder.cloneValue(lhs);
+        result->doMul(rhs, ArithmeticFlags(instr->flags));
+        break;
+    case OPCODE_DIV:
+        // Division by zero and signed overflow are left to the target
+        if (rhs->isConstantZero()) {
+            return nullptr;
+        }
+        if (!(instr->flags & ARITHMETIC_UNSIGNED) && getConstantBits(rhs) == (~0ULL >> (64 - getTypeBits(rhs->type)))) {
+            return nullptr;
+        }
+        result = builder.cloneValue(lhs);
+        result->doDiv(rhs, ArithmeticFlags(instr->flags));
+        break;
+    case OPCODE_NEG:
+        result = builder.cloneValue(lhs);
+        result->doNeg();
+        break;
+    case OPCODE_AND:
+        result = builder.cloneValue(lhs);
+        result->doAnd(rhs);
+        break;
+    case OPCODE_OR:
+        result = builder.cloneValue(lhs);
+        result->doOr(rhs);
+        break;
+    case OPCODE_XOR:
+        result = builder.cloneValue(lhs);
+        result->doXor(rhs);
+        break;
+    case OPCODE_NOT:
+        result = builder.cloneValue(lhs);
+        result->doNot();
+        break;
+    case OPCODE_SHL:
+    case OPCODE_SHR:
+    case OPCODE_SHRA:
+        // Shifting by the type width or more is undefined on the host
+        if (getConstantBits(rhs) >= getTypeBits(lhs->type)) {
+            return nullptr;
+        }
+        result = builder.cloneValue(lhs);
+        if (instr->opcode == OPCODE_SHL) {
+            result->doShl(rhs);
+        } else if (instr->opcode == OPCODE_SHR) {
+            result->doShr(rhs);
+        } else {
+            result->doShrA(rhs);
+        }
+        break;
+    case OPCODE_ROL:
+        result = builder.cloneValue(lhs);
+        result->doRol(rhs);
+        break;
+    case OPCODE_ZEXT:
+        result = builder.cloneValue(lhs);
+        result->doZExt(instr->dest->type);
+        break;
+    case OPCODE_SEXT:
+        result = builder.cloneValue(lhs);
+        result->doSExt(instr->dest->type);
+        break;
+    case OPCODE_TRUNC:
+        result = builder.cloneValue(lhs);
+        result->doTrunc(instr->dest->type);
+        break;
+    case OPCODE_CMP:
+        result = builder.cloneValue(lhs);
+        result->doCompare(rhs, CompareFlags(instr->flags));
+        result->type = TYPE_I8;
+        break;
+    default:
+        break;
+    }
+    return result;
+}
+
+bool ConstantFoldingPass::run(Function* function) {
+    if (!function) {
+        return false;
+    }
+
+    Builder builder;
+    std::unordered_map<Value*, Value*> replacements;
+    for (auto* block : function->blocks) {
+        auto& instructions = block->instructions;
+        for (auto it = instructions.begin(); it != instructions.end();) {
+            Instruction* instr = *it;
+            instr->replaceValues(replacements);
+
+            Value* result = nullptr;
+            if (instr->opcode == OPCODE_SELECT && instr->src1.value->isConstant()) {
+                result = instr->src1.value->isConstantTrue() ? instr->src2.value : instr->src3.value;
+            } else {
+                result = foldInstruction(builder, instr);
+            }
+            if (result) {
+                replacements[instr->dest] = result;
+                instr->releaseValues();
+                it = instructions.erase(it);
+                delete instr;
+                continue;
+            }
+            it++;
+        }
+    }
+
+    // Replace uses preceding their definition in the block layout
+    for (auto* block : function->blocks) {
+        for (auto* instr : block->instructions) {
+            instr->replaceValues(replacements);
+        }
+    }
+    return true;
+}
+
+}  // namespace passes
+}  // namespace hir
+}  // namespace cpu
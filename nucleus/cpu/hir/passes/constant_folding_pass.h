@@ -0,0 +1,35 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/common.h"
+#include "nucleus/cpu/hir/pass.h"
+
+namespace cpu {
+namespace hir {
+namespace passes {
+
+/**
+ * Constant Folding Pass
+ * =====================
+ * Evaluates integer arithmetic, logical, shifting, conversion and comparison instructions
+ * whose operands are all constant, and selections with a constant condition, replacing
+ * their results with constants.
+ */
+class ConstantFoldingPass : public Pass {
+public:
+    // Get the name of this pass
+    const char* name() override {
+        return "Constant Folding";
+    }
+
+    // Apply this pass on a function
+    bool run(Function* function) override;
+};
+
+}  // namespace passes
+}  // namespace hir
+}  // namespace cpu
@@ -0,0 +1,216 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#include "context_promotion_pass.h"
+#include "nucleus/cpu/hir/builder.h"
+
+#include <algorithm>
+
+namespace cpu {
+namespace hir {
+namespace passes {
+
+// Bytes of guest state covered by a value of the given type
+static U32 getTypeSize(Type type) {
+    switch (type) {
+    case TYPE_I8:   return 1;
+    case TYPE_I16:  return 2;
+    case TYPE_I32:  return 4;
+    case TYPE_I64:  return 8;
+    case TYPE_F32:  return 4;
+    case TYPE_F64:  return 8;
+    case TYPE_V128: return 16;
+    case TYPE_V256: return 32;
+    default:
+        return 0;
+    }
+}
+
+std::vector<std::vector<size_t>> ContextPromotionPass::getSuccessors(Function* function) {
+    const size_t count = function->blocks.size();
+    std::unordered_map<const Block*, size_t> indices;
+    for (size_t i = 0; i < count; i++) {
+        indices[function->blocks[i]] = i;
+    }
+
+    std::vector<std::vector<size_t>> successors(count);
+    for (size_t i = 0; i < count; i++) {
+        const auto& instructions = function->blocks[i]->instructions;
+        auto& succs = successors[i];
+        auto addTarget = [&](const Block* target) {
+            auto it = indices.find(target);
+            if (it != indices.end() && std::find(succs.begin(), succs.end(), it->second) == succs.end()) {
+                succs.push_back(it->second);
+            }
+        };
+
+        // Blocks not ending in an unconditional jump fall through to the next one
+        const Instruction* last = instructions.empty() ? nullptr : instructions.back();
+        if (last && last->opcode == OPCODE_RET) {
+            continue;
+        }
+        if (last && last->opcode == OPCODE_BR) {
+            addTarget(last->src1.block);
+            continue;
+        }
+        if (last && last->opcode == OPCODE_BRCOND) {
+            addTarget(last->src2.block);
+        }
+        if (i + 1 < count) {
+            addTarget(function->blocks[i + 1]);
+        }
+    }
+    return successors;
+}
+
+void ContextPromotionPass::flushRange(Block* block, std::list<Instruction*>::iterator it, State& state, U32 begin, U32 end) {
+    Builder builder;
+    for (auto slot = state.begin(); slot != state.end();) {
+        const U32 slotBegin = slot->first;
+        const U32 slotEnd = slotBegin + getTypeSize(slot->second.value->type);
+        if (slotBegin < end && begin < slotEnd) {
+            if (slot->second.dirty) {
+                builder.setInsertPoint(block, it);
+                builder.createCtxStore(slotBegin, slot->second.value);
+            }
+            slot = state.erase(slot);
+        } else {
+            slot++;
+        }
+    }
+}
+
+void ContextPromotionPass::flushAll(Block* block, std::list<Instruction*>::iterator it, State& state) {
+    Builder builder;
+    for (auto& slot : state) {
+        if (slot.second.dirty) {
+            builder.setInsertPoint(block, it);
+            builder.createCtxStore(slot.first, slot.second.value);
+            slot.second.dirty = false;
+        }
+    }
+}
+
+void ContextPromotionPass::promoteBlock(Block* block, State& state, Replacements& replacements) {
+    auto& instructions = block->instructions;
+    auto callStart = instructions.end();
+
+    for (auto it = instructions.begin(); it != instructions.end();) {
+        Instruction* instr = *it;
+
+        // Replace uses of removed loads
+        instr->replaceValues(replacements);
+
+        // Arguments are placed right before their call, pending stores must precede them
+        if (instr->opcode != OPCODE_ARG && instr->opcode != OPCODE_CALL && instr->opcode != OPCODE_CALLCOND) {
+            callStart = instructions.end();
+        }
+
+        switch (instr->opcode) {
+        case OPCODE_CTXLOAD: {
+            const U32 offset = U32(instr->src1.immediate);
+            auto slot = state.find(offset);
+            if (slot != state.end() && slot->second.value->type == instr->dest->type) {
+                replacements[instr->dest] = slot->second.value;
+                it = instructions.erase(it);
+                delete instr;
+                continue;
+            }
+            flushRange(block, it, state, offset, offset + getTypeSize(instr->dest->type));
+            state[offset] = { instr->dest, false };
+            break;
+        }
+        case OPCODE_CTXSTORE: {
+            const U32 offset = U32(instr->src1.immediate);
+            Value* value = instr->src2.value;
+            auto slot = state.find(offset);
+            if (slot != state.end() && slot->second.value->type == value->type) {
+                state.erase(slot);
+            }
+            flushRange(block, it, state, offset, offset + getTypeSize(value->type));
+            state[offset] = { value, true };
+            value->usage -= 1;
+            it = instructions.erase(it);
+            delete instr;
+            continue;
+        }
+        case OPCODE_ARG:
+            if (callStart == instructions.end()) {
+                callStart = it;
+            }
+            break;
+
+        // Callees (including syscalls) access the guest state directly
+        case OPCODE_CALL:
+        case OPCODE_CALLCOND:
+            flushAll(block, (callStart != instructions.end()) ? callStart : it, state);
+            state.clear();
+            callStart = instructions.end();
+            break;
+        }
+        it++;
+    }
+}
+
+bool ContextPromotionPass::run(Function* function) {
+    const auto successors = getSuccessors(function);
+    const size_t count = function->blocks.size();
+    std::vector<std::vector<size_t>> predecessors(count);
+    for (size_t i = 0; i < count; i++) {
+        for (size_t succ : successors[i]) {
+            predecessors[succ].push_back(i);
+        }
+    }
+
+    Replacements replacements;
+    std::vector<State> exitStates(count);
+    for (size_t i = 0; i < count; i++) {
+        Block* block = function->blocks[i];
+        const auto& preds = predecessors[i];
+
+        // Merge the slots known by all predecessors, unless this block is reachable from a back edge
+        State state;
+        const bool isForward = !preds.empty() && std::all_of(preds.begin(), preds.end(), [i](size_t pred) {
+            return pred < i;
+        });
+        if (isForward) {
+            state = exitStates[preds[0]];
+            for (size_t k = 1; k < preds.size(); k++) {
+                const auto& other = exitStates[preds[k]];
+                for (auto slot = state.begin(); slot != state.end();) {
+                    auto match = other.find(slot->first);
+                    if (match == other.end() || match->second.value != slot->second.value) {
+                        slot = state.erase(slot);
+                    } else {
+                        slot++;
+                    }
+                }
+            }
+        }
+
+        promoteBlock(block, state, replacements);
+
+        // Pending stores are only carried into a successor that cannot be reached from elsewhere
+        const auto& succs = successors[i];
+        const bool isCarried = succs.size() == 1 && succs[0] > i && predecessors[succs[0]].size() == 1;
+        if (!isCarried) {
+            auto& instructions = block->instructions;
+            auto it = instructions.end();
+            if (!instructions.empty()) {
+                const Opcode opcode = instructions.back()->opcode;
+                if (opcode == OPCODE_BR || opcode == OPCODE_BRCOND || opcode == OPCODE_RET) {
+                    it = std::prev(instructions.end());
+                }
+            }
+            flushAll(block, it, state);
+        }
+        exitStates[i] = std::move(state);
+    }
+    return true;
+}
+
+}  // namespace passes
+}  // namespace hir
+}  // namespace cpu
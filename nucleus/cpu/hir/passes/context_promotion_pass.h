@@ -0,0 +1,94 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/common.h"
+#include "nucleus/cpu/hir/block.h"
+#include "nucleus/cpu/hir/instruction.h"
+#include "nucleus/cpu/hir/pass.h"
+
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+namespace cpu {
+namespace hir {
+namespace passes {
+
+/**
+ * Context Promotion Pass
+ * ======================
+ * Keeps guest registers in HIR values instead of accessing the guest state on each read
+ * or write. Loads of a context slot whose value is already known are replaced by that value,
+ * and stores are deferred until the value has to be visible in the guest state.
+ *
+ * Notes:
+ * - Known slots flow into the successors that are only reachable from the current block,
+ *   and merge at joins when every forward predecessor holds the same value in that slot.
+ * - Pending stores are written back before calls (including syscalls), at returns and
+ *   at the end of blocks whose successors can be reached from elsewhere.
+ * - Loop headers start with no known slots, so values never flow through back edges.
+ */
+class ContextPromotionPass : public Pass {
+private:
+    struct Slot {
+        Value* value;
+        bool dirty;  // Value differs from the guest state
+    };
+
+    // Known context slots indexed by offset
+    using State = std::map<U32, Slot>;
+
+    // Values replacing the destinations of removed loads
+    using Replacements = std::unordered_map<Value*, Value*>;
+
+    /**
+     * Compute the successors of each block, following the layout order of Function::blocks
+     * @param[in]  function  Function to analyze
+     * @return               Indices of the successors of each block
+     */
+    std::vector<std::vector<size_t>> getSuccessors(Function* function);
+
+    /**
+     * Write back and forget the known slots overlapping a range of the context
+     * @param[in]  block  Block where the stores are inserted
+     * @param[in]  it     Instruction before which the stores are inserted
+     * @param[in]  state  Known context slots
+     * @param[in]  begin  First byte of the range
+     * @param[in]  end    Byte past the end of the range
+     */
+    void flushRange(Block* block, std::list<Instruction*>::iterator it, State& state, U32 begin, U32 end);
+
+    /**
+     * Write back every pending store, keeping the slots known
+     * @param[in]  block  Block where the stores are inserted
+     * @param[in]  it     Instruction before which the stores are inserted
+     * @param[in]  state  Known context slots
+     */
+    void flushAll(Block* block, std::list<Instruction*>::iterator it, State& state);
+
+    /**
+     * Promote the context accesses in a block
+     * @param[in]  block  Block to process
+     * @param[in]  state         Known context slots on entry, updated to those on exit
+     * @param[in]  replacements  Values replacing the destinations of removed loads
+     */
+    void promoteBlock(Block* block, State& state, Replacements& replacements);
+
+public:
+    // Get the name of this pass
+    const char* name() override {
+        return "Context Promotion";
+    }
+
+    // Apply this pass on a function
+    bool run(Function* function) override;
+};
+
+}  // namespace passes
+}  // namespace hir
+}  // namespace cpu
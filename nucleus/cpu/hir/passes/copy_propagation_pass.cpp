@@ -0,0 +1,155 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#include "copy_propagation_pass.h"
+#include "nucleus/cpu/hir/block.h"
+#include "nucleus/cpu/hir/instruction.h"
+
+#include <unordered_map>
+
+namespace cpu {
+namespace hir {
+namespace passes {
+
+// Check whether a value is an integer constant zero
+static bool isIntegerZero(const Value* value) {
+    return value->isTypeInteger() && value->isConstantZero();
+}
+
+/**
+ * Find the operand forwarded by an instruction
+ * @param[in]  instr  Instruction to check
+ * @return            Value equal to the result of the instruction, or nullptr if there is none
+ */
+static Value* getForwardedValue(const Instruction* instr) {
+    if (!instr->dest) {
+        return nullptr;
+    }
+
+    Value* src1 = instr->src1.value;
+    Value* src2 = instr->src2.value;
+    switch (instr->opcode) {
+    case OPCODE_ADD:
+    case OPCODE_XOR:
+        if (isIntegerZero(src1)) {
+            return src2;
+        }
+        if (isIntegerZero(src2)) {
+            return src1;
+        }
+        break;
+    case OPCODE_OR:
+        if (src1 == src2 || isIntegerZero(src2)) {
+            return src1;
+        }
+        if (isIntegerZero(src1)) {
+            return src2;
+        }
+        break;
+    case OPCODE_AND:
+        if (src1 == src2) {
+            return src1;
+        }
+        break;
+    case OPCODE_SUB:
+    case OPCODE_SHL:
+    case OPCODE_SHR:
+    case OPCODE_SHRA:
+    case OPCODE_ROL:
+    case OPCODE_ROR:
+        if (isIntegerZero(src2)) {
+            return src1;
+        }
+        break;
+    case OPCODE_ZEXT:
+    case OPCODE_SEXT:
+    case OPCODE_TRUNC:
+    case OPCODE_CAST:
+    case OPCODE_CONVERT:
+        if (src1->type == instr->dest->type) {
+            return src1;
+        }
+        break;
+    case OPCODE_SELECT:
+        if (instr->src2.value == instr->src3.value) {
+            return src2;
+        }
+        break;
+    default:
+        break;
+    }
+    return nullptr;
+}
+
+/**
+ * Make an integer conversion operate on the source of a previous conversion
+ * @param[in]  instr        Conversion instruction to modify
+ * @param[in]  definitions  Instructions defining each value seen so far
+ */
+static void collapseConversion(Instruction* instr, const std::unordered_map<const Value*, Instruction*>& definitions) {
+    if (instr->opcode != OPCODE_ZEXT && instr->opcode != OPCODE_SEXT && instr->opcode != OPCODE_TRUNC) {
+        return;
+    }
+    auto it = definitions.find(instr->src1.value);
+    if (it == definitions.end()) {
+        return;
+    }
+
+    const Instruction* inner = it->second;
+    Value* source = inner->src1.value;
+    if (instr->opcode == OPCODE_TRUNC && (inner->opcode == OPCODE_ZEXT || inner->opcode == OPCODE_SEXT)) {
+        // Integer types are ordered by size: truncating less than what was extended is an extension
+        if (instr->dest->type > source->type) {
+            instr->opcode = inner->opcode;
+        }
+    } else if (inner->opcode != instr->opcode) {
+        return;
+    }
+
+    instr->src1.value->usage -= 1;
+    instr->src1.setValue(source);
+}
+
+bool CopyPropagationPass::run(Function* function) {
+    if (!function) {
+        return false;
+    }
+
+    std::unordered_map<Value*, Value*> replacements;
+    std::unordered_map<const Value*, Instruction*> definitions;
+    for (auto* block : function->blocks) {
+        auto& instructions = block->instructions;
+        for (auto it = instructions.begin(); it != instructions.end();) {
+            Instruction* instr = *it;
+            instr->replaceValues(replacements);
+            collapseConversion(instr, definitions);
+
+            Value* result = getForwardedValue(instr);
+            if (result) {
+                replacements[instr->dest] = result;
+                instr->releaseValues();
+                it = instructions.erase(it);
+                delete instr;
+                continue;
+            }
+            if (instr->dest) {
+                definitions[instr->dest] = instr;
+            }
+            it++;
+        }
+    }
+
+    // Replace uses preceding their definition in the block layout
+    for (auto* block : function->blocks) {
+        for (auto* instr : block->instructions) {
+            instr->replaceValues(replacements);
+        }
+    }
+    return true;
+}
+
+}  // namespace passes
+}  // namespace hir
+}  // namespace cpu
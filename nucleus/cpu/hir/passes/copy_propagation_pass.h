@@ -0,0 +1,35 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/common.h"
+#include "nucleus/cpu/hir/pass.h"
+
+namespace cpu {
+namespace hir {
+namespace passes {
+
+/**
+ * Copy Propagation Pass
+ * ======================
+ * Replaces the results of instructions that just forward one of their operands, such as
+ * additions of zero, shifts by zero or selections between equal values, with that operand.
+ * Chains of integer extensions and truncations are collapsed into a single conversion.
+ */
+class CopyPropagationPass : public Pass {
+public:
+    // Get the name of this pass
+    const char* name() override {
+        return "Copy Propagation";
+    }
+
+    // Apply this pass on a function
+    bool run(Function* function) override;
+};
+
+}  // namespace passes
+}  // namespace hir
+}  // namespace cpu
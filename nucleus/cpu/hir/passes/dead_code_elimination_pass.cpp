@@ -4,17 +4,53 @@
  */
 
 #include "dead_code_elimination_pass.h"
+#include "nucleus/cpu/hir/block.h"
+#include "nucleus/cpu/hir/instruction.h"
 
 namespace cpu {
 namespace hir {
 namespace passes {
 
+// Check whether an instruction can be removed if its result is unused
+static bool isRemovable(const Instruction* instr) {
+    if (!instr->dest || instr->dest->usage != 0) {
+        return false;
+    }
+    switch (instr->opcode) {
+    case OPCODE_ARG:  // Used implicitly by the following call
+    case OPCODE_CALL:
+    case OPCODE_CALLCOND:
+    case OPCODE_CMPXCHG:  // Writes to memory regardless of its result
+        return false;
+    default:
+        return true;
+    }
+}
+
 bool DeadCodeEliminationPass::run(Function* function) {
-    // Check function flags
-    if (!function || !(function->flags & FUNCTION_IS_DEFINED)) {
+    if (!function) {
         return false;
     }
 
+    // Removing an instruction might leave its operands unused
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto* block : function->blocks) {
+            auto& instructions = block->instructions;
+            auto it = instructions.end();
+            while (it != instructions.begin()) {
+                it--;
+                Instruction* instr = *it;
+                if (isRemovable(instr)) {
+                    instr->releaseValues();
+                    it = instructions.erase(it);
+                    delete instr;
+                    changed = true;
+                }
+            }
+        }
+    }
     return true;
 }
 
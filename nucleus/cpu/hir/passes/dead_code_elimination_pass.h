@@ -12,11 +12,14 @@ namespace cpu {
 namespace hir {
 namespace passes {
 
+/**
+ * Dead Code Elimination Pass
+ * ==========================
+ * Removes instructions without side effects whose results are not used, according to
+ * the usage counters of their values, until no more instructions can be removed.
+ */
 class DeadCodeEliminationPass : public Pass {
 public:
-    // Constructor
-    DeadCodeEliminationPass();
-
     // Get the name of this pass
     const char* name() override {
         return "Dead Code Elimination";
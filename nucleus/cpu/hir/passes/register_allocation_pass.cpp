@@ -5,24 +5,56 @@
 
 #include "register_allocation_pass.h"
 #include "nucleus/cpu/hir/block.h"
+#include "nucleus/cpu/hir/builder.h"
 #include "nucleus/cpu/hir/instruction.h"
-#include "nucleus/assert.h"
+#include "nucleus/logger/logger.h"
+
+#include <algorithm>
+#include <unordered_map>
 
 namespace cpu {
 namespace hir {
 namespace passes {
 
+// Size of each spill slot, enough for any value type held in registers
+constexpr U32 SPILL_SLOT_SIZE = 16;
+
+// Maximum number of spilling rounds before giving up
+constexpr U32 SPILL_MAX_ROUNDS = 64;
+
+// Check whether an operand holds a value given its signature type
+static bool isValueOperand(U08 sigType, const Instruction::Operand& operand) {
+    return (sigType == OPCODE_SIG_TYPE_V) || (sigType == OPCODE_SIG_TYPE_M && operand.value);
+}
+
 RegisterAllocationPass::RegisterAllocationPass(const backend::TargetInfo& targetInfo)
     : targetInfo(targetInfo) {
     for (const auto& regSet : targetInfo.regSets) {
-        RegSetUsage regUsage;
-        regUsage.regs.reset();
-        regUsage.count = regSet.valueIndex.size();
-        regUsage.types = regSet.types;
-        regUsages.push_back(regUsage);
+        std::vector<bool> regs;
+        for (const auto& index : regSet.valueIndex) {
+            const auto& vols = regSet.volatileIndex;
+            regs.push_back(std::find(vols.begin(), vols.end(), index) != vols.end());
+        }
+        volatileRegs.push_back(regs);
     }
 }
 
+int RegisterAllocationPass::getRegSet(const Value* value) const {
+    for (size_t i = 0; i < targetInfo.regSets.size(); i++) {
+        const auto& regSet = targetInfo.regSets[i];
+        if (regSet.types & backend::RegisterSet::TYPE_INT && value->isTypeInteger() ||
+            regSet.types & backend::RegisterSet::TYPE_FLOAT && value->isTypeFloat() ||
+            regSet.types & backend::RegisterSet::TYPE_VECTOR && value->isTypeVector()) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool RegisterAllocationPass::isRegAllowed(const Interval& interval, S32 reg) const {
+    return !interval.crossesCall || !volatileRegs[interval.regSet][reg];
+}
+
 void RegisterAllocationPass::allocArgumentReg(int index, Value* arg) {
     for (const auto& regSet : targetInfo.regSets) {
         if (regSet.types & backend::RegisterSet::TYPE_INT && arg->isTypeInteger()) {
@@ -35,52 +67,188 @@ void RegisterAllocationPass::allocArgumentReg(int index, Value* arg) {
     }
 }
 
-bool RegisterAllocationPass::tryAllocValueReg(Value* value) {
-    // Nothing to alloc if value is unused
-    if (value->usage == 0) {
-        return true;
+void RegisterAllocationPass::buildIntervals(Function* function, std::vector<Interval>& intervals) {
+    std::unordered_map<const Value*, size_t> valueIntervals;
+    std::unordered_map<const Block*, U32> blockStart;
+    std::vector<std::pair<U32, const Block*>> branches;
+    std::vector<U32> calls;
+    intervals.clear();
+
+    // Number instructions in layout order, extending intervals to their last use
+    U32 position = 0;
+    for (const auto* block : function->blocks) {
+        blockStart[block] = position;
+        for (const auto* instr : block->instructions) {
+            const auto& opInfo = opcodeInfo[instr->opcode];
+            const U08 sigs[] = { opInfo.getSignatureSrc1(), opInfo.getSignatureSrc2(), opInfo.getSignatureSrc3() };
+            const Instruction::Operand* srcs[] = { &instr->src1, &instr->src2, &instr->src3 };
+            for (int i = 0; i < 3; i++) {
+                if (!isValueOperand(sigs[i], *srcs[i])) {
+                    continue;
+                }
+                auto it = valueIntervals.find(srcs[i]->value);
+                if (it != valueIntervals.end()) {
+                    intervals[it->second].end = position;
+                }
+            }
+            if (instr->opcode == OPCODE_CALL || instr->opcode == OPCODE_CALLCOND) {
+                calls.push_back(position);
+            }
+            if (instr->opcode == OPCODE_BR) {
+                branches.emplace_back(position, instr->src1.block);
+            }
+            if (instr->opcode == OPCODE_BRCOND) {
+                branches.emplace_back(position, instr->src2.block);
+            }
+
+            // Argument values are placed in the ABI registers instead
+            const U08 sigDest = opInfo.getSignatureDest();
+            if (instr->opcode != OPCODE_ARG && instr->dest && (sigDest == OPCODE_SIG_TYPE_V || sigDest == OPCODE_SIG_TYPE_M)) {
+                const int regSet = getRegSet(instr->dest);
+                if (regSet >= 0) {
+                    valueIntervals[instr->dest] = intervals.size();
+                    intervals.push_back({ instr->dest, position, position, U32(regSet), -1, false });
+                }
+            }
+            position += 1;
+        }
     }
-    for (auto& regUsage : regUsages) {
-        if (regUsage.types & backend::RegisterSet::TYPE_INT && value->isTypeInteger() ||
-            regUsage.types & backend::RegisterSet::TYPE_FLOAT && value->isTypeFloat() ||
-            regUsage.types & backend::RegisterSet::TYPE_VECTOR && value->isTypeVector()) {
-            for (size_t i = 0; i < regUsage.count; i++) {
-                if (!regUsage.regs[i]) {
-                    regUsage.regs[i] = 1;
-                    value->reg = i;
-                    return true;
+
+    // Values live at the header of a loop stay alive until its back edge
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (const auto& branch : branches) {
+            const U32 from = branch.first;
+            const U32 to = blockStart[branch.second];
+            if (to > from) {
+                continue;
+            }
+            for (auto& interval : intervals) {
+                if (interval.start < to && interval.end >= to && interval.end < from) {
+                    interval.end = from;
+                    changed = true;
                 }
             }
         }
     }
-    return false;
+
+    // Detect values that must survive calls
+    for (auto& interval : intervals) {
+        auto it = std::upper_bound(calls.begin(), calls.end(), interval.start);
+        interval.crossesCall = (it != calls.end() && *it < interval.end);
+    }
 }
 
-bool RegisterAllocationPass::tryFreeValueReg(Value* value) {
-    // Nothing to free if value is constant
-    if (value->isConstant()) {
-        return true;
+bool RegisterAllocationPass::scanIntervals(std::vector<Interval>& intervals) {
+    std::vector<Interval*> active;
+    std::vector<std::vector<bool>> usedRegs;
+    for (const auto& regSet : targetInfo.regSets) {
+        usedRegs.emplace_back(regSet.valueIndex.size(), false);
     }
-    value->usage -= 1;
-    if (value->usage == 0) {
-        for (auto& regUsage : regUsages) {
-            if (regUsage.types & backend::RegisterSet::TYPE_INT && value->isTypeInteger() ||
-                regUsage.types & backend::RegisterSet::TYPE_FLOAT && value->isTypeFloat() ||
-                regUsage.types & backend::RegisterSet::TYPE_VECTOR && value->isTypeVector()) {
-                regUsage.regs[value->reg] = 0;
-                return true;
+
+    bool success = true;
+    for (auto& current : intervals) {
+        // Release registers of expired intervals
+        for (auto it = active.begin(); it != active.end();) {
+            if ((*it)->end < current.start) {
+                usedRegs[(*it)->regSet][(*it)->reg] = false;
+                it = active.erase(it);
+            } else {
+                it++;
+            }
+        }
+
+        // Pick a free register, preferring volatile ones for values not live across calls
+        auto& used = usedRegs[current.regSet];
+        const auto& vols = volatileRegs[current.regSet];
+        S32 reg = -1;
+        for (S32 r = 0; r < S32(used.size()); r++) {
+            if (used[r] || !isRegAllowed(current, r)) {
+                continue;
+            }
+            if (reg < 0 || (!current.crossesCall && vols[r] && !vols[reg])) {
+                reg = r;
             }
         }
+
+        // Otherwise, spill the active interval that ends the furthest
+        if (reg < 0) {
+            success = false;
+            auto victim = active.end();
+            for (auto it = active.begin(); it != active.end(); it++) {
+                if ((*it)->regSet != current.regSet || !isRegAllowed(current, (*it)->reg)) {
+                    continue;
+                }
+                if (victim == active.end() || (*it)->end > (*victim)->end) {
+                    victim = it;
+                }
+            }
+            if (victim == active.end() || (*victim)->end <= current.end) {
+                current.reg = -1;
+                continue;
+            }
+            reg = (*victim)->reg;
+            (*victim)->reg = -1;
+            active.erase(victim);
+        }
+        current.reg = reg;
+        used[reg] = true;
+        active.push_back(&current);
     }
-    return false;
+    return success;
 }
 
-bool RegisterAllocationPass::run(Function* function) {
-    // Reset register usage
-    for (auto& regUsage : regUsages) {
-        regUsage.regs.reset();
+void RegisterAllocationPass::insertSpillCode(Function* function, const std::vector<Interval>& intervals) {
+    std::unordered_map<const Value*, U32> slots;
+    for (const auto& interval : intervals) {
+        if (interval.reg < 0) {
+            slots[interval.value] = function->stackSize;
+            function->stackSize += SPILL_SLOT_SIZE;
+        }
+    }
+
+    Builder builder;
+    for (auto* block : function->blocks) {
+        for (auto it = block->instructions.begin(); it != block->instructions.end(); it++) {
+            auto* instr = *it;
+            const auto& opInfo = opcodeInfo[instr->opcode];
+
+            // Reload spilled sources right before their use
+            const U08 sigs[] = { opInfo.getSignatureSrc1(), opInfo.getSignatureSrc2(), opInfo.getSignatureSrc3() };
+            Instruction::Operand* srcs[] = { &instr->src1, &instr->src2, &instr->src3 };
+            std::unordered_map<Value*, Value*> reloads;
+            for (int i = 0; i < 3; i++) {
+                if (!isValueOperand(sigs[i], *srcs[i])) {
+                    continue;
+                }
+                Value* value = srcs[i]->value;
+                auto slot = slots.find(value);
+                if (slot == slots.end()) {
+                    continue;
+                }
+                if (reloads.find(value) == reloads.end()) {
+                    builder.setInsertPoint(block, it);
+                    reloads[value] = builder.createStackLoad(slot->second, value->type);
+                }
+                value->usage -= 1;
+                srcs[i]->setValue(reloads[value]);
+            }
+
+            // Store spilled destinations right after their definition
+            if (instr->dest) {
+                auto slot = slots.find(instr->dest);
+                if (slot != slots.end()) {
+                    builder.setInsertPoint(block, std::next(it));
+                    builder.createStackStore(slot->second, instr->dest);
+                    it++;
+                }
+            }
+        }
     }
+}
 
+bool RegisterAllocationPass::run(Function* function) {
     // Arguments
     for (int i = 0; i < function->args.size(); i++) {
         auto& arg = function->args[i];
@@ -94,58 +262,33 @@ bool RegisterAllocationPass::run(Function* function) {
         }
     }
 
-    // CFG values
+    // Handle call arguments
     for (auto& block : function->blocks) {
         for (auto& i : block->instructions) {
-            // Handle call arguments
             if (i->opcode == OPCODE_ARG) {
                 allocArgumentReg(i->src1.immediate, i->dest);
-                tryFreeValueReg(i->src2.value);
-                continue;
-            }
-            // Handle call returns
-            if (i->opcode == OPCODE_CALL || i->opcode == OPCODE_CALLCOND) {
-                continue;
-            }
-            // Handle everything else
-            auto opInfo = opcodeInfo[i->opcode];
-            if (opInfo.getSignatureDest() == OPCODE_SIG_TYPE_V) {
-                if (!tryAllocValueReg(i->dest)) {
-                    assert_always("This pass does not support placing values in the stack yet");
-                }
-            }
-            if (opInfo.getSignatureSrc1() == OPCODE_SIG_TYPE_V) {
-                tryFreeValueReg(i->src1.value);
-            }
-            if (opInfo.getSignatureSrc2() == OPCODE_SIG_TYPE_V) {
-                tryFreeValueReg(i->src2.value);
-            }
-            if (opInfo.getSignatureSrc3() == OPCODE_SIG_TYPE_V) {
-                tryFreeValueReg(i->src3.value);
             }
         }
     }
 
-    // Register remapping
-    for (auto& block : function->blocks) {
-        for (auto& i : block->instructions) {
-            auto opInfo = opcodeInfo[i->opcode];
-            if (i->opcode == OPCODE_ARG || opInfo.getSignatureDest() != OPCODE_SIG_TYPE_V) {
-                continue;
-            }
-            Value* value = i->dest;
-            for (const auto& regSet : targetInfo.regSets) {
-                if (regSet.types & backend::RegisterSet::TYPE_INT && value->isTypeInteger()) {
-                    value->reg = regSet.valueIndex[value->reg];
-                }
-                if (regSet.types & backend::RegisterSet::TYPE_FLOAT && value->isTypeFloat()) {
-                    value->reg = regSet.valueIndex[value->reg];
-                }
-                if (regSet.types & backend::RegisterSet::TYPE_VECTOR && value->isTypeVector()) {
-                    value->reg = regSet.valueIndex[value->reg];
-                }
-            }
+    // CFG values
+    std::vector<Interval> intervals;
+    for (U32 round = 0; ; round++) {
+        buildIntervals(function, intervals);
+        if (scanIntervals(intervals)) {
+            break;
+        }
+        if (round == SPILL_MAX_ROUNDS) {
+            logger.error(LOG_CPU, "Register allocation did not converge after %d spilling rounds", round);
+            return false;
         }
+        insertSpillCode(function, intervals);
+    }
+
+    // Register remapping
+    for (const auto& interval : intervals) {
+        const auto& regSet = targetInfo.regSets[interval.regSet];
+        interval.value->reg = regSet.valueIndex[interval.reg];
     }
 
     function->flags |= FUNCTION_IS_COMPILABLE;
@@ -9,7 +9,7 @@
 #include "nucleus/cpu/backend/target.h"
 #include "nucleus/cpu/hir/pass.h"
 
-#include <bitset>
+#include <vector>
 
 namespace cpu {
 namespace hir {
@@ -25,43 +25,71 @@ namespace passes {
  *
  * Notes:
  * - This pass should be the last one to apply to a function.
- * - This pass uses Value::usage to determine when a value is no longer needed
- *   and the corresponding register can be. Value::usage will be modified.
+ * - Registers are assigned with a linear scan over the live intervals of the values,
+ *   following the layout order of Function::blocks. Values live across calls are only
+ *   placed in registers preserved by the target ABI.
+ * - Spilled values get a slot in the stack frame (Function::stackSize), are stored right
+ *   after being defined and reloaded into short-lived values right before each use.
  */
 class RegisterAllocationPass : public Pass {
 private:
-    struct RegSetUsage {
-        U32 types;
-        U32 count;
-        std::bitset<32> regs;
+    struct Interval {
+        Value* value;
+        U32 start;         // Position of the defining instruction
+        U32 end;           // Position of the last use
+        U32 regSet;        // Index of the register set of this value
+        S32 reg;           // Index in RegisterSet::valueIndex, or -1 if spilled
+        bool crossesCall;  // Value is live across a call instruction
     };
 
     // Target information
     const backend::TargetInfo& targetInfo;
 
-    // Register usage
-    std::vector<RegSetUsage> regUsages;
+    // Whether each value register of each set is clobbered by calls
+    std::vector<std::vector<bool>> volatileRegs;
 
     /**
-     * Handle call arguments
-     * @param[in]  index  Index of the argument in the function
-     * @param[in]  arg    Argument whose register has to be determined
+     * Find the register set that can hold a value
+     * @param[in]  value  Value to check
+     * @return            Index of the register set, or -1 if there is none
      */
-    void allocArgumentReg(int index, Value* arg);
+    int getRegSet(const Value* value) const;
 
     /**
-     * Try to allocate a register for a value
-     * @param[in]  value  Value to allocate a register for
-     * @return            True if an available register was found
+     * Check whether a register can hold an interval
+     * @param[in]  interval  Interval to allocate
+     * @param[in]  reg       Index in RegisterSet::valueIndex
+     * @return               True if the register is not clobbered while the interval is live
      */
-    bool tryAllocValueReg(Value* value);
+    bool isRegAllowed(const Interval& interval, S32 reg) const;
 
     /**
-     * Try to free a register from a value
-     * @param[in]  value  Value to allocate a register for
-     * @return            True if an available register was found
+     * Compute the live intervals of all values defined in the function
+     * @param[in]   function   Function to analyze
+     * @param[out]  intervals  Live intervals sorted by start position
      */
-    bool tryFreeValueReg(Value* value);
+    void buildIntervals(Function* function, std::vector<Interval>& intervals);
+
+    /**
+     * Assign registers with a linear scan, spilling the intervals that end the furthest
+     * @param[in]   intervals  Live intervals sorted by start position
+     * @return                 True if every interval received a register
+     */
+    bool scanIntervals(std::vector<Interval>& intervals);
+
+    /**
+     * Move spilled values to the stack, inserting the required stores and reloads
+     * @param[in]  function   Function to modify
+     * @param[in]  intervals  Live intervals after the linear scan
+     */
+    void insertSpillCode(Function* function, const std::vector<Interval>& intervals);
+
+    /**
+     * Handle call arguments
+     * @param[in]  index  Index of the argument in the function
+     * @param[in]  arg    Argument whose register has to be determined
+     */
+    void allocArgumentReg(int index, Value* arg);
 
 public:
     // Constructor
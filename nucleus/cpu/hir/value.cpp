@@ -12,6 +12,12 @@
 namespace cpu {
 namespace hir {
 
+// Rotate helpers, taking the amount modulo the width of the value
+static U08 rotl8(U08 x, U08 n)  { n &= 7;  return n ? U08(x << n) | U08(x >> (8 - n)) : x; }
+static U16 rotl16(U16 x, U08 n) { n &= 15; return n ? U16(x << n) | U16(x >> (16 - n)) : x; }
+static U32 rotl32(U32 x, U08 n) { n &= 31; return n ? (x << n) | (x >> (32 - n)) : x; }
+static U64 rotl64(U64 x, U08 n) { n &= 63; return n ? (x << n) | (x >> (64 - n)) : x; }
+
 S32 Value::getId() {
     if (id < 0) {
         Function* parFunction;
@@ -169,7 +175,7 @@ void Value::doSub(Value* rhs) {
 }
 
 void Value::doMul(Value* rhs, ArithmeticFlags flags) {
-    if (flags & ARITHMETIC_SIGNED) {
+    if (!(flags & ARITHMETIC_UNSIGNED)) {
         switch (type) {
         case TYPE_I8:   constant.i8  *= rhs->constant.i8;   break;
         case TYPE_I16:  constant.i16 *= rhs->constant.i16;  break;
@@ -194,7 +200,7 @@ void Value::doMulH(Value* rhs, ArithmeticFlags flags) {
 }
 
 void Value::doDiv(Value* rhs, ArithmeticFlags flags) {
-    if (flags & ARITHMETIC_SIGNED) {
+    if (!(flags & ARITHMETIC_UNSIGNED)) {
         switch (type) {
         case TYPE_I8:   constant.i8  /= rhs->constant.i8;   break;
         case TYPE_I16:  constant.i16 /= rhs->constant.i16;  break;
@@ -205,10 +211,10 @@ void Value::doDiv(Value* rhs, ArithmeticFlags flags) {
         }
     } else {
         switch (type) {
-        case TYPE_I8:   constant.i8  /= U08(rhs->constant.i8);    break;
-        case TYPE_I16:  constant.i16 /= U16(rhs->constant.i16);  break;
-        case TYPE_I32:  constant.i32 /= U32(rhs->constant.i32);  break;
-        case TYPE_I64:  constant.i64 /= U64(rhs->constant.i64);  break;
+        case TYPE_I8:   constant.i8  = U08(constant.i8)  / U08(rhs->constant.i8);   break;
+        case TYPE_I16:  constant.i16 = U16(constant.i16) / U16(rhs->constant.i16);  break;
+        case TYPE_I32:  constant.i32 = U32(constant.i32) / U32(rhs->constant.i32);  break;
+        case TYPE_I64:  constant.i64 = U64(constant.i64) / U64(rhs->constant.i64);  break;
         default:
             assert_always("Unimplemented case");
         }
@@ -303,6 +309,17 @@ void Value::doShrA(Value* amount) {
     }
 }
 
+void Value::doRol(Value* amount) {
+    switch (type) {
+    case TYPE_I8:   constant.i8  = rotl8(constant.i8, amount->constant.i8);    break;
+    case TYPE_I16:  constant.i16 = rotl16(constant.i16, amount->constant.i8);  break;
+    case TYPE_I32:  constant.i32 = rotl32(constant.i32, amount->constant.i8);  break;
+    case TYPE_I64:  constant.i64 = rotl64(constant.i64, amount->constant.i8);  break;
+    default:
+        assert_always("Unimplemented case");
+    }
+}
+
 void Value::doZExt(Type newType) {
     switch (type) {
     case TYPE_I8:   type = newType; constant.i64 &= 0xFF;        break;
@@ -96,6 +96,7 @@ public:
     void doShl(Value* amount);
     void doShr(Value* amount);
     void doShrA(Value* amount);
+    void doRol(Value* amount);
     void doZExt(Type newType);
     void doSExt(Type newType);
     void doTrunc(Type newType);
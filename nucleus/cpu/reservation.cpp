@@ -0,0 +1,46 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#include "reservation.h"
+
+#include <thread>
+
+namespace cpu {
+
+ReservationTable::ReservationTable() {
+    versions = std::make_unique<std::atomic<U64>[]>(ENTRY_MASK + 1);
+    for (Size i = 0; i <= ENTRY_MASK; i++) {
+        versions[i].store(0, std::memory_order_relaxed);
+    }
+}
+
+U64 ReservationTable::acquire(U32 addr) {
+    const auto& version = getVersion(addr);
+    U64 value = version.load(std::memory_order_acquire);
+    while (value & 1) {
+        std::this_thread::yield();
+        value = version.load(std::memory_order_acquire);
+    }
+    return value;
+}
+
+bool ReservationTable::lock(U32 addr, U64 version) {
+    if (version & 1) {
+        return false;
+    }
+    return getVersion(addr).compare_exchange_strong(version, version + 1, std::memory_order_acquire);
+}
+
+void ReservationTable::lockAlways(U32 addr) {
+    while (!lock(addr, acquire(addr))) {
+        std::this_thread::yield();
+    }
+}
+
+void ReservationTable::unlock(U32 addr) {
+    getVersion(addr).fetch_add(1, std::memory_order_release);
+}
+
+}  // namespace cpu
@@ -0,0 +1,90 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/common.h"
+
+#include <atomic>
+#include <memory>
+
+namespace cpu {
+
+/**
+ * Reservation Table
+ * =================
+ * Shared state behind the PPU load-and-reserve/store-conditional instructions and the SPU
+ * lock-line commands. Guest memory is split into 128-byte granules, hashed into a table
+ * of version counters. Writers lock a granule by moving its version from an even value
+ * to the next odd value, and release it by moving it to the following even value.
+ * A reservation is lost once the version observed when it was taken changes.
+ *
+ * Notes:
+ * - Granules sharing a table entry also share their version, which can only cause
+ *   spurious store-conditional failures. These are allowed by the architecture.
+ * - Compiled PPU code indexes the table directly, see ReservationTable::getBase.
+ */
+class ReservationTable {
+public:
+    static constexpr U32 GRANULE_BITS = 7;
+    static constexpr U32 GRANULE_SIZE = 1 << GRANULE_BITS;
+    static constexpr U32 ENTRY_BITS = 16;
+    static constexpr U32 ENTRY_MASK = (1 << ENTRY_BITS) - 1;
+
+    // Version never held by a granule, used to make locking attempts fail
+    static constexpr U64 VERSION_INVALID = ~0ULL;
+
+private:
+    std::unique_ptr<std::atomic<U64>[]> versions;
+
+public:
+    ReservationTable();
+
+    /**
+     * Get the version counter of the granule containing an address
+     * @param[in]  addr  Guest address
+     * @return           Version counter
+     */
+    std::atomic<U64>& getVersion(U32 addr) {
+        return versions[(addr >> GRANULE_BITS) & ENTRY_MASK];
+    }
+
+    /**
+     * Get the host address of the first version counter
+     * @return  Base of an array of (ENTRY_MASK + 1) 64-bit counters
+     */
+    void* getBase() {
+        return versions.get();
+    }
+
+    /**
+     * Wait until the granule containing an address is not locked by a writer
+     * @param[in]  addr  Guest address
+     * @return           Current (even) version of the granule
+     */
+    U64 acquire(U32 addr);
+
+    /**
+     * Lock the granule containing an address, if its version still matches
+     * @param[in]  addr     Guest address
+     * @param[in]  version  Version observed when the reservation was taken
+     * @return              True on success
+     */
+    bool lock(U32 addr, U64 version);
+
+    /**
+     * Lock the granule containing an address, waiting for other writers
+     * @param[in]  addr  Guest address
+     */
+    void lockAlways(U32 addr);
+
+    /**
+     * Unlock a granule previously locked, invalidating the reservations on it
+     * @param[in]  addr  Guest address
+     */
+    void unlock(U32 addr);
+};
+
+}  // namespace cpu
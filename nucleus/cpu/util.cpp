@@ -22,13 +22,10 @@ namespace cpu {
 
 void nucleusTranslate(void* guestFunc, U64 guestAddr) {
     auto* function = static_cast<frontend::ppu::Function*>(guestFunc);
-    function->analyze_cfg();
-    function->recompile();
-
     auto* hirFunction = function->hirFunction;
     auto* cpu = static_cast<GuestCPU*>(CPU::getCurrentThread()->parent);
     auto* state = static_cast<frontend::ppu::PPUThread*>(CPU::getCurrentThread())->state.get();
-    cpu->compiler->compile(hirFunction);
+    function->translate();
     cpu->compiler->call(hirFunction, state);
 }
 
@@ -24,7 +24,11 @@
 bool Emulator::load_ps3(const std::string& path) {
     memory = std::make_shared<mem::GuestVirtualMemory>(4_GB);
     cpu = std::make_shared<cpu::GuestCPU>(this, memory.get());
-    gpu = std::make_shared<gpu::RSX>(this, memory.get(), graphics);
+    auto rsx = std::make_shared<gpu::RSX>(this, memory.get(), graphics);
+    if (!config.cachePath.empty()) {
+        rsx->loadPipelineCache(config.cachePath, path);
+    }
+    gpu = rsx;
     sys = std::make_shared<sys::LV2>(this, memory, sys::LV2_DEX);
     return sys->start(path);
 }
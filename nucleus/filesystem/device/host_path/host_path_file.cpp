@@ -6,6 +6,8 @@
 #include "host_path_file.h"
 #include "nucleus/assert.h"
 
+#include <sys/stat.h>
+
 #if defined(NUCLEUS_COMPILER_MSVC)
 #define fseeko64 _fseeki64
 #define ftello64 _ftelli64
@@ -26,6 +28,9 @@ const char* getOpenMode(OpenMode mode) {
         return "wb";
     case ReadWrite:
         return "r+b";
+    case Append:
+    case WriteAppend:
+        return "ab";
     default:
         assert_always("Unexpected");
         return "r";
@@ -78,12 +83,27 @@ Position HostPathFile::tell() {
 }
 
 File::Attributes HostPathFile::attributes() {
-    // TODO
     File::Attributes attr;
     attr.timestamp_access = 0;
     attr.timestamp_create = 0;
     attr.timestamp_write = 0;
 
+    // Obtain timestamps
+#if defined(NUCLEUS_COMPILER_MSVC)
+    struct _stat64 info;
+    if (_fstat64(_fileno(handle), &info) == 0) {
+        attr.timestamp_access = info.st_atime;
+        attr.timestamp_create = info.st_ctime;
+        attr.timestamp_write = info.st_mtime;
+    }
+#else
+    struct stat info;
+    if (fstat(fileno(handle), &info) == 0) {
+        attr.timestamp_access = info.st_atime;
+        attr.timestamp_write = info.st_mtime;
+    }
+#endif
+
     // Obtain size
     Position originalPosition = tell();
     seek(0, fs::SeekEnd);
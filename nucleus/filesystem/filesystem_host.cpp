@@ -6,6 +6,14 @@
 #include "filesystem_host.h"
 #include "nucleus/filesystem/device/list.h"
 
+#if defined(NUCLEUS_TARGET_WINDOWS)
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#include <cerrno>
+
 namespace fs {
 
 std::unique_ptr<File> HostFileSystem::openFile(const Path& path, OpenMode mode) {
@@ -18,4 +26,24 @@ bool HostFileSystem::existsFile(const Path& path) {
     return hostDevice.existsFile(path);
 }
 
+// Create a single directory, succeeding if it already exists
+static bool createSingleDirectory(const Path& path) {
+#if defined(NUCLEUS_TARGET_WINDOWS)
+    const int result = _mkdir(path.c_str());
+#else
+    const int result = mkdir(path.c_str(), 0755);
+#endif
+    return result == 0 || errno == EEXIST;
+}
+
+bool HostFileSystem::createDirectory(const Path& path) {
+    // Create each parent in order, skipping the root and drive letters
+    for (Size i = 1; i < path.size(); i++) {
+        if ((path[i] == '/' || path[i] == '\\') && path[i - 1] != ':' && path[i - 1] != '/' && path[i - 1] != '\\') {
+            createSingleDirectory(path.substr(0, i));
+        }
+    }
+    return createSingleDirectory(path);
+}
+
 }  // namespace fs
@@ -26,6 +26,9 @@ public:
     static bool createFile(const Path& path);
     static bool existsFile(const Path& path);
     static bool removeFile(const Path& path);
+
+    // Create a directory along with any missing parent, succeeding if it already exists
+    static bool createDirectory(const Path& path);
 };
 
 }  // namespace fs
@@ -6,6 +6,9 @@
 #pragma once
 
 #include "nucleus/common.h"
+#include "nucleus/core/hash.h"
+
+#include <cstring>
 
 namespace gpu {
 
@@ -23,7 +26,7 @@ Hash hashStruct(const Type& object) {
     static_assert((sizeof(Type) % sizeof(Hash)) == 0, "Unimplemented support for arbitrarily-sized types");
 
     // Initial hash value
-    Hash hash = 0xCBF29CE484222325ULL;
+    Hash hash = core::HASH_SEED;
     for (Size offset = 0; offset < sizeof(Type); offset += 8) {
         hash ^= *reinterpret_cast<const U64*>(reinterpret_cast<const char*>(&object) + offset);
         hash += (hash << 1) + (hash << 4) + (hash << 5) + (hash << 7) + (hash << 8) + (hash << 40);
@@ -43,7 +46,47 @@ Hash hashArray(const Component* base) {
     static_assert((sizeof(Component) % sizeof(Hash)) == 0, "Unimplemented support for arbitrarily-sized components");
 
     // Initial hash value
-    Hash hash = 0xCBF29CE484222325ULL;
+    Hash hash = core::HASH_SEED;
+    return hash;
+}
+
+/**
+ * Hash an arbitrary buffer, processing 32-byte blocks in four independent lanes so that
+ * the multiplications of consecutive words overlap. Meant for large buffers like texture
+ * data, where the byte-serial FNV-1a would be the bottleneck.
+ * @param[in]  data  Pointer to the buffer
+ * @param[in]  size  Size of the buffer in bytes
+ * @return           Hash of the buffer
+ */
+inline Hash hashBuffer(const void* data, Size size) {
+    constexpr U64 prime1 = 0x9E3779B185EBCA87ULL;
+    constexpr U64 prime2 = 0xC2B2AE3D27D4EB4FULL;
+    auto rotl = [](U64 value, int shift) -> U64 {
+        return (value << shift) | (value >> (64 - shift));
+    };
+
+    const auto* bytes = static_cast<const Byte*>(data);
+    U64 lanes[4] = { prime1 + prime2, prime2, 0, 0 - prime1 };
+    Size offset = 0;
+    for (; offset + 32 <= size; offset += 32) {
+        for (int i = 0; i < 4; i++) {
+            U64 word;
+            std::memcpy(&word, bytes + offset + 8 * i, sizeof(word));
+            lanes[i] = rotl(lanes[i] + word * prime2, 31) * prime1;
+        }
+    }
+
+    Hash hash = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18) + size;
+    for (; offset < size; offset++) {
+        hash = rotl(hash ^ (bytes[offset] * prime1), 11) * prime2;
+    }
+
+    // Final avalanche
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime1;
+    hash ^= hash >> 32;
     return hash;
 }
 
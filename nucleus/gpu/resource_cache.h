@@ -0,0 +1,195 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/common.h"
+#include "nucleus/gpu/gpu_hash.h"
+#include "nucleus/memory/guest_virtual/guest_virtual_memory.h"
+
+#include <cstring>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace gpu {
+
+/**
+ * Resource Cache Entry
+ * ====================
+ * Host resource created from a range of guest memory.
+ * @tparam  Key       Properties identifying the resource, compared bytewise
+ * @tparam  Resource  Host resource type
+ */
+template <typename Key, typename Resource>
+struct ResourceCacheEntry {
+    std::unique_ptr<Resource> resource;
+    Key key;
+    U32 address;
+    U32 size;
+    U32 capacity;                  // Bytes of the resource, counted against the size limit
+    Hash contentHash;              // Hash of the guest data when uploaded
+    U64 writeCount;                // Write count of the guest pages when validated
+    std::list<Hash>::iterator lru;
+};
+
+/**
+ * Resource Cache
+ * ==============
+ * Skeleton of the caches holding host resources created from guest memory.
+ *
+ * Implementation:
+ * - Entries are indexed by the hash of their key. Entries whose key only shares the
+ *   hash are replaced.
+ * - The pages holding each entry are write-protected. As long as no write hits them,
+ *   lookups return the cached resource without reading the guest memory. Once written,
+ *   the contents are hashed again and the resource is only replaced if the hash differs.
+ * - Entries are evicted in least recently used order whenever their collective capacity
+ *   exceeds the limit. Evicted or replaced resources are retired, and released by the
+ *   derived cache once the host GPU is done with them.
+ * @tparam  Key        Properties identifying a resource, compared bytewise
+ * @tparam  Resource   Host resource type
+ * @tparam  EntryType  Entry type, derived from ResourceCacheEntry<Key, Resource>
+ */
+template <typename Key, typename Resource, typename EntryType = ResourceCacheEntry<Key, Resource>>
+class ResourceCache {
+protected:
+    using Entry = EntryType;
+    using EntryMap = std::unordered_map<Hash, Entry>;
+
+    // Keys of the cached entries, from least to most recently used
+    std::list<Hash> lru;
+
+    // Holds each cached entry
+    EntryMap entries;
+
+    // Resources waiting for the host GPU to finish using them, with their capacity
+    std::vector<std::pair<U32, std::unique_ptr<Resource>>> retired;
+
+    Size curSize;
+    Size maxSize;
+
+    // Statistics
+    U64 uploads;
+
+    ResourceCache(Size maxSize) :
+        curSize(0), maxSize(maxSize), uploads(0) {}
+
+    /**
+     * Find the entry of a key, marking it as the most recently used
+     * @param[in]  key  Key of the entry
+     * @return          Entry, or nullptr if missing
+     */
+    Entry* find(const Key& key) {
+        auto it = entries.find(hashStruct(key));
+        if (it == entries.end()) {
+            return nullptr;
+        }
+        if (std::memcmp(&it->second.key, &key, sizeof(Key)) != 0) {
+            evict(it);
+            return nullptr;
+        }
+        auto& entry = it->second;
+        lru.splice(lru.end(), lru, entry.lru);
+        return &entry;
+    }
+
+    /**
+     * Insert an empty entry for a key, as the most recently used
+     * @param[in]  key  Key of the entry
+     * @return          Entry without resource, to be filled by ResourceCache::track and ResourceCache::replace
+     */
+    Entry& insert(const Key& key) {
+        const Hash keyHash = hashStruct(key);
+        Entry entry = {};
+        entry.key = key;
+        entry.lru = lru.insert(lru.end(), keyHash);
+        return entries.emplace(keyHash, std::move(entry)).first->second;
+    }
+
+    /**
+     * Start tracking the guest data of an entry
+     * @param[in]  memory  Guest memory holding the data
+     * @param[in]  entry   Entry to track
+     * @param[in]  addr    Guest address of the data
+     * @param[in]  size    Size of the data in bytes
+     */
+    void track(mem::GuestVirtualMemory* memory, Entry& entry, U32 addr, U32 size) {
+        // Count writes and watch the pages before reading them, so that no later write goes unnoticed
+        entry.address = addr;
+        entry.size = size;
+        entry.writeCount = memory->getWriteCount(addr, size);
+        memory->watchWrites(addr, size);
+        entry.contentHash = hashBuffer(memory->ptr<Byte>(addr), size);
+    }
+
+    /**
+     * Check whether the guest data of an entry changed since it was validated.
+     * Written pages are watched again and their contents hashed.
+     * @param[in]  memory  Guest memory holding the data
+     * @param[in]  entry   Entry to check
+     * @return             True if the resource has to be replaced
+     */
+    bool isModified(mem::GuestVirtualMemory* memory, Entry& entry) {
+        // Count writes before watching the pages again, so that none goes unnoticed
+        const U64 writeCount = memory->getWriteCount(entry.address, entry.size);
+        if (writeCount == entry.writeCount) {
+            return false;
+        }
+        memory->watchWrites(entry.address, entry.size);
+        entry.writeCount = writeCount;
+        const Hash contentHash = hashBuffer(memory->ptr<Byte>(entry.address), entry.size);
+        if (contentHash == entry.contentHash) {
+            return false;
+        }
+        entry.contentHash = contentHash;
+        return true;
+    }
+
+    /**
+     * Replace the resource of an entry, retiring the previous one
+     * @param[in]  entry     Entry to update
+     * @param[in]  resource  New resource, owned by the cache
+     * @param[in]  capacity  Bytes of the new resource
+     */
+    void replace(Entry& entry, Resource* resource, U32 capacity) {
+        if (entry.resource) {
+            curSize -= entry.capacity;
+            retired.emplace_back(entry.capacity, std::move(entry.resource));
+        }
+        entry.resource.reset(resource);
+        entry.capacity = capacity;
+        curSize += capacity;
+        uploads += 1;
+    }
+
+    // Drop a cached entry, retiring its resource
+    void evict(typename EntryMap::iterator it) {
+        auto& entry = it->second;
+        if (entry.resource) {
+            curSize -= entry.capacity;
+            retired.emplace_back(entry.capacity, std::move(entry.resource));
+        }
+        lru.erase(entry.lru);
+        entries.erase(it);
+    }
+
+    // Evict the least recently used entries until the size limit is satisfied
+    void evictLeastRecentlyUsed() {
+        while (curSize > maxSize && !lru.empty()) {
+            evict(entries.find(lru.front()));
+        }
+    }
+
+public:
+    // Get the number of resources uploaded so far
+    U64 getUploadCount() const {
+        return uploads;
+    }
+};
+
+}  // namespace gpu
@@ -16,9 +16,14 @@
 #include "nucleus/gpu/rsx/rsx_methods.h"
 #include "nucleus/gpu/rsx/rsx_vp.h"
 
+#include <algorithm>
+
 #ifdef NUCLEUS_TARGET_WINDOWS
 #include <Windows.h>
 #endif
+#ifdef NUCLEUS_ARCH_X86_64BITS
+#include <emmintrin.h>
+#endif
 
 // Method matching
 #define case_2(offset, step) \
@@ -43,13 +48,20 @@
 namespace gpu {
 namespace rsx {
 
+// Guest address of the LPAR DMA control registers
+constexpr U32 RSX_DMA_CONTROL_ADDR = 0x40100000;
+
+// Bounds of the number of times PFIFO yields before parking
+constexpr U32 RSX_PFIFO_SPIN_MIN = 16;
+constexpr U32 RSX_PFIFO_SPIN_MAX = 1024;
+
 RSX::RSX(Emulator* emulator, mem::Memory* mem, std::shared_ptr<gfx::GraphicsBackend> graphics) : GPU(emulator),
     memory(dynamic_cast<mem::GuestVirtualMemory*>(mem)),
     pgraph(std::move(graphics), this, dynamic_cast<mem::GuestVirtualMemory*>(mem))
 {
     // HACK: We store the data in memory (the PS3 stores the data in the GPU and maps it later through a LV2 syscall)
     memory->getSegment(mem::SEG_RSX_MAP_MEMORY).allocFixed(0x40000000, 0x1000);
-    memory->getSegment(mem::SEG_RSX_MAP_MEMORY).allocFixed(0x40100000, 0x1000);
+    memory->getSegment(mem::SEG_RSX_MAP_MEMORY).allocFixed(RSX_DMA_CONTROL_ADDR, 0x1000);
     memory->getSegment(mem::SEG_RSX_MAP_MEMORY).allocFixed(0x40200000, 0x4000);
     memory->getSegment(mem::SEG_RSX_MAP_MEMORY).allocFixed(0x40300000, 0x10000);
 
@@ -57,7 +69,7 @@ RSX::RSX(Emulator* emulator, mem::Memory* mem, std::shared_ptr<gfx::GraphicsBack
     device = memory->ptr<rsx_device_t>(0x40000000);
 
     // Context
-    dma_control = memory->ptr<rsx_dma_control_t>(0x40100000);
+    dma_control = memory->ptr<rsx_dma_control_t>(RSX_DMA_CONTROL_ADDR);
     driver_info = memory->ptr<rsx_driver_info_t>(0x40200000);
     reports = memory->ptr<rsx_reports_t>(0x40300000);
 
@@ -71,17 +83,86 @@ RSX::RSX(Emulator* emulator, mem::Memory* mem, std::shared_ptr<gfx::GraphicsBack
     // Prevent the FIFO from fetching commands
     dma_control->get = 0;
     dma_control->put = 0;
+    m_pfifo_spin = RSX_PFIFO_SPIN_MIN;
 
     m_pfifo_thread = new std::thread([&](){
         task();
     });
 }
 
+void RSX::loadPipelineCache(const std::string& directory, const std::string& title) {
+    pgraph.loadPipelineCache(directory, title);
+}
+
+// Convert big-endian words to host byte order, processing 4 words at a time with SSE2
+static void swapWords(U32* dst, const U32* src, U32 count) {
+    U32 i = 0;
+#ifdef NUCLEUS_ARCH_X86_64BITS
+    for (; i + 4 <= count; i += 4) {
+        __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        value = _mm_or_si128(_mm_slli_epi16(value, 8), _mm_srli_epi16(value, 8));
+        value = _mm_shufflelo_epi16(value, _MM_SHUFFLE(2, 3, 0, 1));
+        value = _mm_shufflehi_epi16(value, _MM_SHUFFLE(2, 3, 0, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), value);
+    }
+#endif
+    for (; i < count; i++) {
+        dst[i] = SE32(src[i]);
+    }
+}
+
+bool RSX::waitMemory(U32 addr, U32 size, const std::function<bool()>& condition, std::chrono::microseconds timeout) {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (!condition()) {
+        // Watch the range before checking it again, so that no write goes unnoticed
+        const U64 writeCount = memory->getWriteCount(addr, size);
+        memory->watchWrites(addr, size);
+        if (condition()) {
+            break;
+        }
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            return false;
+        }
+        const auto remaining = std::chrono::duration_cast<std::chrono::microseconds>(deadline - now);
+        if (memory->waitWrites(addr, size, writeCount, remaining)) {
+            // Writes are detected right before being performed, give them time to complete
+            for (U32 i = 0; i < RSX_PFIFO_SPIN_MIN && !condition(); i++) {
+                std::this_thread::yield();
+            }
+        }
+    }
+    return true;
+}
+
+void RSX::waitCommands() {
+    auto isPending = [this] {
+        return dma_control->get != dma_control->put;
+    };
+
+    // Commands usually arrive in quick succession, so spin shortly before parking
+    for (U32 i = 0; i < m_pfifo_spin; i++) {
+        if (isPending()) {
+            m_pfifo_spin = std::min(m_pfifo_spin * 2, RSX_PFIFO_SPIN_MAX);
+            return;
+        }
+        std::this_thread::yield();
+    }
+    m_pfifo_spin = std::max(m_pfifo_spin / 2, RSX_PFIFO_SPIN_MIN);
+
+    // Park until the guest writes the control registers
+    while (!waitMemory(RSX_DMA_CONTROL_ADDR, sizeof(rsx_dma_control_t), isPending, std::chrono::milliseconds(100))) {
+    }
+}
+
 void RSX::task() {
+    // Arguments of the current command, in host byte order
+    std::vector<U32> args(0x800);
+
     while (true) {
         // Wait until GET and PUT are different
-        while (dma_control->get == dma_control->put) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        if (dma_control->get == dma_control->put) {
+            waitCommands();
         }
         const U32 get = dma_control->get;
         const U32 put = dma_control->put;
@@ -104,9 +185,19 @@ void RSX::task() {
             continue;
         }
 
-        for (U32 i = 0; i < cmd.method_count; i++) {
+        // Fetch every argument at once, unless they cross into a discontiguous IO page
+        const U32 count = cmd.method_count;
+        if (const U32* src = io_ptr(get + 4, 4 * count)) {
+            swapWords(args.data(), src, count);
+        } else {
+            for (U32 i = 0; i < count; i++) {
+                args[i] = io_read32(get + 4*(i+1));
+            }
+        }
+
+        for (U32 i = 0; i < count; i++) {
             const U32 offset = (cmd.method_register << 2) + (cmd.flag_ni ? 0 : 4*i);
-            const U32 parameter = io_read32(get + 4*(i+1));
+            const U32 parameter = args[i];
 
 #ifdef NUCLEUS_BUILD_DEBUG
             // Ensure method register correctness by verifying objects to be bound to subchannels
@@ -152,14 +243,20 @@ void RSX::method(U32 offset, U32 parameter) {
         dma_semaphore_offset = parameter;
         break;
 
-    case NV406E_SEMAPHORE_ACQUIRE:
-        while (dma_read32(memory, dma_semaphore, dma_semaphore_offset) != parameter) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
-            break; // HACK: All processes get stuck here, probably due to the lack of context switching.
+    case NV406E_SEMAPHORE_ACQUIRE: {
+        const DMAObject dma = dma_address(dma_semaphore);
+        if (!dma.addr) {
+            break;
         }
+        // HACK: All processes get stuck here, probably due to the lack of context switching. Give up after 1 ms.
+        waitMemory(dma.addr + dma_semaphore_offset, 4, [&] {
+            return dma_read32(memory, dma_semaphore, dma_semaphore_offset) == parameter;
+        }, std::chrono::milliseconds(1));
         break;
+    }
 
     case NV406E_SEMAPHORE_RELEASE:
+        pgraph.Sync();
         dma_write32(memory, dma_semaphore, dma_semaphore_offset, parameter);
         break;
 
@@ -192,12 +289,14 @@ void RSX::method(U32 offset, U32 parameter) {
         break;
 
     case NV4097_TEXTURE_READ_SEMAPHORE_RELEASE:
+        pgraph.Sync();
         reports->semaphore[pgraph.semaphore_index].value = parameter;
         reports->semaphore[pgraph.semaphore_index].padding = 0;
         reports->semaphore[pgraph.semaphore_index].timestamp = ptimer_gettime();
         break;
 
     case NV4097_BACK_END_WRITE_SEMAPHORE_RELEASE: {
+        pgraph.Sync();
         const U32 value = (parameter & 0xFF00FF00) | ((parameter & 0xFF) << 16) | ((parameter >> 16) & 0xFF);
         reports->semaphore[pgraph.semaphore_index].value = value;
         reports->semaphore[pgraph.semaphore_index].padding = 0;
@@ -516,14 +615,42 @@ void RSX::method(U32 offset, U32 parameter) {
     case NV4097_DRAW_ARRAYS: {
         const U32 first = parameter & 0xFFFFFF;
         const U32 count = (parameter >> 24) + 1;
-        pgraph.LoadVertexAttributes(first, count);
         pgraph.DrawArrays(first, count);
         break;
     }
 
+    case NV4097_INLINE_ARRAY:
+        pgraph.inline_array.push_back(parameter);
+        break;
+
+    case NV4097_SET_INDEX_ARRAY_ADDRESS:
+        pgraph.index_array_offset = parameter;
+        break;
+
+    case NV4097_SET_INDEX_ARRAY_DMA:
+        pgraph.index_array_location = parameter & 0xF;
+        pgraph.index_array_type = (parameter >> 4) & 0xF;
+        break;
+
+    case NV4097_SET_RESTART_INDEX_ENABLE:
+        pgraph.restart_index_enable = (parameter != 0);
+        break;
+
+    case NV4097_SET_RESTART_INDEX:
+        pgraph.restart_index = parameter;
+        break;
+
+    case NV4097_DRAW_INDEX_ARRAY: {
+        const U32 first = parameter & 0xFFFFFF;
+        const U32 count = (parameter >> 24) + 1;
+        pgraph.DrawIndexArray(first, count);
+        break;
+    }
+
     case NV4097_GET_REPORT: {
         const U32 type = parameter >> 24;
         const U32 offset = parameter & 0xFFFFFF;
+        pgraph.Sync();
 
         // TODO: Get the value for the requested report type
         U64 timestamp = ptimer_gettime();
@@ -573,33 +700,47 @@ U64 RSX::ptimer_gettime() {
 #endif
 }
 
+const U32* RSX::io_ptr(U32 offset, U32 size) {
+    U32 ea;
+    if (!iotable.translateRange(offset, size, ea)) {
+        return nullptr;
+    }
+    return memory->ptr<U32>(ea);
+}
+
 U32 RSX::io_read32(U32 offset) {
-    for (const auto& map : iomaps) {
-        if (map.io <= offset && (offset & ~0x3) < map.io + map.size) {
-            return memory->read32(map.ea + (offset - map.io));
-        }
+    U32 ea;
+    if (!iotable.translate(offset, ea)) {
+        logger.error(LOG_GPU, "Illegal IO 32-bit read");
+        return 0;
     }
-    logger.error(LOG_GPU, "Illegal IO 32-bit read");
-    return 0;
+    return SE32(*memory->ptr<U32>(ea));
 }
 
 void RSX::io_write32(U32 offset, U32 value) {
-    for (const auto& map : iomaps) {
-        if (map.io <= offset && (offset & ~0x3) <= map.io + map.size) {
-            memory->write32(map.ea + (offset - map.io), value);
-        }
+    U32 ea;
+    if (!iotable.translate(offset, ea)) {
+        logger.error(LOG_GPU, "Illegal IO 32-bit write");
+        return;
     }
-    logger.error(LOG_GPU, "Illegal IO 32-bit write");
+    *memory->ptr<U32>(ea) = SE32(value);
 }
 
 U32 RSX::get_ea(U32 offset) {
-    for (const auto& map : iomaps) {
-        if (map.io <= offset && offset < map.io + map.size) {
-            return map.ea + (offset - map.io);
-        }
+    U32 ea;
+    if (!iotable.translate(offset, ea)) {
+        logger.warning(LOG_GPU, "Queried invalid IO address");
+        return 0;
     }
-    logger.warning(LOG_GPU, "Queried invalid IO address");
-    return 0;
+    return ea;
+}
+
+void RSX::iomap(U32 io, U32 ea, U32 size) {
+    iotable.map(io, ea, size);
+}
+
+void RSX::iounmap(U32 io, U32 size) {
+    iotable.unmap(io, size);
 }
 
 gfx::Texture* RSX::getFrontBuffer() {
@@ -7,8 +7,13 @@
 
 #include "nucleus/common.h"
 #include "nucleus/gpu/gpu.h"
+#include "nucleus/gpu/rsx/rsx_io.h"
 #include "nucleus/gpu/rsx/rsx_pgraph.h"
 
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
 #include <stack>
 #include <thread>
 
@@ -84,13 +89,6 @@ struct rsx_reports_t {
  * Auxiliary classes
  */
 
-// FlexIO mapped memory
-struct rsx_iomap_t {
-    U32 io;    // IO address (destination)
-    U32 ea;    // EA space address (source)
-    U32 size;  // Size of mapped region
-};
-
 // Display buffers (apparently not stored on RSX)
 struct rsx_display_info_t {
     U32 offset;
@@ -115,6 +113,22 @@ class RSX : public GPU {
     // Call stack
     std::stack<U32> m_pfifo_stack;
 
+    // Number of times PFIFO yields before parking, adapted to how soon commands arrive
+    U32 m_pfifo_spin;
+
+    /**
+     * Block until a condition on guest memory holds, waking up on writes to the pages of a range
+     * @param[in]  addr       Guest address of the range
+     * @param[in]  size       Size of the range in bytes
+     * @param[in]  condition  Condition to wait for
+     * @param[in]  timeout    Maximum time to wait
+     * @return                True if the condition holds, false on timeout
+     */
+    bool waitMemory(U32 addr, U32 size, const std::function<bool()>& condition, std::chrono::microseconds timeout);
+
+    // Block until the guest submits commands by updating PUT
+    void waitCommands();
+
 public:
     // RSX Local Memory (mapped into the user space)
     rsx_device_t* device;
@@ -129,11 +143,26 @@ public:
     mem::GuestVirtualMemory* memory;
 
     // IO Memory Access (mapped into GPU memory through FlexIO)
-    std::vector<rsx_iomap_t> iomaps;
+    IOTable iotable;
+
+    /**
+     * Get a host pointer to a range of IO memory mapped to contiguous EA space
+     * @param[in]  offset  IO address of the range
+     * @param[in]  size    Size of the range in bytes
+     * @return             Host pointer, or nullptr if the range is not contiguous in EA space
+     */
+    const U32* io_ptr(U32 offset, U32 size);
 
     // Constructor
     RSX(Emulator* emulator, mem::Memory* memory, std::shared_ptr<gfx::GraphicsBackend> graphics);
 
+    /**
+     * Prepare the pipelines used by a title in previous runs
+     * @param[in]  directory  Directory where the cache file is stored
+     * @param[in]  title      Path to the executable identifying the title
+     */
+    void loadPipelineCache(const std::string& directory, const std::string& title);
+
     U08 io_read8(U32 offset);
     U16 io_read16(U32 offset);
     U32 io_read32(U32 offset);
@@ -145,6 +174,21 @@ public:
     void io_write64(U32 offset, U64 value);
 
     U32 get_ea(U32 io_addr);
+
+    /**
+     * Map a range of EA space into IO memory
+     * @param[in]  io    IO address, aligned to RSX_IO_PAGE_SIZE
+     * @param[in]  ea    EA space address, aligned to RSX_IO_PAGE_SIZE
+     * @param[in]  size  Size of the range in bytes
+     */
+    void iomap(U32 io, U32 ea, U32 size);
+
+    /**
+     * Unmap a range of IO memory
+     * @param[in]  io    IO address, aligned to RSX_IO_PAGE_SIZE
+     * @param[in]  size  Size of the range in bytes
+     */
+    void iounmap(U32 io, U32 size);
     //GLuint get_display();
 
     // Get current time in nanoseconds from PTIMER
@@ -14,6 +14,7 @@ namespace rsx {
 enum {
     RSX_MAX_TEXTURES = 16,
     RSX_MAX_VERTEX_INPUTS = 16,
+    RSX_MAX_VERTEX_INDEX = 0xFFFFF,
 };
 
 // RSX Class handles
@@ -143,6 +144,10 @@ enum {
     RSX_LOCATION_LOCAL  = 0,
     RSX_LOCATION_MAIN   = 1,
 
+    // Index arrays
+    RSX_INDEX_TYPE_32  = 0,
+    RSX_INDEX_TYPE_16  = 1,
+
     // Reports
     RSX_REPORT_ZPASS_PIXEL_CNT  = 1,
     RSX_REPORT_ZCULL_STATS      = 2,
@@ -0,0 +1,70 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#include "rsx_io.h"
+#include "nucleus/assert.h"
+
+namespace gpu {
+namespace rsx {
+
+IOTable::IOTable() {
+    // No IO memory is mapped initially
+    pages = std::make_unique<std::atomic<U32>[]>(RSX_IO_PAGE_COUNT);
+    for (U32 page = 0; page < RSX_IO_PAGE_COUNT; page++) {
+        pages[page] = RSX_IO_PAGE_UNMAPPED;
+    }
+}
+
+void IOTable::map(U32 io, U32 ea, U32 size) {
+    assert_true((io % RSX_IO_PAGE_SIZE) == 0 && (ea % RSX_IO_PAGE_SIZE) == 0);
+    const U32 firstPage = io / RSX_IO_PAGE_SIZE;
+    const U32 pageCount = (size + RSX_IO_PAGE_SIZE - 1) / RSX_IO_PAGE_SIZE;
+    for (U32 i = 0; i < pageCount && firstPage + i < RSX_IO_PAGE_COUNT; i++) {
+        pages[firstPage + i] = ea + i * RSX_IO_PAGE_SIZE;
+    }
+}
+
+void IOTable::unmap(U32 io, U32 size) {
+    assert_true((io % RSX_IO_PAGE_SIZE) == 0);
+    const U32 firstPage = io / RSX_IO_PAGE_SIZE;
+    const U32 pageCount = (size + RSX_IO_PAGE_SIZE - 1) / RSX_IO_PAGE_SIZE;
+    for (U32 i = 0; i < pageCount && firstPage + i < RSX_IO_PAGE_COUNT; i++) {
+        pages[firstPage + i] = RSX_IO_PAGE_UNMAPPED;
+    }
+}
+
+bool IOTable::translate(U32 io, U32& ea) const {
+    const U32 page = pages[io / RSX_IO_PAGE_SIZE];
+    if (page == RSX_IO_PAGE_UNMAPPED) {
+        return false;
+    }
+    ea = page + (io % RSX_IO_PAGE_SIZE);
+    return true;
+}
+
+bool IOTable::translateRange(U32 io, U32 size, U32& ea) const {
+    if (size == 0) {
+        return false;
+    }
+    const U64 firstPage = io / RSX_IO_PAGE_SIZE;
+    const U64 lastPage = (U64(io) + size - 1) / RSX_IO_PAGE_SIZE;
+    if (lastPage >= RSX_IO_PAGE_COUNT) {
+        return false;
+    }
+    const U32 first = pages[firstPage];
+    if (first == RSX_IO_PAGE_UNMAPPED) {
+        return false;
+    }
+    for (U64 page = firstPage + 1; page <= lastPage; page++) {
+        if (pages[page] != first + (page - firstPage) * RSX_IO_PAGE_SIZE) {
+            return false;
+        }
+    }
+    ea = first + (io % RSX_IO_PAGE_SIZE);
+    return true;
+}
+
+}  // namespace rsx
+}  // namespace gpu
@@ -0,0 +1,69 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/common.h"
+#include "nucleus/literals.h"
+
+#include <atomic>
+#include <memory>
+
+namespace gpu {
+namespace rsx {
+
+// FlexIO mappings have a granularity of 1 MB
+constexpr U32 RSX_IO_PAGE_SIZE = 1_MB;
+constexpr U32 RSX_IO_PAGE_COUNT = 0x1000;
+constexpr U32 RSX_IO_PAGE_UNMAPPED = 0xFFFFFFFF;
+
+/**
+ * IO Table
+ * ========
+ * Translates IO addresses (mapped into GPU memory through FlexIO) into EA space addresses
+ * with a table holding the EA of each IO page. Entries are atomic, so that PFIFO can translate
+ * addresses while the PPU maps or unmaps other pages.
+ */
+class IOTable {
+    std::unique_ptr<std::atomic<U32>[]> pages;
+
+public:
+    IOTable();
+
+    /**
+     * Map a range of EA space into IO memory
+     * @param[in]  io    IO address, aligned to RSX_IO_PAGE_SIZE
+     * @param[in]  ea    EA space address, aligned to RSX_IO_PAGE_SIZE
+     * @param[in]  size  Size of the range in bytes
+     */
+    void map(U32 io, U32 ea, U32 size);
+
+    /**
+     * Unmap a range of IO memory
+     * @param[in]  io    IO address, aligned to RSX_IO_PAGE_SIZE
+     * @param[in]  size  Size of the range in bytes
+     */
+    void unmap(U32 io, U32 size);
+
+    /**
+     * Translate an IO address
+     * @param[in]   io  IO address
+     * @param[out]  ea  EA space address
+     * @return          True if the address is mapped
+     */
+    bool translate(U32 io, U32& ea) const;
+
+    /**
+     * Translate a range of IO memory mapped to contiguous EA space
+     * @param[in]   io    IO address of the range
+     * @param[in]   size  Size of the range in bytes
+     * @param[out]  ea    EA space address of the range
+     * @return            True if the whole range is mapped to contiguous EA space
+     */
+    bool translateRange(U32 io, U32 size, U32& ea) const;
+};
+
+}  // namespace rsx
+}  // namespace gpu
@@ -6,32 +6,47 @@
 #include "rsx_pgraph.h"
 #include "nucleus/assert.h"
 #include "nucleus/emulator.h"
+#include "nucleus/core/config.h"
+#include "nucleus/core/hash.h"
 #include "nucleus/logger/logger.h"
 #include "nucleus/gpu/rsx/rsx.h"
 #include "nucleus/gpu/rsx/rsx_convert.h"
 #include "nucleus/gpu/rsx/rsx_enum.h"
 #include "nucleus/gpu/rsx/rsx_methods.h"
+#include "nucleus/gpu/rsx/rsx_pipeline_cache.h"
+#include "nucleus/core/worker_pool.h"
 #include "nucleus/memory/guest_virtual/guest_virtual_memory.h"
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
 #include <cstring>
+#include <tuple>
 
 namespace gpu {
 namespace rsx {
 
+// Pipeline built by a compilation worker, along with the programs it needed to build
+struct PipelineJob {
+    PipelineRecord record;
+    Hash vpHash;
+    Hash fpHash;
+    gfx::Shader* vs;  // Programs already available, otherwise built by the job
+    gfx::Shader* ps;
+    std::unique_ptr<RSXVertexProgram> vp;
+    std::unique_ptr<RSXFragmentProgram> fp;
+    std::unique_ptr<gfx::Pipeline> pipeline;
+    std::future<void> done;
+};
+
 PGRAPH::PGRAPH(std::shared_ptr<gfx::GraphicsBackend> backend, RSX* rsx, mem::GuestVirtualMemory* memory) :
-    graphics(std::move(backend)), rsx(rsx), memory(memory), surface(), cacheTexture(256_MB) {
+    graphics(std::move(backend)), rsx(rsx), memory(memory), surface(), cacheTexture(256_MB), cacheVertex(64_MB) {
     cmdQueue = graphics->getGraphicsCommandQueue();
-    cmdBuffer = graphics->createCommandBuffer();
-
-    // Fence
-    gfx::FenceDesc fenceDesc = {};
-    fence = graphics->createFence(fenceDesc);
 
     // Heaps
     gfx::HeapDesc heapResourcesDesc = {};
     heapResourcesDesc.type = gfx::HEAP_TYPE_RESOURCE;
     heapResourcesDesc.size = RSX_MAX_TEXTURES + 2;
-    heapResources = graphics->createHeap(heapResourcesDesc);
     gfx::HeapDesc heapSamplersDesc = {};
     heapSamplersDesc.type = gfx::HEAP_TYPE_RESOURCE;
     heapSamplersDesc.size = RSX_MAX_TEXTURES;
@@ -40,102 +55,140 @@ PGRAPH::PGRAPH(std::shared_ptr<gfx::GraphicsBackend> backend, RSX* rsx, mem::Gue
     // Vertex Buffer for VPE constant registers
     gfx::VertexBufferDesc vtxConstantBufferDesc;
     vtxConstantBufferDesc.size = 468 * sizeof(V128);
-    vpeConstantMemory = graphics->createVertexBuffer(vtxConstantBufferDesc);
 
     // Vertex buffer for viewport scale+offsets
     gfx::VertexBufferDesc vtxTransformDesc;
     vtxTransformDesc.size = 4 * sizeof(V128);
-    vtxTransform = graphics->createVertexBuffer(vtxConstantBufferDesc);
 
-    // Vertex buffer for VPE input attributes
-    gfx::VertexBufferDesc vtxInputBufferDesc = {};
-    vtxInputBufferDesc.size = 0x100000; // TODO: Could it be bigger? Assuming 0x10000 vertices * 4 coords/vertex * 4 bytes/coord
-    for (Size i = 0; i < 16; i++) {
-        vpeInputs[i] = graphics->createVertexBuffer(vtxInputBufferDesc);
+    // Frames in flight
+    gfx::FenceDesc fenceDesc = {};
+    for (auto& frame : frames) {
+        frame.cmdBuffer = graphics->createCommandBuffer();
+        frame.fence = graphics->createFence(fenceDesc);
+        frame.heapResources = graphics->createHeap(heapResourcesDesc);
+        frame.vpeConstantMemory = graphics->createVertexBuffer(vtxConstantBufferDesc);
+        frame.vtxTransform = graphics->createVertexBuffer(vtxTransformDesc);
+        frame.submitted = false;
+        frame.recording = false;
     }
+    frameIndex = 0;
+    cmdBuffer = frames[0].cmdBuffer;
+    heapResources = frames[0].heapResources;
+    vpeConstantMemory = frames[0].vpeConstantMemory;
+    vtxTransform = frames[0].vtxTransform;
+
+    // Texture bound to disabled texture units
+    gfx::TextureDesc dummyTextureDesc = {};
+    dummyTextureDesc.width = 2;
+    dummyTextureDesc.height = 2;
+    dummyTextureDesc.format = gfx::FORMAT_R8G8B8A8_UNORM;
+    dummyTextureDesc.mipmapLevels = 1;
+    dummyTextureDesc.swizzle = TEXTURE_SWIZZLE_ENCODE(
+        gfx::TEXTURE_SWIZZLE_VALUE_0,
+        gfx::TEXTURE_SWIZZLE_VALUE_0,
+        gfx::TEXTURE_SWIZZLE_VALUE_0,
+        gfx::TEXTURE_SWIZZLE_VALUE_0
+    );
+    dummyTexture = graphics->createTexture(dummyTextureDesc);
+
+    // Pipeline compilation
+    if (config.pipelineCompilation != PIPELINE_COMPILATION_BLOCK) {
+        compilePool = std::make_unique<core::WorkerPool>();
+    }
+    pipelineStats = {};
+    skipDraws = false;
+    restart_index_enable = false;
+    restart_index = 0xFFFFFFFF;
 }
 
 PGRAPH::~PGRAPH() {
+    compilePool.reset();
+    if (warmupThread.joinable()) {
+        warmupThread.join();
+    }
 }
 
-U64 PGRAPH::HashVertexProgram(rsx_vp_instruction_t* program) {
-    // 64-bit Fowler/Noll/Vo FNV-1a hash code
-    U64 hash = 0xCBF29CE484222325ULL;
+U64 PGRAPH::HashVertexProgram(const rsx_vp_instruction_t* program) {
+    U64 hash = core::HASH_SEED;
     do {
-        hash ^= program->dword[0];
-        hash += (hash << 1) + (hash << 4) + (hash << 5) + (hash << 7) + (hash << 8) + (hash << 40);
-        hash ^= program->dword[1];
-        hash += (hash << 1) + (hash << 4) + (hash << 5) + (hash << 7) + (hash << 8) + (hash << 40);
+        hash = core::hashBytes(program->dword, sizeof(program->dword), hash);
     } while (!(program++)->end);
     return hash;
 }
 
-U64 PGRAPH::HashFragmentProgram(rsx_fp_instruction_t* program) {
-    // 64-bit Fowler/Noll/Vo FNV-1a hash code
+U64 PGRAPH::HashFragmentProgram(const rsx_fp_instruction_t* program) {
     bool end = false;
-    U64 hash = 0xCBF29CE484222325ULL;
+    U64 hash = core::HASH_SEED;
     do {
-        hash ^= program->dword[0];
-        hash += (hash << 1) + (hash << 4) + (hash << 5) + (hash << 7) + (hash << 8) + (hash << 40);
-        hash ^= program->dword[1];
-        hash += (hash << 1) + (hash << 4) + (hash << 5) + (hash << 7) + (hash << 8) + (hash << 40);
+        hash = core::hashBytes(program->dword, sizeof(program->dword), hash);
         end = ((program++)->word[0] >> 8) & 0x1; // NOTE: We can't acces program->end directly, since words require byte swapping
     } while (!end);
     return hash;
 }
 
+U32 PGRAPH::getAddress(U32 location, U32 offset) {
+    if (location == RSX_LOCATION_LOCAL) {
+        return memory->getSegment(mem::SEG_RSX_LOCAL_MEMORY).getBaseAddr() + offset;
+    } else {
+        return rsx->get_ea(offset);
+    }
+}
+
 void PGRAPH::LoadVertexAttributes(U32 first, U32 count) {
     // Bytes per vertex coordinate. Index is given by attribute::type.
     static const U32 vertexTypeSize[] = {
         0, 2, 4, 2, 1, 2, 4, 1
     };
 
-    for (Size attrIndex = 0; attrIndex < 16; attrIndex++) {
-        auto& attr = vpe.attr[attrIndex];
-        if (!attr.size) {
-            continue;
+    // Sort the enabled attributes, so that the ones sharing an interleaved stream are adjacent
+    std::vector<U32> attrIndices;
+    for (U32 attrIndex = 0; attrIndex < 16; attrIndex++) {
+        if (vpe.attr[attrIndex].size) {
+            attrIndices.push_back(attrIndex);
+        }
+    }
+    std::sort(attrIndices.begin(), attrIndices.end(), [&](U32 lhs, U32 rhs) {
+        const auto& a = vpe.attr[lhs];
+        const auto& b = vpe.attr[rhs];
+        return std::tie(a.location, a.stride, a.offset) < std::tie(b.location, b.stride, b.offset);
+    });
+
+    for (Size i = 0; i < attrIndices.size();) {
+        const auto& base = vpe.attr[attrIndices[i]];
+
+        // Group the attributes whose elements fit in the same vertex of the stream
+        Size end = i + 1;
+        while (end < attrIndices.size()) {
+            const auto& attr = vpe.attr[attrIndices[end]];
+            const U32 attrEnd = attr.offset + attr.size * vertexTypeSize[attr.type];
+            if (attr.location != base.location || attr.stride != base.stride ||
+                attrEnd - base.offset > std::max<U32>(base.stride, 1)) {
+                break;
+            }
+            end += 1;
         }
 
         // Get vertex buffer address
-        U32 addr;
-        if (attr.location == RSX_LOCATION_LOCAL) {
-            addr = memory->getSegment(mem::SEG_RSX_LOCAL_MEMORY).getBaseAddr() + attr.offset;
-        } else {
-            addr = rsx->get_ea(attr.offset);
+        U32 addr = getAddress(base.location, base.offset);
+        addr += vertex_data_base_offset + base.stride * (vertex_data_base_index + first);
+
+        // Upload only the vertices drawn, the first one becomes vertex 0 of the host buffer
+        VertexStream stream;
+        stream.init(addr, base.stride, count);
+        for (Size j = i; j < end; j++) {
+            const auto& attr = vpe.attr[attrIndices[j]];
+            stream.addElement(attr.offset - base.offset, attr.size, vertexTypeSize[attr.type]);
         }
+        gfx::VertexBuffer* buffer = cacheVertex.get(graphics.get(), memory, stream);
 
-        const U32 typeSize = vertexTypeSize[attr.type];
-        //attr.data.resize(count * attr.size * typeSize);
-
-        // Copy data per vertex
-        U08* data = (U08*)vpeInputs[attrIndex]->map();
-        for (U32 i = 0; i < count; i++) {
-            U32 src = addr + vertex_data_base_offset + attr.stride * (first + i + vertex_data_base_index);
-            void* dst = &/*attr.*/data[i * attr.size * typeSize];
-
-            switch (typeSize) {
-            case 1:
-                for (U08 j = 0; j < attr.size; j++) {
-                    ((U08*)dst)[j] = memory->read8(src + 1*j);
-                }
-                break;
-            case 2:
-                for (U08 j = 0; j < attr.size; j++) {
-                    ((U16*)dst)[j] = memory->read16(src + 2*j);
-                }
-                break;
-            case 4:
-                for (U08 j = 0; j < attr.size; j++) {
-                    ((U32*)dst)[j] = memory->read32(src + 4*j);
-                }
-                break;
-            }
+        for (Size j = i; j < end; j++) {
+            const U32 attrIndex = attrIndices[j];
+            const auto& attr = vpe.attr[attrIndex];
+            U32 offset = attr.offset - base.offset;
+            U32 stride = attr.stride;
+            cmdBuffer->cmdSetVertexBuffers(attrIndex, 1, &buffer, &offset, &stride);
         }
-        vpeInputs[attrIndex]->unmap();
-
-        U32 offset = 0;
-        U32 stride = attr.size * typeSize;
-        cmdBuffer->cmdSetVertexBuffers(attrIndex, 1, &vpeInputs[attrIndex], &offset, &stride);
+        i = end;
     }
 }
 
@@ -227,7 +280,225 @@ void PGRAPH::setSurface() {
     surface.dirty = false;
 }
 
+gfx::Pipeline* PGRAPH::createPipeline(const PipelineRecord& record, gfx::Shader* vs, gfx::Shader* ps) {
+    const auto& p = record.state;
+    const auto& layout = record.layout;
+
+    gfx::PipelineDesc pipelineDesc = {};
+    pipelineDesc.formatDSV = convertFormat(Surface::DepthStencilFormat(layout.depthFormat));
+    pipelineDesc.numCBVs = 2;
+    pipelineDesc.numSRVs = RSX_MAX_TEXTURES;
+    pipelineDesc.vs = vs;
+    pipelineDesc.ps = ps;
+
+    pipelineDesc.rsState.fillMode = gfx::FILL_MODE_SOLID;
+    pipelineDesc.rsState.cullMode = p.cull_face_enable ? convertCullMode(p.cull_mode) : gfx::CULL_MODE_NONE;
+    pipelineDesc.rsState.frontCounterClockwise = convertFrontFace(p.front_face);
+    pipelineDesc.rsState.depthEnable = p.depth_test_enable;
+    pipelineDesc.rsState.depthWriteMask = p.depth_mask ? gfx::DEPTH_WRITE_MASK_ALL : gfx::DEPTH_WRITE_MASK_ZERO;
+    pipelineDesc.rsState.depthFunc = convertCompareFunc(p.depth_func);
+    pipelineDesc.rsState.stencilEnable = p.stencil_test_enable;
+    pipelineDesc.rsState.stencilReadMask = p.stencil_func_mask;
+    pipelineDesc.rsState.stencilWriteMask = p.stencil_mask;
+    pipelineDesc.rsState.frontFace.stencilOpFail = convertStencilOp(p.stencil_op_fail);
+    pipelineDesc.rsState.frontFace.stencilOpZFail = convertStencilOp(p.stencil_op_zfail);
+    pipelineDesc.rsState.frontFace.stencilOpPass = convertStencilOp(p.stencil_op_zpass);
+    pipelineDesc.rsState.frontFace.stencilFunc = convertCompareFunc(p.stencil_func);
+    if (p.two_sided_stencil_test_enable) {
+        pipelineDesc.rsState.backFace.stencilOpFail = convertStencilOp(p.stencil_op_fail);
+        pipelineDesc.rsState.backFace.stencilOpZFail = convertStencilOp(p.stencil_op_zfail);
+        pipelineDesc.rsState.backFace.stencilOpPass = convertStencilOp(p.stencil_op_zpass);
+        pipelineDesc.rsState.backFace.stencilFunc = convertCompareFunc(p.stencil_func);
+    } else {
+        pipelineDesc.rsState.backFace.stencilOpFail = convertStencilOp(p.back_stencil_op_fail);
+        pipelineDesc.rsState.backFace.stencilOpZFail = convertStencilOp(p.back_stencil_op_zfail);
+        pipelineDesc.rsState.backFace.stencilOpPass = convertStencilOp(p.back_stencil_op_zpass);
+        pipelineDesc.rsState.backFace.stencilFunc = convertCompareFunc(p.back_stencil_func);
+    }
+
+    pipelineDesc.cbState.colorTarget[0].enableBlend = p.blend_enable;
+    pipelineDesc.cbState.colorTarget[0].enableLogicOp = p.logic_op_enable;
+    pipelineDesc.cbState.colorTarget[0].blendOp = convertBlendOp(p.blend_equation_rgb);
+    pipelineDesc.cbState.colorTarget[0].blendOpAlpha = convertBlendOp(p.blend_equation_alpha);
+    pipelineDesc.cbState.colorTarget[0].srcBlend = convertBlend(p.blend_sfactor_rgb);
+    pipelineDesc.cbState.colorTarget[0].destBlend = convertBlend(p.blend_dfactor_rgb);
+    pipelineDesc.cbState.colorTarget[0].srcBlendAlpha = convertBlend(p.blend_sfactor_alpha);
+    pipelineDesc.cbState.colorTarget[0].destBlendAlpha = convertBlend(p.blend_dfactor_alpha);
+    pipelineDesc.cbState.colorTarget[0].colorWriteMask = convertColorMask(p.color_mask);
+    pipelineDesc.cbState.colorTarget[0].logicOp = convertLogicOp(p.logic_op);
+    pipelineDesc.iaState.topology = convertPrimitiveTopology(Primitive(layout.primitive));
+    pipelineDesc.iaState.primitiveRestart = layout.restart;
+    pipelineDesc.iaState.indexFormat = (layout.indexFormat == RSX_INDEX_TYPE_16) ? gfx::INDEX_FORMAT_UINT16 : gfx::INDEX_FORMAT_UINT32;
+    for (U32 index = 0; index < RSX_MAX_VERTEX_INPUTS; index++) {
+        const auto& input = layout.inputs[index];
+        if (!input.size) {
+            continue;
+        }
+        gfx::Format format = convertVertexFormat(VertexType(input.type), input.size);
+        U32 stride = input.stride;
+        pipelineDesc.iaState.inputLayout.push_back({
+            index, format, index, 0, stride, 0, gfx::INPUT_CLASSIFICATION_PER_VERTEX, 0 }
+        );
+    }
+    for (U32 i = 0; i < RSX_MAX_TEXTURES; i++) {
+        gfx::Sampler sampler = {};
+        sampler.filter = gfx::FILTER_MIN_MAG_MIP_LINEAR;
+        sampler.addressU = gfx::TEXTURE_ADDRESS_MIRROR;
+        sampler.addressV = gfx::TEXTURE_ADDRESS_MIRROR;
+        sampler.addressW = gfx::TEXTURE_ADDRESS_MIRROR;
+        pipelineDesc.samplers.push_back(sampler);
+    }
+    return graphics->createPipeline(pipelineDesc);
+}
+
+void PGRAPH::requestPipeline(Hash pipelineHash, std::shared_ptr<PipelineJob> job) {
+    auto task = std::make_shared<std::packaged_task<void()>>([this, job] {
+        buildPipeline(*job);
+    });
+    job->done = task->get_future();
+    pendingPipeline[pipelineHash] = std::move(job);
+    if (compilePool) {
+        compilePool->submit([task] {
+            (*task)();
+        });
+    } else {
+        (*task)();
+    }
+}
+
+void PGRAPH::buildPipeline(PipelineJob& job) {
+    if (!job.vs) {
+        job.vp = std::make_unique<RSXVertexProgram>();
+        job.vp->decompile(job.record.vp.data());
+        job.vp->compile(graphics.get());
+        job.vs = job.vp->shader;
+    }
+    if (!job.ps) {
+        job.fp = std::make_unique<RSXFragmentProgram>();
+        job.fp->decompile(job.record.fp.data());
+        job.fp->compile(graphics.get());
+        job.ps = job.fp->shader;
+    }
+    if (job.vs && job.ps) {
+        job.pipeline.reset(createPipeline(job.record, job.vs, job.ps));
+    }
+}
+
+void PGRAPH::finishPipeline(Hash pipelineHash) {
+    auto it = pendingPipeline.find(pipelineHash);
+    auto job = std::move(it->second);
+    pendingPipeline.erase(it);
+
+    // Programs might have been built by other jobs in the meantime
+    if (job->vp && cacheVP.find(job->vpHash) == cacheVP.end()) {
+        cacheVP[job->vpHash] = std::move(job->vp);
+    }
+    if (job->fp && cacheFP.find(job->fpHash) == cacheFP.end()) {
+        cacheFP[job->fpHash] = std::move(job->fp);
+    }
+    if (job->pipeline && cachePersistent) {
+        cachePersistent->store(pipelineHash, job->record);
+    }
+    cachePipeline[pipelineHash] = std::move(job->pipeline);
+}
+
+void PGRAPH::collectPipelines() {
+    std::vector<Hash> ready;
+    for (const auto& entry : pendingPipeline) {
+        if (entry.second->done.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            ready.push_back(entry.first);
+        }
+    }
+    for (Hash pipelineHash : ready) {
+        finishPipeline(pipelineHash);
+    }
+}
+
+void PGRAPH::loadPipelineCache(const std::string& directory, const std::string& title) {
+    char name[32];
+    snprintf(name, sizeof(name), "rsx-%016llX", static_cast<unsigned long long>(hashBuffer(title.data(), title.size())));
+    cachePersistent = std::make_unique<PipelineCache>(directory, name);
+    if (!cachePersistent->getRecords().empty()) {
+        warmupThread = std::thread([this] {
+            warmupPipelines();
+        });
+    }
+}
+
+void PGRAPH::warmupPipelines() {
+    const auto& records = cachePersistent->getRecords();
+    core::WorkerPool pool;
+
+    // Containers are only modified by this thread, workers build the objects in place
+    std::vector<Hash> vpHashes(records.size());
+    std::vector<Hash> fpHashes(records.size());
+    for (Size i = 0; i < records.size(); i++) {
+        const auto& record = records[i];
+        vpHashes[i] = HashVertexProgram(record.vp.data());
+        fpHashes[i] = HashFragmentProgram(record.fp.data());
+        if (warmupVP.find(vpHashes[i]) == warmupVP.end()) {
+            auto* vp = (warmupVP[vpHashes[i]] = std::make_unique<RSXVertexProgram>()).get();
+            pool.submit([this, vp, &record] {
+                vp->decompile(record.vp.data());
+                vp->compile(graphics.get());
+            });
+        }
+        if (warmupFP.find(fpHashes[i]) == warmupFP.end()) {
+            auto* fp = (warmupFP[fpHashes[i]] = std::make_unique<RSXFragmentProgram>()).get();
+            pool.submit([this, fp, &record] {
+                fp->decompile(record.fp.data());
+                fp->compile(graphics.get());
+            });
+        }
+    }
+    pool.wait();
+
+    // Pipelines can be built once every program is available
+    for (Size i = 0; i < records.size(); i++) {
+        const auto& record = records[i];
+        auto* vs = warmupVP[vpHashes[i]]->shader;
+        auto* ps = warmupFP[fpHashes[i]]->shader;
+        if (!vs || !ps) {
+            continue;
+        }
+        const Hash pipelineHash = hashStruct(record.state) ^ vpHashes[i] ^ fpHashes[i] ^ hashStruct(record.layout);
+        auto* slot = &warmupPipeline[pipelineHash];
+        pool.submit([this, slot, vs, ps, &record] {
+            slot->reset(createPipeline(record, vs, ps));
+        });
+    }
+    pool.wait();
+    logger.notice(LOG_GPU, "Built %d pipelines from the pipeline cache", U32(warmupPipeline.size()));
+}
+
+void PGRAPH::finishWarmup() {
+    const auto start = std::chrono::steady_clock::now();
+    warmupThread.join();
+    const auto duration = std::chrono::steady_clock::now() - start;
+    pipelineStats.stallTime += std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+
+    for (auto& entry : warmupVP) {
+        cacheVP.emplace(entry.first, std::move(entry.second));
+    }
+    for (auto& entry : warmupFP) {
+        cacheFP.emplace(entry.first, std::move(entry.second));
+    }
+    for (auto& entry : warmupPipeline) {
+        if (entry.second) {
+            cachePipeline.emplace(entry.first, std::move(entry.second));
+        }
+    }
+    warmupVP.clear();
+    warmupFP.clear();
+    warmupPipeline.clear();
+}
+
 void PGRAPH::Begin(Primitive primitive) {
+    if (warmupThread.joinable()) {
+        finishWarmup();
+    }
+    frames[frameIndex].recording = true;
+
     // Set surface
     setSurface();
 
@@ -242,85 +513,72 @@ void PGRAPH::Begin(Primitive primitive) {
     auto vpHash = HashVertexProgram(vpData);
     auto fpData = memory->ptr<rsx_fp_instruction_t>((fp_location ? rsx->get_ea(0x0) : 0xC0000000) + fp_offset);
     auto fpHash = HashFragmentProgram(fpData);
-    auto pipelineHash = hashStruct(pipeline) ^ vpHash ^ fpHash;
-
-    if (cachePipeline.find(pipelineHash) == cachePipeline.end()) {
-        const auto& p = pipeline;
-        if (cacheVP.find(vpHash) == cacheVP.end()) {
-            auto vp = std::make_unique<RSXVertexProgram>();
-            vp->decompile(vpData);
-            vp->compile(graphics.get());
-            cacheVP[vpHash] = std::move(vp);
+
+    // State baked into the pipeline besides the PGRAPH pipeline registers
+    PipelineLayout layout = {};
+    layout.primitive = primitive;
+    layout.depthFormat = surface.depthFormat;
+    layout.restart = restart_index_enable;
+    layout.indexFormat = index_array_type;
+    for (U32 index = 0; index < RSX_MAX_VERTEX_INPUTS; index++) {
+        const auto& attr = vpe.attr[index];
+        if (attr.size) {
+            layout.inputs[index] = { U08(attr.type), attr.size, attr.stride, 0 };
         }
-        if (cacheFP.find(fpHash) == cacheFP.end()) {
-            auto fp = std::make_unique<RSXFragmentProgram>();
-            fp->decompile(fpData);
-            fp->compile(graphics.get());
-            cacheFP[fpHash] = std::move(fp);
+    }
+    const Hash layoutHash = hashStruct(layout);
+    const Hash pipelineHash = hashStruct(pipeline) ^ vpHash ^ fpHash ^ layoutHash;
+
+    collectPipelines();
+    auto it = cachePipeline.find(pipelineHash);
+    if (it == cachePipeline.end()) {
+        if (pendingPipeline.find(pipelineHash) == pendingPipeline.end()) {
+            auto job = std::make_shared<PipelineJob>();
+            job->record.state = pipeline;
+            job->record.layout = layout;
+            job->vpHash = vpHash;
+            job->fpHash = fpHash;
+            job->vs = (cacheVP.find(vpHash) != cacheVP.end()) ? cacheVP[vpHash]->shader : nullptr;
+            job->ps = (cacheFP.find(fpHash) != cacheFP.end()) ? cacheFP[fpHash]->shader : nullptr;
+
+            // Programs end at the instruction with the end flag, fragment programs might be followed by a constant.
+            // Both are copied, since guest memory might change before the job runs.
+            auto vpEnd = vpData;
+            while (!(vpEnd++)->end);
+            auto fpEnd = fpData;
+            while (!(((fpEnd++)->word[0] >> 8) & 0x1));
+            job->record.vp.assign(vpData, vpEnd);
+            job->record.fp.assign(fpData, fpEnd + 1);
+            requestPipeline(pipelineHash, std::move(job));
         }
-        gfx::PipelineDesc pipelineDesc = {};
-        pipelineDesc.formatDSV = convertFormat(surface.depthFormat);
-        pipelineDesc.numCBVs = 2;
-        pipelineDesc.numSRVs = RSX_MAX_TEXTURES;
-        pipelineDesc.vs = cacheVP[vpHash]->shader;
-        pipelineDesc.ps = cacheFP[fpHash]->shader;
-
-        pipelineDesc.rsState.fillMode = gfx::FILL_MODE_SOLID;
-        pipelineDesc.rsState.cullMode = p.cull_face_enable ? convertCullMode(p.cull_mode) : gfx::CULL_MODE_NONE;
-        pipelineDesc.rsState.frontCounterClockwise = convertFrontFace(p.front_face);
-        pipelineDesc.rsState.depthEnable = p.depth_test_enable;
-        pipelineDesc.rsState.depthWriteMask = p.depth_mask ? gfx::DEPTH_WRITE_MASK_ALL : gfx::DEPTH_WRITE_MASK_ZERO;
-        pipelineDesc.rsState.depthFunc = convertCompareFunc(p.depth_func);
-        pipelineDesc.rsState.stencilEnable = p.stencil_test_enable;
-        pipelineDesc.rsState.stencilReadMask = p.stencil_func_mask;
-        pipelineDesc.rsState.stencilWriteMask = p.stencil_mask;
-        pipelineDesc.rsState.frontFace.stencilOpFail = convertStencilOp(p.stencil_op_fail);
-        pipelineDesc.rsState.frontFace.stencilOpZFail = convertStencilOp(p.stencil_op_zfail);
-        pipelineDesc.rsState.frontFace.stencilOpPass = convertStencilOp(p.stencil_op_zpass);
-        pipelineDesc.rsState.frontFace.stencilFunc = convertCompareFunc(p.stencil_func);
-        if (p.two_sided_stencil_test_enable) {
-            pipelineDesc.rsState.backFace.stencilOpFail = convertStencilOp(p.stencil_op_fail);
-            pipelineDesc.rsState.backFace.stencilOpZFail = convertStencilOp(p.stencil_op_zfail);
-            pipelineDesc.rsState.backFace.stencilOpPass = convertStencilOp(p.stencil_op_zpass);
-            pipelineDesc.rsState.backFace.stencilFunc = convertCompareFunc(p.stencil_func);
-        } else {
-            pipelineDesc.rsState.backFace.stencilOpFail = convertStencilOp(p.back_stencil_op_fail);
-            pipelineDesc.rsState.backFace.stencilOpZFail = convertStencilOp(p.back_stencil_op_zfail);
-            pipelineDesc.rsState.backFace.stencilOpPass = convertStencilOp(p.back_stencil_op_zpass);
-            pipelineDesc.rsState.backFace.stencilFunc = convertCompareFunc(p.back_stencil_func);
+        if (config.pipelineCompilation == PIPELINE_COMPILATION_BLOCK || !compilePool) {
+            const auto start = std::chrono::steady_clock::now();
+            pendingPipeline[pipelineHash]->done.wait();
+            const auto duration = std::chrono::steady_clock::now() - start;
+            pipelineStats.stallTime += std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+            finishPipeline(pipelineHash);
         }
+        it = cachePipeline.find(pipelineHash);
+    }
 
-        pipelineDesc.cbState.colorTarget[0].enableBlend = p.blend_enable;
-        pipelineDesc.cbState.colorTarget[0].enableLogicOp = p.logic_op_enable;
-        pipelineDesc.cbState.colorTarget[0].blendOp = convertBlendOp(p.blend_equation_rgb);
-        pipelineDesc.cbState.colorTarget[0].blendOpAlpha = convertBlendOp(p.blend_equation_alpha);
-        pipelineDesc.cbState.colorTarget[0].srcBlend = convertBlend(p.blend_sfactor_rgb);
-        pipelineDesc.cbState.colorTarget[0].destBlend = convertBlend(p.blend_dfactor_rgb);
-        pipelineDesc.cbState.colorTarget[0].srcBlendAlpha = convertBlend(p.blend_sfactor_alpha);
-        pipelineDesc.cbState.colorTarget[0].destBlendAlpha = convertBlend(p.blend_dfactor_alpha);
-        pipelineDesc.cbState.colorTarget[0].colorWriteMask = convertColorMask(p.color_mask);
-        pipelineDesc.cbState.colorTarget[0].logicOp = convertLogicOp(p.logic_op);
-        pipelineDesc.iaState.topology = convertPrimitiveTopology(primitive);
-        for (U32 index = 0; index < RSX_MAX_VERTEX_INPUTS; index++) {
-            const auto& attr = vpe.attr[index];
-            if (!attr.size) {
-                continue;
-            }
-            gfx::Format format = convertVertexFormat(attr.type, attr.size);
-            U32 stride = attr.stride;
-            pipelineDesc.iaState.inputLayout.push_back({
-                index, format, index, 0, stride, 0, gfx::INPUT_CLASSIFICATION_PER_VERTEX, 0 }
-            );
+    // Use a fallback pipeline or skip the draws if the pipeline is not ready
+    gfx::Pipeline* pipelineHost = nullptr;
+    if (it != cachePipeline.end()) {
+        pipelineHost = it->second.get();
+        if (pipelineHost) {
+            fallbackPipeline[layoutHash] = pipelineHost;
         }
-        for (U32 i = 0; i < RSX_MAX_TEXTURES; i++) {
-            gfx::Sampler sampler = {};
-            sampler.filter = gfx::FILTER_MIN_MAG_MIP_LINEAR;
-            sampler.addressU = gfx::TEXTURE_ADDRESS_MIRROR;
-            sampler.addressV = gfx::TEXTURE_ADDRESS_MIRROR;
-            sampler.addressW = gfx::TEXTURE_ADDRESS_MIRROR;
-            pipelineDesc.samplers.push_back(sampler);
+    } else if (config.pipelineCompilation == PIPELINE_COMPILATION_FALLBACK) {
+        auto fallback = fallbackPipeline.find(layoutHash);
+        if (fallback != fallbackPipeline.end()) {
+            pipelineHost = fallback->second;
+            pipelineStats.fallbackDraws += 1;
         }
-        cachePipeline[pipelineHash] = std::unique_ptr<gfx::Pipeline>(graphics->createPipeline(pipelineDesc));
+    }
+    skipDraws = !pipelineHost;
+    if (skipDraws) {
+        pipelineStats.skippedDraws += 1;
+        return;
     }
 
     heapResources->reset();
@@ -354,27 +612,16 @@ void PGRAPH::Begin(Primitive primitive) {
 
         // Dummy texture
         if (!tex.enable) {
-            gfx::TextureDesc texDesc = {};
-            texDesc.width = 2;
-            texDesc.height = 2;
-            texDesc.format = gfx::FORMAT_R8G8B8A8_UNORM;
-            texDesc.mipmapLevels = 1;
-            texDesc.swizzle = TEXTURE_SWIZZLE_ENCODE(
-                gfx::TEXTURE_SWIZZLE_VALUE_0,
-                gfx::TEXTURE_SWIZZLE_VALUE_0,
-                gfx::TEXTURE_SWIZZLE_VALUE_0,
-                gfx::TEXTURE_SWIZZLE_VALUE_0
-            );
-            gfx::Texture* texDescriptor = graphics->createTexture(texDesc);
-            heapResources->pushTexture(texDescriptor);
+            heapResources->pushTexture(dummyTexture);
         }
 
         // Upload real texture
         else {
             auto texFormat = static_cast<TextureFormat>(tex.format & ~RSX_TEXTURE_LN & ~RSX_TEXTURE_UN);
+            const U32 texAddress = (tex.location ? rsx->get_ea(0x0) : 0xC0000000) + tex.offset;
 
             gfx::TextureDesc texDesc = {};
-            texDesc.data = memory->ptr<Byte>((tex.location ? rsx->get_ea(0x0) : 0xC0000000) + tex.offset);
+            texDesc.data = memory->ptr<Byte>(texAddress);
             texDesc.size = tex.width * tex.height;
             texDesc.width = tex.width;
             texDesc.height = tex.height;
@@ -392,12 +639,12 @@ void PGRAPH::Begin(Primitive primitive) {
                 assert_always("Unimplemented");
             }
 
-            gfx::Texture* texDescriptor = graphics->createTexture(texDesc);
+            gfx::Texture* texDescriptor = cacheTexture.get(graphics.get(), memory, texAddress, texDesc);
             heapResources->pushTexture(texDescriptor);
         }
     }
 
-    cmdBuffer->cmdBindPipeline(cachePipeline[pipelineHash].get());
+    cmdBuffer->cmdBindPipeline(pipelineHost);
     cmdBuffer->cmdSetHeaps({ heapResources });
     cmdBuffer->cmdSetDescriptor(0, heapResources, 0);
     cmdBuffer->cmdSetDescriptor(1, heapResources, 2);
@@ -405,10 +652,10 @@ void PGRAPH::Begin(Primitive primitive) {
 }
 
 void PGRAPH::End() {
-    cmdBuffer->finalize();
-    cmdQueue->submit(cmdBuffer, fence);
-    fence->wait();
-    cmdBuffer->reset();
+    if (!inline_array.empty()) {
+        DrawInlineArray();
+    }
+    submitFrame();
 }
 
 void PGRAPH::ClearSurface(U32 mask) {
@@ -435,15 +682,94 @@ void PGRAPH::ClearSurface(U32 mask) {
         cmdBuffer->cmdClearDepthStencil(depthTarget, depth, stencil);
     }
 
-    // TODO: Check if cmdBuffer is empty
-    cmdBuffer->finalize();
-    cmdQueue->submit(cmdBuffer, fence);
-    fence->wait();
-    cmdBuffer->reset();
+
+    // Submitted along with the next draw or synchronization
+    frames[frameIndex].recording = true;
 }
 
 void PGRAPH::DrawArrays(U32 first, U32 count) {
-    cmdBuffer->cmdDraw(first, count, 0, 1);
+    if (skipDraws) {
+        return;
+    }
+    LoadVertexAttributes(first, count);
+    cmdBuffer->cmdDraw(0, count, 0, 1);
+}
+
+void PGRAPH::DrawIndexArray(U32 first, U32 count) {
+    if (skipDraws) {
+        return;
+    }
+    const U32 indexSize = (index_array_type == RSX_INDEX_TYPE_16) ? 2 : 4;
+    const U32 addr = getAddress(index_array_location, index_array_offset) + first * indexSize;
+
+    VertexStream stream;
+    stream.init(addr, indexSize, count);
+    stream.addElement(0, 1, indexSize);
+    IndexRestart restart;
+    restart.enable = restart_index_enable;
+    restart.index = restart_index & ((indexSize == 2) ? 0xFFFF : 0xFFFFFFFF);
+    U32 minIndex;
+    U32 maxIndex;
+    gfx::VertexBuffer* buffer = cacheVertex.getIndices(graphics.get(), memory, stream, restart, minIndex, maxIndex);
+
+    // Fetch only the referenced vertices, rebasing the indices to the first of them.
+    // Indices beyond the hardware limit cannot address any vertex.
+    maxIndex = std::min<U32>(maxIndex, RSX_MAX_VERTEX_INDEX);
+    minIndex = std::min(minIndex, maxIndex);
+    LoadVertexAttributes(minIndex, maxIndex - minIndex + 1);
+    const gfx::IndexFormat format = (indexSize == 2) ? gfx::INDEX_FORMAT_UINT16 : gfx::INDEX_FORMAT_UINT32;
+    cmdBuffer->cmdSetIndexBuffer(buffer, 0, format);
+    cmdBuffer->cmdDrawIndexed(0, count, -S32(minIndex), 0, 1);
+}
+
+void PGRAPH::DrawInlineArray() {
+    // Bytes per vertex coordinate. Index is given by attribute::type.
+    static const U32 vertexTypeSize[] = {
+        0, 2, 4, 2, 1, 2, 4, 1
+    };
+
+    if (skipDraws) {
+        inline_array.clear();
+        return;
+    }
+
+    // Vertices consist of the enabled attributes packed in order
+    U32 offsets[16];
+    U32 stride = 0;
+    for (Size attrIndex = 0; attrIndex < 16; attrIndex++) {
+        const auto& attr = vpe.attr[attrIndex];
+        offsets[attrIndex] = stride;
+        stride += attr.size * vertexTypeSize[attr.type];
+    }
+    if (stride == 0) {
+        inline_array.clear();
+        return;
+    }
+
+    // Words were byteswapped when read from the FIFO, restore the guest byte order
+    std::vector<Byte> data(inline_array.size() * sizeof(U32));
+    for (Size i = 0; i < inline_array.size(); i++) {
+        const U32 word = SE32(inline_array[i]);
+        std::memcpy(&data[i * sizeof(U32)], &word, sizeof(U32));
+    }
+    const U32 count = U32(data.size() / stride);
+    inline_array.clear();
+
+    VertexStream stream;
+    stream.init(0, stride, count);
+    for (Size attrIndex = 0; attrIndex < 16; attrIndex++) {
+        const auto& attr = vpe.attr[attrIndex];
+        if (attr.size) {
+            stream.addElement(offsets[attrIndex], attr.size, vertexTypeSize[attr.type]);
+        }
+    }
+    gfx::VertexBuffer* buffer = cacheVertex.upload(graphics.get(), data.data(), stream);
+    for (U32 attrIndex = 0; attrIndex < 16; attrIndex++) {
+        if (vpe.attr[attrIndex].size) {
+            cmdBuffer->cmdSetVertexBuffers(attrIndex, 1, &buffer, &offsets[attrIndex], &stride);
+        }
+    }
+    cmdBuffer->cmdDraw(0, count, 0, 1);
 }
 
 void PGRAPH::Enable(U32 prop, U32 enabled) {
@@ -489,6 +815,46 @@ void PGRAPH::Enable(U32 prop, U32 enabled) {
 }
 
 void PGRAPH::Flip() {
+    Sync();
+}
+
+void PGRAPH::submitFrame() {
+    auto& frame = frames[frameIndex];
+    if (!frame.recording) {
+        return;
+    }
+    cmdBuffer->finalize();
+    cmdQueue->submit(cmdBuffer, frame.fence);
+    frame.submitted = true;
+    frame.recording = false;
+
+    // Wait only if the next frame is still being executed by the host GPU
+    frameIndex = (frameIndex + 1) % PGRAPH_MAX_FRAMES_IN_FLIGHT;
+    auto& next = frames[frameIndex];
+    if (next.submitted) {
+        next.fence->wait();
+        next.submitted = false;
+    }
+    next.cmdBuffer->reset();
+
+    cmdBuffer = next.cmdBuffer;
+    heapResources = next.heapResources;
+    vpeConstantMemory = next.vpeConstantMemory;
+    vtxTransform = next.vtxTransform;
+}
+
+void PGRAPH::Sync() {
+    submitFrame();
+    for (auto& frame : frames) {
+        if (frame.submitted) {
+            frame.fence->wait();
+            frame.submitted = false;
+        }
+    }
+
+    // Cached textures and vertex buffers are no longer in use by the host GPU
+    cacheTexture.trim();
+    cacheVertex.trim();
 }
 
 }  // namespace rsx
@@ -9,16 +9,21 @@
 #include "nucleus/graphics/graphics.h"
 #include "nucleus/gpu/gpu_hash.h"
 #include "nucleus/gpu/texture_cache.h"
+#include "nucleus/gpu/vertex_cache.h"
 #include "nucleus/gpu/rsx/rsx_enum.h"
 #include "nucleus/gpu/rsx/rsx_vp.h"
 #include "nucleus/gpu/rsx/rsx_fp.h"
 #include "nucleus/gpu/rsx/rsx_texture.h"
 
+#include <future>
 #include <memory>
+#include <string>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
  // Forward declarations
+namespace core { class WorkerPool; }
 namespace mem { class GuestVirtualMemory; }
 
 namespace gpu {
@@ -26,6 +31,9 @@ namespace rsx {
 
 // Forward declarations
 class RSX;
+class PipelineCache;
+struct PipelineRecord;
+struct PipelineJob;
 
 // RSX Vertex Program attribute
 struct rsx_vp_attribute_t {
@@ -147,6 +155,33 @@ struct alignas(sizeof(Hash)) Pipeline {
     U64 hash();
 };
 
+// Statistics about pipelines that were not ready when needed
+struct PipelineStats {
+    U64 stallTime;      // Nanoseconds the command stream waited for pipelines to be built
+    U64 skippedDraws;   // Draws skipped since their pipeline was being built
+    U64 fallbackDraws;  // Draws using a fallback pipeline since theirs was being built
+};
+
+// Number of command buffers that can be recorded or executed at the same time
+constexpr Size PGRAPH_MAX_FRAMES_IN_FLIGHT = 3;
+
+/**
+ * Frame
+ * =====
+ * Command buffer along with every host resource that is overwritten on each draw.
+ * Frames are used in a round-robin fashion, so that the commands of a draw can be
+ * recorded while the host GPU is still executing the previous ones.
+ */
+struct Frame {
+    gfx::CommandBuffer* cmdBuffer;
+    gfx::Fence* fence;
+    gfx::Heap* heapResources;
+    gfx::VertexBuffer* vtxTransform;
+    gfx::VertexBuffer* vpeConstantMemory;
+    bool submitted;  // Flag: Commands were submitted and the fence has not been waited yet
+    bool recording;  // Flag: Commands were recorded since the last submission
+};
+
 // RSX's PGRAPH engine (Curie)
 class PGRAPH {
     std::shared_ptr<gfx::GraphicsBackend> graphics;
@@ -154,19 +189,43 @@ class PGRAPH {
     RSX* rsx;
 
     gfx::CommandQueue* cmdQueue;
+    gfx::Heap* heapSamplers;
+    gfx::Texture* dummyTexture;
+
+    // Frames in flight
+    Frame frames[PGRAPH_MAX_FRAMES_IN_FLIGHT];
+    Size frameIndex;
+
+    // Resources of the frame being recorded
     gfx::CommandBuffer* cmdBuffer;
-    gfx::Fence* fence;
     gfx::Heap* heapResources;
-    gfx::Heap* heapSamplers;
     gfx::VertexBuffer* vtxTransform;
     gfx::VertexBuffer* vpeConstantMemory;
-    gfx::VertexBuffer* vpeInputs[16];
 
     // Cache
     std::unordered_map<Hash, std::unique_ptr<gfx::Pipeline>> cachePipeline;
     std::unordered_map<Hash, std::unique_ptr<RSXVertexProgram>> cacheVP;
     std::unordered_map<Hash, std::unique_ptr<RSXFragmentProgram>> cacheFP;
     TextureCache cacheTexture;
+    VertexCache cacheVertex;
+
+    // Persistent pipeline cache, and programs and pipelines built from it in the background
+    std::unique_ptr<PipelineCache> cachePersistent;
+    std::thread warmupThread;
+    std::unordered_map<Hash, std::unique_ptr<gfx::Pipeline>> warmupPipeline;
+    std::unordered_map<Hash, std::unique_ptr<RSXVertexProgram>> warmupVP;
+    std::unordered_map<Hash, std::unique_ptr<RSXFragmentProgram>> warmupFP;
+
+    // Pipelines being built by the compilation workers
+    std::unique_ptr<core::WorkerPool> compilePool;
+    std::unordered_map<Hash, std::shared_ptr<PipelineJob>> pendingPipeline;
+
+    // Most recently used pipeline for each vertex layout, used while the actual one is being built
+    std::unordered_map<Hash, gfx::Pipeline*> fallbackPipeline;
+    PipelineStats pipelineStats;
+
+    // Flag: Draws until the next Begin are skipped since no pipeline is available
+    bool skipDraws;
 
     // Surface
     std::unordered_map<U32, gfx::Texture*> textures;
@@ -177,11 +236,51 @@ class PGRAPH {
     gfx::ColorTarget* getColorTarget(U32 address);
     gfx::DepthStencilTarget* getDepthStencilTarget(U32 address);
 
-    U64 HashVertexProgram(rsx_vp_instruction_t* program);
-    U64 HashFragmentProgram(rsx_fp_instruction_t* program);
+    // Get the guest address of data at the specified location
+    U32 getAddress(U32 location, U32 offset);
+
+    U64 HashVertexProgram(const rsx_vp_instruction_t* program);
+    U64 HashFragmentProgram(const rsx_fp_instruction_t* program);
+
+    /**
+     * Create a host pipeline from the guest state it was recorded with
+     * @param[in]  record  Guest state of the pipeline
+     * @param[in]  vs      Compiled vertex program
+     * @param[in]  ps      Compiled fragment program
+     * @return             Host pipeline
+     */
+    gfx::Pipeline* createPipeline(const PipelineRecord& record, gfx::Shader* vs, gfx::Shader* ps);
+
+    /**
+     * Start building a pipeline, on a compilation worker if available
+     * @param[in]  pipelineHash  Hash of the pipeline
+     * @param[in]  job           Pipeline to build, along with the state it is built from
+     */
+    void requestPipeline(Hash pipelineHash, std::shared_ptr<PipelineJob> job);
+
+    // Build the missing programs and the pipeline of a job, runs in the compilation workers
+    void buildPipeline(PipelineJob& job);
+
+    // Move a built pipeline and its programs into the caches
+    void finishPipeline(Hash pipelineHash);
+
+    // Move every pipeline built so far into the caches
+    void collectPipelines();
+
+    // Build the programs and pipelines of the persistent cache, runs in the warm-up thread
+    void warmupPipelines();
+
+    // Wait for the warm-up thread and move its results into the caches
+    void finishWarmup();
 
     void setSurface();
 
+    /**
+     * Submit the commands of the current frame without waiting for them,
+     * and start recording into the next one once the host GPU is done with it
+     */
+    void submitFrame();
+
 public:
     Pipeline pipeline;
 
@@ -192,6 +291,14 @@ public:
     U32 semaphore_index;
     U32 vertex_data_base_offset;
     U32 vertex_data_base_index;
+    U32 index_array_offset;
+    U32 index_array_location;
+    U32 index_array_type;
+    bool restart_index_enable;
+    U32 restart_index;
+
+    // Words sent through NV4097_INLINE_ARRAY since the last draw
+    std::vector<U32> inline_array;
 
     Surface surface;
     rsx_viewport_t viewport;
@@ -229,6 +336,13 @@ public:
     PGRAPH(std::shared_ptr<gfx::GraphicsBackend> graphics, RSX* rsx, mem::GuestVirtualMemory* memory);
     ~PGRAPH();
 
+    /**
+     * Load the pipelines used by a title in previous runs and start building them in the background
+     * @param[in]  directory  Directory where the cache file is stored
+     * @param[in]  title      Path to the executable identifying the title
+     */
+    void loadPipelineCache(const std::string& directory, const std::string& title);
+
     // Auxiliary methods
     gfx::Texture* getTexture(U32 address);
     void LoadVertexAttributes(U32 first, U32 count);
@@ -239,8 +353,21 @@ public:
     void End();
     void ClearSurface(U32 mask);
     void DrawArrays(U32 first, U32 count);
+    void DrawIndexArray(U32 first, U32 count);
+    void DrawInlineArray();
     void Enable(U32 prop, U32 enabled);
     void Flip();
+
+    // Get statistics about pipelines that were not ready when needed
+    const PipelineStats& getPipelineStats() const {
+        return pipelineStats;
+    }
+
+    /**
+     * Submit any pending commands and wait for the host GPU to execute all of them.
+     * Required whenever the guest can observe the results of previous commands.
+     */
+    void Sync();
 };
 
 }  // namespace rsx
@@ -0,0 +1,128 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#include "rsx_pipeline_cache.h"
+#include "nucleus/version.h"
+#include "nucleus/core/config.h"
+#include "nucleus/logger/logger.h"
+#include "nucleus/filesystem/filesystem_host.h"
+
+namespace gpu {
+namespace rsx {
+
+// Cache file format
+enum : U32 {
+    CACHE_MAGIC    = 0x43505352,  // "RSPC"
+    CACHE_VERSION  = 2,
+    CACHE_BUILD    = (NUCLEUS_VERSION_MAJOR << 16) | (NUCLEUS_VERSION_MINOR << 8) | NUCLEUS_VERSION_BUILD,
+    CACHE_STATE    = sizeof(Pipeline) + sizeof(PipelineLayout),
+};
+
+struct CacheHeader {
+    U32 magic;
+    U32 version;
+    U32 backend;      // Graphics backend generating the host programs and pipelines
+    U32 build;        // Emulator version, since the decompilers might change between versions
+    U32 stateSize;    // Size of the guest state in each record
+    U32 padding;
+};
+
+struct CacheRecord {
+    U64 hash;
+    U32 vpCount;
+    U32 fpCount;
+};
+
+PipelineCache::PipelineCache(const std::string& directory, const std::string& name) {
+    if (!fs::HostFileSystem::createDirectory(directory)) {
+        logger.warning(LOG_GPU, "Could not create cache directory: %s", directory.c_str());
+    }
+    path = directory + "/" + name + ".cache";
+    writable = load();
+}
+
+bool PipelineCache::load() {
+    CacheHeader header;
+    if (fs::HostFileSystem::existsFile(path)) {
+        auto file = fs::HostFileSystem::openFile(path, fs::Read);
+        if (!file) {
+            logger.warning(LOG_GPU, "Could not open pipeline cache: %s", path.c_str());
+            return false;
+        }
+
+        // Validate header
+        const auto fileSize = file->attributes().size;
+        if (file->read(&header, sizeof(header)) == sizeof(header) &&
+            header.magic == CACHE_MAGIC &&
+            header.version == CACHE_VERSION &&
+            header.backend == U32(config.graphicsBackend) &&
+            header.build == CACHE_BUILD &&
+            header.stateSize == CACHE_STATE) {
+            // Read records until the end of the file or the first truncated record
+            CacheRecord record;
+            while (Size(file->tell()) + sizeof(record) <= fileSize) {
+                if (file->read(&record, sizeof(record)) != sizeof(record)) {
+                    break;
+                }
+                const Size vpSize = record.vpCount * sizeof(rsx_vp_instruction_t);
+                const Size fpSize = record.fpCount * sizeof(rsx_fp_instruction_t);
+                if (Size(file->tell()) + CACHE_STATE + vpSize + fpSize > fileSize) {
+                    logger.warning(LOG_GPU, "Pipeline cache is truncated: %s", path.c_str());
+                    break;
+                }
+                PipelineRecord entry;
+                entry.vp.resize(record.vpCount);
+                entry.fp.resize(record.fpCount);
+                file->read(&entry.state, sizeof(entry.state));
+                file->read(&entry.layout, sizeof(entry.layout));
+                file->read(entry.vp.data(), vpSize);
+                file->read(entry.fp.data(), fpSize);
+                if (stored.insert(record.hash).second) {
+                    records.push_back(std::move(entry));
+                }
+            }
+            logger.notice(LOG_GPU, "Loaded %d entries from pipeline cache: %s", U32(records.size()), path.c_str());
+            return true;
+        }
+        logger.notice(LOG_GPU, "Discarding outdated pipeline cache: %s", path.c_str());
+    }
+
+    // Create a new cache file
+    auto file = fs::HostFileSystem::openFile(path, fs::Write);
+    if (!file) {
+        logger.warning(LOG_GPU, "Could not create pipeline cache: %s", path.c_str());
+        return false;
+    }
+    header.magic = CACHE_MAGIC;
+    header.version = CACHE_VERSION;
+    header.backend = U32(config.graphicsBackend);
+    header.build = CACHE_BUILD;
+    header.stateSize = CACHE_STATE;
+    header.padding = 0;
+    return file->write(&header, sizeof(header)) == sizeof(header);
+}
+
+void PipelineCache::store(Hash hash, const PipelineRecord& entry) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!writable || !stored.insert(hash).second) {
+        return;
+    }
+    auto file = fs::HostFileSystem::openFile(path, fs::WriteAppend);
+    if (!file) {
+        return;
+    }
+    CacheRecord record;
+    record.hash = hash;
+    record.vpCount = U32(entry.vp.size());
+    record.fpCount = U32(entry.fp.size());
+    file->write(&record, sizeof(record));
+    file->write(&entry.state, sizeof(entry.state));
+    file->write(&entry.layout, sizeof(entry.layout));
+    file->write(entry.vp.data(), entry.vp.size() * sizeof(rsx_vp_instruction_t));
+    file->write(entry.fp.data(), entry.fp.size() * sizeof(rsx_fp_instruction_t));
+}
+
+}  // namespace rsx
+}  // namespace gpu
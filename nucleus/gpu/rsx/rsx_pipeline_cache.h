@@ -0,0 +1,99 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/common.h"
+#include "nucleus/gpu/gpu_hash.h"
+#include "nucleus/gpu/rsx/rsx_pgraph.h"
+
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace gpu {
+namespace rsx {
+
+// Vertex input as seen by the input assembler
+struct PipelineInput {
+    U08 type;     // Type of vertex components
+    U08 size;     // Count of vertex components, or 0 if the input is disabled
+    U08 stride;   // Offset between two consecutive vertices
+    U08 padding;
+};
+
+/**
+ * Pipeline Layout
+ * ===============
+ * PGRAPH state outside of the Pipeline registers that is baked into a host pipeline.
+ */
+struct alignas(sizeof(Hash)) PipelineLayout {
+    U32 primitive;
+    U32 depthFormat;
+    U32 restart;      // Primitive restart is enabled for indexed draws
+    U32 indexFormat;  // Type of the indices, determines the host restart index
+    PipelineInput inputs[16];
+};
+
+/**
+ * Pipeline Record
+ * ===============
+ * Guest state a host pipeline is built from: the PGRAPH pipeline registers, the state
+ * that affects the input assembler and output merger, and the microcode of both programs.
+ */
+struct PipelineRecord {
+    Pipeline state;
+    PipelineLayout layout;
+    std::vector<rsx_vp_instruction_t> vp;
+    std::vector<rsx_fp_instruction_t> fp;
+};
+
+/**
+ * Pipeline Cache
+ * ==============
+ * Persistent on-disk list of the pipelines used by a title. Since the programs and
+ * pipelines generated from a record depend on the graphics backend and on the emulator
+ * build, the file is discarded whenever either of them changes.
+ */
+class PipelineCache {
+    std::mutex mutex;
+
+    // Path to the cache file and whether it can be appended to
+    std::string path;
+    bool writable = false;
+
+    // Records loaded from the cache file
+    std::vector<PipelineRecord> records;
+
+    // Hashes of the pipelines already stored
+    std::unordered_set<Hash> stored;
+
+    // Parse the cache file, discarding it if it was created by a different build or backend
+    bool load();
+
+public:
+    /**
+     * Open or create a pipeline cache file
+     * @param[in]  directory  Directory where the cache file is stored
+     * @param[in]  name       Name identifying the title
+     */
+    PipelineCache(const std::string& directory, const std::string& name);
+
+    /**
+     * Store a pipeline in the cache, unless it was already stored
+     * @param[in]  hash   Hash of the pipeline, as computed by PGRAPH
+     * @param[in]  entry  Guest state of the pipeline
+     */
+    void store(Hash hash, const PipelineRecord& entry);
+
+    // Get the records loaded from the cache file
+    const std::vector<PipelineRecord>& getRecords() const {
+        return records;
+    }
+};
+
+}  // namespace rsx
+}  // namespace gpu
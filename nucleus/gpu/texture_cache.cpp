@@ -4,12 +4,38 @@
  */
 
 #include "texture_cache.h"
-#include "nucleus/graphics/texture.h"
+#include "nucleus/graphics/graphics.h"
+#include "nucleus/memory/guest_virtual/guest_virtual_memory.h"
 
 namespace gpu {
 
-gfx::Texture* TextureCache::get(const Byte* addr, Size size) {
-    return nullptr;
+gfx::Texture* TextureCache::get(gfx::GraphicsBackend* graphics, mem::GuestVirtualMemory* memory, U32 addr, const gfx::TextureDesc& desc) {
+    TextureKey key = {};
+    key.address = addr;
+    key.size = U32(desc.size);
+    key.width = desc.width;
+    key.height = desc.height;
+    key.mipmapLevels = desc.mipmapLevels;
+    key.format = desc.format;
+    key.swizzle = desc.swizzle;
+
+    // Reuse the cached texture unless its pages were written and its contents changed
+    Entry* entry = find(key);
+    if (entry) {
+        if (!isModified(memory, *entry)) {
+            return entry->resource.get();
+        }
+    } else {
+        entry = &insert(key);
+        track(memory, *entry, addr, key.size);
+    }
+    replace(*entry, graphics->createTexture(desc), key.size);
+    return entry->resource.get();
+}
+
+void TextureCache::trim() {
+    evictLeastRecentlyUsed();
+    retired.clear();
 }
 
 }  // namespace gpu
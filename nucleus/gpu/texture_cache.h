@@ -6,13 +6,11 @@
 #pragma once
 
 #include "nucleus/common.h"
-#include "nucleus/gpu/gpu_hash.h"
-
-#include <deque>
-#include <unordered_map>
+#include "nucleus/gpu/resource_cache.h"
+#include "nucleus/graphics/texture.h"
 
 // Forward declarations
-namespace gfx { class Texture; }
+namespace gfx { class GraphicsBackend; }
 
 namespace gpu {
 
@@ -21,35 +19,40 @@ namespace gpu {
  * =============
  * Utility for the emulated guest GPU to upload and cache textures.
  *
- * Implementation:
- * - Textures are hashed and stored into a map, additionally the hash is
- *   inserted into a ring buffer which resizes to accomodate all hashes
- *   such that their collective texture size remains under the limit
- *   specified by the user.
- * - When a hash is removed from the ring buffer, the corresponding
- *   texture cache entry is deleted and thus freed from the host GPU memory.
+ * Textures are indexed by guest address, format, dimensions and mipmap levels, and
+ * validated against writes to their pages as described in ResourceCache. Textures
+ * evicted or replaced are released on TextureCache::trim, once the host GPU is done with them.
  */
-class TextureCache {
-    // Ring buffer of hashes
-    std::deque<Hash> hash;
-
-    // Holds each cached texture
-    std::unordered_map<Hash, gfx::Texture*> textureCache;
-
-    Size curSize;
-    Size maxSize;
+struct TextureKey {
+    U32 address;
+    U32 size;
+    U32 width;
+    U32 height;
+    U32 mipmapLevels;
+    U32 format;
+    U32 swizzle;
+    U32 padding;
+};
 
+class TextureCache : public ResourceCache<TextureKey, gfx::Texture> {
 public:
-    TextureCache(Size maxSize) :
-        curSize(0), maxSize(maxSize) {}
+    TextureCache(Size maxSize) : ResourceCache(maxSize) {}
+
+    /**
+     * Find the specified texture in the cache, uploading it if missing or modified
+     * @param[in]  graphics  Graphics backend creating the host textures
+     * @param[in]  memory    Guest memory holding the texture
+     * @param[in]  addr      Guest address of the texture
+     * @param[in]  desc      Texture description, with `data` and `size` covering the guest data
+     * @return               Pointer to the GPU texture object
+     */
+    gfx::Texture* get(gfx::GraphicsBackend* graphics, mem::GuestVirtualMemory* memory, U32 addr, const gfx::TextureDesc& desc);
 
     /**
-     * Tries to find the specified texture in the cache
-     * @param[in]  addr  Texture address
-     * @param[in]  size  Texture size
-     * @return           Pointer to the GPU texture object if found, otherwise nullptr.
+     * Evict textures until the size limit is satisfied, releasing the retired ones.
+     * Must be called when the host GPU is not using any texture returned by the cache.
      */
-    gfx::Texture* get(const Byte* addr, Size size);
+    void trim();
 };
 
 }  // namespace gpu
@@ -0,0 +1,328 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#include "vertex_cache.h"
+#include "nucleus/assert.h"
+#include "nucleus/core/host.h"
+#include "nucleus/graphics/graphics.h"
+#include "nucleus/memory/guest_virtual/guest_virtual_memory.h"
+
+#include <algorithm>
+
+#ifdef NUCLEUS_ARCH_X86
+#ifdef NUCLEUS_COMPILER_MSVC
+#include <intrin.h>
+#define TARGET_SSSE3
+#define TARGET_SSE41
+#else
+#include <x86intrin.h>
+#define TARGET_SSSE3 __attribute__((target("ssse3")))
+#define TARGET_SSE41 __attribute__((target("sse4.1")))
+#endif
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+namespace gpu {
+
+void VertexStream::init(U32 address, U32 stride, U32 count) {
+    this->address = address;
+    this->stride = stride;
+    this->span = 0;
+    this->count = count;
+    for (Size i = 0; i < VERTEX_MAX_STRIDE; i++) {
+        permutation[i] = U08(i);
+    }
+}
+
+void VertexStream::addElement(U32 offset, U32 components, U32 typeSize) {
+    assert_true(offset + components * typeSize <= VERTEX_MAX_STRIDE);
+    for (U32 c = 0; c < components; c++) {
+        const U32 base = offset + c * typeSize;
+        for (U32 j = 0; j < typeSize; j++) {
+            permutation[base + j] = U08(base + typeSize - 1 - j);
+        }
+    }
+    span = std::max(span, offset + components * typeSize);
+}
+
+// Convert the bytes [begin, end) of a stream one at a time
+static void convertVertexStreamScalar(Byte* dst, const Byte* src, const VertexStream& stream, U32 begin, U32 end) {
+    if (!stream.stride) {
+        for (U32 i = begin; i < end; i++) {
+            dst[i] = src[stream.permutation[i]];
+        }
+        return;
+    }
+    U32 vertex = begin / stream.stride;
+    U32 index = begin % stream.stride;
+    for (U32 i = begin; i < end; i++) {
+        dst[i] = src[vertex * stream.stride + stream.permutation[index]];
+        if (++index == stream.stride) {
+            index = 0;
+            vertex += 1;
+        }
+    }
+}
+
+#ifdef NUCLEUS_ARCH_X86
+/**
+ * Build the PSHUFB masks of each 16-byte chunk of the stream. The masks repeat every
+ * lcm(stride, 16) bytes, and exist only if no element crosses the boundary of a chunk.
+ * @param[out]  masks   Masks for each chunk in a period of the stream
+ * @param[in]   stream  Stream describing the conversion
+ * @return              True if the masks could be built
+ */
+static bool buildShuffleMasks(std::vector<std::array<U08, 16>>& masks, const VertexStream& stream) {
+    U32 period = stream.stride;
+    while (period % 16) {
+        period += stream.stride;
+    }
+    masks.resize(period / 16);
+    for (U32 chunk = 0; chunk < period / 16; chunk++) {
+        for (U32 k = 0; k < 16; k++) {
+            const U32 pos = chunk * 16 + k;
+            const U32 src = (pos / stream.stride) * stream.stride + stream.permutation[pos % stream.stride];
+            if (src < chunk * 16 || src >= chunk * 16 + 16) {
+                return false;
+            }
+            masks[chunk][k] = U08(src - chunk * 16);
+        }
+    }
+    return true;
+}
+
+TARGET_SSSE3
+static void convertVertexStreamSSSE3(Byte* dst, const Byte* src, U32 size, const std::vector<std::array<U08, 16>>& masks) {
+    const Size count = masks.size();
+    Size chunk = 0;
+    U32 offset = 0;
+    for (; offset + 16 <= size; offset += 16) {
+        const __m128i mask = _mm_loadu_si128(reinterpret_cast<const __m128i*>(masks[chunk].data()));
+        const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + offset));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + offset), _mm_shuffle_epi8(data, mask));
+        if (++chunk == count) {
+            chunk = 0;
+        }
+    }
+}
+#endif
+
+void convertVertexStream(Byte* dst, const Byte* src, const VertexStream& stream) {
+    const U32 size = stream.getSize();
+    bool identity = true;
+    for (U32 i = 0; i < stream.span; i++) {
+        identity &= (stream.permutation[i] == i);
+    }
+    if (identity) {
+        std::memcpy(dst, src, size);
+        return;
+    }
+
+    U32 offset = 0;
+#ifdef NUCLEUS_ARCH_X86
+    std::vector<std::array<U08, 16>> masks;
+    if (stream.stride && size >= 16 && core::hasHostFeature(core::HOST_FEATURE_SSSE3) && buildShuffleMasks(masks, stream)) {
+        offset = size & ~15;
+        convertVertexStreamSSSE3(dst, src, offset, masks);
+    }
+#endif
+    convertVertexStreamScalar(dst, src, stream, offset, size);
+}
+
+#ifdef NUCLEUS_ARCH_X86
+TARGET_SSE41
+static void scanIndexRangeSSE41(const Byte* src, U32 count, U32 indexSize, const IndexRestart& restart, U32& minIndex, U32& maxIndex) {
+    // Restart indices are replaced by the identity of each reduction before comparing them
+    const __m128i enable = restart.enable ? _mm_set1_epi32(-1) : _mm_setzero_si128();
+    if (indexSize == 2) {
+        const __m128i swap = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+        const __m128i vrestart = _mm_set1_epi16(S16(restart.index));
+        __m128i vmin = _mm_set1_epi16(-1);
+        __m128i vmax = _mm_setzero_si128();
+        for (U32 i = 0; i < count; i += 8) {
+            const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i));
+            const __m128i value = _mm_shuffle_epi8(data, swap);
+            const __m128i skip = _mm_and_si128(_mm_cmpeq_epi16(value, vrestart), enable);
+            vmin = _mm_min_epu16(vmin, _mm_or_si128(value, skip));
+            vmax = _mm_max_epu16(vmax, _mm_andnot_si128(skip, value));
+        }
+        minIndex = std::min<U32>(minIndex, U16(_mm_cvtsi128_si32(_mm_minpos_epu16(vmin))));
+        maxIndex = std::max<U32>(maxIndex, U16(~_mm_cvtsi128_si32(_mm_minpos_epu16(_mm_xor_si128(vmax, _mm_set1_epi16(-1))))));
+    } else {
+        const __m128i swap = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+        const __m128i vrestart = _mm_set1_epi32(S32(restart.index));
+        __m128i vmin = _mm_set1_epi32(-1);
+        __m128i vmax = _mm_setzero_si128();
+        for (U32 i = 0; i < count; i += 4) {
+            const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * i));
+            const __m128i value = _mm_shuffle_epi8(data, swap);
+            const __m128i skip = _mm_and_si128(_mm_cmpeq_epi32(value, vrestart), enable);
+            vmin = _mm_min_epu32(vmin, _mm_or_si128(value, skip));
+            vmax = _mm_max_epu32(vmax, _mm_andnot_si128(skip, value));
+        }
+        alignas(16) U32 lanesMin[4];
+        alignas(16) U32 lanesMax[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanesMin), vmin);
+        _mm_store_si128(reinterpret_cast<__m128i*>(lanesMax), vmax);
+        for (int i = 0; i < 4; i++) {
+            minIndex = std::min(minIndex, lanesMin[i]);
+            maxIndex = std::max(maxIndex, lanesMax[i]);
+        }
+    }
+}
+#endif
+
+void scanIndexRange(const Byte* src, U32 count, U32 indexSize, const IndexRestart& restart, U32& minIndex, U32& maxIndex) {
+    minIndex = ~0U;
+    maxIndex = 0;
+
+    // Indices processed in blocks of 16 bytes
+    U32 offset = 0;
+#ifdef NUCLEUS_ARCH_X86
+    if (core::hasHostFeature(core::HOST_FEATURE_SSE41)) {
+        offset = count & ~(16 / indexSize - 1);
+        if (offset) {
+            scanIndexRangeSSE41(src, offset, indexSize, restart, minIndex, maxIndex);
+        }
+    }
+#endif
+    for (U32 i = offset; i < count; i++) {
+        const U32 value = (indexSize == 2)
+            ? SE16(*reinterpret_cast<const U16*>(src + 2 * i))
+            : SE32(*reinterpret_cast<const U32*>(src + 4 * i));
+        if (restart.enable && value == restart.index) {
+            continue;
+        }
+        minIndex = std::min(minIndex, value);
+        maxIndex = std::max(maxIndex, value);
+    }
+
+    // No indices other than restart ones
+    if (minIndex > maxIndex) {
+        minIndex = maxIndex = 0;
+    }
+}
+
+gfx::VertexBuffer* VertexCache::allocate(gfx::GraphicsBackend* graphics, U32 capacity) {
+    auto it = available.find(capacity);
+    if (it != available.end()) {
+        auto* buffer = it->second.release();
+        available.erase(it);
+        return buffer;
+    }
+    gfx::VertexBufferDesc desc = {};
+    desc.size = capacity;
+    return graphics->createVertexBuffer(desc);
+}
+
+// Round capacities up to a power of two, so that growing streams can recycle buffers
+static U32 getCapacity(U32 size) {
+    U32 capacity = 256;
+    while (capacity < size) {
+        capacity <<= 1;
+    }
+    return capacity;
+}
+
+// Host backends only restart primitives at indices with all bits set
+static void replaceRestartIndex(Byte* dst, U32 count, U32 indexSize, U32 index) {
+    if (indexSize == 2) {
+        auto* indices = reinterpret_cast<U16*>(dst);
+        std::replace(indices, indices + count, U16(index), U16(0xFFFF));
+    } else {
+        auto* indices = reinterpret_cast<U32*>(dst);
+        std::replace(indices, indices + count, index, U32(0xFFFFFFFF));
+    }
+}
+
+VertexCache::Entry& VertexCache::update(gfx::GraphicsBackend* graphics, mem::GuestVirtualMemory* memory, const VertexStream& stream, const IndexRestart* restart) {
+    // Streams covering a different number of vertices share the same entry
+    VertexStream key = stream;
+    key.count = 0;
+
+    const U32 addr = stream.address;
+    const U32 size = stream.getSize();
+
+    // Reuse the cached stream unless its pages were written and its contents changed,
+    // or the indices were uploaded with different restart settings
+    Entry* entry = find(key);
+    if (entry && size == entry->size) {
+        if (!isModified(memory, *entry) && (!restart || entry->restart == *restart)) {
+            return *entry;
+        }
+    } else {
+        if (!entry) {
+            entry = &insert(key);
+        }
+        track(memory, *entry, addr, size);
+    }
+
+    const U32 capacity = getCapacity(size);
+    replace(*entry, allocate(graphics, capacity), capacity);
+    entry->minIndex = 0;
+    entry->maxIndex = 0;
+
+    const auto* src = memory->ptr<Byte>(addr);
+    auto* mapped = static_cast<Byte*>(entry->resource->map());
+    convertVertexStream(mapped, src, stream);
+    if (restart) {
+        const U32 restartMask = (stream.stride == 2) ? 0xFFFF : 0xFFFFFFFF;
+        scanIndexRange(src, stream.count, stream.stride, *restart, entry->minIndex, entry->maxIndex);
+        if (restart->enable && restart->index != restartMask) {
+            replaceRestartIndex(mapped, stream.count, stream.stride, restart->index);
+        }
+        entry->restart = *restart;
+    }
+    entry->resource->unmap();
+    return *entry;
+}
+
+gfx::VertexBuffer* VertexCache::get(gfx::GraphicsBackend* graphics, mem::GuestVirtualMemory* memory, const VertexStream& stream) {
+    return update(graphics, memory, stream, nullptr).resource.get();
+}
+
+gfx::VertexBuffer* VertexCache::getIndices(gfx::GraphicsBackend* graphics, mem::GuestVirtualMemory* memory, const VertexStream& stream, const IndexRestart& restart, U32& minIndex, U32& maxIndex) {
+    const Entry& entry = update(graphics, memory, stream, &restart);
+    minIndex = entry.minIndex;
+    maxIndex = entry.maxIndex;
+    return entry.resource.get();
+}
+
+gfx::VertexBuffer* VertexCache::upload(gfx::GraphicsBackend* graphics, const Byte* data, const VertexStream& stream) {
+    const U32 capacity = getCapacity(stream.getSize());
+    auto* buffer = allocate(graphics, capacity);
+    auto* mapped = static_cast<Byte*>(buffer->map());
+    convertVertexStream(mapped, data, stream);
+    buffer->unmap();
+    uploads += 1;
+
+    // Released as soon as the host GPU is done with it
+    retired.emplace_back(capacity, std::unique_ptr<gfx::VertexBuffer>(buffer));
+    return buffer;
+}
+
+void VertexCache::trim() {
+    evictLeastRecentlyUsed();
+    for (auto& buffer : retired) {
+        available.emplace(buffer.first, std::move(buffer.second));
+    }
+    retired.clear();
+
+    // Keep recycled buffers within the size limit as well
+    Size availableSize = 0;
+    for (auto it = available.begin(); it != available.end();) {
+        availableSize += it->first;
+        if (availableSize > maxSize) {
+            it = available.erase(it);
+        } else {
+            it++;
+        }
+    }
+}
+
+}  // namespace gpu
@@ -0,0 +1,169 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/common.h"
+#include "nucleus/gpu/resource_cache.h"
+#include "nucleus/graphics/vertex_buffer.h"
+
+#include <map>
+#include <memory>
+
+// Forward declarations
+namespace gfx { class GraphicsBackend; }
+
+namespace gpu {
+
+// Maximum number of bytes between two consecutive vertices of a stream
+constexpr Size VERTEX_MAX_STRIDE = 256;
+
+/**
+ * Vertex Stream
+ * =============
+ * Interleaved vertex data read by one or more vertex attributes. Since the host buffer
+ * keeps the layout of the guest data, converting it only requires reordering the bytes
+ * of each vertex: byte `i` of every host vertex is taken from byte `permutation[i]` of
+ * the corresponding guest vertex.
+ */
+struct alignas(sizeof(Hash)) VertexStream {
+    U32 address;  // Guest address of the first vertex
+    U32 stride;   // Bytes between consecutive vertices, or 0 if all vertices are the same
+    U32 span;     // Bytes of each vertex read by the attributes
+    U32 count;    // Number of vertices
+    U08 permutation[VERTEX_MAX_STRIDE];
+
+    /**
+     * Initialize an empty stream
+     * @param[in]  address  Guest address of the first vertex
+     * @param[in]  stride   Bytes between consecutive vertices
+     * @param[in]  count    Number of vertices
+     */
+    void init(U32 address, U32 stride, U32 count);
+
+    /**
+     * Add an element that has to be converted to the host byte order
+     * @param[in]  offset      Offset of the element inside each vertex
+     * @param[in]  components  Number of components
+     * @param[in]  typeSize    Bytes per component, each of them is byteswapped
+     */
+    void addElement(U32 offset, U32 components, U32 typeSize);
+
+    // Get the size of the stream in bytes
+    U32 getSize() const {
+        return (stride && count) ? (count - 1) * stride + span : span;
+    }
+};
+
+/**
+ * Convert guest vertex data into the host layout described by a stream.
+ * Uses SSSE3 shuffles when available and no element crosses a 16-byte boundary.
+ * @param[out]  dst     Destination buffer of VertexStream::getSize bytes
+ * @param[in]   src     Guest vertex data
+ * @param[in]   stream  Stream describing the conversion
+ */
+void convertVertexStream(Byte* dst, const Byte* src, const VertexStream& stream);
+
+// Primitive restart settings of an index stream
+struct IndexRestart {
+    bool enable;  // Whether the restart index splits primitives instead of addressing a vertex
+    U32 index;    // Restart index, already masked to the index size
+
+    bool operator==(const IndexRestart& other) const {
+        return enable == other.enable && index == other.index;
+    }
+};
+
+/**
+ * Find the smallest and largest values of an array of big-endian indices, ignoring
+ * the restart index if enabled. Uses SSE4.1 when available.
+ * @param[in]   src        Guest index data
+ * @param[in]   count      Number of indices
+ * @param[in]   indexSize  Bytes per index, either 2 or 4
+ * @param[in]   restart    Primitive restart settings
+ * @param[out]  minIndex   Smallest index, or 0 if there are none
+ * @param[out]  maxIndex   Largest index, or 0 if there are none
+ */
+void scanIndexRange(const Byte* src, U32 count, U32 indexSize, const IndexRestart& restart, U32& minIndex, U32& maxIndex);
+
+/**
+ * Vertex Cache
+ * ============
+ * Utility for the emulated guest GPU to upload and cache vertex streams.
+ *
+ * Implementation:
+ * - Streams are indexed by guest address, stride and layout. Entries covering fewer
+ *   vertices than requested are replaced with a larger buffer.
+ * - Static vertex data is detected as described in ResourceCache.
+ * - Buffers are never rewritten while the host GPU could be reading them. Replaced
+ *   buffers are retired and recycled on VertexCache::trim, bucketed by power-of-two size.
+ */
+struct VertexCacheEntry : ResourceCacheEntry<VertexStream, gfx::VertexBuffer> {
+    U32 minIndex;                  // Smallest index, if the stream holds indices
+    U32 maxIndex;                  // Largest index, if the stream holds indices
+    IndexRestart restart;          // Primitive restart settings the indices were uploaded with
+};
+
+class VertexCache : public ResourceCache<VertexStream, gfx::VertexBuffer, VertexCacheEntry> {
+    // Unused buffers indexed by their capacity
+    std::multimap<U32, std::unique_ptr<gfx::VertexBuffer>> available;
+
+    // Get a buffer of the specified capacity, recycling an available one if possible
+    gfx::VertexBuffer* allocate(gfx::GraphicsBackend* graphics, U32 capacity);
+
+    /**
+     * Find or create the entry of a stream, uploading it if missing or modified
+     * @param[in]  graphics  Graphics backend creating the host buffers
+     * @param[in]  memory    Guest memory holding the stream
+     * @param[in]  stream    Stream to upload
+     * @param[in]  restart   Primitive restart settings if the stream holds indices, or nullptr
+     * @return               Entry holding the stream
+     */
+    Entry& update(gfx::GraphicsBackend* graphics, mem::GuestVirtualMemory* memory, const VertexStream& stream, const IndexRestart* restart);
+
+public:
+    VertexCache(Size maxSize) : ResourceCache(maxSize) {}
+
+    /**
+     * Find the specified stream in the cache, uploading it if missing or modified
+     * @param[in]  graphics  Graphics backend creating the host buffers
+     * @param[in]  memory    Guest memory holding the vertex data
+     * @param[in]  stream    Stream to upload
+     * @return               Pointer to the GPU vertex buffer
+     */
+    gfx::VertexBuffer* get(gfx::GraphicsBackend* graphics, mem::GuestVirtualMemory* memory, const VertexStream& stream);
+
+    /**
+     * Find the specified index stream in the cache, uploading it if missing or modified.
+     * The range of the indices is only scanned when uploading them, which also happens when the
+     * restart settings change. Restart indices are rewritten to all bits set in the host buffer,
+     * so a genuine index with all bits set is treated as a restart as well while restart is enabled.
+     * @param[in]   graphics  Graphics backend creating the host buffers
+     * @param[in]   memory    Guest memory holding the indices
+     * @param[in]   stream    Stream with a single element of 2 or 4 bytes
+     * @param[in]   restart   Primitive restart settings
+     * @param[out]  minIndex  Smallest index
+     * @param[out]  maxIndex  Largest index
+     * @return                Pointer to the GPU index buffer
+     */
+    gfx::VertexBuffer* getIndices(gfx::GraphicsBackend* graphics, mem::GuestVirtualMemory* memory, const VertexStream& stream, const IndexRestart& restart, U32& minIndex, U32& maxIndex);
+
+    /**
+     * Upload vertex data that does not reside in guest memory, without caching it
+     * @param[in]  graphics  Graphics backend creating the host buffers
+     * @param[in]  data      Vertex data in guest byte order
+     * @param[in]  stream    Stream describing the data, its address is ignored
+     * @return               Pointer to the GPU vertex buffer, valid until VertexCache::trim
+     */
+    gfx::VertexBuffer* upload(gfx::GraphicsBackend* graphics, const Byte* data, const VertexStream& stream);
+
+    /**
+     * Evict streams until the size limit is satisfied, recycling the retired buffers.
+     * Must be called when the host GPU is not using any buffer returned by the cache.
+     */
+    void trim();
+};
+
+}  // namespace gpu
@@ -46,12 +46,15 @@ void Direct3D11CommandBuffer::cmdClearDepthStencil(DepthStencilTarget* target, F
 void Direct3D11CommandBuffer::cmdDraw(U32 firstVertex, U32 vertexCount, U32 firstInstance, U32 instanceCount) {
 }
 
-void Direct3D11CommandBuffer::cmdDrawIndexed(U32 firstIndex, U32 indexCount, U32 vertexOffset, U32 firstInstance, U32 instanceCount) {
+void Direct3D11CommandBuffer::cmdDrawIndexed(U32 firstIndex, U32 indexCount, S32 vertexOffset, U32 firstInstance, U32 instanceCount) {
 }
 
 void Direct3D11CommandBuffer::cmdSetVertexBuffers(U32 index, U32 vtxBufferCount, VertexBuffer** vtxBuffer, U32* offsets, U32* strides) {
 }
 
+void Direct3D11CommandBuffer::cmdSetIndexBuffer(VertexBuffer* idxBuffer, U32 offset, IndexFormat format) {
+}
+
 void Direct3D11CommandBuffer::cmdSetTargets(U32 colorCount, ColorTarget** colorTargets, DepthStencilTarget* depthStencilTarget) {
     context->OMSetRenderTargets(colorCount, nullptr, nullptr); // TODO
 }
@@ -338,6 +338,13 @@ Pipeline* Direct3D12Backend::createPipeline(const PipelineDesc& desc) {
     d3dDesc.InputLayout.NumElements = d3dInputElements.size();
     d3dDesc.InputLayout.pInputElementDescs = d3dInputElements.data();
     d3dDesc.PrimitiveTopologyType = convertPrimitiveTopologyType(desc.iaState.topology);
+    if (desc.iaState.primitiveRestart) {
+        d3dDesc.IBStripCutValue = (desc.iaState.indexFormat == INDEX_FORMAT_UINT16)
+            ? D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_0xFFFF
+            : D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_0xFFFFFFFF;
+    } else {
+        d3dDesc.IBStripCutValue = D3D12_INDEX_BUFFER_STRIP_CUT_VALUE_DISABLED;
+    }
 
     // RS state
     d3dDesc.RasterizerState.FillMode = convertFillMode(desc.rsState.fillMode);
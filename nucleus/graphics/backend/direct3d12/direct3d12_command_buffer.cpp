@@ -81,7 +81,7 @@ void Direct3D12CommandBuffer::cmdDraw(U32 firstVertex, U32 vertexCount, U32 firs
     list->DrawInstanced(vertexCount, instanceCount, firstVertex, firstInstance);
 }
 
-void Direct3D12CommandBuffer::cmdDrawIndexed(U32 firstIndex, U32 indexCount, U32 vertexOffset, U32 firstInstance, U32 instanceCount) {
+void Direct3D12CommandBuffer::cmdDrawIndexed(U32 firstIndex, U32 indexCount, S32 vertexOffset, U32 firstInstance, U32 instanceCount) {
     list->DrawIndexedInstanced(indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
 }
 
@@ -106,15 +106,25 @@ void Direct3D12CommandBuffer::cmdSetVertexBuffers(U32 index, U32 vtxBufferCount,
     std::vector<D3D12_VERTEX_BUFFER_VIEW> vtxBufferView(vtxBufferCount);
     for (UINT i = 0; i < vtxBufferCount; i++) {
         auto* d3dVertexBuffer = static_cast<Direct3D12VertexBuffer*>(vtxBuffer[i]);
-        vtxBufferView[i].BufferLocation = d3dVertexBuffer->resource->GetGPUVirtualAddress();
+        const UINT offset = offsets ? offsets[i] : 0;
+        vtxBufferView[i].BufferLocation = d3dVertexBuffer->resource->GetGPUVirtualAddress() + offset;
         vtxBufferView[i].StrideInBytes = strides[i];
-        vtxBufferView[i].SizeInBytes = d3dVertexBuffer->resource->GetDesc().Width;
+        vtxBufferView[i].SizeInBytes = UINT(d3dVertexBuffer->resource->GetDesc().Width) - offset;
     }
     UINT startSlot = index;
     UINT numViews = vtxBufferCount;
     list->IASetVertexBuffers(startSlot, numViews, vtxBufferView.data());
 }
 
+void Direct3D12CommandBuffer::cmdSetIndexBuffer(VertexBuffer* idxBuffer, U32 offset, IndexFormat format) {
+    auto* d3dIndexBuffer = static_cast<Direct3D12VertexBuffer*>(idxBuffer);
+    D3D12_INDEX_BUFFER_VIEW idxBufferView;
+    idxBufferView.BufferLocation = d3dIndexBuffer->resource->GetGPUVirtualAddress() + offset;
+    idxBufferView.SizeInBytes = UINT(d3dIndexBuffer->resource->GetDesc().Width) - offset;
+    idxBufferView.Format = (format == INDEX_FORMAT_UINT16) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+    list->IASetIndexBuffer(&idxBufferView);
+}
+
 void Direct3D12CommandBuffer::cmdSetPrimitiveTopology(PrimitiveTopology topology) {
     D3D12_PRIMITIVE_TOPOLOGY d3dTopology;
     switch (topology) {
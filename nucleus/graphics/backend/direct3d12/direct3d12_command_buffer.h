@@ -32,10 +32,11 @@ public:
     virtual void cmdClearColor(ColorTarget* target, const F32* colorValue) override;
     virtual void cmdClearDepthStencil(DepthStencilTarget* target, F32 depthValue, U08 stencilValue) override;
     virtual void cmdDraw(U32 firstVertex, U32 vertexCount, U32 firstInstance, U32 instanceCount) override;
-    virtual void cmdDrawIndexed(U32 firstIndex, U32 indexCount, U32 vertexOffset, U32 firstInstance, U32 instanceCount) override;
+    virtual void cmdDrawIndexed(U32 firstIndex, U32 indexCount, S32 vertexOffset, U32 firstInstance, U32 instanceCount) override;
     virtual void cmdSetHeaps(const std::vector<Heap*>& heaps) override;
     virtual void cmdSetDescriptor(Size index, Heap* heap, Size offset) override;
     virtual void cmdSetVertexBuffers(U32 index, U32 vtxBufferCount, VertexBuffer** vtxBuffer, U32* offsets, U32* strides) override;
+    virtual void cmdSetIndexBuffer(VertexBuffer* idxBuffer, U32 offset, IndexFormat format) override;
     virtual void cmdSetPrimitiveTopology(PrimitiveTopology topology) override;
     virtual void cmdSetTargets(U32 colorCount, ColorTarget** colorTargets, DepthStencilTarget* depthStencilTarget) override;
     virtual void cmdSetViewports(U32 viewportsCount, const Viewport* viewports) override;
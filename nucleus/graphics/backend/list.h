@@ -6,6 +6,8 @@
 #pragma once
 
 // Backends
+#include "nucleus/graphics/backend/null/null_backend.h"
+#include "nucleus/graphics/backend/software/software_backend.h"
 #ifdef NUCLEUS_FEATURE_GFXBACKEND_DIRECT3D11
 #include "nucleus/graphics/backend/direct3d11/direct3d11_backend.h"
 #endif
@@ -22,6 +24,8 @@
 namespace gfx {
 
 // Shorthands
+using NullBackend = null::NullBackend;
+using SoftwareBackend = software::SoftwareBackend;
 #ifdef NUCLEUS_FEATURE_GFXBACKEND_DIRECT3D11
 using Direct3D11Backend = direct3d12::Direct3D11Backend;
 #endif
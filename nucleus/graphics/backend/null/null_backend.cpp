@@ -0,0 +1,223 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#include "null_backend.h"
+#include "nucleus/logger/logger.h"
+#include "nucleus/filesystem/filesystem_host.h"
+
+#include "nucleus/graphics/backend/null/null_command_buffer.h"
+#include "nucleus/graphics/backend/null/null_command_queue.h"
+#include "nucleus/graphics/backend/null/null_fence.h"
+#include "nucleus/graphics/backend/null/null_heap.h"
+#include "nucleus/graphics/backend/null/null_pipeline.h"
+#include "nucleus/graphics/backend/null/null_shader.h"
+#include "nucleus/graphics/backend/null/null_target.h"
+#include "nucleus/graphics/backend/null/null_texture.h"
+#include "nucleus/graphics/backend/null/null_vertex_buffer.h"
+
+#include <cstdio>
+
+namespace gfx {
+namespace null {
+
+// Command names, as written in traces
+static const char* commandNames[NullCommand::TYPE_COUNT] = {
+    "BindPipeline",
+    "ClearColor",
+    "ClearDepthStencil",
+    "Draw",
+    "DrawIndexed",
+    "SetHeaps",
+    "SetDescriptor",
+    "SetVertexBuffers",
+    "SetIndexBuffer",
+    "SetPrimitiveTopology",
+    "SetTargets",
+    "SetViewports",
+    "SetScissors",
+    "ResourceBarrier",
+};
+
+// Write commands as text, one command per line
+static void writeCommands(fs::File* file, const std::vector<NullCommand>& commands) {
+    char line[256];
+    for (const auto& cmd : commands) {
+        int length = snprintf(line, sizeof(line), "%-20s %llX %llX %llX %llX %llX\n", commandNames[cmd.type],
+            cmd.args[0], cmd.args[1], cmd.args[2], cmd.args[3], cmd.args[4]);
+        file->write(line, length);
+    }
+}
+
+NullBackend::NullBackend(U32 flags, const std::string& tracePath) : flags(flags), tracePath(tracePath), traceDropped(0) {
+}
+
+NullBackend::~NullBackend() {
+    if (flags & NULL_BACKEND_FLAG_COUNTERS) {
+        logger.notice(LOG_GRAPHICS, "NullBackend: %llu frames, %llu submits, %llu draws, %llu vertices",
+            counters.frames, counters.submits,
+            counters.commands[NullCommand::TYPE_DRAW] + counters.commands[NullCommand::TYPE_DRAW_INDEXED],
+            counters.vertices);
+    }
+    if ((flags & NULL_BACKEND_FLAG_TRACE) && !tracePath.empty()) {
+        std::lock_guard<std::mutex> lock(mutex);
+        flushTrace();
+    }
+    if (traceDropped) {
+        logger.warning(LOG_GRAPHICS, "NullBackend: %llu commands were dropped from the trace", traceDropped);
+    }
+}
+
+bool NullBackend::initialize(const BackendParameters& params) {
+    queue = std::make_unique<NullCommandQueue>(this);
+
+    // Create screen buffers
+    for (int i = 0; i < 2; i++) {
+        screenTexture[i] = std::make_unique<NullTexture>();
+        screenTexture[i]->width = params.width;
+        screenTexture[i]->height = params.height;
+        screenTexture[i]->format = FORMAT_R8G8B8A8_UNORM;
+        screenTarget[i] = std::make_unique<NullColorTarget>();
+        screenTarget[i]->texture = screenTexture[i].get();
+    }
+    screenBackBuffer = screenTexture[0].get();
+    screenFrontBuffer = screenTexture[1].get();
+    screenBackTarget = screenTarget[0].get();
+    screenFrontTarget = screenTarget[1].get();
+
+    parameters = params;
+    return true;
+}
+
+CommandBuffer* NullBackend::createCommandBuffer() {
+    return new NullCommandBuffer(flags);
+}
+
+Fence* NullBackend::createFence(const FenceDesc& desc) {
+    return new NullFence();
+}
+
+Heap* NullBackend::createHeap(const HeapDesc& desc) {
+    return new NullHeap();
+}
+
+ColorTarget* NullBackend::createColorTarget(Texture* texture) {
+    auto* target = new NullColorTarget();
+    target->texture = static_cast<NullTexture*>(texture);
+    return target;
+}
+
+DepthStencilTarget* NullBackend::createDepthStencilTarget(Texture* texture) {
+    auto* target = new NullDepthStencilTarget();
+    target->texture = static_cast<NullTexture*>(texture);
+    return target;
+}
+
+Pipeline* NullBackend::createPipeline(const PipelineDesc& desc) {
+    return new NullPipeline();
+}
+
+Shader* NullBackend::createShader(const ShaderDesc& desc) {
+    auto* shader = new NullShader();
+    shader->type = desc.type;
+    return shader;
+}
+
+Texture* NullBackend::createTexture(const TextureDesc& desc) {
+    auto* texture = new NullTexture();
+    texture->width = desc.width;
+    texture->height = desc.height;
+    texture->format = desc.format;
+    return texture;
+}
+
+VertexBuffer* NullBackend::createVertexBuffer(const VertexBufferDesc& desc) {
+    return new NullVertexBuffer(desc.size);
+}
+
+CommandQueue* NullBackend::getGraphicsCommandQueue() {
+    return queue.get();
+}
+
+bool NullBackend::doResizeBuffers(int width, int height) {
+    for (auto& texture : screenTexture) {
+        texture->width = width;
+        texture->height = height;
+    }
+    parameters.width = width;
+    parameters.height = height;
+    return true;
+}
+
+bool NullBackend::doSwapBuffers() {
+    if (flags & NULL_BACKEND_FLAG_COUNTERS) {
+        std::lock_guard<std::mutex> lock(mutex);
+        counters.frames += 1;
+    }
+    std::swap(screenBackBuffer, screenFrontBuffer);
+    std::swap(screenBackTarget, screenFrontTarget);
+    return true;
+}
+
+void NullBackend::retire(const NullCommandBuffer* cmdBuffer) {
+    if (!(flags & (NULL_BACKEND_FLAG_COUNTERS | NULL_BACKEND_FLAG_TRACE))) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    if (flags & NULL_BACKEND_FLAG_COUNTERS) {
+        counters += cmdBuffer->counters;
+        counters.submits += 1;
+    }
+    if (flags & NULL_BACKEND_FLAG_TRACE) {
+        trace.insert(trace.end(), cmdBuffer->commands.begin(), cmdBuffer->commands.end());
+        if (trace.size() >= NULL_TRACE_MAX_COMMANDS) {
+            if (!tracePath.empty()) {
+                flushTrace();
+            } else {
+                traceDropped += trace.size() - NULL_TRACE_MAX_COMMANDS;
+                trace.resize(NULL_TRACE_MAX_COMMANDS);
+            }
+        }
+    }
+}
+
+void NullBackend::flushTrace() {
+    if (!traceFile) {
+        traceFile = fs::HostFileSystem::openFile(tracePath, fs::Write);
+        if (!traceFile) {
+            logger.warning(LOG_GRAPHICS, "NullBackend::flushTrace: Could not create %s", tracePath.c_str());
+            tracePath.clear();
+            return;
+        }
+    }
+    writeCommands(traceFile.get(), trace);
+    trace.clear();
+}
+
+NullCounters NullBackend::getCounters() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
+
+std::vector<NullCommand> NullBackend::takeTrace() {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::vector<NullCommand> result;
+    result.swap(trace);
+    return result;
+}
+
+bool NullBackend::dumpTrace(const std::string& path) {
+    auto file = fs::HostFileSystem::openFile(path, fs::Write);
+    if (!file) {
+        logger.warning(LOG_GRAPHICS, "NullBackend::dumpTrace: Could not create %s", path.c_str());
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    writeCommands(file.get(), trace);
+    return true;
+}
+
+}  // namespace null
+}  // namespace gfx
@@ -0,0 +1,103 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/common.h"
+#include "nucleus/filesystem/file.h"
+#include "nucleus/graphics/graphics.h"
+#include "nucleus/graphics/backend/null/null_command_buffer.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace gfx {
+namespace null {
+
+// Forward declarations
+class NullCommandQueue;
+class NullColorTarget;
+class NullTexture;
+
+// Commands buffered before being flushed to the trace file, or kept at most without one
+constexpr Size NULL_TRACE_MAX_COMMANDS = 0x10000;
+
+/**
+ * Null backend
+ * ============
+ * Backend that accepts every resource and command without touching any host GPU.
+ * It allows running the RSX frontend (command processing, program decompilation,
+ * vertex fetching) on machines without graphics hardware, optionally counting or
+ * recording the commands it receives.
+ */
+class NullBackend : public GraphicsBackend {
+    const U32 flags;
+    std::unique_ptr<NullCommandQueue> queue;
+
+    // Screen buffers
+    std::unique_ptr<NullTexture> screenTexture[2];
+    std::unique_ptr<NullColorTarget> screenTarget[2];
+
+    // Commands retired by the queue
+    std::mutex mutex;
+    NullCounters counters;
+    std::vector<NullCommand> trace;
+    std::string tracePath;
+    std::unique_ptr<fs::File> traceFile;
+    U64 traceDropped;
+
+    // Append the buffered commands to the trace file and clear them, with the mutex held
+    void flushTrace();
+
+public:
+    /**
+     * Constructor
+     * @param[in]  flags      Combination of NullBackendFlags
+     * @param[in]  tracePath  File where the trace is written, in batches and on destruction (optional).
+     *                        Without it, NullBackend::takeTrace must be called before NULL_TRACE_MAX_COMMANDS
+     *                        commands are buffered, or further commands are dropped.
+     */
+    NullBackend(U32 flags = NULL_BACKEND_FLAG_NONE, const std::string& tracePath = "");
+    ~NullBackend();
+
+    virtual bool initialize(const BackendParameters& params) override;
+
+    virtual CommandBuffer* createCommandBuffer() override;
+    virtual Fence* createFence(const FenceDesc& desc) override;
+    virtual Heap* createHeap(const HeapDesc& desc) override;
+    virtual ColorTarget* createColorTarget(Texture* texture) override;
+    virtual DepthStencilTarget* createDepthStencilTarget(Texture* texture) override;
+    virtual Pipeline* createPipeline(const PipelineDesc& desc) override;
+    virtual Shader* createShader(const ShaderDesc& desc) override;
+    virtual Texture* createTexture(const TextureDesc& desc) override;
+    virtual VertexBuffer* createVertexBuffer(const VertexBufferDesc& desc) override;
+    virtual CommandQueue* getGraphicsCommandQueue() override;
+    virtual bool doResizeBuffers(int width, int height) override;
+    virtual bool doSwapBuffers() override;
+
+    /**
+     * Accumulate the counters and trace of a submitted command buffer
+     * @param[in]  cmdBuffer  Command buffer retired by the queue
+     */
+    void retire(const NullCommandBuffer* cmdBuffer);
+
+    // Get a snapshot of the counters
+    NullCounters getCounters();
+
+    // Take the commands buffered so far, clearing the trace
+    std::vector<NullCommand> takeTrace();
+
+    /**
+     * Write the commands buffered so far as text, one command per line
+     * @param[in]  path  Output file
+     * @return           True on success
+     */
+    bool dumpTrace(const std::string& path);
+};
+
+}  // namespace null
+}  // namespace gfx
@@ -0,0 +1,122 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#include "null_command_buffer.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace gfx {
+namespace null {
+
+// Helpers
+static inline U64 ptr(const void* object) {
+    return reinterpret_cast<uintptr_t>(object);
+}
+static inline U64 bits(F32 value) {
+    U32 result;
+    memcpy(&result, &value, sizeof(result));
+    return result;
+}
+
+NullCounters& NullCounters::operator+=(const NullCounters& rhs) {
+    for (Size i = 0; i < NullCommand::TYPE_COUNT; i++) {
+        commands[i] += rhs.commands[i];
+    }
+    vertices += rhs.vertices;
+    submits += rhs.submits;
+    frames += rhs.frames;
+    return *this;
+}
+
+bool NullCommandBuffer::reset() {
+    commands.clear();
+    counters = NullCounters();
+    return true;
+}
+
+bool NullCommandBuffer::finalize() {
+    return true;
+}
+
+void NullCommandBuffer::cmdBindPipeline(Pipeline* pipeline) {
+    record(NullCommand::TYPE_BIND_PIPELINE, ptr(pipeline));
+}
+
+void NullCommandBuffer::cmdClearColor(ColorTarget* target, const F32* colorValue) {
+    record(NullCommand::TYPE_CLEAR_COLOR, ptr(target),
+        bits(colorValue[0]), bits(colorValue[1]), bits(colorValue[2]), bits(colorValue[3]));
+}
+
+void NullCommandBuffer::cmdClearDepthStencil(DepthStencilTarget* target, F32 depthValue, U08 stencilValue) {
+    record(NullCommand::TYPE_CLEAR_DEPTH_STENCIL, ptr(target), bits(depthValue), stencilValue);
+}
+
+void NullCommandBuffer::cmdDraw(U32 firstVertex, U32 vertexCount, U32 firstInstance, U32 instanceCount) {
+    if (flags & NULL_BACKEND_FLAG_COUNTERS) {
+        counters.vertices += U64(vertexCount) * instanceCount;
+    }
+    record(NullCommand::TYPE_DRAW, firstVertex, vertexCount, firstInstance, instanceCount);
+}
+
+void NullCommandBuffer::cmdDrawIndexed(U32 firstIndex, U32 indexCount, S32 vertexOffset, U32 firstInstance, U32 instanceCount) {
+    if (flags & NULL_BACKEND_FLAG_COUNTERS) {
+        counters.vertices += U64(indexCount) * instanceCount;
+    }
+    record(NullCommand::TYPE_DRAW_INDEXED, firstIndex, indexCount, vertexOffset, firstInstance, instanceCount);
+}
+
+void NullCommandBuffer::cmdSetHeaps(const std::vector<Heap*>& heaps) {
+    record(NullCommand::TYPE_SET_HEAPS, heaps.size(), heaps.empty() ? 0 : ptr(heaps[0]));
+}
+
+void NullCommandBuffer::cmdSetDescriptor(Size index, Heap* heap, Size offset) {
+    record(NullCommand::TYPE_SET_DESCRIPTOR, index, ptr(heap), offset);
+}
+
+void NullCommandBuffer::cmdSetVertexBuffers(U32 index, U32 vtxBufferCount, VertexBuffer** vtxBuffer, U32* offsets, U32* strides) {
+    record(NullCommand::TYPE_SET_VERTEX_BUFFERS, index, vtxBufferCount,
+        vtxBufferCount ? ptr(vtxBuffer[0]) : 0,
+        vtxBufferCount ? offsets[0] : 0,
+        vtxBufferCount ? strides[0] : 0);
+}
+
+void NullCommandBuffer::cmdSetIndexBuffer(VertexBuffer* idxBuffer, U32 offset, IndexFormat format) {
+    record(NullCommand::TYPE_SET_INDEX_BUFFER, ptr(idxBuffer), offset, format);
+}
+
+void NullCommandBuffer::cmdSetPrimitiveTopology(PrimitiveTopology topology) {
+    record(NullCommand::TYPE_SET_PRIMITIVE_TOPOLOGY, topology);
+}
+
+void NullCommandBuffer::cmdSetTargets(U32 colorCount, ColorTarget** colorTargets, DepthStencilTarget* depthStencilTarget) {
+    record(NullCommand::TYPE_SET_TARGETS, colorCount, colorCount ? ptr(colorTargets[0]) : 0, ptr(depthStencilTarget));
+}
+
+void NullCommandBuffer::cmdSetViewports(U32 viewportsCount, const Viewport* viewports) {
+    record(NullCommand::TYPE_SET_VIEWPORTS, viewportsCount,
+        viewportsCount ? bits(viewports[0].originX) : 0,
+        viewportsCount ? bits(viewports[0].originY) : 0,
+        viewportsCount ? bits(viewports[0].width) : 0,
+        viewportsCount ? bits(viewports[0].height) : 0);
+}
+
+void NullCommandBuffer::cmdSetScissors(U32 scissorsCount, const Rectangle* scissors) {
+    record(NullCommand::TYPE_SET_SCISSORS, scissorsCount,
+        scissorsCount ? U32(scissors[0].left) : 0,
+        scissorsCount ? U32(scissors[0].top) : 0,
+        scissorsCount ? U32(scissors[0].right) : 0,
+        scissorsCount ? U32(scissors[0].bottom) : 0);
+}
+
+void NullCommandBuffer::cmdResourceBarrier(U32 barrierCount, const ResourceBarrier* barriers) {
+    record(NullCommand::TYPE_RESOURCE_BARRIER, barrierCount,
+        barrierCount ? ptr(barriers[0].transition.resource) : 0,
+        barrierCount ? barriers[0].transition.before : 0,
+        barrierCount ? barriers[0].transition.after : 0);
+}
+
+}  // namespace null
+}  // namespace gfx
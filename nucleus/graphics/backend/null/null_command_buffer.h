@@ -0,0 +1,103 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/common.h"
+#include "nucleus/graphics/command_buffer.h"
+
+#include <vector>
+
+namespace gfx {
+namespace null {
+
+enum NullBackendFlags : U32 {
+    NULL_BACKEND_FLAG_NONE      = 0,
+    NULL_BACKEND_FLAG_COUNTERS  = (1 << 0),  // Count the commands submitted to the backend
+    NULL_BACKEND_FLAG_TRACE     = (1 << 1),  // Record every command submitted to the backend
+};
+
+// Recorded command
+struct NullCommand {
+    enum Type : U32 {
+        TYPE_BIND_PIPELINE,
+        TYPE_CLEAR_COLOR,
+        TYPE_CLEAR_DEPTH_STENCIL,
+        TYPE_DRAW,
+        TYPE_DRAW_INDEXED,
+        TYPE_SET_HEAPS,
+        TYPE_SET_DESCRIPTOR,
+        TYPE_SET_VERTEX_BUFFERS,
+        TYPE_SET_INDEX_BUFFER,
+        TYPE_SET_PRIMITIVE_TOPOLOGY,
+        TYPE_SET_TARGETS,
+        TYPE_SET_VIEWPORTS,
+        TYPE_SET_SCISSORS,
+        TYPE_RESOURCE_BARRIER,
+        TYPE_COUNT,
+    } type;
+
+    // Scalar arguments in declaration order. Objects are recorded by address
+    // and arrays by their element count followed by their first element.
+    U64 args[5];
+};
+
+// Command counters
+struct NullCounters {
+    U64 commands[NullCommand::TYPE_COUNT];
+    U64 vertices;   // Vertices or indices fetched by draw commands, including instances
+    U64 submits;    // Command buffers submitted to the queue
+    U64 frames;     // Buffer swaps
+
+    NullCounters() : commands(), vertices(0), submits(0), frames(0) {}
+
+    NullCounters& operator+=(const NullCounters& rhs);
+};
+
+class NullCommandBuffer : public CommandBuffer {
+    const U32 flags;
+
+    /**
+     * Record a command, if the backend was asked to do so
+     * @param[in]  type  Command type
+     * @param[in]  a0    First argument, see NullCommand::args
+     */
+    void record(NullCommand::Type type, U64 a0 = 0, U64 a1 = 0, U64 a2 = 0, U64 a3 = 0, U64 a4 = 0) {
+        if (flags & NULL_BACKEND_FLAG_COUNTERS) {
+            counters.commands[type] += 1;
+        }
+        if (flags & NULL_BACKEND_FLAG_TRACE) {
+            commands.push_back({ type, { a0, a1, a2, a3, a4 } });
+        }
+    }
+
+public:
+    std::vector<NullCommand> commands;
+    NullCounters counters;
+
+    NullCommandBuffer(U32 flags) : flags(flags) {}
+
+    virtual bool reset() override;
+    virtual bool finalize() override;
+
+    // Commands
+    virtual void cmdBindPipeline(Pipeline* pipeline) override;
+    virtual void cmdClearColor(ColorTarget* target, const F32* colorValue) override;
+    virtual void cmdClearDepthStencil(DepthStencilTarget* target, F32 depthValue, U08 stencilValue) override;
+    virtual void cmdDraw(U32 firstVertex, U32 vertexCount, U32 firstInstance, U32 instanceCount) override;
+    virtual void cmdDrawIndexed(U32 firstIndex, U32 indexCount, S32 vertexOffset, U32 firstInstance, U32 instanceCount) override;
+    virtual void cmdSetHeaps(const std::vector<Heap*>& heaps) override;
+    virtual void cmdSetDescriptor(Size index, Heap* heap, Size offset) override;
+    virtual void cmdSetVertexBuffers(U32 index, U32 vtxBufferCount, VertexBuffer** vtxBuffer, U32* offsets, U32* strides) override;
+    virtual void cmdSetIndexBuffer(VertexBuffer* idxBuffer, U32 offset, IndexFormat format) override;
+    virtual void cmdSetPrimitiveTopology(PrimitiveTopology topology) override;
+    virtual void cmdSetTargets(U32 colorCount, ColorTarget** colorTargets, DepthStencilTarget* depthStencilTarget) override;
+    virtual void cmdSetViewports(U32 viewportsCount, const Viewport* viewports) override;
+    virtual void cmdSetScissors(U32 scissorsCount, const Rectangle* scissors) override;
+    virtual void cmdResourceBarrier(U32 barrierCount, const ResourceBarrier* barriers) override;
+};
+
+}  // namespace null
+}  // namespace gfx
@@ -0,0 +1,22 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#include "null_command_queue.h"
+#include "nucleus/graphics/backend/null/null_backend.h"
+#include "nucleus/graphics/backend/null/null_command_buffer.h"
+
+namespace gfx {
+namespace null {
+
+void NullCommandQueue::submit(CommandBuffer* cmdBuffer, Fence* fence) {
+    // Nothing is executed, so command buffers retire (and fences signal) immediately
+    parent->retire(static_cast<NullCommandBuffer*>(cmdBuffer));
+}
+
+void NullCommandQueue::waitIdle() {
+}
+
+}  // namespace null
+}  // namespace gfx
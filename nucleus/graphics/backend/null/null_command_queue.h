@@ -0,0 +1,28 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/graphics/command_queue.h"
+
+namespace gfx {
+namespace null {
+
+// Forward declarations
+class NullBackend;
+
+class NullCommandQueue : public CommandQueue {
+    // Parent null backend
+    NullBackend* parent;
+
+public:
+    NullCommandQueue(NullBackend* parent) : parent(parent) {}
+
+    virtual void submit(CommandBuffer* cmdBuffer, Fence* fence) override;
+    virtual void waitIdle() override;
+};
+
+}  // namespace null
+}  // namespace gfx
@@ -0,0 +1,21 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/graphics/fence.h"
+
+namespace gfx {
+namespace null {
+
+class NullFence : public Fence {
+public:
+    // Commands are retired on submission, so the fence is always signaled
+    virtual void wait() override {}
+    virtual void wait(Clock::duration timeout) override {}
+};
+
+}  // namespace null
+}  // namespace gfx
@@ -0,0 +1,21 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/graphics/heap.h"
+
+namespace gfx {
+namespace null {
+
+class NullHeap : public Heap {
+public:
+    virtual void reset() override {}
+    virtual void pushTexture(Texture* texture) override {}
+    virtual void pushVertexBuffer(VertexBuffer* buffer) override {}
+};
+
+}  // namespace null
+}  // namespace gfx
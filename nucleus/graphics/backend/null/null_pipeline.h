@@ -0,0 +1,18 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/graphics/pipeline.h"
+
+namespace gfx {
+namespace null {
+
+class NullPipeline : public Pipeline {
+public:
+};
+
+}  // namespace null
+}  // namespace gfx
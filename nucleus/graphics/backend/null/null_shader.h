@@ -0,0 +1,19 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/graphics/shader.h"
+
+namespace gfx {
+namespace null {
+
+class NullShader : public Shader {
+public:
+    ShaderType type;
+};
+
+}  // namespace null
+}  // namespace gfx
@@ -0,0 +1,25 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/graphics/target.h"
+#include "nucleus/graphics/backend/null/null_texture.h"
+
+namespace gfx {
+namespace null {
+
+class NullColorTarget : public ColorTarget {
+public:
+    NullTexture* texture;
+};
+
+class NullDepthStencilTarget : public DepthStencilTarget {
+public:
+    NullTexture* texture;
+};
+
+}  // namespace null
+}  // namespace gfx
@@ -0,0 +1,25 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/graphics/texture.h"
+
+namespace gfx {
+namespace null {
+
+class NullTexture : public Texture {
+public:
+    U32 width;
+    U32 height;
+    Format format;
+
+    // Texture contents are never read back, so there is nothing to map
+    virtual void* map() override { return nullptr; }
+    virtual bool unmap() override { return true; }
+};
+
+}  // namespace null
+}  // namespace gfx
@@ -0,0 +1,30 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/common.h"
+#include "nucleus/graphics/vertex_buffer.h"
+
+#include <memory>
+
+namespace gfx {
+namespace null {
+
+class NullVertexBuffer : public VertexBuffer {
+    // Host storage, so that the data uploaded by the caller is still written somewhere
+    std::unique_ptr<Byte[]> data;
+
+public:
+    Size size;
+
+    NullVertexBuffer(Size size) : data(new Byte[size]), size(size) {}
+
+    virtual void* map() override { return data.get(); }
+    virtual bool unmap() override { return true; }
+};
+
+}  // namespace null
+}  // namespace gfx
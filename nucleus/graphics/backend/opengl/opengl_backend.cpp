@@ -210,6 +210,7 @@ Pipeline* OpenGLBackend::createPipeline(const PipelineDesc& desc) {
     pipeline->program = program;
     pipeline->vao = 0;
     pipeline->vaoDesc = desc.iaState.inputLayout;
+    pipeline->primitiveRestart = desc.iaState.primitiveRestart;
     return pipeline;
 }
 
@@ -85,7 +85,7 @@ void OpenGLCommandBuffer::cmdDraw(U32 firstVertex, U32 vertexCount, U32 firstIns
     commands.push_back(command);
 }
 
-void OpenGLCommandBuffer::cmdDrawIndexed(U32 firstIndex, U32 indexCount, U32 vertexOffset, U32 firstInstance, U32 instanceCount) {
+void OpenGLCommandBuffer::cmdDrawIndexed(U32 firstIndex, U32 indexCount, S32 vertexOffset, U32 firstInstance, U32 instanceCount) {
     auto* command = new OpenGLCommandDrawIndexed();
     command->firstIndex = firstIndex;
     command->indexCount = indexCount;
@@ -116,6 +116,15 @@ void OpenGLCommandBuffer::cmdSetVertexBuffers(U32 index, U32 vtxBufferCount, Ver
     commands.push_back(command);
 }
 
+void OpenGLCommandBuffer::cmdSetIndexBuffer(VertexBuffer* idxBuffer, U32 offset, IndexFormat format) {
+    auto* command = new OpenGLCommandSetIndexBuffer();
+    command->buffer = static_cast<OpenGLVertexBuffer*>(idxBuffer)->id;
+    command->offset = offset;
+    command->type = (format == INDEX_FORMAT_UINT16) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+
+    commands.push_back(command);
+}
+
 void OpenGLCommandBuffer::cmdSetPrimitiveTopology(PrimitiveTopology topology) {
     auto* command = new OpenGLCommandSetPrimitiveTopology();
     command->topology = convertPrimitiveTopology(topology);
@@ -28,6 +28,7 @@ struct OpenGLCommand {
         TYPE_DRAW,
         TYPE_DRAW_INDEXED,
         TYPE_SET_VERTEX_BUFFERS,
+        TYPE_SET_INDEX_BUFFER,
         TYPE_SET_PRIMITIVE_TOPOLOGY,
         TYPE_SET_TARGETS,
         TYPE_SET_VIEWPORTS,
@@ -95,6 +96,14 @@ struct OpenGLCommandSetVertexBuffers : public OpenGLCommand {
     std::vector<GLsizei> strides;
 };
 
+struct OpenGLCommandSetIndexBuffer : public OpenGLCommand {
+    OpenGLCommandSetIndexBuffer() : OpenGLCommand(TYPE_SET_INDEX_BUFFER) {}
+
+    GLuint buffer;
+    GLintptr offset;
+    GLenum type;
+};
+
 struct OpenGLCommandSetPrimitiveTopology : public OpenGLCommand {
     OpenGLCommandSetPrimitiveTopology() : OpenGLCommand(TYPE_SET_PRIMITIVE_TOPOLOGY) {}
 
@@ -151,8 +160,9 @@ public:
     virtual void cmdClearColor(ColorTarget* target, const F32* colorValue) override;
     virtual void cmdClearDepthStencil(DepthStencilTarget* target, F32 depthValue, U8 stencilValue) override;
     virtual void cmdDraw(U32 firstVertex, U32 vertexCount, U32 firstInstance, U32 instanceCount) override;
-    virtual void cmdDrawIndexed(U32 firstIndex, U32 indexCount, U32 vertexOffset, U32 firstInstance, U32 instanceCount) override;
+    virtual void cmdDrawIndexed(U32 firstIndex, U32 indexCount, S32 vertexOffset, U32 firstInstance, U32 instanceCount) override;
     virtual void cmdSetVertexBuffers(U32 index, U32 vtxBufferCount, VertexBuffer** vtxBuffer, U32* offsets, U32* strides) override;
+    virtual void cmdSetIndexBuffer(VertexBuffer* idxBuffer, U32 offset, IndexFormat format) override;
     virtual void cmdSetPrimitiveTopology(PrimitiveTopology topology) override;
     virtual void cmdSetTargets(U32 colorCount, ColorTarget** colorTargets, DepthStencilTarget* depthStencilTarget) override;
     virtual void cmdSetViewports(U32 viewportsCount, const Viewport* viewports) override;
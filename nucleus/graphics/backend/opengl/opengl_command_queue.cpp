@@ -17,7 +17,7 @@
 namespace gfx {
 namespace opengl {
 
-OpenGLCommandQueue::OpenGLCommandQueue() {
+OpenGLCommandQueue::OpenGLCommandQueue() : tmpIndexType(GL_UNSIGNED_INT), tmpIndexOffset(0) {
 }
 
 OpenGLCommandQueue::~OpenGLCommandQueue() {
@@ -103,6 +103,9 @@ void OpenGLCommandQueue::execute(const OpenGLCommand& cmd) {
     case OpenGLCommand::TYPE_SET_VERTEX_BUFFERS:
         execute(static_cast<const OpenGLCommandSetVertexBuffers&>(cmd));
         break;
+    case OpenGLCommand::TYPE_SET_INDEX_BUFFER:
+        execute(static_cast<const OpenGLCommandSetIndexBuffer&>(cmd));
+        break;
     case OpenGLCommand::TYPE_SET_PRIMITIVE_TOPOLOGY:
         execute(static_cast<const OpenGLCommandSetPrimitiveTopology&>(cmd));
         break;
@@ -157,6 +160,13 @@ void OpenGLCommandQueue::execute(const OpenGLCommandBindPipeline& cmd) {
         glBindVertexArray(glPipeline->vao);
     }
 
+    // Index buffers hold restart indices with all bits set, regardless of the guest restart index
+    if (glPipeline->primitiveRestart) {
+        glEnable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+    } else {
+        glDisable(GL_PRIMITIVE_RESTART_FIXED_INDEX);
+    }
+
     glUseProgram(glPipeline->program);
     checkBackendError("OpenGLCommandQueue::execute: cmdBindPipeline");
 }
@@ -222,8 +232,9 @@ void OpenGLCommandQueue::execute(const OpenGLCommandDrawIndexed& cmd) {
     const GLuint baseinstance = cmd.firstInstance;
 
 #if defined(GRAPHICS_OPENGL_GL)
-    // TODO: Set index buffer (modify it via cmd.firstIndex)
-    glDrawElementsInstancedBaseVertexBaseInstance(tmpTopology, count, 0, nullptr, instancecount, basevertex, baseinstance);
+    const GLsizei indexSize = (tmpIndexType == GL_UNSIGNED_SHORT) ? 2 : 4;
+    const void* indices = reinterpret_cast<const void*>(tmpIndexOffset + cmd.firstIndex * indexSize);
+    glDrawElementsInstancedBaseVertexBaseInstance(tmpTopology, count, tmpIndexType, indices, instancecount, basevertex, baseinstance);
 #endif
     checkBackendError("OpenGLCommandQueue::execute: cmdDrawIndexed");
 }
@@ -253,6 +264,13 @@ void OpenGLCommandQueue::execute(const OpenGLCommandSetVertexBuffers& cmd) {
     checkBackendError("OpenGLCommandQueue::execute: cmdSetVertexBuffers");
 }
 
+void OpenGLCommandQueue::execute(const OpenGLCommandSetIndexBuffer& cmd) {
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cmd.buffer);
+    tmpIndexType = cmd.type;
+    tmpIndexOffset = cmd.offset;
+    checkBackendError("OpenGLCommandQueue::execute: cmdSetIndexBuffer");
+}
+
 void OpenGLCommandQueue::execute(const OpenGLCommandSetPrimitiveTopology& cmd) {
     tmpTopology = cmd.topology;
     checkBackendError("OpenGLCommandQueue::execute: cmdSetPrimitiveTopology");
@@ -30,6 +30,8 @@ private:
     // Internal state
     GLuint tmpFramebuffer;
     GLenum tmpTopology;
+    GLenum tmpIndexType;
+    GLintptr tmpIndexOffset;
 
 private:
     // Parent OpenGL backend
@@ -50,6 +52,7 @@ private:
     void execute(const OpenGLCommandDraw& cmd);
     void execute(const OpenGLCommandDrawIndexed& cmd);
     void execute(const OpenGLCommandSetVertexBuffers& cmd);
+    void execute(const OpenGLCommandSetIndexBuffer& cmd);
     void execute(const OpenGLCommandSetPrimitiveTopology& cmd);
     void execute(const OpenGLCommandSetTargets& cmd);
     void execute(const OpenGLCommandSetViewports& cmd);
@@ -27,6 +27,7 @@ public:
     // Input Layout
     std::vector<InputElement> vaoDesc;
     GLuint vao;
+    bool primitiveRestart;
 
     // Blending
     GLenum sfactor;
@@ -0,0 +1,144 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#include "software_backend.h"
+#include "nucleus/logger/logger.h"
+
+#include "nucleus/graphics/backend/software/software_command_buffer.h"
+#include "nucleus/graphics/backend/software/software_command_queue.h"
+#include "nucleus/graphics/backend/software/software_fence.h"
+#include "nucleus/graphics/backend/software/software_heap.h"
+#include "nucleus/graphics/backend/software/software_pipeline.h"
+#include "nucleus/graphics/backend/software/software_rasterizer.h"
+#include "nucleus/graphics/backend/software/software_shader.h"
+#include "nucleus/graphics/backend/software/software_target.h"
+#include "nucleus/graphics/backend/software/software_texture.h"
+#include "nucleus/graphics/backend/software/software_vertex_buffer.h"
+
+namespace gfx {
+namespace software {
+
+SoftwareBackend::SoftwareBackend(Size threadCount) : threadCount(threadCount) {
+}
+
+SoftwareBackend::~SoftwareBackend() {
+    if (queue) {
+        queue->waitIdle();
+    }
+}
+
+bool SoftwareBackend::initialize(const BackendParameters& params) {
+    rasterizer = std::make_unique<SoftwareRasterizer>(threadCount);
+    queue = std::make_unique<SoftwareCommandQueue>(rasterizer.get());
+
+    // Create screen buffers
+    TextureDesc screenDesc = {};
+    screenDesc.width = U32(params.width);
+    screenDesc.height = U32(params.height);
+    screenDesc.mipmapLevels = 1;
+    screenDesc.format = FORMAT_R8G8B8A8_UNORM;
+    for (int i = 0; i < 2; i++) {
+        screenTexture[i] = std::make_unique<SoftwareTexture>(screenDesc);
+        screenTarget[i] = std::make_unique<SoftwareColorTarget>();
+        screenTarget[i]->texture = screenTexture[i].get();
+    }
+    screenBackBuffer = screenTexture[0].get();
+    screenFrontBuffer = screenTexture[1].get();
+    screenBackTarget = screenTarget[0].get();
+    screenFrontTarget = screenTarget[1].get();
+
+    parameters = params;
+    return true;
+}
+
+CommandBuffer* SoftwareBackend::createCommandBuffer() {
+    return new SoftwareCommandBuffer();
+}
+
+Fence* SoftwareBackend::createFence(const FenceDesc& desc) {
+    return new SoftwareFence();
+}
+
+Heap* SoftwareBackend::createHeap(const HeapDesc& desc) {
+    auto* heap = new SoftwareHeap();
+    heap->entries.reserve(desc.size);
+    return heap;
+}
+
+ColorTarget* SoftwareBackend::createColorTarget(Texture* texture) {
+    auto* target = new SoftwareColorTarget();
+    target->texture = static_cast<SoftwareTexture*>(texture);
+    return target;
+}
+
+DepthStencilTarget* SoftwareBackend::createDepthStencilTarget(Texture* texture) {
+    auto* target = new SoftwareDepthStencilTarget();
+    target->texture = static_cast<SoftwareTexture*>(texture);
+    return target;
+}
+
+Pipeline* SoftwareBackend::createPipeline(const PipelineDesc& desc) {
+    auto* pipeline = new SoftwarePipeline();
+    pipeline->desc = desc;
+    pipeline->vs = static_cast<SoftwareShader*>(desc.vs);
+    pipeline->ps = static_cast<SoftwareShader*>(desc.ps);
+    if (!pipeline->vs || !pipeline->ps) {
+        logger.error(LOG_GRAPHICS, "SoftwareBackend::createPipeline: Vertex and pixel shaders are required");
+        return pipeline;
+    }
+
+    // Link the input layout with the vertex shader inputs
+    for (const auto& element : desc.iaState.inputLayout) {
+        int reg = -1;
+        for (const auto& input : pipeline->vs->inputs) {
+            if (input.kind == ShaderVariable::KIND_LOCATION && input.index == element.semanticIndex) {
+                reg = input.reg;
+            }
+        }
+        pipeline->inputRegs.push_back(reg);
+    }
+    return pipeline;
+}
+
+Shader* SoftwareBackend::createShader(const ShaderDesc& desc) {
+    auto* shader = new SoftwareShader();
+    if (!shader->initialize(desc)) {
+        logger.error(LOG_GRAPHICS, "SoftwareBackend::createShader: Could not translate the shader");
+    }
+    return shader;
+}
+
+Texture* SoftwareBackend::createTexture(const TextureDesc& desc) {
+    return new SoftwareTexture(desc);
+}
+
+VertexBuffer* SoftwareBackend::createVertexBuffer(const VertexBufferDesc& desc) {
+    return new SoftwareVertexBuffer(desc.size);
+}
+
+CommandQueue* SoftwareBackend::getGraphicsCommandQueue() {
+    return queue.get();
+}
+
+bool SoftwareBackend::doResizeBuffers(int width, int height) {
+    queue->waitIdle();
+    for (auto& texture : screenTexture) {
+        texture->resize(width, height);
+    }
+    parameters.width = width;
+    parameters.height = height;
+    return true;
+}
+
+bool SoftwareBackend::doSwapBuffers() {
+    // TODO: Screen buffers are not presented to the window yet, they can be read back with Texture::map
+    queue->waitIdle();
+    std::swap(screenBackBuffer, screenFrontBuffer);
+    std::swap(screenBackTarget, screenFrontTarget);
+    return true;
+}
+
+}  // namespace software
+}  // namespace gfx
@@ -0,0 +1,65 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/common.h"
+#include "nucleus/graphics/graphics.h"
+
+#include <memory>
+
+namespace gfx {
+namespace software {
+
+// Forward declarations
+class SoftwareColorTarget;
+class SoftwareCommandQueue;
+class SoftwareRasterizer;
+class SoftwareTexture;
+
+/**
+ * Software backend
+ * ================
+ * Backend that renders on the host CPU. Shaders are translated from HIR into programs for
+ * a SIMD interpreter, and primitives are rasterized by SoftwareRasterizer, which spreads
+ * screen tiles across a pool of worker threads. Output does not depend on the host GPU or
+ * drivers, so it can be used as a reference for the other backends.
+ */
+class SoftwareBackend : public GraphicsBackend {
+    std::unique_ptr<SoftwareRasterizer> rasterizer;
+    std::unique_ptr<SoftwareCommandQueue> queue;
+
+    // Screen buffers
+    std::unique_ptr<SoftwareTexture> screenTexture[2];
+    std::unique_ptr<SoftwareColorTarget> screenTarget[2];
+
+    Size threadCount;
+
+public:
+    /**
+     * Constructor
+     * @param[in]  threadCount  Number of rasterizer threads, or 0 to use one per host core
+     */
+    SoftwareBackend(Size threadCount = 0);
+    ~SoftwareBackend();
+
+    virtual bool initialize(const BackendParameters& params) override;
+
+    virtual CommandBuffer* createCommandBuffer() override;
+    virtual Fence* createFence(const FenceDesc& desc) override;
+    virtual Heap* createHeap(const HeapDesc& desc) override;
+    virtual ColorTarget* createColorTarget(Texture* texture) override;
+    virtual DepthStencilTarget* createDepthStencilTarget(Texture* texture) override;
+    virtual Pipeline* createPipeline(const PipelineDesc& desc) override;
+    virtual Shader* createShader(const ShaderDesc& desc) override;
+    virtual Texture* createTexture(const TextureDesc& desc) override;
+    virtual VertexBuffer* createVertexBuffer(const VertexBufferDesc& desc) override;
+    virtual CommandQueue* getGraphicsCommandQueue() override;
+    virtual bool doResizeBuffers(int width, int height) override;
+    virtual bool doSwapBuffers() override;
+};
+
+}  // namespace software
+}  // namespace gfx
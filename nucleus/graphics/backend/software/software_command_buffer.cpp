@@ -0,0 +1,202 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#include "software_command_buffer.h"
+#include "nucleus/logger/logger.h"
+#include "nucleus/graphics/backend/software/software_pipeline.h"
+#include "nucleus/graphics/backend/software/software_target.h"
+
+#include <algorithm>
+
+namespace gfx {
+namespace software {
+
+std::shared_ptr<const SoftwareDrawState> SoftwareCommandBuffer::getDrawState() {
+    const auto* pipeline = state.pipeline;
+    const Size numCBVs = pipeline ? pipeline->desc.numCBVs : 0;
+    const Size numSRVs = pipeline ? pipeline->desc.numSRVs : 0;
+
+    // Descriptor tables follow the root signature: constant buffers first, if any, then textures
+    const DescriptorTable* cbvTable = nullptr;
+    const DescriptorTable* srvTable = nullptr;
+    Size rootIndex = 0;
+    if (numCBVs > 0) {
+        cbvTable = &tables[rootIndex++];
+    }
+    if (numSRVs > 0) {
+        srvTable = &tables[rootIndex++];
+    }
+
+    // Constant buffers are copied, since they might be rewritten before the draw executes
+    std::vector<std::vector<Byte>> constants;
+    if (cbvTable && cbvTable->heap) {
+        const auto& entries = cbvTable->heap->entries;
+        for (Size i = 0; i < numCBVs && i < SHADER_MAX_BUFFERS; i++) {
+            const Size index = cbvTable->offset + i;
+            if (index < entries.size() && entries[index].buffer) {
+                constants.push_back(entries[index].buffer->data);
+            } else {
+                constants.emplace_back();
+            }
+        }
+    }
+    if (!dirty && snapshot && snapshot->constants == constants) {
+        return snapshot;
+    }
+
+    auto drawState = std::make_shared<SoftwareDrawState>(state);
+    drawState->constants = std::move(constants);
+    drawState->resources = {};
+    for (Size i = 0; i < drawState->constants.size(); i++) {
+        drawState->resources.buffers[i] = drawState->constants[i].data();
+        drawState->resources.bufferSizes[i] = drawState->constants[i].size();
+    }
+    if (srvTable && srvTable->heap) {
+        const auto& entries = srvTable->heap->entries;
+        const auto& samplers = pipeline->desc.samplers;
+        for (Size i = 0; i < numSRVs && i < SHADER_MAX_TEXTURES; i++) {
+            const Size index = srvTable->offset + i;
+            if (index < entries.size() && i < samplers.size()) {
+                drawState->resources.textures[i] = entries[index].texture;
+                drawState->resources.samplers[i] = &samplers[i];
+            }
+        }
+    }
+    snapshot = drawState;
+    dirty = false;
+    return snapshot;
+}
+
+bool SoftwareCommandBuffer::reset() {
+    state = SoftwareDrawState();
+    snapshot.reset();
+    dirty = true;
+    for (auto& table : tables) {
+        table = {};
+    }
+    commands.clear();
+    return true;
+}
+
+bool SoftwareCommandBuffer::finalize() {
+    return true;
+}
+
+void SoftwareCommandBuffer::cmdBindPipeline(Pipeline* pipeline) {
+    state.pipeline = static_cast<SoftwarePipeline*>(pipeline);
+    dirty = true;
+}
+
+void SoftwareCommandBuffer::cmdClearColor(ColorTarget* target, const F32* colorValue) {
+    SoftwareCommand cmd = {};
+    cmd.type = SoftwareCommand::TYPE_CLEAR_COLOR;
+    cmd.target = static_cast<SoftwareColorTarget*>(target)->texture;
+    std::copy(colorValue, colorValue + 4, cmd.color);
+    commands.push_back(cmd);
+}
+
+void SoftwareCommandBuffer::cmdClearDepthStencil(DepthStencilTarget* target, F32 depthValue, U08 stencilValue) {
+    SoftwareCommand cmd = {};
+    cmd.type = SoftwareCommand::TYPE_CLEAR_DEPTH_STENCIL;
+    cmd.target = static_cast<SoftwareDepthStencilTarget*>(target)->texture;
+    cmd.depth = depthValue;
+    cmd.stencil = stencilValue;
+    commands.push_back(cmd);
+}
+
+void SoftwareCommandBuffer::cmdDraw(U32 firstVertex, U32 vertexCount, U32 firstInstance, U32 instanceCount) {
+    SoftwareCommand cmd = {};
+    cmd.type = SoftwareCommand::TYPE_DRAW;
+    cmd.draw.state = getDrawState();
+    cmd.draw.indexed = false;
+    cmd.draw.first = firstVertex;
+    cmd.draw.count = vertexCount;
+    cmd.draw.firstInstance = firstInstance;
+    cmd.draw.instanceCount = instanceCount;
+    commands.push_back(cmd);
+}
+
+void SoftwareCommandBuffer::cmdDrawIndexed(U32 firstIndex, U32 indexCount, S32 vertexOffset, U32 firstInstance, U32 instanceCount) {
+    SoftwareCommand cmd = {};
+    cmd.type = SoftwareCommand::TYPE_DRAW;
+    cmd.draw.state = getDrawState();
+    cmd.draw.indexed = true;
+    cmd.draw.first = firstIndex;
+    cmd.draw.count = indexCount;
+    cmd.draw.vertexOffset = vertexOffset;
+    cmd.draw.firstInstance = firstInstance;
+    cmd.draw.instanceCount = instanceCount;
+    commands.push_back(cmd);
+}
+
+void SoftwareCommandBuffer::cmdSetHeaps(const std::vector<Heap*>& heaps) {
+    // Descriptors are resolved through the heaps given to cmdSetDescriptor
+}
+
+void SoftwareCommandBuffer::cmdSetDescriptor(Size index, Heap* heap, Size offset) {
+    if (index >= SOFTWARE_MAX_DESCRIPTOR_TABLES) {
+        logger.error(LOG_GRAPHICS, "SoftwareCommandBuffer::cmdSetDescriptor: Descriptor table %d is out of range", int(index));
+        return;
+    }
+    tables[index].heap = static_cast<SoftwareHeap*>(heap);
+    tables[index].offset = offset;
+    dirty = true;
+}
+
+void SoftwareCommandBuffer::cmdSetVertexBuffers(U32 index, U32 vtxBufferCount, VertexBuffer** vtxBuffer, U32* offsets, U32* strides) {
+    for (U32 i = 0; i < vtxBufferCount && index + i < SOFTWARE_MAX_VERTEX_BUFFERS; i++) {
+        auto& stream = state.streams[index + i];
+        stream.buffer = static_cast<SoftwareVertexBuffer*>(vtxBuffer[i]);
+        stream.offset = offsets ? offsets[i] : 0;
+        stream.stride = strides ? strides[i] : 0;
+    }
+    dirty = true;
+}
+
+void SoftwareCommandBuffer::cmdSetIndexBuffer(VertexBuffer* idxBuffer, U32 offset, IndexFormat format) {
+    state.indexBuffer = static_cast<SoftwareVertexBuffer*>(idxBuffer);
+    state.indexOffset = offset;
+    state.indexFormat = format;
+    dirty = true;
+}
+
+void SoftwareCommandBuffer::cmdSetPrimitiveTopology(PrimitiveTopology topology) {
+    state.topology = topology;
+    dirty = true;
+}
+
+void SoftwareCommandBuffer::cmdSetTargets(U32 colorCount, ColorTarget** colorTargets, DepthStencilTarget* depthStencilTarget) {
+    for (Size i = 0; i < SOFTWARE_MAX_COLOR_TARGETS; i++) {
+        auto* target = (i < colorCount) ? static_cast<SoftwareColorTarget*>(colorTargets[i]) : nullptr;
+        state.colorTargets[i] = target ? target->texture : nullptr;
+    }
+    auto* target = static_cast<SoftwareDepthStencilTarget*>(depthStencilTarget);
+    state.depthTarget = target ? target->texture : nullptr;
+    dirty = true;
+}
+
+void SoftwareCommandBuffer::cmdSetViewports(U32 viewportsCount, const Viewport* viewports) {
+    // TODO: Only the first viewport is used
+    if (viewportsCount > 0) {
+        state.viewport = viewports[0];
+        dirty = true;
+    }
+}
+
+void SoftwareCommandBuffer::cmdSetScissors(U32 scissorsCount, const Rectangle* scissors) {
+    // TODO: Only the first scissor is used
+    state.hasScissor = (scissorsCount > 0);
+    if (scissorsCount > 0) {
+        state.scissor = scissors[0];
+    }
+    dirty = true;
+}
+
+void SoftwareCommandBuffer::cmdResourceBarrier(U32 barrierCount, const ResourceBarrier* barriers) {
+    // Commands execute in order on the same memory, so transitions need no work
+}
+
+}  // namespace software
+}  // namespace gfx
@@ -0,0 +1,78 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/common.h"
+#include "nucleus/graphics/command_buffer.h"
+#include "nucleus/graphics/backend/software/software_heap.h"
+#include "nucleus/graphics/backend/software/software_rasterizer.h"
+
+#include <memory>
+#include <vector>
+
+namespace gfx {
+namespace software {
+
+// Maximum number of descriptor tables bound at once
+constexpr Size SOFTWARE_MAX_DESCRIPTOR_TABLES = 4;
+
+// Recorded command
+struct SoftwareCommand {
+    enum Type : U32 {
+        TYPE_CLEAR_COLOR,
+        TYPE_CLEAR_DEPTH_STENCIL,
+        TYPE_DRAW,
+    } type;
+
+    SoftwareTexture* target;
+    F32 color[4];
+    F32 depth;
+    U08 stencil;
+    SoftwareDraw draw;
+};
+
+class SoftwareCommandBuffer : public CommandBuffer {
+    // State set by the commands recorded so far
+    SoftwareDrawState state;
+
+    // State of the last draw, shared with the following draws until the state changes
+    std::shared_ptr<const SoftwareDrawState> snapshot;
+    bool dirty = true;
+
+    // Descriptor tables, resolved when a draw is recorded
+    struct DescriptorTable {
+        const SoftwareHeap* heap;
+        Size offset;
+    } tables[SOFTWARE_MAX_DESCRIPTOR_TABLES] = {};
+
+    // Get the state for a new draw
+    std::shared_ptr<const SoftwareDrawState> getDrawState();
+
+public:
+    std::vector<SoftwareCommand> commands;
+
+    virtual bool reset() override;
+    virtual bool finalize() override;
+
+    // Commands
+    virtual void cmdBindPipeline(Pipeline* pipeline) override;
+    virtual void cmdClearColor(ColorTarget* target, const F32* colorValue) override;
+    virtual void cmdClearDepthStencil(DepthStencilTarget* target, F32 depthValue, U08 stencilValue) override;
+    virtual void cmdDraw(U32 firstVertex, U32 vertexCount, U32 firstInstance, U32 instanceCount) override;
+    virtual void cmdDrawIndexed(U32 firstIndex, U32 indexCount, S32 vertexOffset, U32 firstInstance, U32 instanceCount) override;
+    virtual void cmdSetHeaps(const std::vector<Heap*>& heaps) override;
+    virtual void cmdSetDescriptor(Size index, Heap* heap, Size offset) override;
+    virtual void cmdSetVertexBuffers(U32 index, U32 vtxBufferCount, VertexBuffer** vtxBuffer, U32* offsets, U32* strides) override;
+    virtual void cmdSetIndexBuffer(VertexBuffer* idxBuffer, U32 offset, IndexFormat format) override;
+    virtual void cmdSetPrimitiveTopology(PrimitiveTopology topology) override;
+    virtual void cmdSetTargets(U32 colorCount, ColorTarget** colorTargets, DepthStencilTarget* depthStencilTarget) override;
+    virtual void cmdSetViewports(U32 viewportsCount, const Viewport* viewports) override;
+    virtual void cmdSetScissors(U32 scissorsCount, const Rectangle* scissors) override;
+    virtual void cmdResourceBarrier(U32 barrierCount, const ResourceBarrier* barriers) override;
+};
+
+}  // namespace software
+}  // namespace gfx
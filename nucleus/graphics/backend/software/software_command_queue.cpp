@@ -0,0 +1,48 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#include "software_command_queue.h"
+#include "nucleus/graphics/backend/software/software_command_buffer.h"
+#include "nucleus/graphics/backend/software/software_fence.h"
+#include "nucleus/graphics/backend/software/software_rasterizer.h"
+
+namespace gfx {
+namespace software {
+
+void SoftwareCommandQueue::submit(CommandBuffer* cmdBuffer, Fence* fence) {
+    auto* softwareFence = static_cast<SoftwareFence*>(fence);
+    if (softwareFence) {
+        softwareFence->reset();
+    }
+
+    // Commands are copied, so that the buffer can be reset or recorded again right away
+    auto commands = static_cast<SoftwareCommandBuffer*>(cmdBuffer)->commands;
+    submitter.submit([this, commands, softwareFence] {
+        for (const auto& cmd : commands) {
+            switch (cmd.type) {
+            case SoftwareCommand::TYPE_CLEAR_COLOR:
+                rasterizer->clearColor(cmd.target, cmd.color);
+                break;
+            case SoftwareCommand::TYPE_CLEAR_DEPTH_STENCIL:
+                rasterizer->clearDepthStencil(cmd.target, cmd.depth, cmd.stencil);
+                break;
+            case SoftwareCommand::TYPE_DRAW:
+                rasterizer->draw(cmd.draw);
+                break;
+            }
+        }
+        rasterizer->flush();
+        if (softwareFence) {
+            softwareFence->signal();
+        }
+    });
+}
+
+void SoftwareCommandQueue::waitIdle() {
+    submitter.wait();
+}
+
+}  // namespace software
+}  // namespace gfx
@@ -0,0 +1,31 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/core/worker_pool.h"
+#include "nucleus/graphics/command_queue.h"
+
+namespace gfx {
+namespace software {
+
+// Forward declarations
+class SoftwareRasterizer;
+
+class SoftwareCommandQueue : public CommandQueue {
+    SoftwareRasterizer* rasterizer;
+
+    // Executes submissions in order, apart from the thread that records them
+    core::WorkerPool submitter;
+
+public:
+    SoftwareCommandQueue(SoftwareRasterizer* rasterizer) : rasterizer(rasterizer), submitter(1) {}
+
+    virtual void submit(CommandBuffer* cmdBuffer, Fence* fence) override;
+    virtual void waitIdle() override;
+};
+
+}  // namespace software
+}  // namespace gfx
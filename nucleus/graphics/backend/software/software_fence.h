@@ -0,0 +1,46 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/graphics/fence.h"
+
+#include <condition_variable>
+#include <mutex>
+
+namespace gfx {
+namespace software {
+
+class SoftwareFence : public Fence {
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool signaled = true;
+
+public:
+    // Called by the queue when the fence is submitted
+    void reset() {
+        std::lock_guard<std::mutex> lock(mutex);
+        signaled = false;
+    }
+
+    // Called by the queue once the commands submitted before the fence have executed
+    void signal() {
+        std::lock_guard<std::mutex> lock(mutex);
+        signaled = true;
+        cv.notify_all();
+    }
+
+    virtual void wait() override {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return signaled; });
+    }
+    virtual void wait(Clock::duration timeout) override {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait_for(lock, timeout, [this] { return signaled; });
+    }
+};
+
+}  // namespace software
+}  // namespace gfx
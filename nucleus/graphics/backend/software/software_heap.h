@@ -0,0 +1,38 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/graphics/heap.h"
+#include "nucleus/graphics/backend/software/software_texture.h"
+#include "nucleus/graphics/backend/software/software_vertex_buffer.h"
+
+#include <vector>
+
+namespace gfx {
+namespace software {
+
+class SoftwareHeap : public Heap {
+public:
+    // Descriptors in push order, each holding either a texture or a buffer
+    struct Entry {
+        SoftwareTexture* texture;
+        SoftwareVertexBuffer* buffer;
+    };
+    std::vector<Entry> entries;
+
+    virtual void reset() override {
+        entries.clear();
+    }
+    virtual void pushTexture(Texture* texture) override {
+        entries.push_back({ static_cast<SoftwareTexture*>(texture), nullptr });
+    }
+    virtual void pushVertexBuffer(VertexBuffer* buffer) override {
+        entries.push_back({ nullptr, static_cast<SoftwareVertexBuffer*>(buffer) });
+    }
+};
+
+}  // namespace software
+}  // namespace gfx
@@ -0,0 +1,27 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/graphics/pipeline.h"
+#include "nucleus/graphics/backend/software/software_shader.h"
+
+#include <vector>
+
+namespace gfx {
+namespace software {
+
+class SoftwarePipeline : public Pipeline {
+public:
+    PipelineDesc desc;
+    SoftwareShader* vs;
+    SoftwareShader* ps;
+
+    // Vertex shader register fed by each element of the input layout, or -1 if unused
+    std::vector<int> inputRegs;
+};
+
+}  // namespace software
+}  // namespace gfx
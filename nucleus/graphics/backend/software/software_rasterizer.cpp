@@ -0,0 +1,1162 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#include "software_rasterizer.h"
+#include "nucleus/core/host.h"
+#include "nucleus/graphics/hir/hir.h"
+
+#ifdef NUCLEUS_ARCH_X86
+#ifdef NUCLEUS_COMPILER_MSVC
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#include <x86intrin.h>
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+
+namespace gfx {
+namespace software {
+
+// Precision of screen coordinates in fixed point
+constexpr S32 SUBPIXEL_BITS = 8;
+constexpr S32 SUBPIXEL_ONE = 1 << SUBPIXEL_BITS;
+constexpr S32 SUBPIXEL_HALF = SUBPIXEL_ONE / 2;
+
+// Primitives are clipped against w = CLIP_EPSILON and against a guard band around the
+// viewport, which keeps fixed-point coordinates and edge functions far from overflowing.
+// Pixels outside the viewport are discarded by the draw clip rectangle instead.
+constexpr F32 CLIP_EPSILON = 1e-5f;
+constexpr F32 CLIP_GUARD_BAND = 4.0f;
+constexpr int CLIP_PLANES = 5;
+
+// Maximum number of values passed from the vertex shader to the pixel shader
+constexpr Size SOFTWARE_MAX_VARYINGS = 16;
+
+// Vertices shaded by each vertex shading task
+constexpr Size VERTEX_CHUNK_SIZE = 1024;
+
+// Pixels per side of the blocks whose coverage is evaluated at once, as a 64-bit mask
+constexpr S32 BLOCK_SIZE = 8;
+
+struct SoftwareRasterizer::DrawInfo {
+    std::shared_ptr<const SoftwareDrawState> state;
+    const SoftwarePipeline* pipeline;
+    const SoftwareShader* vs;
+    const SoftwareShader* ps;
+
+    // Registers linking vertex shader outputs and pixel shader inputs
+    U32 varyingCount;
+    int vsVaryingRegs[SOFTWARE_MAX_VARYINGS];
+    int psVaryingRegs[SOFTWARE_MAX_VARYINGS];
+    int vsPositionReg;
+    int vsVertexIdReg;
+    int vsInstanceIdReg;
+    int psFragCoordReg;
+    int psFrontFacingReg;
+    int psColorRegs[SOFTWARE_MAX_COLOR_TARGETS];
+    int psDepthReg;
+
+    // Depth can be tested before shading unless the pixel shader kills or writes depth
+    bool earlyDepth;
+
+    // Viewport transform and depth range
+    F32 scaleX, offsetX;
+    F32 scaleY, offsetY;
+    F32 scaleZ, offsetZ;
+    F32 minZ, maxZ;
+
+    // Pixels the draw may touch (inclusive): viewport, scissor and targets
+    S32 clipX0, clipY0;
+    S32 clipX1, clipY1;
+
+    // Floats per shaded vertex: clip-space position followed by the varyings
+    Size stride;
+};
+
+// Vertex after the viewport transform
+struct SoftwareRasterizer::ScreenVertex {
+    F32 x;
+    F32 y;
+    F32 z;
+    F32 invW;
+    const F32* varyings;
+};
+
+struct SoftwareRasterizer::Triangle {
+    // Vertices in fixed point, ordered so that the area is positive
+    S32 x[3];
+    S32 y[3];
+    S64 area;
+
+    // Covered pixels (inclusive)
+    S32 minX, minY;
+    S32 maxX, maxY;
+
+    F32 z[3];
+    F32 invW[3];
+
+    U32 draw;
+    Size attributes;   // Offset of the varyings of each vertex, premultiplied by 1/w
+    bool frontFacing;
+};
+
+struct SoftwareRasterizer::Batch {
+    SoftwareTexture* colorTargets[SOFTWARE_MAX_COLOR_TARGETS] = {};
+    SoftwareTexture* depthTarget = nullptr;
+    S32 width = 0;
+    S32 height = 0;
+    S32 tilesX = 0;
+    S32 tilesY = 0;
+
+    std::vector<DrawInfo> draws;
+    std::vector<Triangle> triangles;
+    std::vector<F32> attributes;
+    std::vector<std::vector<U32>> bins;
+};
+
+static S32 floorShift(S64 value) {
+    return S32(value >= 0 ? (value >> SUBPIXEL_BITS) : -((-value + SUBPIXEL_ONE - 1) >> SUBPIXEL_BITS));
+}
+
+static S32 ceilShift(S64 value) {
+    return -floorShift(-value);
+}
+
+static U32 toUnorm(F32 value, U32 max) {
+    value = std::min(std::max(value, 0.0f), 1.0f);
+    return U32(value * max + 0.5f);
+}
+
+static bool isFloatFormat(Format format) {
+    switch (format) {
+    case FORMAT_R16_FLOAT:
+    case FORMAT_R16G16_FLOAT:
+    case FORMAT_R16G16B16_FLOAT:
+    case FORMAT_R16G16B16A16_FLOAT:
+    case FORMAT_R32_FLOAT:
+    case FORMAT_R32G32_FLOAT:
+    case FORMAT_R32G32B32_FLOAT:
+    case FORMAT_R32G32B32A32_FLOAT:
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool compare(ComparisonFunc func, U32 src, U32 dst) {
+    switch (func) {
+    case COMPARISON_FUNC_NEVER:          return false;
+    case COMPARISON_FUNC_LESS:           return src < dst;
+    case COMPARISON_FUNC_EQUAL:          return src == dst;
+    case COMPARISON_FUNC_LESS_EQUAL:     return src <= dst;
+    case COMPARISON_FUNC_GREATER:        return src > dst;
+    case COMPARISON_FUNC_NOT_EQUAL:      return src != dst;
+    case COMPARISON_FUNC_GREATER_EQUAL:  return src >= dst;
+    default:                             return true;
+    }
+}
+
+static F32 getBlendFactor(Blend blend, const F32* src, const F32* dst, Size k) {
+    switch (blend) {
+    case BLEND_ZERO:            return 0.0f;
+    case BLEND_ONE:             return 1.0f;
+    case BLEND_SRC_COLOR:       return src[k];
+    case BLEND_INV_SRC_COLOR:   return 1.0f - src[k];
+    case BLEND_SRC_ALPHA:       return src[3];
+    case BLEND_INV_SRC_ALPHA:   return 1.0f - src[3];
+    case BLEND_DEST_ALPHA:      return dst[3];
+    case BLEND_INV_DEST_ALPHA:  return 1.0f - dst[3];
+    case BLEND_DEST_COLOR:      return dst[k];
+    case BLEND_INV_DEST_COLOR:  return 1.0f - dst[k];
+    case BLEND_SRC_ALPHA_SAT:   return (k < 3) ? std::min(src[3], 1.0f - dst[3]) : 1.0f;
+    // TODO: Blend constants are not part of the pipeline state yet
+    case BLEND_BLEND_FACTOR:      return 1.0f;
+    case BLEND_INV_BLEND_FACTOR:  return 0.0f;
+    // TODO: Dual-source blending is unimplemented, the first output is used instead
+    case BLEND_SRC1_COLOR:      return src[k];
+    case BLEND_INV_SRC1_COLOR:  return 1.0f - src[k];
+    case BLEND_SRC1_ALPHA:      return src[3];
+    case BLEND_INV_SRC1_ALPHA:  return 1.0f - src[3];
+    default:
+        return 1.0f;
+    }
+}
+
+static F32 getBlendResult(BlendOp op, F32 src, F32 dst, F32 srcFactor, F32 dstFactor) {
+    switch (op) {
+    case BLEND_OP_ADD:           return src * srcFactor + dst * dstFactor;
+    case BLEND_OP_SUBTRACT:      return src * srcFactor - dst * dstFactor;
+    case BLEND_OP_REV_SUBTRACT:  return dst * dstFactor - src * srcFactor;
+    case BLEND_OP_MIN:           return std::min(src, dst);
+    case BLEND_OP_MAX:           return std::max(src, dst);
+    default:
+        return src;
+    }
+}
+
+/**
+ * Block coverage
+ * ==============
+ * Edge functions are evaluated over blocks of BLOCK_SIZE x BLOCK_SIZE pixels. Each edge is
+ * linear, so its extremes over a block lie on the corners: blocks outside any edge are rejected
+ * and blocks inside all of them are accepted without testing their pixels. The rest compute the
+ * coverage of all their pixels at once. Edge values need 64 bits because of the guard band.
+ * @param[in]  edge       Edge values at the center of the top-left pixel of the block
+ * @param[in]  stepX      Edge increments per pixel to the right
+ * @param[in]  stepY      Edge increments per pixel downwards
+ * @param[in]  threshold  Smallest edge values covering a pixel
+ * @return                Coverage mask, one bit per pixel in row-major order
+ */
+static U64 getBlockCoverageScalar(const S64 edge[3], const S64 stepX[3], const S64 stepY[3], const S64 threshold[3]) {
+    U64 mask = 0;
+    for (S32 y = 0; y < BLOCK_SIZE; y++) {
+        for (S32 x = 0; x < BLOCK_SIZE; x++) {
+            bool covered = true;
+            for (Size e = 0; e < 3; e++) {
+                covered &= (edge[e] + stepX[e] * x + stepY[e] * y >= threshold[e]);
+            }
+            mask |= U64(covered) << (y * BLOCK_SIZE + x);
+        }
+    }
+    return mask;
+}
+
+#ifdef NUCLEUS_ARCH_X86
+TARGET_AVX2
+static U64 getBlockCoverageAVX2(const S64 edge[3], const S64 stepX[3], const S64 stepY[3], const S64 threshold[3]) {
+    // Each row is split in two vectors of four 64-bit edge values
+    __m256i row[3], offsetLo[3], offsetHi[3], step[3], limit[3];
+    for (Size e = 0; e < 3; e++) {
+        row[e] = _mm256_set1_epi64x(edge[e]);
+        offsetLo[e] = _mm256_setr_epi64x(0, stepX[e], 2 * stepX[e], 3 * stepX[e]);
+        offsetHi[e] = _mm256_add_epi64(offsetLo[e], _mm256_set1_epi64x(4 * stepX[e]));
+        step[e] = _mm256_set1_epi64x(stepY[e]);
+        limit[e] = _mm256_set1_epi64x(threshold[e] - 1);
+    }
+    U64 mask = 0;
+    for (S32 y = 0; y < BLOCK_SIZE; y++) {
+        __m256i coveredLo = _mm256_set1_epi64x(-1);
+        __m256i coveredHi = _mm256_set1_epi64x(-1);
+        for (Size e = 0; e < 3; e++) {
+            coveredLo = _mm256_and_si256(coveredLo, _mm256_cmpgt_epi64(_mm256_add_epi64(row[e], offsetLo[e]), limit[e]));
+            coveredHi = _mm256_and_si256(coveredHi, _mm256_cmpgt_epi64(_mm256_add_epi64(row[e], offsetHi[e]), limit[e]));
+            row[e] = _mm256_add_epi64(row[e], step[e]);
+        }
+        const U32 bits = _mm256_movemask_pd(_mm256_castsi256_pd(coveredLo)) |
+                        (_mm256_movemask_pd(_mm256_castsi256_pd(coveredHi)) << 4);
+        mask |= U64(bits) << (y * BLOCK_SIZE);
+    }
+    return mask;
+}
+#endif
+
+static U64 getBlockCoverage(const S64 edge[3], const S64 stepX[3], const S64 stepY[3], const S64 threshold[3]) {
+    bool inside = true;
+    for (Size e = 0; e < 3; e++) {
+        const S64 spanX = stepX[e] * (BLOCK_SIZE - 1);
+        const S64 spanY = stepY[e] * (BLOCK_SIZE - 1);
+        if (edge[e] + std::max<S64>(spanX, 0) + std::max<S64>(spanY, 0) < threshold[e]) {
+            return 0;
+        }
+        inside &= (edge[e] + std::min<S64>(spanX, 0) + std::min<S64>(spanY, 0) >= threshold[e]);
+    }
+    if (inside) {
+        return ~0ULL;
+    }
+#ifdef NUCLEUS_ARCH_X86
+    if (core::hasHostFeature(core::HOST_FEATURE_AVX2)) {
+        return getBlockCoverageAVX2(edge, stepX, stepY, threshold);
+    }
+#endif
+    return getBlockCoverageScalar(edge, stepX, stepY, threshold);
+}
+
+// Mask of the pixels of a block inside a rectangle, in the layout of getBlockCoverage
+static U64 getBlockRectMask(S32 blockX, S32 blockY, S32 x0, S32 y0, S32 x1, S32 y1) {
+    const S32 colBegin = std::max(x0 - blockX, 0);
+    const S32 colEnd = std::min(x1 - blockX + 1, BLOCK_SIZE);
+    const S32 rowBegin = std::max(y0 - blockY, 0);
+    const S32 rowEnd = std::min(y1 - blockY + 1, BLOCK_SIZE);
+    if (colBegin >= colEnd || rowBegin >= rowEnd) {
+        return 0;
+    }
+    const U64 row = ((1ULL << colEnd) - 1) & ~((1ULL << colBegin) - 1);
+    U64 mask = 0;
+    for (S32 y = rowBegin; y < rowEnd; y++) {
+        mask |= row << (y * BLOCK_SIZE);
+    }
+    return mask;
+}
+
+static F32 getClipDistance(const F32* v, int plane) {
+    switch (plane) {
+    case 0:  return v[3] - CLIP_EPSILON;
+    case 1:  return CLIP_GUARD_BAND * v[3] - v[0];
+    case 2:  return CLIP_GUARD_BAND * v[3] + v[0];
+    case 3:  return CLIP_GUARD_BAND * v[3] - v[1];
+    default: return CLIP_GUARD_BAND * v[3] + v[1];
+    }
+}
+
+// Interpolate from a vertex inside a plane towards one outside, so shared edges clip identically
+static void lerpVertex(F32* dst, const F32* inside, const F32* outside, F32 t, Size stride) {
+    for (Size i = 0; i < stride; i++) {
+        dst[i] = inside[i] + (outside[i] - inside[i]) * t;
+    }
+}
+
+SoftwareRasterizer::SoftwareRasterizer(Size threadCount)
+    : pool(threadCount), batch(std::make_unique<Batch>()) {
+}
+
+SoftwareRasterizer::~SoftwareRasterizer() {
+}
+
+void SoftwareRasterizer::clearColor(SoftwareTexture* texture, const F32* color) {
+    if (!texture || !texture->texelSize) {
+        return;
+    }
+    flush();
+    std::vector<Byte> texel(texture->texelSize);
+    encodeFormat(texture->format, color, texel.data());
+
+    // Clear bands of rows in parallel
+    const U32 bandHeight = SOFTWARE_TILE_SIZE;
+    for (U32 y0 = 0; y0 < texture->height; y0 += bandHeight) {
+        pool.submit([texture, &texel, y0, bandHeight] {
+            const U32 y1 = std::min(y0 + bandHeight, texture->height);
+            for (U32 y = y0; y < y1; y++) {
+                for (U32 x = 0; x < texture->width; x++) {
+                    memcpy(texture->getTexel(x, y), texel.data(), texel.size());
+                }
+            }
+        });
+    }
+    pool.wait();
+}
+
+void SoftwareRasterizer::clearDepthStencil(SoftwareTexture* texture, F32 depth, U08 stencil) {
+    const F32 value[4] = { depth, F32(stencil), 0.0f, 0.0f };
+    clearColor(texture, value);
+}
+
+void SoftwareRasterizer::draw(const SoftwareDraw& draw) {
+    const auto& state = *draw.state;
+    const auto* pipeline = state.pipeline;
+    if (!pipeline || !pipeline->vs || !pipeline->ps || !pipeline->vs->valid || !pipeline->ps->valid) {
+        return;
+    }
+
+    // Binned draws must share their targets
+    auto& b = *batch;
+    bool sameTargets = (b.depthTarget == state.depthTarget);
+    for (Size i = 0; i < SOFTWARE_MAX_COLOR_TARGETS; i++) {
+        sameTargets &= (b.colorTargets[i] == state.colorTargets[i]);
+    }
+    if (!sameTargets) {
+        flush();
+        S32 width = S32(0x7FFFFFFF);
+        S32 height = S32(0x7FFFFFFF);
+        bool hasTargets = false;
+        for (Size i = 0; i < SOFTWARE_MAX_COLOR_TARGETS; i++) {
+            b.colorTargets[i] = state.colorTargets[i];
+            if (state.colorTargets[i]) {
+                width = std::min(width, S32(state.colorTargets[i]->width));
+                height = std::min(height, S32(state.colorTargets[i]->height));
+                hasTargets = true;
+            }
+        }
+        b.depthTarget = state.depthTarget;
+        if (state.depthTarget) {
+            width = std::min(width, S32(state.depthTarget->width));
+            height = std::min(height, S32(state.depthTarget->height));
+            hasTargets = true;
+        }
+        b.width = hasTargets ? width : 0;
+        b.height = hasTargets ? height : 0;
+        b.tilesX = (b.width + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE;
+        b.tilesY = (b.height + SOFTWARE_TILE_SIZE - 1) / SOFTWARE_TILE_SIZE;
+        b.bins.resize(b.tilesX * b.tilesY);
+    }
+    if (b.width <= 0 || b.height <= 0) {
+        return;
+    }
+
+    DrawInfo info = {};
+    info.state = draw.state;
+    info.pipeline = pipeline;
+    info.vs = pipeline->vs;
+    info.ps = pipeline->ps;
+    info.vsPositionReg = info.vs->findOutput(ShaderVariable::KIND_BUILTIN, hir::BUILTIN_POSITION);
+    if (info.vsPositionReg < 0) {
+        return;
+    }
+    info.vsVertexIdReg = -1;
+    info.vsInstanceIdReg = -1;
+    for (const auto& input : info.vs->inputs) {
+        if (input.kind == ShaderVariable::KIND_BUILTIN) {
+            if (input.index == hir::BUILTIN_VERTEXID || input.index == hir::BUILTIN_VERTEXINDEX) {
+                info.vsVertexIdReg = input.reg;
+            }
+            if (input.index == hir::BUILTIN_INSTANCEID || input.index == hir::BUILTIN_INSTANCEINDEX) {
+                info.vsInstanceIdReg = input.reg;
+            }
+        }
+    }
+    info.psFragCoordReg = -1;
+    info.psFrontFacingReg = -1;
+    for (const auto& input : info.ps->inputs) {
+        if (input.kind == ShaderVariable::KIND_BUILTIN) {
+            if (input.index == hir::BUILTIN_FRAGCOORD) {
+                info.psFragCoordReg = input.reg;
+            }
+            if (input.index == hir::BUILTIN_FRONTFACING) {
+                info.psFrontFacingReg = input.reg;
+            }
+        } else if (info.varyingCount < SOFTWARE_MAX_VARYINGS) {
+            info.vsVaryingRegs[info.varyingCount] = info.vs->findOutput(ShaderVariable::KIND_LOCATION, input.index);
+            info.psVaryingRegs[info.varyingCount] = input.reg;
+            info.varyingCount++;
+        }
+    }
+    for (Size i = 0; i < SOFTWARE_MAX_COLOR_TARGETS; i++) {
+        info.psColorRegs[i] = info.ps->findOutput(ShaderVariable::KIND_LOCATION, U32(i));
+    }
+    info.psDepthReg = info.ps->findOutput(ShaderVariable::KIND_BUILTIN, hir::BUILTIN_FRAGDEPTH);
+    info.earlyDepth = !info.ps->usesKill && info.psDepthReg < 0;
+    info.stride = 4 + 4 * info.varyingCount;
+
+    const auto& viewport = state.viewport;
+    info.scaleX = viewport.width * 0.5f;
+    info.scaleY = viewport.height * 0.5f;
+    info.offsetX = viewport.originX + info.scaleX;
+    info.offsetY = viewport.originY + info.scaleY;
+    info.scaleZ = viewport.maxDepth - viewport.minDepth;
+    info.offsetZ = viewport.minDepth;
+    info.minZ = std::min(viewport.minDepth, viewport.maxDepth);
+    info.maxZ = std::max(viewport.minDepth, viewport.maxDepth);
+
+    info.clipX0 = std::max(0, S32(std::floor(viewport.originX)));
+    info.clipY0 = std::max(0, S32(std::floor(viewport.originY)));
+    info.clipX1 = std::min(b.width, S32(std::ceil(viewport.originX + viewport.width))) - 1;
+    info.clipY1 = std::min(b.height, S32(std::ceil(viewport.originY + viewport.height))) - 1;
+    if (state.hasScissor) {
+        info.clipX0 = std::max(info.clipX0, state.scissor.left);
+        info.clipY0 = std::max(info.clipY0, state.scissor.top);
+        info.clipX1 = std::min(info.clipX1, state.scissor.right - 1);
+        info.clipY1 = std::min(info.clipY1, state.scissor.bottom - 1);
+    }
+    if (info.clipX0 > info.clipX1 || info.clipY0 > info.clipY1) {
+        return;
+    }
+
+    // Vertices to shade, and the element of each primitive vertex among them
+    std::vector<U32> vertexIds;
+    std::vector<U32> elements;
+    std::vector<Size> restarts;
+    if (draw.indexed) {
+        const auto* buffer = state.indexBuffer;
+        if (!buffer) {
+            return;
+        }
+        const Size indexSize = (state.indexFormat == INDEX_FORMAT_UINT16) ? 2 : 4;
+        const U32 restartIndex = (indexSize == 2) ? 0xFFFF : 0xFFFFFFFF;
+        const bool restart = info.pipeline->desc.iaState.primitiveRestart;
+        std::vector<U32> indices;
+        indices.reserve(draw.count);
+        U32 minIndex = ~0U;
+        U32 maxIndex = 0;
+        for (U32 i = 0; i < draw.count; i++) {
+            const Size address = state.indexOffset + Size(draw.first + i) * indexSize;
+            if (address + indexSize > buffer->data.size()) {
+                break;
+            }
+            U32 index;
+            if (indexSize == 2) {
+                U16 value;
+                memcpy(&value, &buffer->data[address], sizeof(value));
+                index = value;
+            } else {
+                memcpy(&index, &buffer->data[address], sizeof(index));
+            }
+            // Restart indices end the current primitive and are never fetched
+            if (restart && index == restartIndex) {
+                restarts.push_back(indices.size());
+                continue;
+            }
+            index += draw.vertexOffset;
+            indices.push_back(index);
+            minIndex = std::min(minIndex, index);
+            maxIndex = std::max(maxIndex, index);
+        }
+        if (indices.empty()) {
+            return;
+        }
+        // Shade the referenced range once if it is compact, every index otherwise
+        if (Size(maxIndex - minIndex) < 2 * indices.size() + SHADER_LANES) {
+            for (U32 index = minIndex; index <= maxIndex && index >= minIndex; index++) {
+                vertexIds.push_back(index);
+            }
+            for (const auto index : indices) {
+                elements.push_back(index - minIndex);
+            }
+        } else {
+            vertexIds = indices;
+            for (U32 i = 0; i < indices.size(); i++) {
+                elements.push_back(i);
+            }
+        }
+    } else {
+        for (U32 i = 0; i < draw.count; i++) {
+            vertexIds.push_back(draw.first + i);
+            elements.push_back(i);
+        }
+    }
+
+    const U32 drawIndex = U32(b.draws.size());
+    b.draws.push_back(info);
+    const DrawInfo& drawInfo = b.draws.back();
+
+    std::vector<F32> vertices;
+    const U32 instanceCount = std::max<U32>(draw.instanceCount, 1);
+    for (U32 instance = draw.firstInstance; instance < draw.firstInstance + instanceCount; instance++) {
+        shadeVertices(drawInfo, instance, vertexIds, vertices);
+        Size begin = 0;
+        for (const auto end : restarts) {
+            assemble(drawInfo, drawIndex, vertices, elements, begin, end);
+            begin = end;
+        }
+        assemble(drawInfo, drawIndex, vertices, elements, begin, elements.size());
+    }
+}
+
+static void shadeVertexRange(const SoftwarePipeline& pipeline, const SoftwareDrawState& state, int positionReg,
+        int vertexIdReg, int instanceIdReg, const int* varyingRegs, U32 varyingCount, Size stride,
+        U32 instance, const std::vector<U32>& vertexIds, Size begin, Size end, F32* output) {
+    const auto& layout = pipeline.desc.iaState.inputLayout;
+    const auto* vs = pipeline.vs;
+    std::vector<ShaderRegister> regs;
+    vs->prepare(regs);
+
+    for (Size base = begin; base < end; base += SHADER_LANES) {
+        const Size lanes = std::min<Size>(SHADER_LANES, end - base);
+
+        // Fetch attributes
+        for (Size e = 0; e < layout.size() && e < pipeline.inputRegs.size(); e++) {
+            const int reg = pipeline.inputRegs[e];
+            if (reg < 0) {
+                continue;
+            }
+            const auto& element = layout[e];
+            const auto& stream = state.streams[element.inputSlot % SOFTWARE_MAX_VERTEX_BUFFERS];
+            const Size size = getFormatSize(element.format);
+            const Size elementStride = stream.stride ? stream.stride : element.stride;
+            auto& r = regs[reg];
+            for (Size l = 0; l < lanes; l++) {
+                F32 value[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+                U32 index = vertexIds[base + l];
+                if (element.inputClassification == INPUT_CLASSIFICATION_PER_INSTANCE) {
+                    index = element.instanceStepRate ? (instance / element.instanceStepRate) : 0;
+                }
+                if (stream.buffer && size) {
+                    const Size address = stream.offset + element.offset + Size(index) * elementStride;
+                    if (address + size <= stream.buffer->data.size()) {
+                        decodeFormat(element.format, &stream.buffer->data[address], value);
+                    }
+                }
+                for (Size k = 0; k < 4; k++) {
+                    r.c[k][l] = value[k];
+                }
+            }
+        }
+        for (Size l = 0; l < lanes; l++) {
+            for (Size k = 0; k < 4; k++) {
+                if (vertexIdReg >= 0) {
+                    regs[vertexIdReg].c[k][l] = F32(vertexIds[base + l]);
+                }
+                if (instanceIdReg >= 0) {
+                    regs[instanceIdReg].c[k][l] = F32(instance);
+                }
+            }
+        }
+
+        U32 mask = (1 << lanes) - 1;
+        vs->execute(regs.data(), state.resources, mask);
+
+        for (Size l = 0; l < lanes; l++) {
+            F32* out = &output[(base + l) * stride];
+            for (Size k = 0; k < 4; k++) {
+                out[k] = regs[positionReg].c[k][l];
+            }
+            for (U32 v = 0; v < varyingCount; v++) {
+                const int reg = varyingRegs[v];
+                for (Size k = 0; k < 4; k++) {
+                    out[4 + 4 * v + k] = (reg >= 0) ? regs[reg].c[k][l] : 0.0f;
+                }
+            }
+        }
+    }
+}
+
+void SoftwareRasterizer::shadeVertices(const DrawInfo& info, U32 instance,
+        const std::vector<U32>& vertexIds, std::vector<F32>& output) {
+    output.resize(vertexIds.size() * info.stride);
+    auto shadeRange = [&info, instance, &vertexIds, &output](Size begin, Size end) {
+        shadeVertexRange(*info.pipeline, *info.state, info.vsPositionReg, info.vsVertexIdReg,
+            info.vsInstanceIdReg, info.vsVaryingRegs, info.varyingCount, info.stride,
+            instance, vertexIds, begin, end, output.data());
+    };
+
+    // Small draws are not worth waking up the workers
+    if (vertexIds.size() <= VERTEX_CHUNK_SIZE) {
+        shadeRange(0, vertexIds.size());
+        return;
+    }
+    for (Size begin = 0; begin < vertexIds.size(); begin += VERTEX_CHUNK_SIZE) {
+        const Size end = std::min(begin + VERTEX_CHUNK_SIZE, vertexIds.size());
+        pool.submit([&shadeRange, begin, end] {
+            shadeRange(begin, end);
+        });
+    }
+    pool.wait();
+}
+
+void SoftwareRasterizer::assemble(const DrawInfo& info, U32 drawIndex, const std::vector<F32>& vertices,
+        const std::vector<U32>& elements, Size begin, Size end) {
+    auto vertex = [&](Size i) {
+        return &vertices[Size(elements[begin + i]) * info.stride];
+    };
+    const Size n = end - begin;
+    switch (info.state->topology) {
+    case TOPOLOGY_POINT_LIST:
+        for (Size i = 0; i < n; i++) {
+            setupPoint(info, drawIndex, vertex(i));
+        }
+        break;
+    case TOPOLOGY_LINE_LIST:
+        for (Size i = 0; i + 1 < n; i += 2) {
+            clipLine(info, drawIndex, vertex(i), vertex(i + 1));
+        }
+        break;
+    case TOPOLOGY_LINE_LOOP:
+    case TOPOLOGY_LINE_STRIP:
+        for (Size i = 0; i + 1 < n; i++) {
+            clipLine(info, drawIndex, vertex(i), vertex(i + 1));
+        }
+        if (info.state->topology == TOPOLOGY_LINE_LOOP && n > 2) {
+            clipLine(info, drawIndex, vertex(n - 1), vertex(0));
+        }
+        break;
+    case TOPOLOGY_TRIANGLE_LIST:
+        for (Size i = 0; i + 2 < n; i += 3) {
+            clipTriangle(info, drawIndex, vertex(i), vertex(i + 1), vertex(i + 2));
+        }
+        break;
+    case TOPOLOGY_TRIANGLE_STRIP:
+        for (Size i = 0; i + 2 < n; i++) {
+            if (i & 1) {
+                clipTriangle(info, drawIndex, vertex(i + 1), vertex(i), vertex(i + 2));
+            } else {
+                clipTriangle(info, drawIndex, vertex(i), vertex(i + 1), vertex(i + 2));
+            }
+        }
+        break;
+    case TOPOLOGY_QUAD_LIST:
+        for (Size i = 0; i + 3 < n; i += 4) {
+            clipTriangle(info, drawIndex, vertex(i), vertex(i + 1), vertex(i + 2));
+            clipTriangle(info, drawIndex, vertex(i), vertex(i + 2), vertex(i + 3));
+        }
+        break;
+    case TOPOLOGY_QUAD_STRIP:
+        for (Size i = 0; i + 3 < n; i += 2) {
+            clipTriangle(info, drawIndex, vertex(i), vertex(i + 1), vertex(i + 3));
+            clipTriangle(info, drawIndex, vertex(i), vertex(i + 3), vertex(i + 2));
+        }
+        break;
+    }
+}
+
+void SoftwareRasterizer::clipTriangle(const DrawInfo& info, U32 drawIndex, const F32* v0, const F32* v1, const F32* v2) {
+    auto project = [&info](const F32* v) {
+        const F32 invW = 1.0f / v[3];
+        return ScreenVertex{
+            info.offsetX + v[0] * invW * info.scaleX,
+            info.offsetY + v[1] * invW * info.scaleY,
+            info.offsetZ + v[2] * invW * info.scaleZ,
+            invW, v + 4 };
+    };
+
+    bool inside = true;
+    for (int plane = 0; plane < CLIP_PLANES; plane++) {
+        inside &= getClipDistance(v0, plane) >= 0.0f;
+        inside &= getClipDistance(v1, plane) >= 0.0f;
+        inside &= getClipDistance(v2, plane) >= 0.0f;
+    }
+    if (inside) {
+        setupTriangle(info, drawIndex, project(v0), project(v1), project(v2), true);
+        return;
+    }
+
+    // Each plane adds at most one vertex to the polygon and creates at most two
+    std::vector<F32> storage((3 + 2 * CLIP_PLANES) * info.stride);
+    Size used = 0;
+    std::vector<const F32*> polygon = { v0, v1, v2 };
+    std::vector<const F32*> clipped;
+    for (int plane = 0; plane < CLIP_PLANES; plane++) {
+        clipped.clear();
+        for (Size i = 0; i < polygon.size(); i++) {
+            const F32* cur = polygon[i];
+            const F32* next = polygon[(i + 1) % polygon.size()];
+            const F32 dc = getClipDistance(cur, plane);
+            const F32 dn = getClipDistance(next, plane);
+            if (dc >= 0.0f) {
+                clipped.push_back(cur);
+            }
+            if ((dc >= 0.0f) != (dn >= 0.0f)) {
+                F32* vertex = &storage[used++ * info.stride];
+                if (dc >= 0.0f) {
+                    lerpVertex(vertex, cur, next, dc / (dc - dn), info.stride);
+                } else {
+                    lerpVertex(vertex, next, cur, dn / (dn - dc), info.stride);
+                }
+                clipped.push_back(vertex);
+            }
+        }
+        std::swap(polygon, clipped);
+        if (polygon.size() < 3) {
+            return;
+        }
+    }
+    for (Size i = 1; i + 1 < polygon.size(); i++) {
+        setupTriangle(info, drawIndex, project(polygon[0]), project(polygon[i]), project(polygon[i + 1]), true);
+    }
+}
+
+void SoftwareRasterizer::clipLine(const DrawInfo& info, U32 drawIndex, const F32* v0, const F32* v1) {
+    F32 t0 = 0.0f;
+    F32 t1 = 1.0f;
+    for (int plane = 0; plane < CLIP_PLANES; plane++) {
+        const F32 d0 = getClipDistance(v0, plane);
+        const F32 d1 = getClipDistance(v1, plane);
+        if (d0 < 0.0f && d1 < 0.0f) {
+            return;
+        }
+        if (d0 < 0.0f) {
+            t0 = std::max(t0, d0 / (d0 - d1));
+        } else if (d1 < 0.0f) {
+            t1 = std::min(t1, d0 / (d0 - d1));
+        }
+    }
+    if (t0 > t1) {
+        return;
+    }
+    std::vector<F32> storage(2 * info.stride);
+    lerpVertex(&storage[0], v0, v1, t0, info.stride);
+    lerpVertex(&storage[info.stride], v0, v1, t1, info.stride);
+
+    ScreenVertex ends[2];
+    for (Size i = 0; i < 2; i++) {
+        const F32* v = &storage[i * info.stride];
+        const F32 invW = 1.0f / v[3];
+        ends[i] = {
+            info.offsetX + v[0] * invW * info.scaleX,
+            info.offsetY + v[1] * invW * info.scaleY,
+            info.offsetZ + v[2] * invW * info.scaleZ,
+            invW, v + 4 };
+    }
+    setupLine(info, drawIndex, ends[0], ends[1]);
+}
+
+void SoftwareRasterizer::setupPoint(const DrawInfo& info, U32 drawIndex, const F32* v) {
+    for (int plane = 0; plane < CLIP_PLANES; plane++) {
+        if (getClipDistance(v, plane) < 0.0f) {
+            return;
+        }
+    }
+    const F32 invW = 1.0f / v[3];
+    const ScreenVertex center = {
+        info.offsetX + v[0] * invW * info.scaleX,
+        info.offsetY + v[1] * invW * info.scaleY,
+        info.offsetZ + v[2] * invW * info.scaleZ,
+        invW, v + 4 };
+
+    // Points are squares of one pixel
+    ScreenVertex corners[4] = { center, center, center, center };
+    corners[0].x -= 0.5f; corners[0].y -= 0.5f;
+    corners[1].x += 0.5f; corners[1].y -= 0.5f;
+    corners[2].x += 0.5f; corners[2].y += 0.5f;
+    corners[3].x -= 0.5f; corners[3].y += 0.5f;
+    setupTriangle(info, drawIndex, corners[0], corners[1], corners[2], false);
+    setupTriangle(info, drawIndex, corners[0], corners[2], corners[3], false);
+}
+
+void SoftwareRasterizer::setupLine(const DrawInfo& info, U32 drawIndex, const ScreenVertex& a, const ScreenVertex& b) {
+    const F32 dx = b.x - a.x;
+    const F32 dy = b.y - a.y;
+    const F32 length = std::sqrt(dx * dx + dy * dy);
+    if (length == 0.0f) {
+        return;
+    }
+
+    // Lines are rectangles of one pixel of width
+    const F32 nx = -dy / length * 0.5f;
+    const F32 ny = dx / length * 0.5f;
+    ScreenVertex a0 = a, a1 = a, b0 = b, b1 = b;
+    a0.x += nx; a0.y += ny;
+    a1.x -= nx; a1.y -= ny;
+    b0.x += nx; b0.y += ny;
+    b1.x -= nx; b1.y -= ny;
+    setupTriangle(info, drawIndex, a0, a1, b1, false);
+    setupTriangle(info, drawIndex, a0, b1, b0, false);
+}
+
+void SoftwareRasterizer::setupTriangle(const DrawInfo& info, U32 drawIndex, ScreenVertex a, ScreenVertex b, ScreenVertex c, bool isPolygon) {
+    auto& batch = *this->batch;
+    const auto& rsState = info.pipeline->desc.rsState;
+
+    S32 x[3], y[3];
+    const ScreenVertex* v[3] = { &a, &b, &c };
+    for (Size i = 0; i < 3; i++) {
+        x[i] = S32(std::floor(v[i]->x * SUBPIXEL_ONE + 0.5f));
+        y[i] = S32(std::floor(v[i]->y * SUBPIXEL_ONE + 0.5f));
+    }
+    S64 area = S64(x[1] - x[0]) * (y[2] - y[0]) - S64(x[2] - x[0]) * (y[1] - y[0]);
+    if (area == 0) {
+        return;
+    }
+
+    // Orientation follows the Vulkan convention: with y pointing down, a negative area
+    // computed above is counter-clockwise
+    bool frontFacing = true;
+    if (isPolygon) {
+        const bool counterClockwise = (area < 0);
+        frontFacing = (counterClockwise == rsState.frontCounterClockwise);
+        if ((rsState.cullMode == CULL_MODE_FRONT && frontFacing) ||
+            (rsState.cullMode == CULL_MODE_BACK && !frontFacing)) {
+            return;
+        }
+        if (rsState.fillMode == FILL_MODE_WIREFRAME) {
+            setupLine(info, drawIndex, a, b);
+            setupLine(info, drawIndex, b, c);
+            setupLine(info, drawIndex, c, a);
+            return;
+        }
+    }
+    if (area < 0) {
+        std::swap(v[1], v[2]);
+        std::swap(x[1], x[2]);
+        std::swap(y[1], y[2]);
+        area = -area;
+    }
+
+    // Pixels whose centers lie within the bounding box
+    Triangle tri;
+    tri.minX = ceilShift(S64(std::min({ x[0], x[1], x[2] })) - SUBPIXEL_HALF);
+    tri.minY = ceilShift(S64(std::min({ y[0], y[1], y[2] })) - SUBPIXEL_HALF);
+    tri.maxX = floorShift(S64(std::max({ x[0], x[1], x[2] })) - SUBPIXEL_HALF);
+    tri.maxY = floorShift(S64(std::max({ y[0], y[1], y[2] })) - SUBPIXEL_HALF);
+    tri.minX = std::max(tri.minX, info.clipX0);
+    tri.minY = std::max(tri.minY, info.clipY0);
+    tri.maxX = std::min(tri.maxX, info.clipX1);
+    tri.maxY = std::min(tri.maxY, info.clipY1);
+    if (tri.minX > tri.maxX || tri.minY > tri.maxY) {
+        return;
+    }
+
+    for (Size i = 0; i < 3; i++) {
+        tri.x[i] = x[i];
+        tri.y[i] = y[i];
+        tri.z[i] = v[i]->z;
+        tri.invW[i] = v[i]->invW;
+    }
+    tri.area = area;
+    tri.draw = drawIndex;
+    tri.frontFacing = frontFacing;
+    tri.attributes = batch.attributes.size();
+    const Size varyingFloats = 4 * info.varyingCount;
+    for (Size i = 0; i < 3; i++) {
+        for (Size k = 0; k < varyingFloats; k++) {
+            batch.attributes.push_back(v[i]->varyings[k] * v[i]->invW);
+        }
+    }
+
+    const U32 index = U32(batch.triangles.size());
+    batch.triangles.push_back(tri);
+    for (S32 ty = tri.minY / SOFTWARE_TILE_SIZE; ty <= tri.maxY / SOFTWARE_TILE_SIZE; ty++) {
+        for (S32 tx = tri.minX / SOFTWARE_TILE_SIZE; tx <= tri.maxX / SOFTWARE_TILE_SIZE; tx++) {
+            batch.bins[ty * batch.tilesX + tx].push_back(index);
+        }
+    }
+}
+
+void SoftwareRasterizer::rasterizeTile(U32 tileIndex) {
+    const auto& batch = *this->batch;
+    const auto& bin = batch.bins[tileIndex];
+    if (bin.empty()) {
+        return;
+    }
+    const S32 tileX0 = (tileIndex % batch.tilesX) * SOFTWARE_TILE_SIZE;
+    const S32 tileY0 = (tileIndex / batch.tilesX) * SOFTWARE_TILE_SIZE;
+    const S32 tileX1 = std::min(tileX0 + SOFTWARE_TILE_SIZE, batch.width) - 1;
+    const S32 tileY1 = std::min(tileY0 + SOFTWARE_TILE_SIZE, batch.height) - 1;
+
+    std::vector<ShaderRegister> regs;
+    const SoftwareShader* preparedShader = nullptr;
+
+    for (const U32 triIndex : bin) {
+        const Triangle& tri = batch.triangles[triIndex];
+        const DrawInfo& info = batch.draws[tri.draw];
+        const auto& rsState = info.pipeline->desc.rsState;
+        const auto& cbState = info.pipeline->desc.cbState;
+        const auto* ps = info.ps;
+        if (ps != preparedShader) {
+            ps->prepare(regs);
+            preparedShader = ps;
+        }
+
+        const S32 x0 = std::max(tri.minX, tileX0);
+        const S32 y0 = std::max(tri.minY, tileY0);
+        const S32 x1 = std::min(tri.maxX, tileX1);
+        const S32 y1 = std::min(tri.maxY, tileY1);
+        if (x0 > x1 || y0 > y1) {
+            continue;
+        }
+
+        // Edge functions E(p) = A * (p.x - a.x) + B * (p.y - a.y), positive inside. Pixels on an
+        // edge are covered only if it is a top or left edge, so that adjacent triangles never overlap.
+        S64 stepX[3], stepY[3], edgeRow[3], threshold[3];
+        const S32 blockX0 = x0 & ~(BLOCK_SIZE - 1);
+        const S32 blockY0 = y0 & ~(BLOCK_SIZE - 1);
+        for (Size e = 0; e < 3; e++) {
+            const Size i = e;
+            const Size j = (e + 1) % 3;
+            const S64 edgeA = tri.y[i] - tri.y[j];
+            const S64 edgeB = tri.x[j] - tri.x[i];
+            threshold[e] = (edgeA > 0 || (edgeA == 0 && edgeB > 0)) ? 0 : 1;
+            stepX[e] = edgeA * SUBPIXEL_ONE;
+            stepY[e] = edgeB * SUBPIXEL_ONE;
+            edgeRow[e] = edgeA * (S64(blockX0) * SUBPIXEL_ONE + SUBPIXEL_HALF - tri.x[i]) +
+                         edgeB * (S64(blockY0) * SUBPIXEL_ONE + SUBPIXEL_HALF - tri.y[i]);
+        }
+
+        const F32 invArea = 1.0f / F32(tri.area);
+        const F32* attr0 = &batch.attributes[tri.attributes];
+        const F32* attr1 = attr0 + 4 * info.varyingCount;
+        const F32* attr2 = attr1 + 4 * info.varyingCount;
+
+        SoftwareTexture* depthTarget = rsState.depthEnable ? batch.depthTarget : nullptr;
+        const bool depthWrite = rsState.depthWriteMask == DEPTH_WRITE_MASK_ALL;
+
+        // Test depth of the lanes in the mask, writing the values that pass
+        auto testDepth = [&](U32 mask, S32 bx, S32 by, const F32* z) -> U32 {
+            if (!depthTarget) {
+                return mask;
+            }
+            for (Size l = 0; l < SHADER_LANES; l++) {
+                if (!(mask & (1 << l))) {
+                    continue;
+                }
+                Byte* texel = depthTarget->getTexel(bx + (l & 3), by + (l >> 2));
+                U32 src, dst, stored;
+                switch (depthTarget->format) {
+                case FORMAT_D16_UNORM: {
+                    U16 value;
+                    memcpy(&value, texel, sizeof(value));
+                    dst = value;
+                    src = toUnorm(z[l], 0xFFFF);
+                    stored = src;
+                    break;
+                }
+                case FORMAT_D24_UNORM_S8_UINT: {
+                    U32 value;
+                    memcpy(&value, texel, sizeof(value));
+                    dst = value & 0xFFFFFF;
+                    src = toUnorm(z[l], 0xFFFFFF);
+                    stored = (value & 0xFF000000) | src;
+                    break;
+                }
+                default:
+                    continue;
+                }
+                if (!compare(rsState.depthFunc, src, dst)) {
+                    mask &= ~(1 << l);
+                } else if (depthWrite) {
+                    memcpy(texel, &stored, getFormatSize(depthTarget->format));
+                }
+            }
+            return mask;
+        };
+
+        for (S32 blockY = blockY0; blockY <= y1; blockY += BLOCK_SIZE) {
+            S64 edgeBlock[3] = { edgeRow[0], edgeRow[1], edgeRow[2] };
+            for (S32 blockX = blockX0; blockX <= x1; blockX += BLOCK_SIZE) {
+                const S64 edge[3] = { edgeBlock[0], edgeBlock[1], edgeBlock[2] };
+                for (Size e = 0; e < 3; e++) {
+                    edgeBlock[e] += stepX[e] * BLOCK_SIZE;
+                }
+                const U64 coverage = getBlockCoverage(edge, stepX, stepY, threshold) &
+                    getBlockRectMask(blockX, blockY, x0, y0, x1, y1);
+                if (!coverage) {
+                    continue;
+                }
+
+                // Shade the covered blocks of 4x2 pixels, one per shader lane
+                for (S32 qy = 0; qy < BLOCK_SIZE; qy += 2) {
+                    for (S32 qx = 0; qx < BLOCK_SIZE; qx += 4) {
+                        U32 mask = U32((coverage >> (qy * BLOCK_SIZE + qx)) & 0xF) |
+                                  (U32((coverage >> ((qy + 1) * BLOCK_SIZE + qx)) & 0xF) << 4);
+                        if (!mask) {
+                            continue;
+                        }
+                        const S32 bx = blockX + qx;
+                        const S32 by = blockY + qy;
+                        F32 w0[SHADER_LANES], w1[SHADER_LANES], w2[SHADER_LANES];
+                        for (Size l = 0; l < SHADER_LANES; l++) {
+                            const S64 dx = qx + S64(l & 3);
+                            const S64 dy = qy + S64(l >> 2);
+                            w0[l] = F32(edge[1] + stepX[1] * dx + stepY[1] * dy) * invArea;
+                            w1[l] = F32(edge[2] + stepX[2] * dx + stepY[2] * dy) * invArea;
+                            w2[l] = F32(edge[0] + stepX[0] * dx + stepY[0] * dy) * invArea;
+                        }
+
+                        // Depth is interpolated linearly in screen space, other values with perspective
+                        F32 z[SHADER_LANES], invW[SHADER_LANES];
+                        for (Size l = 0; l < SHADER_LANES; l++) {
+                            z[l] = w0[l] * tri.z[0] + w1[l] * tri.z[1] + w2[l] * tri.z[2];
+                            invW[l] = w0[l] * tri.invW[0] + w1[l] * tri.invW[1] + w2[l] * tri.invW[2];
+                            if (z[l] < info.minZ || z[l] > info.maxZ) {
+                                mask &= ~(1 << l);
+                            }
+                        }
+                        if (info.earlyDepth) {
+                            mask = testDepth(mask, bx, by, z);
+                        }
+                        if (!mask) {
+                            continue;
+                        }
+
+                        for (U32 v = 0; v < info.varyingCount; v++) {
+                            const int reg = info.psVaryingRegs[v];
+                            for (Size k = 0; k < 4; k++) {
+                                const F32 a0 = attr0[4 * v + k];
+                                const F32 a1 = attr1[4 * v + k];
+                                const F32 a2 = attr2[4 * v + k];
+                                for (Size l = 0; l < SHADER_LANES; l++) {
+                                    regs[reg].c[k][l] = (w0[l] * a0 + w1[l] * a1 + w2[l] * a2) / invW[l];
+                                }
+                            }
+                        }
+                        if (info.psFragCoordReg >= 0) {
+                            auto& r = regs[info.psFragCoordReg];
+                            for (Size l = 0; l < SHADER_LANES; l++) {
+                                r.c[0][l] = F32(bx + S32(l & 3)) + 0.5f;
+                                r.c[1][l] = F32(by + S32(l >> 2)) + 0.5f;
+                                r.c[2][l] = z[l];
+                                r.c[3][l] = invW[l];
+                            }
+                        }
+                        if (info.psFrontFacingReg >= 0) {
+                            auto& r = regs[info.psFrontFacingReg];
+                            for (Size k = 0; k < 4; k++) {
+                                std::fill(std::begin(r.c[k]), std::end(r.c[k]), tri.frontFacing ? 1.0f : 0.0f);
+                            }
+                        }
+
+                        ps->execute(regs.data(), info.state->resources, mask);
+                        if (!mask) {
+                            continue;
+                        }
+                        if (info.psDepthReg >= 0) {
+                            for (Size l = 0; l < SHADER_LANES; l++) {
+                                z[l] = regs[info.psDepthReg].c[0][l];
+                            }
+                        }
+                        if (!info.earlyDepth) {
+                            mask = testDepth(mask, bx, by, z);
+                        }
+
+                        // Blending and output merging
+                        // TODO: Logic operations and stencil testing are unimplemented
+                        for (Size i = 0; i < SOFTWARE_MAX_COLOR_TARGETS; i++) {
+                            SoftwareTexture* target = batch.colorTargets[i];
+                            const int reg = info.psColorRegs[i];
+                            if (!target || reg < 0 || !target->texelSize) {
+                                continue;
+                            }
+                            const auto& blend = cbState.colorTarget[cbState.enableIndependentBlend ? i : 0];
+                            const bool clampSource = !isFloatFormat(target->format);
+                            const bool readTarget = blend.enableBlend || blend.colorWriteMask != COLOR_WRITE_ENABLE_ALL;
+                            for (Size l = 0; l < SHADER_LANES; l++) {
+                                if (!(mask & (1 << l))) {
+                                    continue;
+                                }
+                                Byte* texel = target->getTexel(bx + (l & 3), by + (l >> 2));
+                                F32 src[4], dst[4] = { 0.0f, 0.0f, 0.0f, 1.0f }, out[4];
+                                for (Size k = 0; k < 4; k++) {
+                                    src[k] = regs[reg].c[k][l];
+                                    if (clampSource) {
+                                        src[k] = std::min(std::max(src[k], 0.0f), 1.0f);
+                                    }
+                                }
+                                if (readTarget) {
+                                    decodeFormat(target->format, texel, dst);
+                                }
+                                for (Size k = 0; k < 4; k++) {
+                                    out[k] = src[k];
+                                    if (blend.enableBlend) {
+                                        const bool alpha = (k == 3);
+                                        const Blend srcBlend = alpha ? blend.srcBlendAlpha : blend.srcBlend;
+                                        const Blend dstBlend = alpha ? blend.destBlendAlpha : blend.destBlend;
+                                        out[k] = getBlendResult(alpha ? blend.blendOpAlpha : blend.blendOp, src[k], dst[k],
+                                            getBlendFactor(srcBlend, src, dst, k),
+                                            getBlendFactor(dstBlend, src, dst, k));
+                                    }
+                                    if (!(blend.colorWriteMask & (1 << k))) {
+                                        out[k] = dst[k];
+                                    }
+                                }
+                                encodeFormat(target->format, out, texel);
+                            }
+                        }
+                    }
+                }
+            }
+            for (Size e = 0; e < 3; e++) {
+                edgeRow[e] += stepY[e] * BLOCK_SIZE;
+            }
+        }
+    }
+}
+
+void SoftwareRasterizer::flush() {
+    auto& b = *batch;
+    if (!b.triangles.empty()) {
+        const U32 tileCount = U32(b.tilesX * b.tilesY);
+        std::atomic<U32> nextTile(0);
+        for (Size i = 0; i < pool.getThreadCount(); i++) {
+            pool.submit([this, &nextTile, tileCount] {
+                for (U32 tile = nextTile++; tile < tileCount; tile = nextTile++) {
+                    rasterizeTile(tile);
+                }
+            });
+        }
+        pool.wait();
+    }
+    for (auto& bin : b.bins) {
+        bin.clear();
+    }
+    b.draws.clear();
+    b.triangles.clear();
+    b.attributes.clear();
+}
+
+}  // namespace software
+}  // namespace gfx
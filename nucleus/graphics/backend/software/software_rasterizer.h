@@ -0,0 +1,113 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/common.h"
+#include "nucleus/core/worker_pool.h"
+#include "nucleus/graphics/primitive.h"
+#include "nucleus/graphics/rectangle.h"
+#include "nucleus/graphics/viewport.h"
+#include "nucleus/graphics/backend/software/software_pipeline.h"
+#include "nucleus/graphics/backend/software/software_shader.h"
+#include "nucleus/graphics/backend/software/software_texture.h"
+#include "nucleus/graphics/backend/software/software_vertex_buffer.h"
+
+#include <memory>
+#include <vector>
+
+namespace gfx {
+namespace software {
+
+// Maximum number of color targets and vertex buffer slots
+constexpr Size SOFTWARE_MAX_COLOR_TARGETS = 8;
+constexpr Size SOFTWARE_MAX_VERTEX_BUFFERS = 16;
+
+// Pixels covered by each tile
+constexpr S32 SOFTWARE_TILE_SIZE = 64;
+
+struct SoftwareVertexStream {
+    const SoftwareVertexBuffer* buffer;
+    U32 offset;
+    U32 stride;
+};
+
+// State read by draws, shared by consecutive draws until a command changes it
+struct SoftwareDrawState {
+    const SoftwarePipeline* pipeline = nullptr;
+    PrimitiveTopology topology = TOPOLOGY_TRIANGLE_LIST;
+
+    SoftwareTexture* colorTargets[SOFTWARE_MAX_COLOR_TARGETS] = {};
+    SoftwareTexture* depthTarget = nullptr;
+    Viewport viewport = {};
+    Rectangle scissor = {};
+    bool hasScissor = false;
+
+    SoftwareVertexStream streams[SOFTWARE_MAX_VERTEX_BUFFERS] = {};
+    const SoftwareVertexBuffer* indexBuffer = nullptr;
+    U32 indexOffset = 0;
+    IndexFormat indexFormat = INDEX_FORMAT_UINT16;
+
+    // Constant buffers are copied when the draw is recorded, since callers rewrite them between draws
+    std::vector<std::vector<Byte>> constants;
+    ShaderResources resources = {};
+};
+
+struct SoftwareDraw {
+    std::shared_ptr<const SoftwareDrawState> state;
+    bool indexed;
+    U32 first;
+    U32 count;
+    S32 vertexOffset;
+    U32 firstInstance;
+    U32 instanceCount;
+};
+
+/**
+ * Software rasterizer
+ * ===================
+ * Draws are shaded and set up as they arrive, and their triangles are binned into tiles of
+ * SOFTWARE_TILE_SIZE pixels. Binned work is rasterized when the targets change or on flush:
+ * workers take whole tiles, so each pixel is owned by a single thread and triangles are
+ * processed in submission order. Pixels are shaded in blocks of 4x2, one per shader lane.
+ */
+class SoftwareRasterizer {
+    struct DrawInfo;
+    struct Triangle;
+    struct ScreenVertex;
+    struct Batch;
+
+    core::WorkerPool pool;
+    std::unique_ptr<Batch> batch;
+
+    void shadeVertices(const DrawInfo& info, U32 instance,
+        const std::vector<U32>& vertexIds, std::vector<F32>& output);
+    void assemble(const DrawInfo& info, U32 drawIndex, const std::vector<F32>& vertices,
+        const std::vector<U32>& elements, Size begin, Size end);
+    void clipTriangle(const DrawInfo& info, U32 drawIndex, const F32* v0, const F32* v1, const F32* v2);
+    void clipLine(const DrawInfo& info, U32 drawIndex, const F32* v0, const F32* v1);
+    void setupPoint(const DrawInfo& info, U32 drawIndex, const F32* v);
+    void setupLine(const DrawInfo& info, U32 drawIndex, const ScreenVertex& a, const ScreenVertex& b);
+    void setupTriangle(const DrawInfo& info, U32 drawIndex, ScreenVertex a, ScreenVertex b, ScreenVertex c, bool isPolygon);
+    void rasterizeTile(U32 tileIndex);
+
+public:
+    /**
+     * Constructor
+     * @param[in]  threadCount  Number of worker threads, or 0 to use one per host core
+     */
+    SoftwareRasterizer(Size threadCount = 0);
+    ~SoftwareRasterizer();
+
+    void clearColor(SoftwareTexture* texture, const F32* color);
+    void clearDepthStencil(SoftwareTexture* texture, F32 depth, U08 stencil);
+    void draw(const SoftwareDraw& draw);
+
+    // Rasterize all binned draws
+    void flush();
+};
+
+}  // namespace software
+}  // namespace gfx
@@ -0,0 +1,1275 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#include "software_shader.h"
+#include "nucleus/logger/logger.h"
+#include "nucleus/core/host.h"
+#include "nucleus/graphics/backend/software/software_texture.h"
+#include "nucleus/graphics/hir/block.h"
+#include "nucleus/graphics/hir/function.h"
+#include "nucleus/graphics/hir/instruction.h"
+#include "nucleus/graphics/hir/module.h"
+
+#ifdef NUCLEUS_ARCH_X86
+#ifdef NUCLEUS_COMPILER_MSVC
+#include <intrin.h>
+#define TARGET_AVX2
+#else
+#include <x86intrin.h>
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+
+namespace gfx {
+namespace software {
+
+using namespace gfx::hir;
+
+/**
+ * Instruction sets
+ * ================
+ * Each namespace defines the vector helpers used by the interpreter in software_shader.inl.
+ * All paths round identically: fused multiply-adds are avoided on purpose.
+ */
+#ifdef NUCLEUS_ARCH_X86
+namespace sse {
+#define SIMD_TARGET
+using V = __m128;
+constexpr Size W = 4;
+
+static inline V vload(const F32* p) { return _mm_loadu_ps(p); }
+static inline void vstore(F32* p, V x) { _mm_storeu_ps(p, x); }
+static inline V vset(F32 x) { return _mm_set1_ps(x); }
+static inline V vadd(V x, V y) { return _mm_add_ps(x, y); }
+static inline V vsub(V x, V y) { return _mm_sub_ps(x, y); }
+static inline V vmul(V x, V y) { return _mm_mul_ps(x, y); }
+static inline V vdiv(V x, V y) { return _mm_div_ps(x, y); }
+static inline V vmin(V x, V y) { return _mm_min_ps(x, y); }
+static inline V vmax(V x, V y) { return _mm_max_ps(x, y); }
+static inline V vsqrt(V x) { return _mm_sqrt_ps(x); }
+static inline V vabs(V x) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), x); }
+static inline V vblend(V mask, V x, V y) { return _mm_or_ps(_mm_and_ps(mask, x), _mm_andnot_ps(mask, y)); }
+static inline V vcmpeq(V x, V y, V one) { return _mm_and_ps(_mm_cmpeq_ps(x, y), one); }
+static inline V vcmpne(V x, V y, V one) { return _mm_and_ps(_mm_cmpneq_ps(x, y), one); }
+static inline V vcmplt(V x, V y, V one) { return _mm_and_ps(_mm_cmplt_ps(x, y), one); }
+static inline V vcmple(V x, V y, V one) { return _mm_and_ps(_mm_cmple_ps(x, y), one); }
+static inline V vselect(V c, V x, V y) { return vblend(_mm_cmpneq_ps(c, _mm_setzero_ps()), x, y); }
+
+// SSE2 has no rounding instructions: values of magnitude 2^23 and above are already integral
+static inline V vtrunc(V x) {
+    const V t = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+    return vblend(_mm_cmpnlt_ps(vabs(x), _mm_set1_ps(8388608.0f)), x, t);
+}
+static inline V vfloor(V x) {
+    const V t = vtrunc(x);
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, x), _mm_set1_ps(1.0f)));
+}
+static inline V vceil(V x) {
+    const V t = vtrunc(x);
+    return _mm_add_ps(t, _mm_and_ps(_mm_cmplt_ps(t, x), _mm_set1_ps(1.0f)));
+}
+
+#include "software_shader.inl"
+#undef SIMD_TARGET
+}  // namespace sse
+
+namespace avx2 {
+#define SIMD_TARGET TARGET_AVX2
+using V = __m256;
+constexpr Size W = 8;
+
+static inline TARGET_AVX2 V vload(const F32* p) { return _mm256_loadu_ps(p); }
+static inline TARGET_AVX2 void vstore(F32* p, V x) { _mm256_storeu_ps(p, x); }
+static inline TARGET_AVX2 V vset(F32 x) { return _mm256_set1_ps(x); }
+static inline TARGET_AVX2 V vadd(V x, V y) { return _mm256_add_ps(x, y); }
+static inline TARGET_AVX2 V vsub(V x, V y) { return _mm256_sub_ps(x, y); }
+static inline TARGET_AVX2 V vmul(V x, V y) { return _mm256_mul_ps(x, y); }
+static inline TARGET_AVX2 V vdiv(V x, V y) { return _mm256_div_ps(x, y); }
+static inline TARGET_AVX2 V vmin(V x, V y) { return _mm256_min_ps(x, y); }
+static inline TARGET_AVX2 V vmax(V x, V y) { return _mm256_max_ps(x, y); }
+static inline TARGET_AVX2 V vsqrt(V x) { return _mm256_sqrt_ps(x); }
+static inline TARGET_AVX2 V vabs(V x) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), x); }
+static inline TARGET_AVX2 V vcmpeq(V x, V y, V one) { return _mm256_and_ps(_mm256_cmp_ps(x, y, _CMP_EQ_OQ), one); }
+static inline TARGET_AVX2 V vcmpne(V x, V y, V one) { return _mm256_and_ps(_mm256_cmp_ps(x, y, _CMP_NEQ_UQ), one); }
+static inline TARGET_AVX2 V vcmplt(V x, V y, V one) { return _mm256_and_ps(_mm256_cmp_ps(x, y, _CMP_LT_OS), one); }
+static inline TARGET_AVX2 V vcmple(V x, V y, V one) { return _mm256_and_ps(_mm256_cmp_ps(x, y, _CMP_LE_OS), one); }
+static inline TARGET_AVX2 V vselect(V c, V x, V y) {
+    return _mm256_blendv_ps(y, x, _mm256_cmp_ps(c, _mm256_setzero_ps(), _CMP_NEQ_UQ));
+}
+static inline TARGET_AVX2 V vtrunc(V x) { return _mm256_round_ps(x, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC); }
+static inline TARGET_AVX2 V vfloor(V x) { return _mm256_round_ps(x, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+static inline TARGET_AVX2 V vceil(V x) { return _mm256_round_ps(x, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC); }
+
+#include "software_shader.inl"
+#undef SIMD_TARGET
+}  // namespace avx2
+
+#else
+namespace scalar {
+#define SIMD_TARGET
+using V = F32;
+constexpr Size W = 1;
+
+static inline V vload(const F32* p) { return *p; }
+static inline void vstore(F32* p, V x) { *p = x; }
+static inline V vset(F32 x) { return x; }
+static inline V vadd(V x, V y) { return x + y; }
+static inline V vsub(V x, V y) { return x - y; }
+static inline V vmul(V x, V y) { return x * y; }
+static inline V vdiv(V x, V y) { return x / y; }
+static inline V vmin(V x, V y) { return (x < y) ? x : y; }
+static inline V vmax(V x, V y) { return (x > y) ? x : y; }
+static inline V vsqrt(V x) { return std::sqrt(x); }
+static inline V vabs(V x) { return std::fabs(x); }
+static inline V vcmpeq(V x, V y, V one) { return (x == y) ? one : 0.0f; }
+static inline V vcmpne(V x, V y, V one) { return (x != y) ? one : 0.0f; }
+static inline V vcmplt(V x, V y, V one) { return (x < y) ? one : 0.0f; }
+static inline V vcmple(V x, V y, V one) { return (x <= y) ? one : 0.0f; }
+static inline V vselect(V c, V x, V y) { return (c != 0.0f) ? x : y; }
+static inline V vtrunc(V x) { return std::trunc(x); }
+static inline V vfloor(V x) { return std::floor(x); }
+static inline V vceil(V x) { return std::ceil(x); }
+
+#include "software_shader.inl"
+#undef SIMD_TARGET
+}  // namespace scalar
+#endif
+
+/**
+ * Translator
+ * ==========
+ * Registers are first allocated as virtual registers of three classes. Constants are placed
+ * first, so that preparing a register file only copies a prefix. Variables live during the
+ * whole program. Temporaries hold SSA values and share physical registers once dead.
+ */
+enum RegisterClass : U08 {
+    REGISTER_CONSTANT,
+    REGISTER_VARIABLE,
+    REGISTER_TEMPORARY,
+};
+
+// Marks unused operands of virtual instructions
+constexpr U32 REGISTER_NONE = ~0U;
+
+struct VirtualOp {
+    ShaderOpcode opcode;
+    U32 dst;
+    U32 src[3];
+    U32 imm;
+};
+
+// Translation-time view of a HIR result
+struct Value {
+    enum Kind {
+        KIND_NONE,
+        KIND_REGISTERS,  // SSA value held in registers
+        KIND_POINTER,    // Pointer to variable registers
+        KIND_UNIFORM,    // Pointer to constant buffer memory
+        KIND_TEXTURE,    // Texture and sampler pair
+    } kind = KIND_NONE;
+
+    Literal typeId = 0;      // Type of the value or pointee
+    std::vector<U32> regs;   // Virtual registers
+    int component = -1;      // Pointee is a single component of regs[0]
+    U32 buffer = 0;          // Constant buffer index
+    U32 offset = 0;          // Offset in vec4 units
+    U32 binding = 0;         // Texture binding
+};
+
+static U32 getSelectors(U32 x, U32 y, U32 z, U32 w) {
+    return (x << 0) | (y << 3) | (z << 6) | (w << 9);
+}
+
+static int getSourceCount(ShaderOpcode opcode) {
+    switch (opcode) {
+    case SHADER_OP_UNIFORM:
+    case SHADER_OP_KILL:
+        return 0;
+    case SHADER_OP_SWIZZLE:
+    case SHADER_OP_ADD:
+    case SHADER_OP_SUB:
+    case SHADER_OP_MUL:
+    case SHADER_OP_DIV:
+    case SHADER_OP_MIN:
+    case SHADER_OP_MAX:
+    case SHADER_OP_POW:
+    case SHADER_OP_DOT:
+    case SHADER_OP_CMP_EQ:
+    case SHADER_OP_CMP_NE:
+    case SHADER_OP_CMP_LT:
+    case SHADER_OP_CMP_LE:
+    case SHADER_OP_CMP_GT:
+    case SHADER_OP_CMP_GE:
+        return 2;
+    case SHADER_OP_MAD:
+    case SHADER_OP_MIX:
+    case SHADER_OP_CLAMP:
+    case SHADER_OP_SELECT:
+        return 3;
+    default:
+        return 1;
+    }
+}
+
+class ShaderTranslator {
+    const Module& module;
+    SoftwareShader& shader;
+    bool success = true;
+
+    std::vector<Value> values;
+    std::vector<VirtualOp> ops;
+    std::vector<RegisterClass> regClasses;
+    std::unordered_map<U32, std::array<F32, 4>> constantData;
+    std::map<std::array<U32, 4>, U32> constantCache;
+
+    // Decorations of each result and of each structure member
+    std::unordered_map<Literal, std::vector<std::pair<Literal, Literal>>> decorations;
+    std::map<std::pair<Literal, Literal>, Literal> memberBuiltins;
+
+    // Virtual registers of the shader inputs and outputs
+    std::vector<U32> inputRegs;
+    std::vector<U32> outputRegs;
+
+    U32 bufferCount = 0;
+    U32 textureCount = 0;
+    U32 undecoratedOutputs = 0;
+
+    bool fail(const char* message, int opcode) {
+        logger.error(LOG_GRAPHICS, "SoftwareShader: %s (%d)", message, opcode);
+        success = false;
+        return false;
+    }
+
+    const Instruction* getInstruction(Literal id) const {
+        if (id >= module.idInstructions.size()) {
+            return nullptr;
+        }
+        return module.idInstructions[id];
+    }
+
+    bool getDecoration(Literal id, Literal decoration, Literal& argument) const {
+        auto it = decorations.find(id);
+        if (it == decorations.end()) {
+            return false;
+        }
+        for (const auto& entry : it->second) {
+            if (entry.first == decoration) {
+                argument = entry.second;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool getConstantIndex(Literal id, U32& index) const {
+        const Instruction* instr = getInstruction(id);
+        if (!instr || instr->opcode != OP_CONSTANT || instr->operands.empty()) {
+            return false;
+        }
+        index = instr->operands[0];
+        return true;
+    }
+
+    // Number of registers spanned by a value of the given type
+    U32 getRegisterCount(Literal typeId) const {
+        const Instruction* type = getInstruction(typeId);
+        if (!type) {
+            return 1;
+        }
+        switch (type->opcode) {
+        case OP_TYPE_MATRIX:
+            return type->operands[1];
+        case OP_TYPE_ARRAY: {
+            U32 length = 0;
+            getConstantIndex(type->operands[1], length);
+            return length * getRegisterCount(type->operands[0]);
+        }
+        case OP_TYPE_STRUCT: {
+            U32 count = 0;
+            for (const auto member : type->operands) {
+                count += getRegisterCount(member);
+            }
+            return count;
+        }
+        default:
+            return 1;
+        }
+    }
+
+    // Number of components of a scalar or vector type
+    U32 getComponentCount(Literal typeId) const {
+        const Instruction* type = getInstruction(typeId);
+        if (type && type->opcode == OP_TYPE_VECTOR) {
+            return type->operands[1];
+        }
+        if (type && (type->opcode == OP_TYPE_FLOAT || type->opcode == OP_TYPE_INT || type->opcode == OP_TYPE_BOOL)) {
+            return 1;
+        }
+        return 4;
+    }
+
+    /**
+     * Descend one level into a composite type
+     * @param[inout]  typeId     Type being indexed, replaced by the type of the element
+     * @param[in]     index      Element index
+     * @param[out]    offset     Register offset of the element
+     * @param[out]    component  Component index if the element is a vector component
+     */
+    bool descend(Literal& typeId, U32 index, U32& offset, int& component) {
+        const Instruction* type = getInstruction(typeId);
+        if (!type || component >= 0) {
+            return fail("Invalid composite index", type ? type->opcode : 0);
+        }
+        switch (type->opcode) {
+        case OP_TYPE_STRUCT:
+            if (index >= type->operands.size()) {
+                return fail("Structure member out of range", index);
+            }
+            for (U32 i = 0; i < index; i++) {
+                offset += getRegisterCount(type->operands[i]);
+            }
+            typeId = type->operands[index];
+            return true;
+        case OP_TYPE_ARRAY:
+            typeId = type->operands[0];
+            offset += index * getRegisterCount(typeId);
+            return true;
+        case OP_TYPE_MATRIX:
+            typeId = type->operands[0];
+            offset += index;
+            return true;
+        case OP_TYPE_VECTOR:
+            typeId = type->operands[0];
+            component = index;
+            return true;
+        default:
+            return fail("Indexing a non-composite type", type->opcode);
+        }
+    }
+
+    U32 newRegister(RegisterClass regClass) {
+        regClasses.push_back(regClass);
+        return U32(regClasses.size() - 1);
+    }
+
+    U32 getConstant(F32 x, F32 y, F32 z, F32 w) {
+        const std::array<F32, 4> data = {{ x, y, z, w }};
+        std::array<U32, 4> key;
+        memcpy(key.data(), data.data(), sizeof(key));
+        auto it = constantCache.find(key);
+        if (it != constantCache.end()) {
+            return it->second;
+        }
+        const U32 reg = newRegister(REGISTER_CONSTANT);
+        constantData[reg] = data;
+        constantCache[key] = reg;
+        return reg;
+    }
+
+    U32 getConstant(F32 x) {
+        return getConstant(x, x, x, x);
+    }
+
+    void emit(ShaderOpcode opcode, U32 dst, U32 src0 = REGISTER_NONE, U32 src1 = REGISTER_NONE, U32 src2 = REGISTER_NONE, U32 imm = 0) {
+        ops.push_back({ opcode, dst, { src0, src1, src2 }, imm });
+    }
+
+    U32 emitTemporary(ShaderOpcode opcode, U32 src0 = REGISTER_NONE, U32 src1 = REGISTER_NONE, U32 src2 = REGISTER_NONE, U32 imm = 0) {
+        const U32 dst = newRegister(REGISTER_TEMPORARY);
+        emit(opcode, dst, src0, src1, src2, imm);
+        return dst;
+    }
+
+    Value& getValue(Literal id) {
+        if (id >= values.size()) {
+            values.resize(id + 1);
+        }
+        return values[id];
+    }
+
+    // Turn any pointer into the SSA value it points to
+    Value load(const Value& value) {
+        Value result;
+        result.typeId = value.typeId;
+        result.kind = Value::KIND_REGISTERS;
+        switch (value.kind) {
+        case Value::KIND_REGISTERS:
+        case Value::KIND_TEXTURE:
+            return value;
+        case Value::KIND_POINTER:
+            if (value.component >= 0) {
+                const U32 c = value.component;
+                result.regs.push_back(emitTemporary(SHADER_OP_SWIZZLE, value.regs[0], value.regs[0], REGISTER_NONE, getSelectors(c, c, c, c)));
+            } else {
+                for (const auto reg : value.regs) {
+                    result.regs.push_back(emitTemporary(SHADER_OP_MOV, reg));
+                }
+            }
+            return result;
+        case Value::KIND_UNIFORM:
+            if (value.component >= 0) {
+                const U32 c = value.component;
+                const U32 row = emitTemporary(SHADER_OP_UNIFORM, REGISTER_NONE, REGISTER_NONE, REGISTER_NONE, (value.buffer << 16) | value.offset);
+                result.regs.push_back(emitTemporary(SHADER_OP_SWIZZLE, row, row, REGISTER_NONE, getSelectors(c, c, c, c)));
+            } else {
+                const U32 count = getRegisterCount(value.typeId);
+                for (U32 i = 0; i < count; i++) {
+                    result.regs.push_back(emitTemporary(SHADER_OP_UNIFORM, REGISTER_NONE, REGISTER_NONE, REGISTER_NONE, (value.buffer << 16) | (value.offset + i)));
+                }
+            }
+            return result;
+        default:
+            fail("Undefined value", 0);
+            result.regs.push_back(getConstant(0.0f));
+            return result;
+        }
+    }
+
+    Value load(Literal id) {
+        return load(getValue(id));
+    }
+
+    U32 loadRegister(Literal id) {
+        const Value value = load(id);
+        if (value.regs.empty()) {
+            fail("Value without registers", id);
+            return getConstant(0.0f);
+        }
+        return value.regs[0];
+    }
+
+    void store(const Value& pointer, const Value& object) {
+        const Value value = load(object);
+        if (pointer.kind != Value::KIND_POINTER) {
+            fail("Store to a non-writable pointer", pointer.kind);
+            return;
+        }
+        if (pointer.component >= 0) {
+            U32 sel[4] = { 0, 1, 2, 3 };
+            sel[pointer.component] = 4;
+            emit(SHADER_OP_SWIZZLE, pointer.regs[0], pointer.regs[0], value.regs[0], REGISTER_NONE,
+                getSelectors(sel[0], sel[1], sel[2], sel[3]));
+            return;
+        }
+        const Size count = std::min(pointer.regs.size(), value.regs.size());
+        for (Size i = 0; i < count; i++) {
+            emit(SHADER_OP_MOV, pointer.regs[i], value.regs[i]);
+        }
+    }
+
+    void addInterface(Literal varId, Literal typeId, const std::vector<U32>& regs, bool isOutput) {
+        auto& list = isOutput ? shader.outputs : shader.inputs;
+        auto& listRegs = isOutput ? outputRegs : inputRegs;
+        auto add = [&](ShaderVariable::Kind kind, U32 reg, U32 index) {
+            list.push_back({ kind, 0, index });
+            listRegs.push_back(reg);
+        };
+
+        Literal argument;
+        if (getDecoration(varId, DECORATION_BUILTIN, argument)) {
+            add(ShaderVariable::KIND_BUILTIN, regs[0], argument);
+            return;
+        }
+        if (getDecoration(varId, DECORATION_LOCATION, argument)) {
+            for (Size i = 0; i < regs.size(); i++) {
+                add(ShaderVariable::KIND_LOCATION, regs[i], U32(argument + i));
+            }
+            return;
+        }
+        const Instruction* type = getInstruction(typeId);
+        if (type && type->opcode == OP_TYPE_STRUCT) {
+            U32 offset = 0;
+            for (Size i = 0; i < type->operands.size(); i++) {
+                auto it = memberBuiltins.find(std::make_pair(typeId, Literal(i)));
+                if (it != memberBuiltins.end()) {
+                    add(ShaderVariable::KIND_BUILTIN, regs[offset], it->second);
+                }
+                offset += getRegisterCount(type->operands[i]);
+            }
+            return;
+        }
+        // Undecorated outputs, as emitted by fragment programs, are assigned in declaration order
+        if (isOutput) {
+            add(ShaderVariable::KIND_LOCATION, regs[0], undecoratedOutputs++);
+        }
+    }
+
+    void declareVariable(const Instruction* instr) {
+        const Instruction* pointerType = getInstruction(instr->typeId);
+        if (!pointerType || pointerType->opcode != OP_TYPE_POINTER) {
+            fail("Variable without pointer type", instr->resultId);
+            return;
+        }
+        const Literal storage = instr->operands[0];
+        const Literal typeId = pointerType->operands[1];
+        const Instruction* type = getInstruction(typeId);
+
+        Value& value = getValue(instr->resultId);
+        value.typeId = typeId;
+        if (storage == STORAGE_CLASS_UNIFORM_CONSTANT) {
+            if (type && (type->opcode == OP_TYPE_SAMPLED_IMAGE || type->opcode == OP_TYPE_IMAGE || type->opcode == OP_TYPE_SAMPLER)) {
+                value.kind = Value::KIND_TEXTURE;
+                if (!getDecoration(instr->resultId, DECORATION_BINDING, value.binding)) {
+                    value.binding = textureCount;
+                }
+                textureCount++;
+                if (value.binding >= SHADER_MAX_TEXTURES) {
+                    fail("Texture binding out of range", value.binding);
+                }
+            } else {
+                value.kind = Value::KIND_UNIFORM;
+                value.buffer = bufferCount++;
+                if (value.buffer >= SHADER_MAX_BUFFERS) {
+                    fail("Too many constant buffers", value.buffer);
+                }
+            }
+            return;
+        }
+
+        value.kind = Value::KIND_POINTER;
+        const U32 count = getRegisterCount(typeId);
+        for (U32 i = 0; i < count; i++) {
+            value.regs.push_back(newRegister(REGISTER_VARIABLE));
+        }
+        switch (storage) {
+        case STORAGE_CLASS_INPUT:
+            addInterface(instr->resultId, typeId, value.regs, false);
+            return;
+        case STORAGE_CLASS_OUTPUT:
+            addInterface(instr->resultId, typeId, value.regs, true);
+            break;
+        }
+        // Variables do not carry values across invocations
+        const Value copy = value;
+        for (const auto reg : copy.regs) {
+            emit(SHADER_OP_MOV, reg, getConstant(0.0f));
+        }
+        if (instr->operands.size() > 1) {
+            store(copy, getValue(instr->operands[1]));
+        }
+    }
+
+    void declareConstant(const Instruction* instr) {
+        Value& value = getValue(instr->resultId);
+        value.kind = Value::KIND_REGISTERS;
+        value.typeId = instr->typeId;
+        const Instruction* type = getInstruction(instr->typeId);
+
+        switch (instr->opcode) {
+        case OP_CONSTANT_TRUE:
+            value.regs.push_back(getConstant(1.0f));
+            return;
+        case OP_CONSTANT_FALSE:
+            value.regs.push_back(getConstant(0.0f));
+            return;
+        case OP_CONSTANT_NULL: {
+            const U32 count = getRegisterCount(instr->typeId);
+            for (U32 i = 0; i < count; i++) {
+                value.regs.push_back(getConstant(0.0f));
+            }
+            return;
+        }
+        case OP_CONSTANT: {
+            const U32 bits = instr->operands[0];
+            F32 x;
+            if (type && type->opcode == OP_TYPE_INT) {
+                x = type->operands[1] ? F32(S32(bits)) : F32(bits);
+            } else {
+                memcpy(&x, &bits, sizeof(x));
+            }
+            value.regs.push_back(getConstant(x));
+            return;
+        }
+        case OP_CONSTANT_COMPOSITE:
+            if (type && type->opcode == OP_TYPE_VECTOR) {
+                F32 data[4] = {};
+                for (Size i = 0; i < instr->operands.size() && i < 4; i++) {
+                    const Value& element = getValue(instr->operands[i]);
+                    if (!element.regs.empty()) {
+                        data[i] = constantData[element.regs[0]][0];
+                    }
+                }
+                value.regs.push_back(getConstant(data[0], data[1], data[2], data[3]));
+            } else {
+                for (const auto operand : instr->operands) {
+                    const auto& regs = getValue(operand).regs;
+                    value.regs.insert(value.regs.end(), regs.begin(), regs.end());
+                }
+            }
+            return;
+        }
+    }
+
+    // Gather components from several registers into a single one
+    U32 gather(const std::vector<std::pair<U32, U32>>& components) {
+        const Size count = std::min<Size>(components.size(), 4);
+        if (count == 0) {
+            return getConstant(0.0f);
+        }
+        // Each swizzle merges the components of one more register into the result
+        U32 dst = REGISTER_NONE;
+        bool done[4] = {};
+        Size pending = count;
+        while (pending) {
+            U32 srcA = REGISTER_NONE;
+            U32 srcB = REGISTER_NONE;
+            for (Size i = 0; i < count; i++) {
+                if (done[i]) {
+                    continue;
+                }
+                const U32 reg = components[i].first;
+                if (dst == REGISTER_NONE && srcA == REGISTER_NONE) {
+                    srcA = reg;
+                } else if (srcB == REGISTER_NONE && reg != srcA) {
+                    srcB = reg;
+                }
+            }
+            if (dst != REGISTER_NONE) {
+                srcA = dst;
+            }
+            U32 sel[4];
+            for (Size i = 0; i < 4; i++) {
+                sel[i] = (dst == REGISTER_NONE) ? 0 : U32(i);
+                if (i >= count || done[i]) {
+                    continue;
+                }
+                const auto& component = components[i];
+                if (dst == REGISTER_NONE && component.first == srcA) {
+                    sel[i] = component.second;
+                } else if (component.first == srcB) {
+                    sel[i] = 4 + component.second;
+                } else {
+                    continue;
+                }
+                done[i] = true;
+                pending--;
+            }
+            const U32 imm = getSelectors(sel[0], sel[1], sel[2], sel[3]);
+            if (dst == REGISTER_NONE) {
+                dst = emitTemporary(SHADER_OP_SWIZZLE, srcA, (srcB == REGISTER_NONE) ? srcA : srcB, REGISTER_NONE, imm);
+            } else {
+                emit(SHADER_OP_SWIZZLE, dst, srcA, srcB, REGISTER_NONE, imm);
+            }
+        }
+        return dst;
+    }
+
+    // Apply an operation register by register, broadcasting single-register operands
+    void translateComponentwise(const Instruction* instr, ShaderOpcode opcode, Size argBegin, Size argCount) {
+        std::vector<Value> args;
+        Size count = 1;
+        for (Size i = 0; i < argCount; i++) {
+            args.push_back(load(instr->operands[argBegin + i]));
+            count = std::max(count, args.back().regs.size());
+        }
+        Value& result = getValue(instr->resultId);
+        result.kind = Value::KIND_REGISTERS;
+        result.typeId = instr->typeId;
+        result.regs.clear();
+        for (Size r = 0; r < count; r++) {
+            U32 src[3] = { REGISTER_NONE, REGISTER_NONE, REGISTER_NONE };
+            for (Size i = 0; i < argCount; i++) {
+                const auto& regs = args[i].regs;
+                src[i] = regs.empty() ? getConstant(0.0f) : regs[std::min(r, regs.size() - 1)];
+            }
+            result.regs.push_back(emitTemporary(opcode, src[0], src[1], src[2]));
+        }
+    }
+
+    void setResult(const Instruction* instr, U32 reg) {
+        Value& result = getValue(instr->resultId);
+        result.kind = Value::KIND_REGISTERS;
+        result.typeId = instr->typeId;
+        result.regs = { reg };
+    }
+
+    void translateExtInst(const Instruction* instr) {
+        const Literal function = instr->operands[1];
+        switch (function) {
+        case GLSLstd450FAbs:         translateComponentwise(instr, SHADER_OP_ABS, 2, 1); break;
+        case GLSLstd450Floor:        translateComponentwise(instr, SHADER_OP_FLOOR, 2, 1); break;
+        case GLSLstd450Ceil:         translateComponentwise(instr, SHADER_OP_CEIL, 2, 1); break;
+        case GLSLstd450Fract:        translateComponentwise(instr, SHADER_OP_FRACT, 2, 1); break;
+        case GLSLstd450Trunc:        translateComponentwise(instr, SHADER_OP_TRUNC, 2, 1); break;
+        case GLSLstd450Sqrt:         translateComponentwise(instr, SHADER_OP_SQRT, 2, 1); break;
+        case GLSLstd450InverseSqrt:  translateComponentwise(instr, SHADER_OP_RSQ, 2, 1); break;
+        case GLSLstd450Exp2:         translateComponentwise(instr, SHADER_OP_EXP2, 2, 1); break;
+        case GLSLstd450Log2:         translateComponentwise(instr, SHADER_OP_LOG2, 2, 1); break;
+        case GLSLstd450Sin:          translateComponentwise(instr, SHADER_OP_SIN, 2, 1); break;
+        case GLSLstd450Cos:          translateComponentwise(instr, SHADER_OP_COS, 2, 1); break;
+        case GLSLstd450Pow:          translateComponentwise(instr, SHADER_OP_POW, 2, 2); break;
+        case GLSLstd450FMin:         translateComponentwise(instr, SHADER_OP_MIN, 2, 2); break;
+        case GLSLstd450FMax:         translateComponentwise(instr, SHADER_OP_MAX, 2, 2); break;
+        case GLSLstd450FClamp:       translateComponentwise(instr, SHADER_OP_CLAMP, 2, 3); break;
+        case GLSLstd450FMix:         translateComponentwise(instr, SHADER_OP_MIX, 2, 3); break;
+        case GLSLstd450Fma:          translateComponentwise(instr, SHADER_OP_MAD, 2, 3); break;
+        case GLSLstd450Length: {
+            const U32 x = loadRegister(instr->operands[2]);
+            const U32 n = getComponentCount(getValue(instr->operands[2]).typeId);
+            const U32 dot = emitTemporary(SHADER_OP_DOT, x, x, REGISTER_NONE, n);
+            setResult(instr, emitTemporary(SHADER_OP_SQRT, dot));
+            break;
+        }
+        case GLSLstd450Normalize: {
+            const U32 x = loadRegister(instr->operands[2]);
+            const U32 n = getComponentCount(instr->typeId);
+            const U32 dot = emitTemporary(SHADER_OP_DOT, x, x, REGISTER_NONE, n);
+            const U32 rsq = emitTemporary(SHADER_OP_RSQ, dot);
+            setResult(instr, emitTemporary(SHADER_OP_MUL, x, rsq));
+            break;
+        }
+        default:
+            fail("Unsupported extended instruction", function);
+        }
+    }
+
+    void translateInstruction(const Instruction* instr) {
+        const auto& operands = instr->operands;
+        switch (instr->opcode) {
+        case OP_NOP:
+        case OP_LINE:
+        case OP_NO_LINE:
+        case OP_LABEL:
+        case OP_SELECTION_MERGE:
+        case OP_RETURN:
+        case OP_FUNCTION_END:
+            break;
+
+        // Straight-line code only: blocks are translated in order
+        case OP_BRANCH:
+            break;
+
+        case OP_VARIABLE:
+            declareVariable(instr);
+            break;
+
+        case OP_UNDEF:
+            setResult(instr, getConstant(0.0f));
+            break;
+
+        case OP_LOAD: {
+            Value result = load(operands[0]);
+            result.typeId = instr->typeId;
+            getValue(instr->resultId) = result;
+            break;
+        }
+        case OP_STORE: {
+            const Value pointer = getValue(operands[0]);
+            const Value object = getValue(operands[1]);
+            store(pointer, object);
+            break;
+        }
+        case OP_ACCESS_CHAIN:
+        case OP_IN_BOUNDS_ACCESS_CHAIN: {
+            Value result = getValue(operands[0]);
+            U32 offset = 0;
+            for (Size i = 1; i < operands.size(); i++) {
+                U32 index;
+                if (!getConstantIndex(operands[i], index)) {
+                    fail("Dynamic indexing is not supported", instr->opcode);
+                    return;
+                }
+                if (!descend(result.typeId, index, offset, result.component)) {
+                    return;
+                }
+            }
+            if (result.kind == Value::KIND_UNIFORM) {
+                result.offset += offset;
+            } else if (result.kind == Value::KIND_POINTER) {
+                const U32 count = (result.component >= 0) ? 1 : getRegisterCount(result.typeId);
+                if (offset + count > result.regs.size()) {
+                    fail("Access chain out of range", instr->opcode);
+                    return;
+                }
+                result.regs = std::vector<U32>(result.regs.begin() + offset, result.regs.begin() + offset + count);
+            }
+            getValue(instr->resultId) = result;
+            break;
+        }
+
+        case OP_COPY_OBJECT:
+        case OP_SAMPLED_IMAGE:
+        case OP_BITCAST:
+        case OP_CONVERT_S_TO_F:
+        case OP_CONVERT_U_TO_F:
+        case OP_FCONVERT: {
+            Value result = load(operands[0]);
+            result.typeId = instr->typeId;
+            getValue(instr->resultId) = result;
+            break;
+        }
+
+        case OP_COMPOSITE_CONSTRUCT: {
+            const Instruction* type = getInstruction(instr->typeId);
+            if (type && type->opcode == OP_TYPE_VECTOR) {
+                std::vector<std::pair<U32, U32>> components;
+                for (const auto operand : operands) {
+                    const U32 reg = loadRegister(operand);
+                    const U32 count = getComponentCount(getValue(operand).typeId);
+                    for (U32 c = 0; c < count; c++) {
+                        components.emplace_back(reg, c);
+                    }
+                }
+                setResult(instr, gather(components));
+            } else {
+                std::vector<U32> regs;
+                for (const auto operand : operands) {
+                    const Value element = load(operand);
+                    regs.insert(regs.end(), element.regs.begin(), element.regs.end());
+                }
+                Value& result = getValue(instr->resultId);
+                result.kind = Value::KIND_REGISTERS;
+                result.typeId = instr->typeId;
+                result.regs = regs;
+            }
+            break;
+        }
+        case OP_COMPOSITE_EXTRACT: {
+            const Value composite = load(operands[0]);
+            Literal typeId = composite.typeId;
+            U32 offset = 0;
+            int component = -1;
+            for (Size i = 1; i < operands.size(); i++) {
+                if (!descend(typeId, operands[i], offset, component)) {
+                    return;
+                }
+            }
+            const U32 count = (component >= 0) ? 1 : getRegisterCount(typeId);
+            if (offset + count > composite.regs.size()) {
+                fail("Composite index out of range", instr->opcode);
+                return;
+            }
+            Value result;
+            result.kind = Value::KIND_REGISTERS;
+            result.typeId = instr->typeId;
+            if (component >= 0) {
+                const U32 reg = composite.regs[offset];
+                const U32 c = component;
+                result.regs.push_back(emitTemporary(SHADER_OP_SWIZZLE, reg, reg, REGISTER_NONE, getSelectors(c, c, c, c)));
+            } else {
+                result.regs.assign(composite.regs.begin() + offset, composite.regs.begin() + offset + count);
+            }
+            getValue(instr->resultId) = result;
+            break;
+        }
+        case OP_COMPOSITE_INSERT: {
+            const Value object = load(operands[0]);
+            const Value composite = load(operands[1]);
+            Literal typeId = composite.typeId;
+            U32 offset = 0;
+            int component = -1;
+            for (Size i = 2; i < operands.size(); i++) {
+                if (!descend(typeId, operands[i], offset, component)) {
+                    return;
+                }
+            }
+            Value copy;
+            copy.kind = Value::KIND_POINTER;
+            copy.typeId = composite.typeId;
+            for (const auto reg : composite.regs) {
+                copy.regs.push_back(emitTemporary(SHADER_OP_MOV, reg));
+            }
+            Value target = copy;
+            target.component = component;
+            target.regs.assign(copy.regs.begin() + std::min<Size>(offset, copy.regs.size()), copy.regs.end());
+            store(target, object);
+            Value& result = getValue(instr->resultId);
+            result.kind = Value::KIND_REGISTERS;
+            result.typeId = instr->typeId;
+            result.regs = copy.regs;
+            break;
+        }
+        case OP_VECTOR_SHUFFLE: {
+            const U32 a = loadRegister(operands[0]);
+            const U32 b = loadRegister(operands[1]);
+            const U32 n = getComponentCount(getValue(operands[0]).typeId);
+            U32 sel[4] = { 0, 0, 0, 0 };
+            for (Size i = 2; i < operands.size() && i < 6; i++) {
+                const U32 c = operands[i];
+                sel[i - 2] = (c == 0xFFFFFFFF) ? 0 : (c < n) ? c : 4 + (c - n);
+            }
+            setResult(instr, emitTemporary(SHADER_OP_SWIZZLE, a, b, REGISTER_NONE, getSelectors(sel[0], sel[1], sel[2], sel[3])));
+            break;
+        }
+        case OP_VECTOR_EXTRACT_DYNAMIC: {
+            U32 c;
+            if (!getConstantIndex(operands[1], c) || c >= 4) {
+                fail("Dynamic indexing is not supported", instr->opcode);
+                return;
+            }
+            const U32 a = loadRegister(operands[0]);
+            setResult(instr, emitTemporary(SHADER_OP_SWIZZLE, a, a, REGISTER_NONE, getSelectors(c, c, c, c)));
+            break;
+        }
+
+        // Arithmetic
+        case OP_FNEGATE:
+        case OP_SNEGATE:
+            translateComponentwise(instr, SHADER_OP_NEG, 0, 1);
+            break;
+        case OP_FADD:
+        case OP_IADD:
+            translateComponentwise(instr, SHADER_OP_ADD, 0, 2);
+            break;
+        case OP_FSUB:
+        case OP_ISUB:
+            translateComponentwise(instr, SHADER_OP_SUB, 0, 2);
+            break;
+        case OP_FMUL:
+        case OP_IMUL:
+        case OP_VECTOR_TIMES_SCALAR:
+        case OP_MATRIX_TIMES_SCALAR:
+            translateComponentwise(instr, SHADER_OP_MUL, 0, 2);
+            break;
+        case OP_FDIV:
+            translateComponentwise(instr, SHADER_OP_DIV, 0, 2);
+            break;
+        case OP_FMOD: {
+            const U32 a = loadRegister(operands[0]);
+            const U32 b = loadRegister(operands[1]);
+            const U32 q = emitTemporary(SHADER_OP_FLOOR, emitTemporary(SHADER_OP_DIV, a, b));
+            setResult(instr, emitTemporary(SHADER_OP_SUB, a, emitTemporary(SHADER_OP_MUL, b, q)));
+            break;
+        }
+        case OP_CONVERT_F_TO_S:
+        case OP_CONVERT_F_TO_U:
+            translateComponentwise(instr, SHADER_OP_TRUNC, 0, 1);
+            break;
+        case OP_DOT: {
+            const U32 a = loadRegister(operands[0]);
+            const U32 b = loadRegister(operands[1]);
+            const U32 n = getComponentCount(getValue(operands[0]).typeId);
+            setResult(instr, emitTemporary(SHADER_OP_DOT, a, b, REGISTER_NONE, n));
+            break;
+        }
+        // Matrices are stored one row per register, as uploaded by the RSX
+        case OP_MATRIX_TIMES_VECTOR: {
+            const Value m = load(operands[0]);
+            const U32 v = loadRegister(operands[1]);
+            const U32 n = getComponentCount(getValue(operands[1]).typeId);
+            std::vector<std::pair<U32, U32>> components;
+            for (const auto row : m.regs) {
+                components.emplace_back(emitTemporary(SHADER_OP_DOT, row, v, REGISTER_NONE, n), 0);
+            }
+            setResult(instr, gather(components));
+            break;
+        }
+        case OP_VECTOR_TIMES_MATRIX: {
+            const U32 v = loadRegister(operands[0]);
+            const Value m = load(operands[1]);
+            U32 sum = REGISTER_NONE;
+            for (U32 i = 0; i < m.regs.size() && i < 4; i++) {
+                const U32 s = emitTemporary(SHADER_OP_SWIZZLE, v, v, REGISTER_NONE, getSelectors(i, i, i, i));
+                sum = (i == 0)
+                    ? emitTemporary(SHADER_OP_MUL, s, m.regs[i])
+                    : emitTemporary(SHADER_OP_MAD, s, m.regs[i], sum);
+            }
+            setResult(instr, (sum == REGISTER_NONE) ? getConstant(0.0f) : sum);
+            break;
+        }
+
+        // Comparisons and logic, with booleans stored as 1.0 and 0.0
+        case OP_FORD_EQUAL:
+        case OP_FUNORD_EQUAL:
+        case OP_IEQUAL:
+        case OP_LOGICAL_EQUAL:
+            translateComponentwise(instr, SHADER_OP_CMP_EQ, 0, 2);
+            break;
+        case OP_FORD_NOT_EQUAL:
+        case OP_FUNORD_NOT_EQUAL:
+        case OP_INOT_EQUAL:
+        case OP_LOGICAL_NOT_EQUAL:
+            translateComponentwise(instr, SHADER_OP_CMP_NE, 0, 2);
+            break;
+        case OP_FORD_LESS_THAN:
+        case OP_FUNORD_LESS_THAN:
+        case OP_SLESS_THAN:
+        case OP_ULESS_THAN:
+            translateComponentwise(instr, SHADER_OP_CMP_LT, 0, 2);
+            break;
+        case OP_FORD_LESS_THAN_EQUAL:
+        case OP_FUNORD_LESS_THAN_EQUAL:
+        case OP_SLESS_THAN_EQUAL:
+        case OP_ULESS_THAN_EQUAL:
+            translateComponentwise(instr, SHADER_OP_CMP_LE, 0, 2);
+            break;
+        case OP_FORD_GREATER_THAN:
+        case OP_FUNORD_GREATER_THAN:
+        case OP_SGREATER_THAN:
+        case OP_UGREATER_THAN:
+            translateComponentwise(instr, SHADER_OP_CMP_GT, 0, 2);
+            break;
+        case OP_FORD_GREATER_THAN_EQUAL:
+        case OP_FUNORD_GREATER_THAN_EQUAL:
+        case OP_SGREATER_THAN_EQUAL:
+        case OP_UGREATER_THAN_EQUAL:
+            translateComponentwise(instr, SHADER_OP_CMP_GE, 0, 2);
+            break;
+        case OP_LOGICAL_AND:
+            translateComponentwise(instr, SHADER_OP_MUL, 0, 2);
+            break;
+        case OP_LOGICAL_OR:
+            translateComponentwise(instr, SHADER_OP_MAX, 0, 2);
+            break;
+        case OP_LOGICAL_NOT: {
+            const U32 a = loadRegister(operands[0]);
+            setResult(instr, emitTemporary(SHADER_OP_CMP_EQ, a, getConstant(0.0f)));
+            break;
+        }
+        case OP_SELECT:
+            translateComponentwise(instr, SHADER_OP_SELECT, 0, 3);
+            break;
+
+        case OP_EXT_INST:
+            translateExtInst(instr);
+            break;
+
+        case OP_IMAGE_SAMPLE_IMPLICIT_LOD:
+        case OP_IMAGE_SAMPLE_EXPLICIT_LOD: {
+            const Value image = load(operands[0]);
+            if (image.kind != Value::KIND_TEXTURE) {
+                fail("Sampling a non-texture value", instr->opcode);
+                return;
+            }
+            const U32 coord = loadRegister(operands[1]);
+            setResult(instr, emitTemporary(SHADER_OP_SAMPLE, coord, REGISTER_NONE, REGISTER_NONE, image.binding));
+            break;
+        }
+
+        case OP_KILL:
+            emit(SHADER_OP_KILL, REGISTER_NONE);
+            shader.usesKill = true;
+            break;
+
+        default:
+            fail("Unsupported opcode", instr->opcode);
+        }
+    }
+
+    // Assign physical registers, sharing them between temporaries with disjoint lifetimes
+    bool allocate() {
+        const Size virtualCount = regClasses.size();
+        std::vector<U32> physical(virtualCount, REGISTER_NONE);
+        U32 count = 0;
+        for (Size v = 0; v < virtualCount; v++) {
+            if (regClasses[v] == REGISTER_CONSTANT) {
+                ShaderRegister reg;
+                const auto& data = constantData[U32(v)];
+                for (Size k = 0; k < 4; k++) {
+                    std::fill(std::begin(reg.c[k]), std::end(reg.c[k]), data[k]);
+                }
+                shader.constants.push_back(reg);
+                physical[v] = count++;
+            }
+        }
+        for (Size v = 0; v < virtualCount; v++) {
+            if (regClasses[v] == REGISTER_VARIABLE) {
+                physical[v] = count++;
+            }
+        }
+
+        std::vector<Size> lastUse(virtualCount, 0);
+        for (Size i = 0; i < ops.size(); i++) {
+            const auto& op = ops[i];
+            if (op.dst != REGISTER_NONE) {
+                lastUse[op.dst] = i;
+            }
+            for (int s = 0; s < getSourceCount(op.opcode); s++) {
+                if (op.src[s] != REGISTER_NONE) {
+                    lastUse[op.src[s]] = i;
+                }
+            }
+        }
+
+        std::vector<U32> freeRegisters;
+        auto allocateTemporary = [&](U32 v) {
+            if (physical[v] == REGISTER_NONE) {
+                if (freeRegisters.empty()) {
+                    physical[v] = count++;
+                } else {
+                    physical[v] = freeRegisters.back();
+                    freeRegisters.pop_back();
+                }
+            }
+        };
+        auto releaseTemporary = [&](U32 v, Size i) {
+            if (regClasses[v] == REGISTER_TEMPORARY && lastUse[v] == i && physical[v] != REGISTER_NONE) {
+                freeRegisters.push_back(physical[v]);
+                lastUse[v] = ~Size(0);
+            }
+        };
+
+        shader.ops.resize(ops.size());
+        for (Size i = 0; i < ops.size(); i++) {
+            const auto& op = ops[i];
+            auto& result = shader.ops[i];
+            result.opcode = op.opcode;
+            result.imm = op.imm;
+            const int srcCount = getSourceCount(op.opcode);
+            for (int s = 0; s < 3; s++) {
+                const U32 v = (s < srcCount) ? op.src[s] : REGISTER_NONE;
+                if (v == REGISTER_NONE) {
+                    result.src[s] = 0;
+                    continue;
+                }
+                allocateTemporary(v);
+                result.src[s] = U16(physical[v]);
+            }
+            for (int s = 0; s < srcCount; s++) {
+                if (op.src[s] != REGISTER_NONE) {
+                    releaseTemporary(op.src[s], i);
+                }
+            }
+            if (op.dst == REGISTER_NONE) {
+                result.dst = 0;
+                continue;
+            }
+            allocateTemporary(op.dst);
+            result.dst = U16(physical[op.dst]);
+            releaseTemporary(op.dst, i);
+        }
+
+        for (Size i = 0; i < inputRegs.size(); i++) {
+            shader.inputs[i].reg = U16(physical[inputRegs[i]]);
+        }
+        for (Size i = 0; i < outputRegs.size(); i++) {
+            shader.outputs[i].reg = U16(physical[outputRegs[i]]);
+        }
+        if (count > 0xFFFF) {
+            return fail("Too many registers", count);
+        }
+        shader.registerCount = std::max<U32>(count, 1);
+        return true;
+    }
+
+public:
+    ShaderTranslator(const Module& module, SoftwareShader& shader)
+        : module(module), shader(shader) {
+    }
+
+    bool translate() {
+        // Modules built by the RSX programs are flattened into the header before compiling,
+        // modules parsed from SPIR-V store their declarations only there.
+        values.resize(module.idInstructions.size());
+
+        std::vector<Instruction*> header = module.header;
+        if (header.empty()) {
+            for (const auto* list : { &module.hEntryPoints, &module.hAnnotation, &module.hConstsTypesGlobs }) {
+                header.insert(header.end(), list->begin(), list->end());
+            }
+        }
+
+        Literal entryId = 0;
+        for (const auto* instr : header) {
+            switch (instr->opcode) {
+            case OP_ENTRY_POINT:
+                entryId = instr->operands[1];
+                break;
+            case OP_DECORATE:
+                decorations[instr->operands[0]].emplace_back(instr->operands[1],
+                    (instr->operands.size() > 2) ? instr->operands[2] : 0);
+                break;
+            case OP_MEMBER_DECORATE:
+                if (instr->operands[2] == DECORATION_BUILTIN) {
+                    memberBuiltins[std::make_pair(instr->operands[0], instr->operands[1])] = instr->operands[3];
+                }
+                break;
+            }
+        }
+        for (const auto* instr : header) {
+            switch (instr->opcode) {
+            case OP_CONSTANT:
+            case OP_CONSTANT_TRUE:
+            case OP_CONSTANT_FALSE:
+            case OP_CONSTANT_COMPOSITE:
+            case OP_CONSTANT_NULL:
+                declareConstant(instr);
+                break;
+            case OP_VARIABLE:
+                declareVariable(instr);
+                break;
+            }
+        }
+
+        const Function* entry = nullptr;
+        for (const auto* function : module.functions) {
+            if (function->getId() == entryId) {
+                entry = function;
+            }
+        }
+        if (!entry && !module.functions.empty()) {
+            entry = module.functions[0];
+        }
+        if (!entry) {
+            return fail("Module without functions", 0);
+        }
+
+        for (const auto* block : entry->blocks) {
+            for (const auto* instr : block->variables) {
+                declareVariable(instr);
+            }
+        }
+        for (const auto* block : entry->blocks) {
+            for (const auto* instr : block->instructions) {
+                if (instr->opcode == OP_BRANCH_CONDITIONAL || instr->opcode == OP_SWITCH ||
+                    instr->opcode == OP_LOOP_MERGE || instr->opcode == OP_PHI || instr->opcode == OP_FUNCTION_CALL) {
+                    return fail("Control flow is not supported", instr->opcode);
+                }
+                translateInstruction(instr);
+                if (!success) {
+                    return false;
+                }
+            }
+        }
+        return success && allocate();
+    }
+};
+
+bool SoftwareShader::initialize(const ShaderDesc& desc) {
+    type = desc.type;
+    if (!desc.module) {
+        logger.error(LOG_GRAPHICS, "SoftwareShader: No module was provided");
+        return false;
+    }
+    ShaderTranslator translator(*desc.module, *this);
+    valid = translator.translate();
+    return valid;
+}
+
+int SoftwareShader::findOutput(ShaderVariable::Kind kind, U32 index) const {
+    for (const auto& output : outputs) {
+        if (output.kind == kind && output.index == index) {
+            return output.reg;
+        }
+    }
+    return -1;
+}
+
+void SoftwareShader::prepare(std::vector<ShaderRegister>& regs) const {
+    regs.resize(registerCount);
+    std::copy(constants.begin(), constants.end(), regs.begin());
+}
+
+void SoftwareShader::execute(ShaderRegister* regs, const ShaderResources& resources, U32& mask) const {
+#ifdef NUCLEUS_ARCH_X86
+    if (core::hasHostFeature(core::HOST_FEATURE_AVX2)) {
+        avx2::executeProgram(ops.data(), ops.size(), regs, resources, mask);
+    } else {
+        sse::executeProgram(ops.data(), ops.size(), regs, resources, mask);
+    }
+#else
+    scalar::executeProgram(ops.data(), ops.size(), regs, resources, mask);
+#endif
+}
+
+}  // namespace software
+}  // namespace gfx
@@ -0,0 +1,150 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/common.h"
+#include "nucleus/graphics/shader.h"
+#include "nucleus/graphics/texture.h"
+
+#include <vector>
+
+namespace gfx {
+namespace software {
+
+// Forward declarations
+class SoftwareTexture;
+
+// Number of invocations executed together by each shader instruction
+constexpr Size SHADER_LANES = 8;
+
+// Maximum number of constant buffers and textures read by a shader
+constexpr Size SHADER_MAX_BUFFERS = 8;
+constexpr Size SHADER_MAX_TEXTURES = 16;
+
+// Register holding the four components of a value for every lane, stored component by component
+struct alignas(32) ShaderRegister {
+    F32 c[4][SHADER_LANES];
+};
+
+enum ShaderOpcode : U16 {
+    SHADER_OP_MOV,       // dst = src0
+    SHADER_OP_SWIZZLE,   // dst[i] = (sel[i] < 4) ? src0[sel[i]] : src1[sel[i] - 4]
+    SHADER_OP_ADD,       // dst = src0 + src1
+    SHADER_OP_SUB,       // dst = src0 - src1
+    SHADER_OP_MUL,       // dst = src0 * src1
+    SHADER_OP_DIV,       // dst = src0 / src1
+    SHADER_OP_MIN,       // dst = min(src0, src1)
+    SHADER_OP_MAX,       // dst = max(src0, src1)
+    SHADER_OP_MAD,       // dst = src0 * src1 + src2
+    SHADER_OP_MIX,       // dst = src0 + (src1 - src0) * src2
+    SHADER_OP_CLAMP,     // dst = min(max(src0, src1), src2)
+    SHADER_OP_SELECT,    // dst = (src0 != 0) ? src1 : src2
+    SHADER_OP_NEG,       // dst = -src0
+    SHADER_OP_ABS,       // dst = |src0|
+    SHADER_OP_FLOOR,     // dst = floor(src0)
+    SHADER_OP_CEIL,      // dst = ceil(src0)
+    SHADER_OP_FRACT,     // dst = src0 - floor(src0)
+    SHADER_OP_TRUNC,     // dst = trunc(src0)
+    SHADER_OP_SQRT,      // dst = sqrt(src0)
+    SHADER_OP_RSQ,       // dst = 1 / sqrt(src0)
+    SHADER_OP_EXP2,      // dst = 2^src0
+    SHADER_OP_LOG2,      // dst = log2(src0)
+    SHADER_OP_POW,       // dst = src0^src1
+    SHADER_OP_SIN,       // dst = sin(src0)
+    SHADER_OP_COS,       // dst = cos(src0)
+    SHADER_OP_DOT,       // dst = dot(src0, src1) over imm components, replicated
+    SHADER_OP_CMP_EQ,    // dst = (src0 == src1) ? 1 : 0
+    SHADER_OP_CMP_NE,    // dst = (src0 != src1) ? 1 : 0
+    SHADER_OP_CMP_LT,    // dst = (src0 <  src1) ? 1 : 0
+    SHADER_OP_CMP_LE,    // dst = (src0 <= src1) ? 1 : 0
+    SHADER_OP_CMP_GT,    // dst = (src0 >  src1) ? 1 : 0
+    SHADER_OP_CMP_GE,    // dst = (src0 >= src1) ? 1 : 0
+    SHADER_OP_UNIFORM,   // dst = buffer[imm >> 16][imm & 0xFFFF], replicated in every lane
+    SHADER_OP_SAMPLE,    // dst = texture[imm](src0.xy)
+    SHADER_OP_KILL,      // Discard every lane
+};
+
+struct ShaderOp {
+    ShaderOpcode opcode;
+    U16 dst;
+    U16 src[3];
+    U32 imm;  // Swizzle selectors (3 bits each), buffer location or texture binding
+};
+
+// Shader input or output
+struct ShaderVariable {
+    enum Kind : U16 {
+        KIND_LOCATION,
+        KIND_BUILTIN,
+    } kind;
+    U16 reg;     // Register holding the value
+    U32 index;   // Location or hir::BuiltIn
+};
+
+// Resources read by a batch of invocations
+struct ShaderResources {
+    const Byte* buffers[SHADER_MAX_BUFFERS];
+    Size bufferSizes[SHADER_MAX_BUFFERS];
+    const SoftwareTexture* textures[SHADER_MAX_TEXTURES];
+    const Sampler* samplers[SHADER_MAX_TEXTURES];
+};
+
+/**
+ * Software shader
+ * ===============
+ * The HIR module is translated once into a flat program over registers of SHADER_LANES
+ * invocations. Every HIR value and variable gets a register, constants are preloaded, and
+ * pointers are resolved at translation time, so the interpreter only runs arithmetic.
+ * Scalars are replicated in all four components of their register.
+ */
+class SoftwareShader : public Shader {
+public:
+    ShaderType type;
+    bool valid = false;
+
+    std::vector<ShaderOp> ops;
+    std::vector<ShaderVariable> inputs;
+    std::vector<ShaderVariable> outputs;
+
+    // Registers preloaded with the constants of the module
+    std::vector<ShaderRegister> constants;
+    Size registerCount = 0;
+
+    // Whether the program contains kill instructions
+    bool usesKill = false;
+
+    /**
+     * Translate a HIR module
+     * @param[in]  desc  Describes the shader
+     * @return           True on success
+     */
+    bool initialize(const ShaderDesc& desc);
+
+    /**
+     * Get the register assigned to an output
+     * @param[in]  kind   Location or built-in
+     * @param[in]  index  Location number or hir::BuiltIn
+     * @return            Register index, or -1 if the shader has no such output
+     */
+    int findOutput(ShaderVariable::Kind kind, U32 index) const;
+
+    /**
+     * Allocate registers for a batch and preload the constants
+     * @param[out]  regs  Register file
+     */
+    void prepare(std::vector<ShaderRegister>& regs) const;
+
+    /**
+     * Run the program over a batch of invocations. Uses AVX2 when available, SSE otherwise.
+     * @param[in]     regs       Register file, created with prepare
+     * @param[in]     resources  Buffers and textures
+     * @param[inout]  mask       Active lanes, kill instructions clear them
+     */
+    void execute(ShaderRegister* regs, const ShaderResources& resources, U32& mask) const;
+};
+
+}  // namespace software
+}  // namespace gfx
@@ -0,0 +1,165 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+/**
+ * Shader interpreter
+ * ==================
+ * Included by software_shader.cpp once per instruction set. The including namespace
+ * provides the vector type V of W lanes, the helpers v* and the SIMD_TARGET attribute.
+ * Every instruction reads its sources before writing its destination, so that a
+ * destination may share a register with a source.
+ */
+
+#define FOR_EACH_CHUNK(k, l) \
+    for (Size k = 0; k < 4; k++) \
+    for (Size l = 0; l < SHADER_LANES; l += W)
+
+#define SHADER_UNARY(expr) \
+    FOR_EACH_CHUNK(k, l) { \
+        const V x = vload(&a.c[k][l]); \
+        vstore(&d.c[k][l], expr); \
+    } \
+    break;
+
+#define SHADER_BINARY(expr) \
+    FOR_EACH_CHUNK(k, l) { \
+        const V x = vload(&a.c[k][l]); \
+        const V y = vload(&b.c[k][l]); \
+        vstore(&d.c[k][l], expr); \
+    } \
+    break;
+
+#define SHADER_TERNARY(expr) \
+    FOR_EACH_CHUNK(k, l) { \
+        const V x = vload(&a.c[k][l]); \
+        const V y = vload(&b.c[k][l]); \
+        const V z = vload(&c.c[k][l]); \
+        vstore(&d.c[k][l], expr); \
+    } \
+    break;
+
+// Functions without vector instructions are evaluated one lane at a time
+#define SHADER_SCALAR(expr) \
+    for (Size k = 0; k < 4; k++) \
+    for (Size l = 0; l < SHADER_LANES; l++) { \
+        const F32 x = a.c[k][l]; \
+        const F32 y = b.c[k][l]; \
+        (void)y; \
+        d.c[k][l] = expr; \
+    } \
+    break;
+
+SIMD_TARGET
+static void executeProgram(const ShaderOp* ops, Size count, ShaderRegister* regs, const ShaderResources& res, U32& mask) {
+    const V zero = vset(0.0f);
+    const V one = vset(1.0f);
+
+    for (Size i = 0; i < count; i++) {
+        const ShaderOp& op = ops[i];
+        ShaderRegister& d = regs[op.dst];
+        const ShaderRegister& a = regs[op.src[0]];
+        const ShaderRegister& b = regs[op.src[1]];
+        const ShaderRegister& c = regs[op.src[2]];
+
+        switch (op.opcode) {
+        case SHADER_OP_MOV:    SHADER_UNARY(x)
+        case SHADER_OP_ADD:    SHADER_BINARY(vadd(x, y))
+        case SHADER_OP_SUB:    SHADER_BINARY(vsub(x, y))
+        case SHADER_OP_MUL:    SHADER_BINARY(vmul(x, y))
+        case SHADER_OP_DIV:    SHADER_BINARY(vdiv(x, y))
+        case SHADER_OP_MIN:    SHADER_BINARY(vmin(x, y))
+        case SHADER_OP_MAX:    SHADER_BINARY(vmax(x, y))
+        case SHADER_OP_MAD:    SHADER_TERNARY(vadd(vmul(x, y), z))
+        case SHADER_OP_MIX:    SHADER_TERNARY(vadd(x, vmul(vsub(y, x), z)))
+        case SHADER_OP_CLAMP:  SHADER_TERNARY(vmin(vmax(x, y), z))
+        case SHADER_OP_SELECT: SHADER_TERNARY(vselect(x, y, z))
+        case SHADER_OP_NEG:    SHADER_UNARY(vsub(zero, x))
+        case SHADER_OP_ABS:    SHADER_UNARY(vabs(x))
+        case SHADER_OP_FLOOR:  SHADER_UNARY(vfloor(x))
+        case SHADER_OP_CEIL:   SHADER_UNARY(vceil(x))
+        case SHADER_OP_FRACT:  SHADER_UNARY(vsub(x, vfloor(x)))
+        case SHADER_OP_TRUNC:  SHADER_UNARY(vtrunc(x))
+        case SHADER_OP_SQRT:   SHADER_UNARY(vsqrt(x))
+        case SHADER_OP_RSQ:    SHADER_UNARY(vdiv(one, vsqrt(x)))
+        case SHADER_OP_CMP_EQ: SHADER_BINARY(vcmpeq(x, y, one))
+        case SHADER_OP_CMP_NE: SHADER_BINARY(vcmpne(x, y, one))
+        case SHADER_OP_CMP_LT: SHADER_BINARY(vcmplt(x, y, one))
+        case SHADER_OP_CMP_LE: SHADER_BINARY(vcmple(x, y, one))
+        case SHADER_OP_CMP_GT: SHADER_BINARY(vcmplt(y, x, one))
+        case SHADER_OP_CMP_GE: SHADER_BINARY(vcmple(y, x, one))
+        case SHADER_OP_EXP2:   SHADER_SCALAR(std::exp2(x))
+        case SHADER_OP_LOG2:   SHADER_SCALAR(std::log2(x))
+        case SHADER_OP_POW:    SHADER_SCALAR(std::pow(x, y))
+        case SHADER_OP_SIN:    SHADER_SCALAR(std::sin(x))
+        case SHADER_OP_COS:    SHADER_SCALAR(std::cos(x))
+
+        case SHADER_OP_SWIZZLE:
+            for (Size l = 0; l < SHADER_LANES; l += W) {
+                V t[4];
+                for (Size k = 0; k < 4; k++) {
+                    const U32 sel = (op.imm >> (3 * k)) & 7;
+                    t[k] = vload(sel < 4 ? &a.c[sel][l] : &b.c[sel - 4][l]);
+                }
+                for (Size k = 0; k < 4; k++) {
+                    vstore(&d.c[k][l], t[k]);
+                }
+            }
+            break;
+
+        case SHADER_OP_DOT:
+            for (Size l = 0; l < SHADER_LANES; l += W) {
+                V sum = vmul(vload(&a.c[0][l]), vload(&b.c[0][l]));
+                for (Size k = 1; k < op.imm; k++) {
+                    sum = vadd(sum, vmul(vload(&a.c[k][l]), vload(&b.c[k][l])));
+                }
+                for (Size k = 0; k < 4; k++) {
+                    vstore(&d.c[k][l], sum);
+                }
+            }
+            break;
+
+        case SHADER_OP_UNIFORM: {
+            const Size buffer = op.imm >> 16;
+            const Size offset = (op.imm & 0xFFFF) * 4 * sizeof(F32);
+            F32 value[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+            if (res.buffers[buffer] && offset + sizeof(value) <= res.bufferSizes[buffer]) {
+                memcpy(value, res.buffers[buffer] + offset, sizeof(value));
+            }
+            FOR_EACH_CHUNK(k, l) {
+                vstore(&d.c[k][l], vset(value[k]));
+            }
+            break;
+        }
+
+        case SHADER_OP_SAMPLE: {
+            const SoftwareTexture* texture = res.textures[op.imm];
+            ShaderRegister t = {};
+            if (texture && res.samplers[op.imm]) {
+                for (Size l = 0; l < SHADER_LANES; l++) {
+                    if (mask & (1 << l)) {
+                        F32 rgba[4];
+                        texture->sample(*res.samplers[op.imm], a.c[0][l], a.c[1][l], rgba);
+                        for (Size k = 0; k < 4; k++) {
+                            t.c[k][l] = rgba[k];
+                        }
+                    }
+                }
+            }
+            d = t;
+            break;
+        }
+
+        case SHADER_OP_KILL:
+            mask = 0;
+            break;
+        }
+    }
+}
+
+#undef FOR_EACH_CHUNK
+#undef SHADER_UNARY
+#undef SHADER_BINARY
+#undef SHADER_TERNARY
+#undef SHADER_SCALAR
@@ -0,0 +1,25 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/graphics/target.h"
+#include "nucleus/graphics/backend/software/software_texture.h"
+
+namespace gfx {
+namespace software {
+
+class SoftwareColorTarget : public ColorTarget {
+public:
+    SoftwareTexture* texture;
+};
+
+class SoftwareDepthStencilTarget : public DepthStencilTarget {
+public:
+    SoftwareTexture* texture;
+};
+
+}  // namespace software
+}  // namespace gfx
@@ -0,0 +1,443 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#include "software_texture.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace gfx {
+namespace software {
+
+// Helpers
+template <typename T>
+static inline T read(const Byte* src, Size index) {
+    T value;
+    memcpy(&value, src + index * sizeof(T), sizeof(T));
+    return value;
+}
+
+template <typename T>
+static inline void write(Byte* dst, Size index, T value) {
+    memcpy(dst + index * sizeof(T), &value, sizeof(T));
+}
+
+static inline F32 halfToFloat(U16 h) {
+    const U32 sign = U32(h & 0x8000) << 16;
+    U32 exponent = (h >> 10) & 0x1F;
+    U32 mantissa = h & 0x3FF;
+    U32 bits;
+    if (exponent == 0x1F) {
+        bits = sign | 0x7F800000 | (mantissa << 13);
+    } else if (exponent) {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    } else if (mantissa) {
+        // Normalize the denormal
+        exponent = 113;
+        while (!(mantissa & 0x400)) {
+            mantissa <<= 1;
+            exponent -= 1;
+        }
+        bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+    } else {
+        bits = sign;
+    }
+    F32 value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+static inline U16 floatToHalf(F32 value) {
+    U32 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const U16 sign = (bits >> 16) & 0x8000;
+    const S32 exponent = S32((bits >> 23) & 0xFF) - 112;
+    const U32 mantissa = bits & 0x7FFFFF;
+    if (((bits >> 23) & 0xFF) == 0xFF) {
+        return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+    }
+    if (exponent >= 0x1F) {
+        return sign | 0x7C00;
+    }
+    if (exponent <= 0) {
+        if (exponent < -10) {
+            return sign;
+        }
+        // Denormal, rounding to nearest even
+        const U32 m = mantissa | 0x800000;
+        const U32 shift = 14 - exponent;
+        U32 h = m >> shift;
+        const U32 rest = m & ((1 << shift) - 1);
+        const U32 half = 1 << (shift - 1);
+        if (rest > half || (rest == half && (h & 1))) {
+            h += 1;
+        }
+        return sign | U16(h);
+    }
+    U32 h = (U32(exponent) << 10) | (mantissa >> 13);
+    const U32 rest = mantissa & 0x1FFF;
+    if (rest > 0x1000 || (rest == 0x1000 && (h & 1))) {
+        h += 1;
+    }
+    return sign | U16(h);
+}
+
+static inline F32 unorm(U32 value, U32 max) {
+    return F32(value) / F32(max);
+}
+static inline F32 snorm(S32 value, S32 max) {
+    return std::max(F32(value) / F32(max), -1.0f);
+}
+static inline U32 toUnorm(F32 value, U32 max) {
+    value = std::min(std::max(value, 0.0f), 1.0f);
+    return U32(value * F32(max) + 0.5f);
+}
+static inline S32 toSnorm(F32 value, S32 max) {
+    value = std::min(std::max(value, -1.0f), 1.0f);
+    return S32(std::floor(value * F32(max) + 0.5f));
+}
+
+Size getFormatSize(Format format) {
+    switch (format) {
+    case FORMAT_R8_UINT:
+    case FORMAT_R8_UNORM:
+        return 1;
+    case FORMAT_R8G8_UINT:
+    case FORMAT_R8G8_UNORM:
+    case FORMAT_R16_FLOAT:
+    case FORMAT_R16_SINT:
+    case FORMAT_R16_SNORM:
+    case FORMAT_R16_UNORM:
+    case FORMAT_D16_UNORM:
+    case FORMAT_B5G6R5_UNORM:
+    case FORMAT_B4G4R4A4_UNORM:
+    case FORMAT_B5G5R5A1_UNORM:
+        return 2;
+    case FORMAT_R8G8B8_UINT:
+    case FORMAT_R8G8B8_UNORM:
+        return 3;
+    case FORMAT_R8G8B8A8_UINT:
+    case FORMAT_R8G8B8A8_UNORM:
+    case FORMAT_R16G16_FLOAT:
+    case FORMAT_R16G16_SINT:
+    case FORMAT_R16G16_SNORM:
+    case FORMAT_R16G16_UNORM:
+    case FORMAT_R32_FLOAT:
+    case FORMAT_R32_UINT:
+    case FORMAT_D24_UNORM_S8_UINT:
+        return 4;
+    case FORMAT_R16G16B16_FLOAT:
+    case FORMAT_R16G16B16_SINT:
+    case FORMAT_R16G16B16_SNORM:
+    case FORMAT_R16G16B16_UNORM:
+        return 6;
+    case FORMAT_R16G16B16A16_FLOAT:
+    case FORMAT_R16G16B16A16_SINT:
+    case FORMAT_R16G16B16A16_SNORM:
+    case FORMAT_R16G16B16A16_UNORM:
+    case FORMAT_R32G32_FLOAT:
+        return 8;
+    case FORMAT_R32G32B32_FLOAT:
+        return 12;
+    case FORMAT_R32G32B32A32_FLOAT:
+        return 16;
+    default:
+        return 0;
+    }
+}
+
+void decodeFormat(Format format, const Byte* src, F32* rgba) {
+    rgba[0] = 0.0f;
+    rgba[1] = 0.0f;
+    rgba[2] = 0.0f;
+    rgba[3] = 1.0f;
+
+    switch (format) {
+    case FORMAT_R8_UINT:
+    case FORMAT_R8G8_UINT:
+    case FORMAT_R8G8B8_UINT:
+    case FORMAT_R8G8B8A8_UINT:
+        for (Size i = 0; i < getFormatSize(format); i++) {
+            rgba[i] = F32(src[i]);
+        }
+        break;
+    case FORMAT_R8_UNORM:
+    case FORMAT_R8G8_UNORM:
+    case FORMAT_R8G8B8_UNORM:
+    case FORMAT_R8G8B8A8_UNORM:
+        for (Size i = 0; i < getFormatSize(format); i++) {
+            rgba[i] = unorm(src[i], 0xFF);
+        }
+        break;
+    case FORMAT_R16_FLOAT:
+    case FORMAT_R16G16_FLOAT:
+    case FORMAT_R16G16B16_FLOAT:
+    case FORMAT_R16G16B16A16_FLOAT:
+        for (Size i = 0; i < getFormatSize(format) / 2; i++) {
+            rgba[i] = halfToFloat(read<U16>(src, i));
+        }
+        break;
+    case FORMAT_R16_SINT:
+    case FORMAT_R16G16_SINT:
+    case FORMAT_R16G16B16_SINT:
+    case FORMAT_R16G16B16A16_SINT:
+        for (Size i = 0; i < getFormatSize(format) / 2; i++) {
+            rgba[i] = F32(read<S16>(src, i));
+        }
+        break;
+    case FORMAT_R16_SNORM:
+    case FORMAT_R16G16_SNORM:
+    case FORMAT_R16G16B16_SNORM:
+    case FORMAT_R16G16B16A16_SNORM:
+        for (Size i = 0; i < getFormatSize(format) / 2; i++) {
+            rgba[i] = snorm(read<S16>(src, i), 0x7FFF);
+        }
+        break;
+    case FORMAT_R16_UNORM:
+    case FORMAT_R16G16_UNORM:
+    case FORMAT_R16G16B16_UNORM:
+    case FORMAT_R16G16B16A16_UNORM:
+        for (Size i = 0; i < getFormatSize(format) / 2; i++) {
+            rgba[i] = unorm(read<U16>(src, i), 0xFFFF);
+        }
+        break;
+    case FORMAT_R32_FLOAT:
+    case FORMAT_R32G32_FLOAT:
+    case FORMAT_R32G32B32_FLOAT:
+    case FORMAT_R32G32B32A32_FLOAT:
+        for (Size i = 0; i < getFormatSize(format) / 4; i++) {
+            rgba[i] = read<F32>(src, i);
+        }
+        break;
+    case FORMAT_R32_UINT:
+        rgba[0] = F32(read<U32>(src, 0));
+        break;
+    case FORMAT_D16_UNORM:
+        rgba[0] = unorm(read<U16>(src, 0), 0xFFFF);
+        break;
+    case FORMAT_D24_UNORM_S8_UINT:
+        rgba[0] = unorm(read<U32>(src, 0) & 0xFFFFFF, 0xFFFFFF);
+        rgba[1] = F32(read<U32>(src, 0) >> 24);
+        break;
+    case FORMAT_B5G6R5_UNORM: {
+        const U16 value = read<U16>(src, 0);
+        rgba[0] = unorm((value >> 11) & 0x1F, 0x1F);
+        rgba[1] = unorm((value >> 5) & 0x3F, 0x3F);
+        rgba[2] = unorm((value >> 0) & 0x1F, 0x1F);
+        break;
+    }
+    case FORMAT_B4G4R4A4_UNORM: {
+        const U16 value = read<U16>(src, 0);
+        rgba[0] = unorm((value >> 8) & 0xF, 0xF);
+        rgba[1] = unorm((value >> 4) & 0xF, 0xF);
+        rgba[2] = unorm((value >> 0) & 0xF, 0xF);
+        rgba[3] = unorm((value >> 12) & 0xF, 0xF);
+        break;
+    }
+    case FORMAT_B5G5R5A1_UNORM: {
+        const U16 value = read<U16>(src, 0);
+        rgba[0] = unorm((value >> 10) & 0x1F, 0x1F);
+        rgba[1] = unorm((value >> 5) & 0x1F, 0x1F);
+        rgba[2] = unorm((value >> 0) & 0x1F, 0x1F);
+        rgba[3] = F32((value >> 15) & 0x1);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void encodeFormat(Format format, const F32* rgba, Byte* dst) {
+    switch (format) {
+    case FORMAT_R8_UINT:
+    case FORMAT_R8G8_UINT:
+    case FORMAT_R8G8B8_UINT:
+    case FORMAT_R8G8B8A8_UINT:
+        for (Size i = 0; i < getFormatSize(format); i++) {
+            dst[i] = U08(std::min(std::max(rgba[i], 0.0f), 255.0f));
+        }
+        break;
+    case FORMAT_R8_UNORM:
+    case FORMAT_R8G8_UNORM:
+    case FORMAT_R8G8B8_UNORM:
+    case FORMAT_R8G8B8A8_UNORM:
+        for (Size i = 0; i < getFormatSize(format); i++) {
+            dst[i] = U08(toUnorm(rgba[i], 0xFF));
+        }
+        break;
+    case FORMAT_R16_FLOAT:
+    case FORMAT_R16G16_FLOAT:
+    case FORMAT_R16G16B16_FLOAT:
+    case FORMAT_R16G16B16A16_FLOAT:
+        for (Size i = 0; i < getFormatSize(format) / 2; i++) {
+            write<U16>(dst, i, floatToHalf(rgba[i]));
+        }
+        break;
+    case FORMAT_R16_SINT:
+    case FORMAT_R16G16_SINT:
+    case FORMAT_R16G16B16_SINT:
+    case FORMAT_R16G16B16A16_SINT:
+        for (Size i = 0; i < getFormatSize(format) / 2; i++) {
+            write<S16>(dst, i, S16(std::min(std::max(rgba[i], -32768.0f), 32767.0f)));
+        }
+        break;
+    case FORMAT_R16_SNORM:
+    case FORMAT_R16G16_SNORM:
+    case FORMAT_R16G16B16_SNORM:
+    case FORMAT_R16G16B16A16_SNORM:
+        for (Size i = 0; i < getFormatSize(format) / 2; i++) {
+            write<S16>(dst, i, S16(toSnorm(rgba[i], 0x7FFF)));
+        }
+        break;
+    case FORMAT_R16_UNORM:
+    case FORMAT_R16G16_UNORM:
+    case FORMAT_R16G16B16_UNORM:
+    case FORMAT_R16G16B16A16_UNORM:
+        for (Size i = 0; i < getFormatSize(format) / 2; i++) {
+            write<U16>(dst, i, U16(toUnorm(rgba[i], 0xFFFF)));
+        }
+        break;
+    case FORMAT_R32_FLOAT:
+    case FORMAT_R32G32_FLOAT:
+    case FORMAT_R32G32B32_FLOAT:
+    case FORMAT_R32G32B32A32_FLOAT:
+        memcpy(dst, rgba, getFormatSize(format));
+        break;
+    case FORMAT_R32_UINT:
+        write<U32>(dst, 0, U32(std::max(rgba[0], 0.0f)));
+        break;
+    case FORMAT_D16_UNORM:
+        write<U16>(dst, 0, U16(toUnorm(rgba[0], 0xFFFF)));
+        break;
+    case FORMAT_D24_UNORM_S8_UINT:
+        write<U32>(dst, 0, toUnorm(rgba[0], 0xFFFFFF) | (U32(std::min(std::max(rgba[1], 0.0f), 255.0f)) << 24));
+        break;
+    case FORMAT_B5G6R5_UNORM:
+        write<U16>(dst, 0, U16(
+            (toUnorm(rgba[0], 0x1F) << 11) |
+            (toUnorm(rgba[1], 0x3F) << 5) |
+            (toUnorm(rgba[2], 0x1F) << 0)));
+        break;
+    case FORMAT_B4G4R4A4_UNORM:
+        write<U16>(dst, 0, U16(
+            (toUnorm(rgba[0], 0xF) << 8) |
+            (toUnorm(rgba[1], 0xF) << 4) |
+            (toUnorm(rgba[2], 0xF) << 0) |
+            (toUnorm(rgba[3], 0xF) << 12)));
+        break;
+    case FORMAT_B5G5R5A1_UNORM:
+        write<U16>(dst, 0, U16(
+            (toUnorm(rgba[0], 0x1F) << 10) |
+            (toUnorm(rgba[1], 0x1F) << 5) |
+            (toUnorm(rgba[2], 0x1F) << 0) |
+            (toUnorm(rgba[3], 0x1) << 15)));
+        break;
+    default:
+        break;
+    }
+}
+
+SoftwareTexture::SoftwareTexture(const TextureDesc& desc) :
+    width(0), height(0), format(desc.format), swizzle(desc.swizzle), texelSize(getFormatSize(desc.format)) {
+    resize(desc.width, desc.height);
+    if (desc.data && texelSize) {
+        // Only the first mipmap level is kept
+        memcpy(data.data(), desc.data, std::min(desc.size, data.size()));
+    }
+}
+
+void SoftwareTexture::resize(U32 width, U32 height) {
+    this->width = width;
+    this->height = height;
+    data.assign(Size(width) * height * texelSize, 0);
+}
+
+void SoftwareTexture::fill(const Byte* texel) {
+    if (!texelSize) {
+        return;
+    }
+    for (Size offset = 0; offset < data.size(); offset += texelSize) {
+        memcpy(&data[offset], texel, texelSize);
+    }
+}
+
+// Map a texel coordinate into [0, size) according to the addressing mode, or return -1 for the border
+static S32 applyAddress(TextureAddress mode, S32 coord, S32 size) {
+    switch (mode) {
+    case TEXTURE_ADDRESS_WRAP:
+        coord %= size;
+        return coord < 0 ? coord + size : coord;
+    case TEXTURE_ADDRESS_MIRROR: {
+        const S32 period = 2 * size;
+        coord %= period;
+        coord = coord < 0 ? coord + period : coord;
+        return coord < size ? coord : period - 1 - coord;
+    }
+    case TEXTURE_ADDRESS_MIRROR_ONCE:
+        coord = coord < 0 ? -1 - coord : coord;
+        return std::min(coord, size - 1);
+    case TEXTURE_ADDRESS_BORDER:
+        return (coord < 0 || coord >= size) ? -1 : coord;
+    case TEXTURE_ADDRESS_CLAMP:
+    default:
+        return std::min(std::max(coord, 0), size - 1);
+    }
+}
+
+void SoftwareTexture::sample(const Sampler& sampler, F32 u, F32 v, F32* rgba) const {
+    F32 texel[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+    if (texelSize && width && height && std::isfinite(u) && std::isfinite(v)) {
+        const auto fetch = [&](S32 x, S32 y, F32 weight) {
+            x = applyAddress(sampler.addressU, x, S32(width));
+            y = applyAddress(sampler.addressV, y, S32(height));
+            if (x < 0 || y < 0) {
+                return;  // Transparent black border
+            }
+            F32 value[4];
+            decodeFormat(format, getTexel(x, y), value);
+            for (Size i = 0; i < 4; i++) {
+                texel[i] += weight * value[i];
+            }
+        };
+
+        // Mipmaps are not kept, so only the magnification filter is relevant
+        const F32 x = u * F32(width);
+        const F32 y = v * F32(height);
+        if (sampler.filter & FILTER_MIN_POINT_MAG_LINEAR_MIP_POINT) {
+            const F32 fx = std::floor(x - 0.5f);
+            const F32 fy = std::floor(y - 0.5f);
+            const F32 ax = (x - 0.5f) - fx;
+            const F32 ay = (y - 0.5f) - fy;
+            const S32 x0 = S32(fx);
+            const S32 y0 = S32(fy);
+            fetch(x0 + 0, y0 + 0, (1.0f - ax) * (1.0f - ay));
+            fetch(x0 + 1, y0 + 0, ax * (1.0f - ay));
+            fetch(x0 + 0, y0 + 1, (1.0f - ax) * ay);
+            fetch(x0 + 1, y0 + 1, ax * ay);
+        } else {
+            fetch(S32(std::floor(x)), S32(std::floor(y)), 1.0f);
+        }
+    }
+
+    // Component swizzle
+    for (Size i = 0; i < 4; i++) {
+        const int select = (swizzle >> (TEXTURE_SWIZZLE_SHIFT * i)) & TEXTURE_SWIZZLE_MASK;
+        switch (select) {
+        case TEXTURE_SWIZZLE_VALUE_0:
+            rgba[i] = 0.0f;
+            break;
+        case TEXTURE_SWIZZLE_VALUE_1:
+            rgba[i] = 1.0f;
+            break;
+        default:
+            rgba[i] = texel[select & 3];
+            break;
+        }
+    }
+}
+
+}  // namespace software
+}  // namespace gfx
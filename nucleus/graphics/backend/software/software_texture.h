@@ -0,0 +1,90 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/common.h"
+#include "nucleus/graphics/texture.h"
+
+#include <vector>
+
+namespace gfx {
+namespace software {
+
+/**
+ * Get the size of each texel or vertex element stored with a format
+ * @param[in]  format  Format of the element
+ * @return             Size in bytes, or 0 if the format is not supported
+ */
+Size getFormatSize(Format format);
+
+/**
+ * Decode a texel or vertex element into RGBA components.
+ * Components missing from the format are set to (0, 0, 0, 1).
+ * @param[in]   format  Format of the element
+ * @param[in]   src     Element data
+ * @param[out]  rgba    Decoded components
+ */
+void decodeFormat(Format format, const Byte* src, F32* rgba);
+
+/**
+ * Encode RGBA components into a texel
+ * @param[in]   format  Format of the texel
+ * @param[in]   rgba    Components to be encoded
+ * @param[out]  dst     Texel data
+ */
+void encodeFormat(Format format, const F32* rgba, Byte* dst);
+
+class SoftwareTexture : public Texture {
+public:
+    U32 width;
+    U32 height;
+    Format format;
+    int swizzle;
+
+    // Size of each texel, or 0 if the format can't be decoded
+    Size texelSize;
+
+    // Texels of the first mipmap level, stored row by row without padding
+    std::vector<Byte> data;
+
+    SoftwareTexture(const TextureDesc& desc);
+
+    virtual void* map() override { return data.data(); }
+    virtual bool unmap() override { return true; }
+
+    // Get the address of a texel
+    Byte* getTexel(U32 x, U32 y) {
+        return &data[(Size(y) * width + x) * texelSize];
+    }
+    const Byte* getTexel(U32 x, U32 y) const {
+        return &data[(Size(y) * width + x) * texelSize];
+    }
+
+    /**
+     * Change the size of the texture, discarding its contents
+     * @param[in]  width   New width
+     * @param[in]  height  New height
+     */
+    void resize(U32 width, U32 height);
+
+    /**
+     * Set every texel to the same encoded value
+     * @param[in]  texel  Value of size texelSize
+     */
+    void fill(const Byte* texel);
+
+    /**
+     * Sample the first mipmap level, applying the component swizzle of the texture
+     * @param[in]   sampler  Filtering and addressing modes
+     * @param[in]   u        Normalized horizontal coordinate
+     * @param[in]   v        Normalized vertical coordinate
+     * @param[out]  rgba     Sampled components
+     */
+    void sample(const Sampler& sampler, F32 u, F32 v, F32* rgba) const;
+};
+
+}  // namespace software
+}  // namespace gfx
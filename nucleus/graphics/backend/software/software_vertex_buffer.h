@@ -0,0 +1,27 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/common.h"
+#include "nucleus/graphics/vertex_buffer.h"
+
+#include <vector>
+
+namespace gfx {
+namespace software {
+
+class SoftwareVertexBuffer : public VertexBuffer {
+public:
+    std::vector<Byte> data;
+
+    SoftwareVertexBuffer(Size size) : data(size) {}
+
+    virtual void* map() override { return data.data(); }
+    virtual bool unmap() override { return true; }
+};
+
+}  // namespace software
+}  // namespace gfx
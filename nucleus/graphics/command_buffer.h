@@ -69,7 +69,7 @@ public:
      * @param[in]  firstInstance  Offset to the first instance
      * @param[in]  instanceCount  Number of instances to draw
      */
-    virtual void cmdDrawIndexed(U32 firstIndex, U32 indexCount, U32 vertexOffset, U32 firstInstance, U32 instanceCount) = 0;
+    virtual void cmdDrawIndexed(U32 firstIndex, U32 indexCount, S32 vertexOffset, U32 firstInstance, U32 instanceCount) = 0;
 
     /**
      * Sets the descriptor heaps to be used by the pipeline
@@ -95,6 +95,14 @@ public:
      */
     virtual void cmdSetVertexBuffers(U32 index, U32 vtxBufferCount, VertexBuffer** vtxBuffer, U32* offsets, U32* strides) = 0;
 
+    /**
+     * Pushes a command to set the index buffer used for indexed draws
+     * @param[in]  idxBuffer  Buffer holding the indices
+     * @param[in]  offset     Offset to the first index in bytes
+     * @param[in]  format     Format of each index
+     */
+    virtual void cmdSetIndexBuffer(VertexBuffer* idxBuffer, U32 offset, IndexFormat format) = 0;
+
     /**
      * Pushes a command to set the primitive topology used for drawing
      * @param[in]  topology  Primitive topology
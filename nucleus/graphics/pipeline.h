@@ -33,6 +33,8 @@ struct InputElement {
 struct IAState {
     PrimitiveTopology topology;
     std::vector<InputElement> inputLayout;
+    bool primitiveRestart = false;                  // Indices with all bits set start a new primitive
+    IndexFormat indexFormat = INDEX_FORMAT_UINT32;  // Width of the restart index
 };
 
 // Tesselator
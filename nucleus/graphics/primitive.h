@@ -21,6 +21,11 @@ enum PrimitiveTopology {
     TOPOLOGY_QUAD_STRIP,
 };
 
+enum IndexFormat {
+    INDEX_FORMAT_UINT16,
+    INDEX_FORMAT_UINT32,
+};
+
 enum PrimitiveTopologyType {
     TOPOLOGY_TYPE_POINT,
     TOPOLOGY_TYPE_LINE,
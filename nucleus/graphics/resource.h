@@ -28,6 +28,8 @@ struct ResourceBarrier {
 
 class Resource {
 public:
+    virtual ~Resource() {}
+
     /**
      * Map this resource into the user address space
      * @return  Address where this resource was mapped into
@@ -6,19 +6,140 @@
 #include "guest_virtual_memory.h"
 #include "nucleus/logger/logger.h"
 
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <thread>
+
 #ifdef NUCLEUS_TARGET_WINDOWS
 #include <Windows.h>
+#ifdef NUCLEUS_COMPILER_MSVC
+#pragma comment(lib, "Synchronization.lib")
+#endif
 #endif
 #ifdef NUCLEUS_TARGET_LINUX
+#include <linux/futex.h>
+#include <signal.h>
 #include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 #endif
 #ifdef NUCLEUS_TARGET_OSX
+#include <signal.h>
 #include <sys/mman.h>
 #define MAP_ANONYMOUS MAP_ANON
 #endif
 
 namespace mem {
 
+// Page write tracking flags
+constexpr U32 PAGE_WRITE_PROTECTED = 0x80000000;
+constexpr U32 PAGE_WRITE_COUNTER   = 0x7FFFFFFF;
+
+// Guest memory whose watched pages are handled by the fault handlers
+static GuestVirtualMemory* watchedMemory = nullptr;
+
+static void protectPage(void* addr, bool writable) {
+#if defined(NUCLEUS_TARGET_UWP)
+#elif defined(NUCLEUS_TARGET_WINDOWS)
+    DWORD oldProtect;
+    VirtualProtect(addr, GuestVirtualMemory::WATCH_PAGE_SIZE, writable ? PAGE_READWRITE : PAGE_READONLY, &oldProtect);
+#elif defined(NUCLEUS_TARGET_LINUX) || defined(NUCLEUS_TARGET_OSX)
+    ::mprotect(addr, GuestVirtualMemory::WATCH_PAGE_SIZE, writable ? (PROT_READ | PROT_WRITE) : PROT_READ);
+#endif
+}
+
+/**
+ * Block while a word holds the expected value, up to a timeout. Might return spuriously.
+ * @param[in]  word      Word to wait on
+ * @param[in]  expected  Value the word held when last checked
+ * @param[in]  timeout   Maximum time to wait
+ */
+static void waitOnWord(std::atomic<U32>& word, U32 expected, std::chrono::microseconds timeout) {
+    static_assert(sizeof(std::atomic<U32>) == sizeof(U32), "Atomic words must be lock-free");
+#if defined(NUCLEUS_TARGET_WINDOWS) || defined(NUCLEUS_TARGET_UWP)
+    const DWORD milliseconds = DWORD(std::max<S64>((timeout.count() + 999) / 1000, 1));
+    WaitOnAddress(&word, &expected, sizeof(U32), milliseconds);
+#elif defined(NUCLEUS_TARGET_LINUX)
+    struct timespec ts;
+    ts.tv_sec = timeout.count() / 1000000;
+    ts.tv_nsec = (timeout.count() % 1000000) * 1000;
+    syscall(SYS_futex, &word, FUTEX_WAIT_PRIVATE, expected, &ts, nullptr, 0);
+#else
+    // No public address-based wait, poll the word with short sleeps
+    const auto step = std::min(timeout, std::chrono::microseconds(500));
+    if (word.load() == expected) {
+        std::this_thread::sleep_for(step);
+    }
+#endif
+}
+
+// Wake all threads blocked in waitOnWord. Safe to call from the fault handlers.
+static void wakeOnWord(std::atomic<U32>& word) {
+#if defined(NUCLEUS_TARGET_WINDOWS) || defined(NUCLEUS_TARGET_UWP)
+    WakeByAddressAll(&word);
+#elif defined(NUCLEUS_TARGET_LINUX)
+    syscall(SYS_futex, &word, FUTEX_WAKE_PRIVATE, INT_MAX, nullptr, nullptr, 0);
+#endif
+}
+
+#if defined(NUCLEUS_TARGET_UWP)
+static void installFaultHandler() {
+}
+static void removeFaultHandler() {
+}
+#elif defined(NUCLEUS_TARGET_WINDOWS)
+static PVOID faultHandle = nullptr;
+
+static LONG CALLBACK faultHandler(PEXCEPTION_POINTERS info) {
+    const auto* record = info->ExceptionRecord;
+    if (record->ExceptionCode == EXCEPTION_ACCESS_VIOLATION && record->ExceptionInformation[0] == 1 && watchedMemory &&
+        watchedMemory->handleWriteFault(reinterpret_cast<const void*>(record->ExceptionInformation[1]))) {
+        return EXCEPTION_CONTINUE_EXECUTION;
+    }
+    return EXCEPTION_CONTINUE_SEARCH;
+}
+static void installFaultHandler() {
+    faultHandle = AddVectoredExceptionHandler(1, faultHandler);
+}
+static void removeFaultHandler() {
+    RemoveVectoredExceptionHandler(faultHandle);
+}
+#elif defined(NUCLEUS_TARGET_LINUX) || defined(NUCLEUS_TARGET_OSX)
+static const int faultSignals[] = { SIGSEGV, SIGBUS };
+static struct sigaction faultPrevActions[2];
+
+static void faultHandler(int sig, siginfo_t* info, void* context) {
+    if (watchedMemory && watchedMemory->handleWriteFault(info->si_addr)) {
+        return;
+    }
+
+    // Forward any other fault to the previous handler, or crash as usual
+    const auto& prev = faultPrevActions[(sig == SIGSEGV) ? 0 : 1];
+    if (prev.sa_flags & SA_SIGINFO) {
+        prev.sa_sigaction(sig, info, context);
+    } else if (prev.sa_handler != SIG_DFL && prev.sa_handler != SIG_IGN) {
+        prev.sa_handler(sig);
+    } else {
+        ::signal(sig, SIG_DFL);
+    }
+}
+static void installFaultHandler() {
+    struct sigaction action = {};
+    action.sa_sigaction = faultHandler;
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+    for (int i = 0; i < 2; i++) {
+        ::sigaction(faultSignals[i], &action, &faultPrevActions[i]);
+    }
+}
+static void removeFaultHandler() {
+    for (int i = 0; i < 2; i++) {
+        ::sigaction(faultSignals[i], &faultPrevActions[i], nullptr);
+    }
+}
+#endif
+
 GuestVirtualMemory::GuestVirtualMemory(Size amount) {
     // Reserve 4 GB of memory for any 32-bit pointer in the PS3 memory
 #if defined(NUCLEUS_TARGET_UWP)
@@ -45,9 +166,23 @@ GuestVirtualMemory::GuestVirtualMemory(Size amount) {
 
     // Allocate SPU-related memory
     m_segments[SEG_SPU].alloc(0x10000000);
+
+    // Write tracking
+    const Size pageCount = 0x100000000ULL >> WATCH_PAGE_BITS;
+    m_pageWrites = std::make_unique<std::atomic<U32>[]>(pageCount);
+    for (Size i = 0; i < pageCount; i++) {
+        m_pageWrites[i].store(0, std::memory_order_relaxed);
+    }
+    m_writeSequence = 0;
+    m_writeWaiters = 0;
+    watchedMemory = this;
+    installFaultHandler();
 }
 
 GuestVirtualMemory::~GuestVirtualMemory() {
+    removeFaultHandler();
+    watchedMemory = nullptr;
+
     bool success;
 #if defined(NUCLEUS_TARGET_UWP)
     success = false;
@@ -73,6 +208,89 @@ bool GuestVirtualMemory::check(U64 addr) {
     return true;
 }
 
+/**
+ * Write tracking
+ */
+void GuestVirtualMemory::watchWrites(U32 addr, U32 size) {
+    const U64 first = addr >> WATCH_PAGE_BITS;
+    const U64 last = (U64(addr) + size - 1) >> WATCH_PAGE_BITS;
+    for (U64 page = first; size && page <= last; page++) {
+        // Flag the page before protecting it, so that a racing fault is recognized
+        const U32 state = m_pageWrites[page].fetch_or(PAGE_WRITE_PROTECTED);
+        if (!(state & PAGE_WRITE_PROTECTED)) {
+            protectPage(ptr(U32(page << WATCH_PAGE_BITS)), false);
+        }
+    }
+}
+
+U64 GuestVirtualMemory::getWriteCount(U32 addr, U32 size) {
+    const U64 first = addr >> WATCH_PAGE_BITS;
+    const U64 last = (U64(addr) + size - 1) >> WATCH_PAGE_BITS;
+    U64 count = 0;
+    for (U64 page = first; size && page <= last; page++) {
+        count += m_pageWrites[page].load(std::memory_order_acquire) & PAGE_WRITE_COUNTER;
+    }
+    return count;
+}
+
+void GuestVirtualMemory::notifyWrites(U32 addr, U32 size) {
+    const U64 first = addr >> WATCH_PAGE_BITS;
+    const U64 last = (U64(addr) + size - 1) >> WATCH_PAGE_BITS;
+    for (U64 page = first; size && page <= last; page++) {
+        if (m_pageWrites[page].load(std::memory_order_relaxed) & PAGE_WRITE_PROTECTED) {
+            handleWriteFault(ptr(U32(page << WATCH_PAGE_BITS)));
+        }
+    }
+}
+
+bool GuestVirtualMemory::handleWriteFault(const void* hostAddr) {
+    const U64 offset = reinterpret_cast<U64>(hostAddr) - reinterpret_cast<U64>(m_base);
+    if (offset >= 0x100000000ULL) {
+        return false;
+    }
+
+    // Pages never watched are not protected by us, the fault is unrelated
+    const U64 page = offset >> WATCH_PAGE_BITS;
+    auto& pageWrites = m_pageWrites[page];
+    U32 state = pageWrites.load(std::memory_order_acquire);
+    if (state == 0) {
+        return false;
+    }
+
+    // Unprotect before clearing the flag, so that unflagged pages are always writable
+    protectPage(ptr(U32(page << WATCH_PAGE_BITS)), true);
+    while (!pageWrites.compare_exchange_weak(state, ((state & PAGE_WRITE_COUNTER) + 1) & PAGE_WRITE_COUNTER)) {
+    }
+
+    // Runs inside the fault handlers: no locks, only atomics and the wake system call
+    m_writeSequence.fetch_add(1);
+    if (m_writeWaiters.load()) {
+        wakeOnWord(m_writeSequence);
+    }
+    return true;
+}
+
+bool GuestVirtualMemory::waitWrites(U32 addr, U32 size, U64 writeCount, std::chrono::microseconds timeout) {
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+    bool written = false;
+    m_writeWaiters += 1;
+    while (true) {
+        // Read the sequence before the counters, so that a write in between makes the wait return
+        const U32 sequence = m_writeSequence.load();
+        if (getWriteCount(addr, size) != writeCount) {
+            written = true;
+            break;
+        }
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            break;
+        }
+        waitOnWord(m_writeSequence, sequence, std::chrono::duration_cast<std::chrono::microseconds>(deadline - now));
+    }
+    m_writeWaiters -= 1;
+    return written;
+}
+
 /**
  * Read memory reversing endianness if necessary
  */
@@ -9,6 +9,10 @@
 #include "nucleus/memory/memory.h"
 #include "nucleus/memory/guest_virtual/guest_virtual_segment.h"
 
+#include <atomic>
+#include <chrono>
+#include <memory>
+
 namespace mem {
 
 enum {
@@ -50,7 +54,18 @@ class GuestVirtualMemory : public Memory {
     void* m_base;
     Segment m_segments[_SEG_COUNT];
 
+    // Write tracking state of each 4 KB page: protection flag and write counter
+    std::unique_ptr<std::atomic<U32>[]> m_pageWrites;
+
+    // Incremented by the fault handler after each write. Threads blocked in waitWrites
+    // wait on its address, since the handler cannot take locks.
+    std::atomic<U32> m_writeSequence;
+    std::atomic<U32> m_writeWaiters;
+
 public:
+    static constexpr U32 WATCH_PAGE_BITS = 12;
+    static constexpr U32 WATCH_PAGE_SIZE = 1 << WATCH_PAGE_BITS;
+
     GuestVirtualMemory(Size amount);
     ~GuestVirtualMemory();
 
@@ -77,6 +92,49 @@ public:
 
     void* getBaseAddr() { return m_base; }
 
+    /**
+     * Write-protect the pages of a range. The first write to each of them afterwards
+     * removes the protection and increments the page write counter.
+     * @param[in]  addr  Guest address of the range
+     * @param[in]  size  Size of the range in bytes
+     */
+    void watchWrites(U32 addr, U32 size);
+
+    /**
+     * Get the sum of the write counters of the pages of a range. This value changes
+     * whenever a watched page of the range is written.
+     * @param[in]  addr  Guest address of the range
+     * @param[in]  size  Size of the range in bytes
+     * @return           Sum of the write counters
+     */
+    U64 getWriteCount(U32 addr, U32 size);
+
+    /**
+     * Count a write to the watched pages of a range, performed without the host CPU
+     * writing to them (e.g. by the host OS), which would otherwise fail on protected pages.
+     * @param[in]  addr  Guest address of the range
+     * @param[in]  size  Size of the range in bytes
+     */
+    void notifyWrites(U32 addr, U32 size);
+
+    /**
+     * Block until a watched page of a range is written. Since writes are detected right before
+     * being performed, the written value might not be visible immediately after returning.
+     * @param[in]  addr        Guest address of the range
+     * @param[in]  size        Size of the range in bytes
+     * @param[in]  writeCount  Write count of the range obtained before watching it
+     * @param[in]  timeout     Maximum time to wait
+     * @return                 True if the range was written, false on timeout
+     */
+    bool waitWrites(U32 addr, U32 size, U64 writeCount, std::chrono::microseconds timeout);
+
+    /**
+     * Handle an access violation of the host CPU inside the guest memory
+     * @param[in]  hostAddr  Host address that caused the fault
+     * @return               True if it was a write to a watched page, which can be retried
+     */
+    bool handleWriteFault(const void* hostAddr);
+
     Segment& getSegment(size_t id) { return m_segments[id]; }
 
     template <typename T>
@@ -105,6 +105,20 @@ bool nucleusInitialize(HWND hwnd, HDC hdc, int width, int height) {
 bool Nucleus::initialize(gfx::BackendParameters& params) {
     // Select graphics backend
     switch (config.graphicsBackend) {
+    case GRAPHICS_BACKEND_NULL: {
+        U32 flags = gfx::null::NULL_BACKEND_FLAG_NONE;
+        if (config.nullCounters) {
+            flags |= gfx::null::NULL_BACKEND_FLAG_COUNTERS;
+        }
+        if (!config.nullTrace.empty()) {
+            flags |= gfx::null::NULL_BACKEND_FLAG_TRACE;
+        }
+        graphics = std::make_unique<gfx::NullBackend>(flags, config.nullTrace);
+        break;
+    }
+    case GRAPHICS_BACKEND_SOFTWARE:
+        graphics = std::make_unique<gfx::SoftwareBackend>(config.softwareThreads > 0 ? config.softwareThreads : 0);
+        break;
 #if defined(NUCLEUS_FEATURE_GFXBACKEND_DIRECT3D11)
     case GRAPHICS_BACKEND_DIRECT3D11:
         graphics = std::make_unique<gfx::Direct3D11Backend>();
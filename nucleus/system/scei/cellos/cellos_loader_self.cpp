@@ -6,8 +6,12 @@
 #include "cellos_loader_self.h"
 #include "nucleus/common.h"
 #include "nucleus/core/config.h"
+#include "nucleus/core/hash.h"
+#include "nucleus/core/host.h"
+#include "nucleus/core/worker_pool.h"
 #include "nucleus/emulator.h"
 #include "nucleus/cpu/cpu_guest.h"
+#include "nucleus/filesystem/filesystem_host.h"
 #include "nucleus/memory/guest_virtual/guest_virtual_memory.h"
 #include "nucleus/cpu/frontend/ppu/ppu_decoder.h"
 #include "nucleus/system/keys.h"
@@ -21,27 +25,165 @@
 #include "externals/aes.h"
 #include <zlib.h>
 
+#ifdef NUCLEUS_ARCH_X86
+#ifdef NUCLEUS_COMPILER_MSVC
+#include <intrin.h>
+#define TARGET_AES
+#else
+#include <x86intrin.h>
+#define TARGET_AES __attribute__((target("aes,sse2")))
+#endif
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
 #include <cstring>
 
 namespace sys {
 namespace scei {
 namespace cellos {
 
+// Decrypted SELF cache
+constexpr U32 SELF_CACHE_MAGIC = 0x464C4553;  // "SELF"
+constexpr U32 SELF_CACHE_VERSION = 1;
+
+struct SelfCacheHeader {
+    U32 magic;
+    U32 version;
+    U64 key;        // Key of the SELF file the ELF file was decrypted from
+    U64 elfSize;    // Size of the ELF file following the header
+};
+
+// Get the path of the cached ELF file, creating its directory if needed
+static std::string getCacheFilePath(U64 key) {
+    const std::string directory = config.cachePath + "/self";
+    if (!fs::HostFileSystem::createDirectory(directory)) {
+        logger.warning(LOG_LOADER, "Could not create cache directory: %s", directory.c_str());
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "%016llX.elf", static_cast<unsigned long long>(key));
+    return directory + "/" + name;
+}
+
+// Get the workers decrypting the sections of SELF files, shared by every loader
+static core::WorkerPool& getDecryptPool() {
+    static core::WorkerPool pool;
+    return pool;
+}
+
+// Increment a big-endian AES-CTR counter
+static void incrementCounter(U08 counter[16]) {
+    for (int i = 15; i >= 0; i--) {
+        if (++counter[i] != 0) {
+            break;
+        }
+    }
+}
+
+#ifdef NUCLEUS_ARCH_X86
+/**
+ * AES-CTR with AES-NI, processing four counter blocks at once to hide the latency of AESENC.
+ * The round keys expanded by aes_setkey_enc are stored in the byte order expected by AESENC.
+ */
+TARGET_AES
+static void cryptCtrAESNI(const aes_context& aes, U08 counter[16], const U08* input, U08* output, Size size) {
+    __m128i rk[15];
+    for (int i = 0; i <= aes.nr; i++) {
+        rk[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(aes.rk + 4 * i));
+    }
+
+    alignas(16) U08 blocks[4][16];
+    while (size > 0) {
+        __m128i b[4];
+        for (int k = 0; k < 4; k++) {
+            memcpy(blocks[k], counter, 16);
+            incrementCounter(counter);
+            b[k] = _mm_xor_si128(_mm_load_si128(reinterpret_cast<const __m128i*>(blocks[k])), rk[0]);
+        }
+        for (int i = 1; i < aes.nr; i++) {
+            for (int k = 0; k < 4; k++) {
+                b[k] = _mm_aesenc_si128(b[k], rk[i]);
+            }
+        }
+        for (int k = 0; k < 4; k++) {
+            b[k] = _mm_aesenclast_si128(b[k], rk[aes.nr]);
+        }
+
+        if (size >= 64) {
+            for (int k = 0; k < 4; k++) {
+                const __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(input) + k);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(output) + k, _mm_xor_si128(data, b[k]));
+            }
+            input += 64;
+            output += 64;
+            size -= 64;
+        } else {
+            // Counters generated beyond the end of the data are not consumed
+            for (int k = 0; k < 4; k++) {
+                _mm_store_si128(reinterpret_cast<__m128i*>(blocks[k]), b[k]);
+            }
+            const U08* stream = blocks[0];
+            for (Size i = 0; i < size; i++) {
+                output[i] = input[i] ^ stream[i];
+            }
+            size = 0;
+        }
+    }
+}
+#endif
+
+/**
+ * Decrypt data with AES-128-CTR, starting at the beginning of the key stream
+ * @param[in]  key     Key
+ * @param[in]  iv      Initial counter
+ * @param[in]  input   Encrypted data
+ * @param[out] output  Decrypted data, which may be the same buffer as the input
+ * @param[in]  size    Number of bytes
+ */
+static void decryptCtr(const U08 key[16], const U08 iv[16], const U08* input, U08* output, Size size) {
+    aes_context aes;
+    U08 counter[16];
+    memcpy(counter, iv, 16);
+    aes_setkey_enc(&aes, key, 128);
+
+#ifdef NUCLEUS_ARCH_X86
+    if (core::hasHostFeature(core::HOST_FEATURE_AESNI)) {
+        cryptCtrAESNI(aes, counter, input, output, size);
+        return;
+    }
+#endif
+    U08 ctr_stream_block[0x10] = {};
+    Size ctr_nc_off = 0;
+    aes_crypt_ctr(&aes, size, &ctr_nc_off, counter, ctr_stream_block, input, output);
+}
+
 bool SELFLoader::open(fs::File* file)
 {
-    const U64 selfSize = file->attributes().size;
+    const auto attributes = file->attributes();
+    const U64 selfSize = attributes.size;
     self.resize(selfSize);
     file->seek(0, fs::SeekSet);
     file->read(&self[0], selfSize);
 
     switch (detectFiletype(file)) {
     case FILETYPE_SELF:
-        decrypt();
-        return true;
+        if (config.selfCache && !config.cachePath.empty()) {
+            // Decryption modifies the SELF headers, so the key is computed first
+            const U64 key = getCacheKey(attributes);
+            if (loadCache(key)) {
+                return true;
+            }
+            if (!decrypt()) {
+                return false;
+            }
+            saveCache(key);
+            return true;
+        }
+        return decrypt();
 
     case FILETYPE_ELF:
-        elf.resize(selfSize);
-        memcpy(&elf[0], &self[0], selfSize);
+        elf.swap(self);
         return true;
 
     default:
@@ -320,6 +462,64 @@ void SELFLoader::close()
     self.clear();
 }
 
+U64 SELFLoader::getCacheKey(const fs::File::Attributes& attributes)
+{
+    const auto& sce_header = (SceHeader&)self[0x0];
+    const Size headerSize = std::min<Size>(sce_header.hsize, self.size());
+    U64 key = core::hashBytes(&self[0], headerSize);
+    key = core::hashBytes(&attributes.size, sizeof(attributes.size), key);
+    key = core::hashBytes(&attributes.timestamp_write, sizeof(attributes.timestamp_write), key);
+    return key;
+}
+
+bool SELFLoader::loadCache(U64 key)
+{
+    const std::string path = getCacheFilePath(key);
+    if (!fs::HostFileSystem::existsFile(path)) {
+        return false;
+    }
+    auto file = fs::HostFileSystem::openFile(path, fs::Read);
+    if (!file) {
+        return false;
+    }
+
+    // Entries are discarded if they are outdated or truncated
+    SelfCacheHeader header;
+    const auto fileSize = file->attributes().size;
+    if (file->read(&header, sizeof(header)) != sizeof(header) ||
+        header.magic != SELF_CACHE_MAGIC ||
+        header.version != SELF_CACHE_VERSION ||
+        header.key != key ||
+        header.elfSize != fileSize - sizeof(header)) {
+        logger.notice(LOG_LOADER, "Discarding outdated SELF cache entry: %s", path.c_str());
+        return false;
+    }
+    elf.resize(header.elfSize);
+    if (file->read(elf.data(), elf.size()) != elf.size()) {
+        elf.clear();
+        return false;
+    }
+    return true;
+}
+
+bool SELFLoader::saveCache(U64 key)
+{
+    const std::string path = getCacheFilePath(key);
+    auto file = fs::HostFileSystem::openFile(path, fs::Write);
+    if (!file) {
+        logger.warning(LOG_LOADER, "Could not create SELF cache entry: %s", path.c_str());
+        return false;
+    }
+
+    SelfCacheHeader header;
+    header.magic = SELF_CACHE_MAGIC;
+    header.version = SELF_CACHE_VERSION;
+    header.key = key;
+    header.elfSize = elf.size();
+    return file->write(&header, sizeof(header)) == sizeof(header) &&
+           file->write(elf.data(), elf.size()) == elf.size();
+}
+
 bool SELFLoader::decryptMetadata()
 {
     aes_context aes;
@@ -345,7 +545,7 @@ bool SELFLoader::decryptMetadata()
         case 1: // Network license
         case 2: // Local license
             logger.error(LOG_LOADER, "NPDRM Network / Local licenses not yet supported");
-            break;
+            return false;
         case 3: // Free license
             memcpy(npdrm_key, NP_KLIC_FREE, 0x10);
             break;
@@ -406,6 +606,35 @@ U32 SELFLoader::getDecryptedElfSize()
     return size;
 }
 
+bool SELFLoader::decryptSection(const MetadataSectionHeader& meta_shdr, const Phdr& meta_phdr, const U08* data_keys)
+{
+    Byte* src = &self[meta_shdr.data_offset];
+    Byte* dst = &elf[meta_phdr.offset];
+    const Size size = meta_shdr.data_size;
+    const bool compressed = (meta_shdr.compressed == 2);
+
+    // Decrypt if necessary. Compressed data is decrypted in place, to be inflated from there
+    if (meta_shdr.encrypted == 3) {
+        decryptCtr(data_keys + meta_shdr.key_idx * 0x10, data_keys + meta_shdr.iv_idx * 0x10, src, compressed ? src : dst, size);
+        if (!compressed) {
+            return true;
+        }
+    }
+
+    // Decompress if necessary
+    if (compressed) {
+        uLongf length = meta_phdr.filesz;
+        if (uncompress(dst, &length, src, uLong(size)) != Z_OK) {
+            logger.error(LOG_LOADER, "Could not decompress the data of segment %d", U32(meta_shdr.program_idx));
+            return false;
+        }
+    }
+    else {
+        memcpy(dst, src, size);
+    }
+    return true;
+}
+
 bool SELFLoader::decrypt()
 {
     if (self.empty()) {
@@ -429,7 +658,9 @@ bool SELFLoader::decrypt()
      */
     else {
         // Get Metadata Information
-        decryptMetadata();
+        if (!decryptMetadata()) {
+            return false;
+        }
         const U32 meta_header_off = sizeof(SceHeader) + sce_header.meta + sizeof(MetadataInfo);
         const auto& meta_header = (MetadataHeader&)self[meta_header_off];
         const U08* data_keys = (U08*)&self[meta_header_off + sizeof(MetadataHeader) + meta_header.section_count * sizeof(MetadataSectionHeader)];
@@ -449,46 +680,34 @@ bool SELFLoader::decrypt()
         memcpy(elf_shdrs, self_shdrs, ehdr.shnum * sizeof(Shdr));
 
         // Write Data
-        aes_context aes;
+        std::vector<U32> sections;
         for (U32 i = 0; i < meta_header.section_count; i++) {
             const auto& meta_shdr = (MetadataSectionHeader&)self[meta_header_off + sizeof(MetadataHeader) + i*sizeof(MetadataSectionHeader)];
-            const auto& meta_phdr = (Phdr&)self[self_header.phdroff + meta_shdr.program_idx * sizeof(Phdr)];
             // Check if PHDR type
-            if (meta_shdr.type != 2) {
-                continue;
+            if (meta_shdr.type == 2) {
+                sections.push_back(i);
             }
-
-            U08* data_decrypted = new U08[meta_shdr.data_size.ToLE()]();
-            U08* data_decompressed = new U08[meta_phdr.filesz.ToLE()]();
-
-            // Decrypt if necessary
-            if (meta_shdr.encrypted == 3) {
-                U08 data_key[0x10];
-                U08 data_iv[0x10];
-                memcpy(data_key, data_keys + meta_shdr.key_idx * 0x10, 0x10);
-                memcpy(data_iv, data_keys + meta_shdr.iv_idx * 0x10, 0x10);
-                memcpy(data_decrypted, &self[meta_shdr.data_offset], meta_shdr.data_size);
-
-                // Perform AES-CTR encryption on the data
-                U08 ctr_stream_block[0x10] = {};
-                Size ctr_nc_off = 0;
-                aes_setkey_enc(&aes, data_key, 128);
-                aes_crypt_ctr(&aes, meta_shdr.data_size, &ctr_nc_off, data_iv, ctr_stream_block, data_decrypted, data_decrypted);
+        }
+        std::atomic<bool> succeeded{ true };
+        auto processSection = [&](U32 i) {
+            const auto& meta_shdr = (MetadataSectionHeader&)self[meta_header_off + sizeof(MetadataHeader) + i*sizeof(MetadataSectionHeader)];
+            const auto& meta_phdr = (Phdr&)self[self_header.phdroff + meta_shdr.program_idx * sizeof(Phdr)];
+            if (!decryptSection(meta_shdr, meta_phdr, data_keys)) {
+                succeeded = false;
             }
-
-            // Decompress if necessary
-            if (meta_shdr.compressed == 2) {
-                unsigned long length = meta_phdr.filesz;
-                uncompress(data_decompressed, &length, data_decrypted, (U32)meta_shdr.data_size);
-                memcpy(&elf[meta_phdr.offset], data_decompressed, meta_phdr.filesz);
+        };
+        if (sections.size() > 1) {
+            auto& pool = getDecryptPool();
+            for (U32 i : sections) {
+                pool.submit([&, i] { processSection(i); });
             }
-            else {
-                memcpy(&elf[meta_phdr.offset], data_decrypted, meta_shdr.data_size);
+            pool.wait();
+        } else {
+            for (U32 i : sections) {
+                processSection(i);
             }
-
-            delete[] data_decrypted;
-            delete[] data_decompressed;
         }
+        return succeeded;
     }
     return true;
 }
@@ -181,6 +181,18 @@ protected:
     // by using accessing the SELF's EHDR and decrypted Metadata headers.
     U32 getDecryptedElfSize();
 
+    // Decrypts and decompresses a section of the SELF file into its segment of the ELF file.
+    // Each section only modifies its own data, so sections can be processed concurrently.
+    // Returns false if the data could not be decompressed.
+    bool decryptSection(const MetadataSectionHeader& meta_shdr, const Phdr& meta_phdr, const U08* data_keys);
+
+    // Returns the key of the SELF file in the decrypted SELF cache
+    U64 getCacheKey(const fs::File::Attributes& attributes);
+
+    // Loads the decrypted ELF file from the cache, or stores it there
+    bool loadCache(U64 key);
+    bool saveCache(U64 key);
+
     void process_seg_custom_os(System* sys, const Phdr& phdr, std::vector<Byte>& data);
     void process_seg_custom_proc(System* sys, const Phdr& phdr, std::vector<Byte>& data);
 
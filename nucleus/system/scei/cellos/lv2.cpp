@@ -132,16 +132,16 @@ LV2::LV2(Emulator* emulator, std::shared_ptr<mem::Memory> memory, U32 fw_type)
         //syscalls[0x0B0] = SYSCALL_WRAP(sys_spu_thread_group_yield, LV2_NONE);
         //syscalls[0x0B1] = SYSCALL_WRAP(sys_spu_thread_group_terminate, LV2_NONE);
         syscalls[0x0B2] = SYSCALL_WRAP(sys_spu_thread_group_join, LV2_NONE);
-        //syscalls[0x0B3] = SYSCALL_WRAP(sys_spu_thread_group_set_priority, LV2_NONE);
-        //syscalls[0x0B4] = SYSCALL_WRAP(sys_spu_thread_group_get_priority, LV2_NONE);
+        syscalls[0x0B3] = SYSCALL_WRAP(sys_spu_thread_group_set_priority, LV2_NONE);
+        syscalls[0x0B4] = SYSCALL_WRAP(sys_spu_thread_group_get_priority, LV2_NONE);
         //syscalls[0x0B5] = SYSCALL_WRAP(sys_spu_thread_write_ls, LV2_NONE);
         syscalls[0x0B6] = SYSCALL_WRAP(sys_spu_thread_read_ls, LV2_NONE);
-        //syscalls[0x0B8] = SYSCALL_WRAP(sys_spu_thread_write_snr, LV2_NONE);
+        syscalls[0x0B8] = SYSCALL_WRAP(sys_spu_thread_write_snr, LV2_NONE);
         syscalls[0x0B9] = SYSCALL_WRAP(sys_spu_thread_group_connect_event, LV2_NONE);
         //syscalls[0x0BA] = SYSCALL_WRAP(sys_spu_thread_group_disconnect_event, LV2_NONE);
         //syscalls[0x0BB] = SYSCALL_WRAP(sys_spu_thread_set_spu_cfg, LV2_NONE);
         //syscalls[0x0BC] = SYSCALL_WRAP(sys_spu_thread_get_spu_cfg, LV2_NONE);
-        //syscalls[0x0BE] = SYSCALL_WRAP(sys_spu_thread_write_spu_mb, LV2_NONE);
+        syscalls[0x0BE] = SYSCALL_WRAP(sys_spu_thread_write_spu_mb, LV2_NONE);
         //syscalls[0x0BF] = SYSCALL_WRAP(sys_spu_thread_connect_event, LV2_NONE);
         //syscalls[0x0C0] = SYSCALL_WRAP(sys_spu_thread_disconnect_event, LV2_NONE);
         //syscalls[0x0C1] = SYSCALL_WRAP(sys_spu_thread_bind_queue, LV2_NONE);
@@ -66,6 +66,10 @@ HLE_FUNCTION(sys_fs_read, S32 fd, void* buf, U64 nbytes, BE<U64>* nread) {
     auto* descriptor = kernel.objects.get<sys_fs_t>(fd);
     auto* file = descriptor->file;
 
+    // The host OS cannot write into pages protected to track writes
+    const U64 addr = reinterpret_cast<U64>(buf) - reinterpret_cast<U64>(kernel.memory->getBaseAddr());
+    kernel.memory->notifyWrites(U32(addr), U32(nbytes));
+
     *nread = file->read(buf, nbytes);
     return CELL_OK;
 }
@@ -15,6 +15,16 @@ enum {
     SYS_MEMORY_PAGE_SIZE_64K = 0x200,
 };
 
+// Access rights
+enum {
+    SYS_MEMORY_ACCESS_RIGHT_NONE    = 0x0,
+    SYS_MEMORY_ACCESS_RIGHT_RAW_SPU = 0x1,
+    SYS_MEMORY_ACCESS_RIGHT_SPU_THR = 0x2,
+    SYS_MEMORY_ACCESS_RIGHT_HANDLER = 0x4,
+    SYS_MEMORY_ACCESS_RIGHT_PPU_THR = 0x8,
+    SYS_MEMORY_ACCESS_RIGHT_ANY     = 0xF,
+};
+
 struct sys_memory_info_t
 {
     BE<U32> total_user_memory;
@@ -4,6 +4,7 @@
  */
 
 #include "sys_process.h"
+#include "sys_memory.h"
 #include "nucleus/logger/logger.h"
 #include "nucleus/emulator.h"
 #include "../lv2.h"
@@ -36,7 +37,14 @@ HLE_FUNCTION(sys_process_get_sdk_version, U32 pid, BE<U32>* version) {
 }
 
 HLE_FUNCTION(sys_process_is_spu_lock_line_reservation_address, U32 addr, U64 flags) {
-    logger.warning(LOG_HLE, "LV2 Syscall (0x00E) called: sys_process_is_spu_lock_line_reservation_address");
+    if (!flags || (flags & ~(SYS_MEMORY_ACCESS_RIGHT_SPU_THR | SYS_MEMORY_ACCESS_RIGHT_RAW_SPU))) {
+        return CELL_EINVAL;
+    }
+
+    // Every mapped line can be reserved, since reservations are tracked by cpu::ReservationTable
+    if (!kernel.memory->check(addr)) {
+        return CELL_EPERM;
+    }
     return CELL_OK;
 }
 
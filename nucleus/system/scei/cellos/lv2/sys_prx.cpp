@@ -88,7 +88,7 @@ HLE_FUNCTION(sys_prx_start_module, S32 id, U64 flags, sys_prx_start_module_optio
                         kernel.memory->write32(hookAddr + 20, 0);                                    // OPD: Function RTOC
                         kernel.memory->write32(importedLibrary.fstub_addr + 4*i, hookAddr + 16);
                     }
-                    if (config.ppuTranslator == CPU_TRANSLATOR_FUNCTION) {
+                    if (config.ppuTranslator & (CPU_TRANSLATOR_FUNCTION | CPU_TRANSLATOR_MODULE)) {
                         const U32 addr = lib.exports.at(fnid);
                         const U32 func_addr = kernel.memory->read32(addr + 0);
                         const U32 func_rtoc = kernel.memory->read32(addr + 4);
@@ -95,13 +95,8 @@ HLE_FUNCTION(sys_rsx_context_free, U32 context_id)
  */
 HLE_FUNCTION(sys_rsx_context_iomap, U32 context_id, U32 io, U32 ea, U32 size, U64 flags)
 {
-    gpu::rsx::rsx_iomap_t iomap;
-    iomap.io = io;
-    iomap.ea = ea;
-    iomap.size = size;
-
     // TODO: Implement flags
-    static_cast<gpu::rsx::RSX*>(kernel.getEmulator()->gpu.get())->iomaps.push_back(iomap);
+    static_cast<gpu::rsx::RSX*>(kernel.getEmulator()->gpu.get())->iomap(io, ea, size);
     return CELL_OK;
 }
 
@@ -114,7 +109,7 @@ HLE_FUNCTION(sys_rsx_context_iomap, U32 context_id, U32 io, U32 ea, U32 size, U6
  */
 HLE_FUNCTION(sys_rsx_context_iounmap, U32 context_id, U32 a2, U32 io_addr, U32 size)
 {
-    logger.warning(LOG_HLE, "LV2 Syscall (0x2A1) called: sys_rsx_context_iounmap");
+    static_cast<gpu::rsx::RSX*>(kernel.getEmulator()->gpu.get())->iounmap(io_addr, size);
     return CELL_OK;
 }
 
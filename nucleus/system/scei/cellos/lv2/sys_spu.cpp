@@ -87,6 +87,7 @@ HLE_FUNCTION(sys_spu_thread_initialize, BE<U32>* thread, U32 group, U32 spu_num,
     auto* spuThread = new SPUThread();
     spuThread->parent = spuThreadGroup;
     spuThread->thread = static_cast<cpu::frontend::spu::SPUThread*>(cpu->addThread(cpu::THREAD_TYPE_SPU));
+    spuThread->thread->priority = spuThreadGroup->prio;
     if (0 /*TODO*/) {
         spuThread->name = attr->name;
     }
@@ -111,7 +112,7 @@ HLE_FUNCTION(sys_spu_thread_initialize, BE<U32>* thread, U32 group, U32 spu_num,
             auto segment = new cpu::frontend::spu::Module(cpu);
             segment->address = SPU_LS_OFFSET(spu_num) + seg.ls_start;
             segment->size = seg.size;
-            cpu->spu_modules.push_back(segment);
+            cpu->addSpuModule(segment);
         }
         if (seg.type == SYS_SPU_SEGMENT_TYPE_FILL) {
             assert_always("Unimplemented");
@@ -172,6 +173,35 @@ HLE_FUNCTION(sys_spu_thread_group_join, U32 gid, BE<S32>* cause, BE<S32>* status
     return CELL_OK;
 }
 
+HLE_FUNCTION(sys_spu_thread_group_set_priority, U32 id, S32 priority) {
+    auto* spuThreadGroup = kernel.objects.get<SPUThreadGroup>(id);
+    if (!spuThreadGroup) {
+        return CELL_ESRCH;
+    }
+    if (priority < 16 || 255 < priority) {
+        return CELL_EINVAL;
+    }
+
+    // Threads already waiting for a run slot keep their place until they wait again
+    spuThreadGroup->prio = priority;
+    for (auto* spuThread : spuThreadGroup->threads) {
+        if (spuThread) {
+            spuThread->thread->priority = priority;
+        }
+    }
+    return CELL_OK;
+}
+
+HLE_FUNCTION(sys_spu_thread_group_get_priority, U32 id, BE<S32>* priority) {
+    auto* spuThreadGroup = kernel.objects.get<SPUThreadGroup>(id);
+    if (!spuThreadGroup) {
+        return CELL_ESRCH;
+    }
+
+    *priority = spuThreadGroup->prio;
+    return CELL_OK;
+}
+
 HLE_FUNCTION(sys_spu_thread_read_ls, U32 id, U32 address, BE<U64>* value, U32 type) {
     auto* spuThread = kernel.objects.get<SPUThread>(id);
     if (!spuThread) {
@@ -192,6 +222,38 @@ HLE_FUNCTION(sys_spu_thread_read_ls, U32 id, U32 address, BE<U64>* value, U32 ty
     return CELL_OK;
 }
 
+HLE_FUNCTION(sys_spu_thread_write_snr, U32 id, S32 number, U32 value) {
+    auto* spuThread = kernel.objects.get<SPUThread>(id);
+    if (!spuThread) {
+        return CELL_ESRCH;
+    }
+
+    // TODO: Signal notification registers configured in OR mode through sys_spu_thread_set_spu_cfg
+    auto* state = spuThread->thread->state.get();
+    switch (number) {
+    case 0:
+        state->chSigNotify1.overwrite(value);
+        break;
+    case 1:
+        state->chSigNotify2.overwrite(value);
+        break;
+    default:
+        return CELL_EINVAL;
+    }
+    return CELL_OK;
+}
+
+HLE_FUNCTION(sys_spu_thread_write_spu_mb, U32 id, U32 value) {
+    auto* spuThread = kernel.objects.get<SPUThread>(id);
+    if (!spuThread) {
+        return CELL_ESRCH;
+    }
+
+    // As on hardware, writing to a full inbound mailbox replaces its newest entry
+    spuThread->thread->state->chInMbox.overwrite(value);
+    return CELL_OK;
+}
+
 HLE_FUNCTION(sys_spu_thread_group_connect_event_all_threads, S32 group_id, U32 equeue_id, U64 req, U08* spup) {
     auto* spuThreadGroup = kernel.objects.get<SPUThreadGroup>(group_id);
     auto* eventQueue = kernel.objects.get<sys_event_queue_t>(equeue_id);
@@ -41,4 +41,70 @@ public:
         //auto result = function->call(3,4);
         //Assert::IsTrue(result == 28);
     }
+
+    TEST_METHOD(CPU_OptimizationPasses) {
+        Module* module = new Module();
+        Function* function = new Function(module, TYPE_I64, {TYPE_I64, TYPE_I64});
+        Block* block = new Block(function);
+
+        Builder builder;
+        builder.setInsertPoint(block);
+        auto sum1 = builder.createAdd(function->args[0], function->args[1]);
+        auto sum2 = builder.createAdd(function->args[0], function->args[1]);
+        auto unused = builder.createSub(function->args[0], function->args[1]);
+        builder.createRet(builder.createMul(sum1, sum2));
+
+        passes::CommonSubexpressionEliminationPass cse;
+        passes::DeadCodeEliminationPass dce;
+        Assert::IsTrue(cse.run(function));
+        Assert::IsTrue(dce.run(function));
+
+        // Only one addition, the multiplication and the return remain
+        Assert::IsTrue(block->instructions.size() == 3);
+    }
+
+    TEST_METHOD(CPU_ConstantFolding) {
+        Module* module = new Module();
+        Function* function = new Function(module, TYPE_I64, {TYPE_I64});
+        Block* block = new Block(function);
+
+        Builder builder;
+        builder.setInsertPoint(block);
+        auto product = builder.createMul(builder.getConstantI32(-3), builder.getConstantI32(5));
+        auto quotient = builder.createDiv(product, builder.getConstantI32(2));
+        auto extended = builder.createSExt(quotient, TYPE_I64);
+        builder.createRet(builder.createAdd(function->args[0], extended));
+
+        passes::ConstantFoldingPass cf;
+        Assert::IsTrue(cf.run(function));
+
+        // Signed arithmetic is folded into a constant operand of the addition
+        Assert::IsTrue(block->instructions.size() == 2);
+        const auto* add = block->instructions.front();
+        Assert::IsTrue(add->opcode == OPCODE_ADD);
+        Assert::IsTrue(add->src2.value->isConstant());
+        Assert::IsTrue(add->src2.value->constant.i64 == -7);
+    }
+
+    TEST_METHOD(CPU_CopyPropagation) {
+        Module* module = new Module();
+        Function* function = new Function(module, TYPE_I32, {TYPE_I32});
+        Block* block = new Block(function);
+
+        Builder builder;
+        builder.setInsertPoint(block);
+        auto extended = builder.createZExt(function->args[0], TYPE_I64);
+        auto truncated = builder.createTrunc(extended, TYPE_I32);
+        builder.createRet(builder.createAdd(truncated, builder.getConstantI32(0)));
+
+        passes::CopyPropagationPass cp;
+        passes::DeadCodeEliminationPass dce;
+        Assert::IsTrue(cp.run(function));
+        Assert::IsTrue(dce.run(function));
+
+        // Truncating an extension back to the original type, and adding zero, forward the argument
+        Assert::IsTrue(block->instructions.size() == 1);
+        Assert::IsTrue(block->instructions.front()->opcode == OPCODE_RET);
+        Assert::IsTrue(block->instructions.front()->src1.value == function->args[0]);
+    }
 };
@@ -71,6 +71,8 @@ public:
         cpu = std::make_shared<cpu::CPU>(memory);
         thread = new PPUThread(cpu.get());
         cpu->setCurrentThread(thread);
+        state.memoryBase = thread->state->memoryBase;
+        state.reservationBase = thread->state->reservationBase;
         thread->state.reset(&state);
 
         compiler = std::make_unique<backend::x86::X86Compiler>();
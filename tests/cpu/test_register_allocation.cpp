@@ -0,0 +1,143 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+// Visual Studio testing dependencies
+#include "CppUnitTest.h"
+
+// Target
+#include "nucleus/cpu/hir/builder.h"
+#include "nucleus/cpu/hir/block.h"
+#include "nucleus/cpu/hir/function.h"
+#include "nucleus/cpu/hir/instruction.h"
+#include "nucleus/cpu/hir/module.h"
+#include "nucleus/cpu/hir/passes.h"
+#include "nucleus/cpu/backend/x86/x86_compiler.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+// Target
+using namespace cpu::hir;
+using namespace cpu::backend;
+
+// Integer register set with two call-clobbered and two call-preserved registers
+static TargetInfo getTestTarget() {
+    TargetInfo targetInfo;
+    targetInfo.regSets.resize(1);
+    targetInfo.regSets[0].types = RegisterSet::TYPE_INT;
+    targetInfo.regSets[0].valueIndex = {10, 11, 12, 13};
+    targetInfo.regSets[0].volatileIndex = {10, 11};
+    targetInfo.regSets[0].argIndex = {7, 6, 2, 1};
+    targetInfo.regSets[0].retIndex = 0;
+    return targetInfo;
+}
+
+// Count the instructions of a function with the given opcode
+static Size countOpcode(const Function* function, U32 opcode) {
+    Size count = 0;
+    for (const auto* block : function->blocks) {
+        for (const auto* instr : block->instructions) {
+            count += (instr->opcode == opcode) ? 1 : 0;
+        }
+    }
+    return count;
+}
+
+TEST_CLASS(CpuRegisterAllocationTests) {
+
+public:
+    TEST_METHOD(CPU_RegAlloc_PreservedAcrossCalls) {
+        Module* module = new Module();
+        Function* callee = new Function(module, TYPE_VOID);
+        Function* function = new Function(module, TYPE_I64, {TYPE_I64, TYPE_I64});
+        Block* block = new Block(function);
+
+        Builder builder;
+        builder.setInsertPoint(block);
+        auto live = builder.createAdd(function->args[0], function->args[1]);
+        auto local = builder.createSub(function->args[0], function->args[1]);
+        auto product = builder.createMul(local, local);
+        builder.createCall(callee);
+        builder.createRet(builder.createAdd(live, product));
+
+        const auto targetInfo = getTestTarget();
+        passes::RegisterAllocationPass pass(targetInfo);
+        Assert::IsTrue(pass.run(function));
+
+        // Values surviving the call use preserved registers, the rest prefer clobbered ones
+        Assert::IsTrue(live->reg == 12 || live->reg == 13);
+        Assert::IsTrue(product->reg == 12 || product->reg == 13);
+        Assert::IsTrue(live->reg != product->reg);
+        Assert::IsTrue(local->reg == 10 || local->reg == 11);
+        Assert::IsTrue(function->stackSize == 0);
+    }
+
+    TEST_METHOD(CPU_RegAlloc_SpillsWhenOutOfRegisters) {
+        Module* module = new Module();
+        Function* function = new Function(module, TYPE_I64, {TYPE_I64, TYPE_I64});
+        Block* block = new Block(function);
+
+        // Keep six values alive at once, with only four registers available
+        Builder builder;
+        builder.setInsertPoint(block);
+        std::vector<Value*> values;
+        for (int i = 0; i < 6; i++) {
+            values.push_back(builder.createAdd(function->args[0], builder.getConstantI64(i)));
+        }
+        Value* sum = values[0];
+        for (int i = 1; i < 6; i++) {
+            sum = builder.createAdd(sum, values[i]);
+        }
+        builder.createRet(sum);
+
+        const auto targetInfo = getTestTarget();
+        passes::RegisterAllocationPass pass(targetInfo);
+        Assert::IsTrue(pass.run(function));
+
+        Assert::IsTrue(function->stackSize > 0);
+        Assert::IsTrue(countOpcode(function, OPCODE_STACKSTORE) > 0);
+        Assert::IsTrue(countOpcode(function, OPCODE_STACKLOAD) >= countOpcode(function, OPCODE_STACKSTORE));
+
+        // Every remaining value received one of the registers of the set
+        const auto& regs = targetInfo.regSets[0].valueIndex;
+        for (const auto* instr : block->instructions) {
+            if (instr->dest && instr->opcode != OPCODE_STACKSTORE) {
+                Assert::IsTrue(std::find(regs.begin(), regs.end(), int(instr->dest->reg)) != regs.end());
+            }
+        }
+    }
+
+    TEST_METHOD(CPU_RegAlloc_PrologSavesPreservedRegisters) {
+        Module* module = new Module();
+        Function* callee = new Function(module, TYPE_VOID);
+        Function* function = new Function(module, TYPE_I64, {TYPE_I64, TYPE_I64});
+        Block* calleeBlock = new Block(callee);
+        Block* block = new Block(function);
+
+        Builder builder;
+        builder.setInsertPoint(calleeBlock);
+        builder.createRet();
+        callee->flags |= FUNCTION_IS_DEFINED;
+
+        builder.setInsertPoint(block);
+        auto live = builder.createAdd(function->args[0], function->args[1]);
+        builder.createCall(callee);
+        builder.createRet(builder.createAdd(live, function->args[0]));
+        function->flags |= FUNCTION_IS_DEFINED;
+
+        x86::X86Compiler compiler;
+        compiler.addPass(std::make_unique<passes::RegisterAllocationPass>(compiler.targetInfo));
+        Assert::IsTrue(compiler.compile(callee));
+        Assert::IsTrue(compiler.compile(function));
+
+        // Compiled callees do not follow the host ABI on their own, so the caller
+        // code must begin by pushing the preserved register holding the live value
+        const auto* code = static_cast<const U08*>(function->nativeAddress);
+        Assert::IsTrue(live->reg >= 12 && live->reg <= 15);
+        Assert::IsTrue(code[0] == 0x41 && code[1] == 0x50 + (live->reg - 8));
+    }
+};
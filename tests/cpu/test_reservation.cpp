@@ -0,0 +1,194 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+// Visual Studio testing dependencies
+#include "CppUnitTest.h"
+
+// Target
+#include "nucleus/cpu/cpu_guest.h"
+#include "nucleus/cpu/reservation.h"
+#include "nucleus/cpu/backend/ppc/ppc_assembler.h"
+#include "nucleus/cpu/frontend/ppu/ppu_state.h"
+#include "nucleus/cpu/frontend/ppu/ppu_tables.h"
+#include "nucleus/cpu/frontend/ppu/translator/ppu_translator.h"
+#include "nucleus/cpu/frontend/spu/spu_state.h"
+#include "nucleus/cpu/frontend/spu/spu_thread.h"
+#include "nucleus/cpu/hir/block.h"
+#include "nucleus/cpu/hir/function.h"
+#include "nucleus/cpu/hir/module.h"
+#include "nucleus/memory/guest_virtual/guest_virtual_memory.h"
+
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+// Target
+using namespace cpu;
+using namespace cpu::backend::ppc;
+
+// Guest address of the local storage used by the tests
+constexpr U32 TEST_LS_BASE = 0xF0000000;
+
+// Increments done by each contending thread
+constexpr U32 TEST_INCREMENTS = 2000;
+
+TEST_CLASS(ReservationTests) {
+    std::unique_ptr<mem::GuestVirtualMemory> memory;
+    std::unique_ptr<GuestCPU> guestCpu;
+    U32 buffer;
+
+    // Compile the PPU atomic increment: lwarx r3,0,r1; addi r3,r3,1; stwcx. r3,0,r1
+    hir::Function* compileIncrement() {
+        auto* module = new hir::Module();
+        auto* function = new hir::Function(module, hir::TYPE_VOID);
+        auto* block = new hir::Block(function);
+
+        frontend::ppu::Translator recompiler(guestCpu.get(), nullptr);
+        recompiler.builder.setInsertPoint(block);
+        recompiler.currentAddress = 0x10000;
+
+        U32 code[3];
+        PPCAssembler a(sizeof(code), code);
+        a.lwarx(r3, r0, r1);
+        a.addi(r3, r3, 1);
+        a.stwcx_(r3, r0, r1);
+        for (Size i = 0; (i * sizeof(U32)) < a.curSize; i++) {
+            frontend::ppu::Instruction instr;
+            instr.value = static_cast<U32*>(a.codeAddr)[i];
+            auto method = frontend::ppu::get_entry(instr).recompile;
+            (recompiler.*method)(instr);
+        }
+
+        guestCpu->compiler->compile(function);
+        return function;
+    }
+
+    // Increment a word with the PPU reservation instructions, retrying failed stores
+    void incrementPPU(hir::Function* function, U32 addr, U32 count) {
+        frontend::ppu::PPUState state;
+        std::memset(&state, 0, sizeof(state));
+        state.memoryBase = reinterpret_cast<U64>(memory->getBaseAddr());
+        state.reservationBase = reinterpret_cast<U64>(guestCpu->reservations.getBase());
+        state.r[1] = addr;
+        for (U32 done = 0; done < count;) {
+            guestCpu->compiler->call(function, &state);
+            done += state.cr.field[0].eq ? 1 : 0;
+        }
+    }
+
+    // Increment a word with the SPU lock-line commands, retrying failed stores
+    void incrementSPU(frontend::spu::SPUThread* thread, U32 addr, U32 lsa, U32 count) {
+        const U32 offset = addr & (ReservationTable::GRANULE_SIZE - 1);
+        for (U32 done = 0; done < count;) {
+            thread->atomicTransfer(frontend::spu::MFC_GETLLAR_CMD, addr, lsa);
+            Assert::IsTrue(thread->state->chAtomicStat.read() == frontend::spu::MFC_GETLLAR_SUCCESS);
+            memory->write32(lsa + offset, memory->read32(lsa + offset) + 1);
+            thread->atomicTransfer(frontend::spu::MFC_PUTLLC_CMD, addr, lsa);
+            done += (thread->state->chAtomicStat.read() == frontend::spu::MFC_PUTLLC_SUCCESS) ? 1 : 0;
+        }
+    }
+
+public:
+    TEST_METHOD_INITIALIZE(Reservation_Initialize) {
+        memory = std::make_unique<mem::GuestVirtualMemory>(0x100000000ULL);
+        guestCpu = std::make_unique<GuestCPU>(nullptr, memory.get());
+        buffer = memory->getSegment(mem::SEG_MAIN_MEMORY).alloc(0x1000, ReservationTable::GRANULE_SIZE);
+        std::memset(memory->ptr<U08>(buffer), 0, 0x1000);
+    }
+
+    TEST_METHOD(Reservation_LockInvalidates) {
+        ReservationTable table;
+        const U64 version = table.acquire(buffer);
+
+        // Another writer on the same granule makes the reservation stale
+        table.lockAlways(buffer + 0x40);
+        Assert::IsTrue(table.getVersion(buffer).load() == version + 1);
+        table.unlock(buffer + 0x40);
+        Assert::IsFalse(table.lock(buffer, version));
+
+        // Reservations taken afterwards are valid again
+        const U64 current = table.acquire(buffer);
+        Assert::IsTrue(table.lock(buffer, current));
+        Assert::IsFalse(table.lock(buffer, current));
+        table.unlock(buffer);
+        Assert::IsTrue(table.acquire(buffer) == current + 2);
+    }
+
+    TEST_METHOD(Reservation_TableContention) {
+        ReservationTable table;
+        U32 counter = 0;
+
+        // Every successful lock must observe the value stored by the previous one
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; i++) {
+            threads.emplace_back([&] {
+                for (U32 done = 0; done < TEST_INCREMENTS;) {
+                    const U64 version = table.acquire(buffer);
+                    const U32 value = counter;
+                    if (table.lock(buffer, version)) {
+                        counter = value + 1;
+                        table.unlock(buffer);
+                        done++;
+                    }
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        Assert::IsTrue(counter == 4 * TEST_INCREMENTS);
+    }
+
+    TEST_METHOD(Reservation_StoreConditionalContention) {
+        auto* function = compileIncrement();
+
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; i++) {
+            threads.emplace_back([&] { incrementPPU(function, buffer, TEST_INCREMENTS); });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        Assert::IsTrue(memory->read32(buffer) == 4 * TEST_INCREMENTS);
+    }
+
+    TEST_METHOD(Reservation_LockLineContention) {
+        std::vector<std::unique_ptr<frontend::spu::SPUThread>> spus;
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; i++) {
+            spus.push_back(std::make_unique<frontend::spu::SPUThread>(guestCpu.get()));
+        }
+        for (int i = 0; i < 4; i++) {
+            auto* spu = spus[i].get();
+            threads.emplace_back([=] { incrementSPU(spu, buffer + 0x10, TEST_LS_BASE + i * 0x100, TEST_INCREMENTS); });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        Assert::IsTrue(memory->read32(buffer + 0x10) == 4 * TEST_INCREMENTS);
+    }
+
+    TEST_METHOD(Reservation_MixedContention) {
+        // PPU and SPU atomics on the same granule exclude each other
+        auto* function = compileIncrement();
+        std::vector<std::unique_ptr<frontend::spu::SPUThread>> spus;
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 2; i++) {
+            spus.push_back(std::make_unique<frontend::spu::SPUThread>(guestCpu.get()));
+        }
+        for (int i = 0; i < 2; i++) {
+            auto* spu = spus[i].get();
+            threads.emplace_back([=] { incrementSPU(spu, buffer + 0x20, TEST_LS_BASE + i * 0x100, TEST_INCREMENTS); });
+            threads.emplace_back([=] { incrementPPU(function, buffer + 0x20, TEST_INCREMENTS); });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        Assert::IsTrue(memory->read32(buffer + 0x20) == 4 * TEST_INCREMENTS);
+    }
+};
@@ -0,0 +1,121 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+// Visual Studio testing dependencies
+#include "CppUnitTest.h"
+
+// Target
+#include "nucleus/cpu/frontend/spu/spu_channel.h"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+// Target
+using namespace cpu::frontend::spu;
+
+TEST_CLASS(SpuChannelTests) {
+public:
+    TEST_METHOD(SpuChannel_Blocking) {
+        Channel<1, true> channel;
+        U32 entry;
+        Assert::IsFalse(channel.tryRead(entry));
+        Assert::IsTrue(channel.tryWrite(1));
+        Assert::IsFalse(channel.tryWrite(2));
+        Assert::IsTrue(channel.getSpace() == 0);
+
+        // Readers wait for entries, and writers wait for space
+        std::thread writer([&] {
+            channel.write(2);
+            channel.write(3);
+        });
+        Assert::IsTrue(channel.read() == 1);
+        Assert::IsTrue(channel.read() == 2);
+        Assert::IsTrue(channel.read() == 3);
+        writer.join();
+        Assert::IsTrue(channel.getCount() == 0);
+    }
+
+    TEST_METHOD(SpuChannel_NonBlocking) {
+        Channel<1, false> channel;
+        Assert::IsTrue(channel.read() == 0);
+
+        // Writing a full channel replaces its entry
+        channel.write(1);
+        channel.write(2);
+        Assert::IsTrue(channel.getCount() == 1);
+        Assert::IsTrue(channel.read() == 2);
+        Assert::IsTrue(channel.read() == 0);
+    }
+
+    TEST_METHOD(SpuChannel_Overwrite) {
+        Channel<4, true> channel;
+        for (U32 i = 1; i <= 6; i++) {
+            channel.overwrite(i);
+        }
+
+        // Only the newest entry is replaced
+        Assert::IsTrue(channel.getCount() == 4);
+        Assert::IsTrue(channel.read() == 1);
+        Assert::IsTrue(channel.read() == 2);
+        Assert::IsTrue(channel.read() == 3);
+        Assert::IsTrue(channel.read() == 6);
+    }
+
+    TEST_METHOD(SpuChannel_OverwriteConcurrent) {
+        constexpr U32 count = 100000;
+        Channel<1, true> channel;
+
+        // Entries are not lost when the consumer takes the one being replaced,
+        // so the last entry is always read and entries stay in order
+        std::thread producer([&] {
+            for (U32 i = 1; i <= count; i++) {
+                channel.overwrite(i);
+            }
+        });
+        U32 last = 0;
+        while (last != count) {
+            const U32 entry = channel.read();
+            Assert::IsTrue(entry > last);
+            last = entry;
+        }
+        producer.join();
+        Assert::IsTrue(channel.getCount() == 0);
+    }
+
+    TEST_METHOD(SpuChannel_OverwriteProducers) {
+        constexpr U32 count = 10000;
+        constexpr U32 producers = 4;
+        Channel<4, true> channel;
+
+        // Producers overwriting at once are serialized, keeping the entries of each in order
+        std::atomic<U32> running{ producers };
+        std::vector<std::thread> threads;
+        for (U32 p = 0; p < producers; p++) {
+            threads.emplace_back([&channel, &running, p] {
+                for (U32 i = 1; i <= count; i++) {
+                    channel.overwrite((p << 24) | i);
+                }
+                running -= 1;
+            });
+        }
+        U32 last[producers] = {};
+        U32 entry;
+        while (running || channel.getCount()) {
+            if (!channel.tryRead(entry)) {
+                continue;
+            }
+            const U32 p = entry >> 24;
+            const U32 i = entry & 0xFFFFFF;
+            Assert::IsTrue(p < producers && i > last[p]);
+            last[p] = i;
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+};
@@ -0,0 +1,88 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+// Visual Studio testing dependencies
+#include "CppUnitTest.h"
+
+// Target
+#include "nucleus/cpu/frontend/spu/spu_mfc.h"
+#include "nucleus/cpu/frontend/spu/spu_state.h"
+#include "nucleus/memory/guest_virtual/guest_virtual_memory.h"
+
+#include <cstring>
+#include <memory>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+// Target
+using namespace cpu::frontend::spu;
+
+// Guest address of the local storage used by the tests
+constexpr U32 TEST_LS_BASE = 0xF0000000;
+
+TEST_CLASS(SpuMfcTests) {
+    std::unique_ptr<mem::GuestVirtualMemory> memory;
+    U32 buffer;
+
+public:
+    TEST_METHOD_INITIALIZE(SpuMfc_Initialize) {
+        memory = std::make_unique<mem::GuestVirtualMemory>(0x100000000ULL);
+        buffer = memory->getSegment(mem::SEG_MAIN_MEMORY).alloc(0x4000, 0x80);
+        for (U32 i = 0; i < 0x4000; i++) {
+            memory->write8(buffer + i, U08(i * 7));
+        }
+    }
+
+    TEST_METHOD(SpuMfc_GetAndPut) {
+        MFCEngine engine(memory.get());
+        Assert::IsTrue(engine.getQueueSpace() == MFCEngine::QUEUE_SIZE);
+
+        // Transfers into local storage are visible once the tag group completes
+        engine.enqueue({ MFC_GET_CMD, buffer, TEST_LS_BASE + 0x2000, 0x1000, 5 });
+        Assert::IsTrue(engine.readTagStatus(1 << 5, MFC_TAG_UPDATE_ALL) == (1 << 5));
+        Assert::IsTrue(std::memcmp(memory->ptr<U08>(TEST_LS_BASE + 0x2000), memory->ptr<U08>(buffer), 0x1000) == 0);
+        Assert::IsTrue(engine.getQueueSpace() == MFCEngine::QUEUE_SIZE);
+
+        // Only the pages written by GET commands are reported, once
+        Assert::IsTrue(engine.takeWrittenPages() == (1ULL << 2));
+        Assert::IsTrue(engine.takeWrittenPages() == 0);
+
+        engine.enqueue({ MFC_PUT_CMD, buffer + 0x3000, TEST_LS_BASE + 0x2000, 0x800, 6 });
+        Assert::IsTrue(engine.readTagStatus(1 << 6, MFC_TAG_UPDATE_ALL) == (1 << 6));
+        Assert::IsTrue(std::memcmp(memory->ptr<U08>(buffer + 0x3000), memory->ptr<U08>(buffer), 0x800) == 0);
+        Assert::IsTrue(engine.takeWrittenPages() == 0);
+    }
+
+    TEST_METHOD(SpuMfc_OrderedWithinQueue) {
+        MFCEngine engine(memory.get());
+
+        // Commands run in issue order, so the last transfer to a buffer wins
+        for (U32 i = 0; i < 4 * MFCEngine::QUEUE_SIZE; i++) {
+            engine.enqueue({ MFC_GET_CMD, buffer + (i % 4) * 0x100, TEST_LS_BASE, 0x100, i % 2 });
+        }
+        Assert::IsTrue(engine.readTagStatus(0x3, MFC_TAG_UPDATE_ALL) == 0x3);
+        Assert::IsTrue(std::memcmp(memory->ptr<U08>(TEST_LS_BASE), memory->ptr<U08>(buffer + 0x300), 0x100) == 0);
+    }
+
+    TEST_METHOD(SpuMfc_ListStall) {
+        MFCEngine engine(memory.get());
+
+        // Two contiguous elements followed by a stall, then a discontiguous element
+        auto* list = memory->ptr<MFCListElement>(buffer + 0x3F00);
+        list[0].s = 0x0000; list[0].lts = 0x80; list[0].leal = buffer;
+        list[1].s = 0x8000; list[1].lts = 0x80; list[1].leal = buffer + 0x80;
+        list[2].s = 0x0000; list[2].lts = 0x80; list[2].leal = buffer + 0x1000;
+        engine.enqueue({ MFC_GETL_CMD, buffer + 0x3F00, TEST_LS_BASE, 3 * sizeof(MFCListElement), 3 });
+
+        // The list stops after the stalling element until it is acknowledged
+        Assert::IsTrue(engine.readStallStatus() == (1 << 3));
+        Assert::IsFalse(engine.isTagStatusReady(1 << 3, MFC_TAG_UPDATE_ALL));
+        Assert::IsTrue(std::memcmp(memory->ptr<U08>(TEST_LS_BASE), memory->ptr<U08>(buffer), 0x100) == 0);
+
+        engine.acknowledgeStall(3);
+        Assert::IsTrue(engine.readTagStatus(1 << 3, MFC_TAG_UPDATE_ALL) == (1 << 3));
+        Assert::IsTrue(std::memcmp(memory->ptr<U08>(TEST_LS_BASE + 0x100), memory->ptr<U08>(buffer + 0x1000), 0x80) == 0);
+    }
+};
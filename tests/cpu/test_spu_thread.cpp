@@ -0,0 +1,195 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+// Visual Studio testing dependencies
+#include "CppUnitTest.h"
+
+// Target
+#include "nucleus/cpu/cpu_guest.h"
+#include "nucleus/cpu/backend/spu/spu_assembler.h"
+#include "nucleus/cpu/frontend/spu/spu_decoder.h"
+#include "nucleus/cpu/frontend/spu/spu_scheduler.h"
+#include "nucleus/cpu/frontend/spu/spu_state.h"
+#include "nucleus/cpu/frontend/spu/spu_thread.h"
+#include "nucleus/memory/guest_virtual/guest_virtual_memory.h"
+
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <thread>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+// Target
+using namespace cpu;
+using namespace cpu::backend::spu;
+using namespace cpu::frontend::spu;
+
+// Guest address of the local storage used by the tests
+constexpr U32 TEST_LS_BASE = 0xF0000000;
+
+// Local storage addresses of the test kernels, placed in different pages
+constexpr U32 TEST_LS_CALLER = 0x0000;
+constexpr U32 TEST_LS_CALLEE = 0x1000;
+
+// Guest address of the local storage of a second SPU
+constexpr U32 TEST_LS_OTHER = 0xF0040000;
+
+TEST_CLASS(SpuThreadTests) {
+    std::unique_ptr<mem::GuestVirtualMemory> memory;
+    std::unique_ptr<GuestCPU> guestCpu;
+    std::unique_ptr<Module> module;
+    std::unique_ptr<SPUThread> thread;
+    U32 buffer;
+
+    // Assemble SPU code into guest memory, returning its size in bytes
+    U32 assemble(U32 addr, std::function<void(SPUAssembler&)> spuFunc) {
+        U32 code[64];
+        SPUAssembler a(sizeof(code), code);
+        spuFunc(a);
+        for (Size i = 0; (i * sizeof(U32)) < a.curSize; i++) {
+            memory->write32(addr + U32(i * sizeof(U32)), code[i]);
+        }
+
+        return U32(a.curSize);
+    }
+
+    // Assemble a kernel setting r3 to the given value and returning
+    U32 assembleKernel(U32 addr, U32 value) {
+        return assemble(addr, [=](SPUAssembler& a) {
+            a.il(r3, value);
+            a.bi(r0);
+        });
+    }
+
+    // Transfer a kernel from main memory into local storage, as SPU overlays do
+    void load(U32 lsa, U32 addr, U32 size) {
+        thread->mfcEngine->enqueue({ MFC_GET_CMD, addr, TEST_LS_BASE + lsa, size, 0 });
+        Assert::IsTrue(thread->mfcEngine->readTagStatus(1 << 0, MFC_TAG_UPDATE_ALL) == (1 << 0));
+    }
+
+    // Run the function at the given local storage address, returning r3
+    U32 run(U32 lsa) {
+        thread->state->pc = TEST_LS_BASE + lsa;
+        thread->task();
+        return thread->state->r[3].u32[0];
+    }
+
+public:
+    TEST_METHOD_INITIALIZE(SpuThread_Initialize) {
+        memory = std::make_unique<mem::GuestVirtualMemory>(0x100000000ULL);
+        guestCpu = std::make_unique<GuestCPU>(nullptr, memory.get());
+        buffer = memory->getSegment(mem::SEG_MAIN_MEMORY).alloc(0x1000, 0x80);
+        std::memset(memory->ptr<U08>(TEST_LS_BASE), 0, 0x2000);
+
+        module = std::make_unique<Module>(guestCpu.get());
+        module->address = TEST_LS_BASE;
+        module->size = 0x40000;
+        guestCpu->addSpuModule(module.get());
+
+        thread = std::make_unique<SPUThread>(guestCpu.get());
+        CPU::setCurrentThread(thread.get());
+    }
+
+    TEST_METHOD(SpuThread_OverlayEntry) {
+        assembleKernel(TEST_LS_BASE + TEST_LS_CALLEE, 1);
+        Assert::IsTrue(run(TEST_LS_CALLEE) == 1);
+
+        // Entering the translated function again runs the kernel loaded over it
+        const U32 size = assembleKernel(buffer, 2);
+        load(TEST_LS_CALLEE, buffer, size);
+        Assert::IsTrue(run(TEST_LS_CALLEE) == 2);
+
+        // Loading the first kernel back reuses its translation
+        assembleKernel(buffer, 1);
+        load(TEST_LS_CALLEE, buffer, size);
+        Assert::IsTrue(run(TEST_LS_CALLEE) == 1);
+    }
+
+    TEST_METHOD(SpuThread_EntryModified) {
+        assembleKernel(TEST_LS_BASE + TEST_LS_CALLEE, 1);
+        Assert::IsTrue(run(TEST_LS_CALLEE) == 1);
+
+        // Code stored by the SPU itself does not go through DMA, but changes the entry block
+        assembleKernel(TEST_LS_BASE + TEST_LS_CALLEE, 2);
+        Assert::IsTrue(run(TEST_LS_CALLEE) == 2);
+    }
+
+    TEST_METHOD(SpuThread_OverlayCallee) {
+        assemble(TEST_LS_BASE + TEST_LS_CALLER, [](SPUAssembler& a) {
+            a.brsl(r0, (TEST_LS_CALLEE - TEST_LS_CALLER) >> 2);
+            a.bi(r0);
+        });
+        assembleKernel(TEST_LS_BASE + TEST_LS_CALLEE, 1);
+        Assert::IsTrue(run(TEST_LS_CALLER) == 1);
+
+        // Direct calls from unchanged code reach the kernel loaded over the callee
+        const U32 size = assembleKernel(buffer, 2);
+        load(TEST_LS_CALLEE, buffer, size);
+        Assert::IsTrue(run(TEST_LS_CALLER) == 2);
+    }
+
+    TEST_METHOD(SpuThread_Yield) {
+        // Run two SPU threads on a single slot
+        guestCpu->spuScheduler = std::make_unique<SPUScheduler>(1);
+        Module other(guestCpu.get());
+        other.address = TEST_LS_OTHER;
+        other.size = 0x40000;
+        guestCpu->addSpuModule(&other);
+
+        // The first thread polls its inbound mailbox, which is only written once the second thread finished
+        assemble(TEST_LS_BASE, [](SPUAssembler& a) {
+            a.rchcnt(r3, SPU_RdInMbox);
+            a.brz(r3, -1 & 0xFFFF);
+            a.rdch(r3, SPU_RdInMbox);
+            a.bi(r0);
+        });
+        assembleKernel(TEST_LS_OTHER, 2);
+
+        SPUThread polling(guestCpu.get());
+        SPUThread waiting(guestCpu.get());
+        polling.state->pc = TEST_LS_BASE;
+        waiting.state->pc = TEST_LS_OTHER;
+        polling.start();
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        waiting.start();
+        waiting.join();
+        Assert::IsTrue(waiting.state->r[3].u32[0] == 2);
+
+        polling.state->chInMbox.write(1);
+        polling.join();
+        Assert::IsTrue(polling.state->r[3].u32[3] == 1);
+    }
+
+    TEST_METHOD(SpuThread_OutboundMailbox) {
+        // The second write stalls the SPU until the PPU reads the first entry
+        assemble(TEST_LS_BASE, [](SPUAssembler& a) {
+            a.il(r3, 1);
+            a.wrch(SPU_WrOutMbox, r3);
+            a.il(r3, 2);
+            a.wrch(SPU_WrOutMbox, r3);
+            a.rchcnt(r3, SPU_WrOutMbox);
+            a.bi(r0);
+        });
+
+        SPUThread spu(guestCpu.get());
+        spu.state->pc = TEST_LS_BASE;
+        spu.start();
+        U32 value = 0;
+        while (!spu.readOutMbox(value)) {
+            std::this_thread::yield();
+        }
+        Assert::IsTrue(value == 1);
+        while ((spu.getMailboxStatus() & 0xFF) == 0) {
+            std::this_thread::yield();
+        }
+        spu.join();
+        Assert::IsTrue(spu.readOutMbox(value) && value == 2);
+        Assert::IsFalse(spu.readOutMbox(value));
+        Assert::IsTrue(spu.state->r[3].u32[3] == 0);
+        Assert::IsTrue(spu.getMailboxStatus() == (4 << 8));
+    }
+};
@@ -0,0 +1,60 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+#pragma once
+
+#include "nucleus/graphics/graphics.h"
+
+#include <vector>
+
+// Resources created by the mock backend, holding no host GPU objects
+class MockTexture : public gfx::Texture {
+public:
+    virtual void* map() override { return nullptr; }
+    virtual bool unmap() override { return true; }
+};
+
+class MockVertexBuffer : public gfx::VertexBuffer {
+public:
+    std::vector<Byte> data;
+
+    MockVertexBuffer(Size size) : data(size) {}
+
+    virtual void* map() override { return data.data(); }
+    virtual bool unmap() override { return true; }
+};
+
+/**
+ * Mock Graphics Backend
+ * =====================
+ * Counts the resources created by the caches under test.
+ */
+class MockGraphicsBackend : public gfx::GraphicsBackend {
+public:
+    U32 textures = 0;
+    U32 vertexBuffers = 0;
+
+    virtual bool initialize(const gfx::BackendParameters& params) override { return true; }
+    virtual gfx::CommandBuffer* createCommandBuffer() override { return nullptr; }
+    virtual gfx::Fence* createFence(const gfx::FenceDesc& desc) override { return nullptr; }
+    virtual gfx::Heap* createHeap(const gfx::HeapDesc& desc) override { return nullptr; }
+    virtual gfx::ColorTarget* createColorTarget(gfx::Texture* texture) override { return nullptr; }
+    virtual gfx::DepthStencilTarget* createDepthStencilTarget(gfx::Texture* texture) override { return nullptr; }
+    virtual gfx::Pipeline* createPipeline(const gfx::PipelineDesc& desc) override { return nullptr; }
+    virtual gfx::Shader* createShader(const gfx::ShaderDesc& desc) override { return nullptr; }
+    virtual gfx::CommandQueue* getGraphicsCommandQueue() override { return nullptr; }
+    virtual bool doResizeBuffers(int width, int height) override { return true; }
+    virtual bool doSwapBuffers() override { return true; }
+
+    virtual gfx::Texture* createTexture(const gfx::TextureDesc& desc) override {
+        textures += 1;
+        return new MockTexture();
+    }
+
+    virtual gfx::VertexBuffer* createVertexBuffer(const gfx::VertexBufferDesc& desc) override {
+        vertexBuffers += 1;
+        return new MockVertexBuffer(desc.size);
+    }
+};
@@ -0,0 +1,59 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+// Visual Studio testing dependencies
+#include "CppUnitTest.h"
+
+// Target
+#include "nucleus/gpu/rsx/rsx_io.h"
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+// Target
+using namespace gpu::rsx;
+
+TEST_CLASS(RsxIoTests) {
+
+public:
+    TEST_METHOD(RSX_IO_Translate) {
+        IOTable iotable;
+        U32 ea = 0;
+        Assert::IsFalse(iotable.translate(0x00000000, ea));
+
+        // Pages are mapped individually, and addresses keep their offset within the page
+        iotable.map(0x00100000, 0x30000000, 0x00200000);
+        Assert::IsTrue(iotable.translate(0x00100004, ea) && ea == 0x30000004);
+        Assert::IsTrue(iotable.translate(0x002FFFFC, ea) && ea == 0x301FFFFC);
+        Assert::IsFalse(iotable.translate(0x000FFFFC, ea));
+        Assert::IsFalse(iotable.translate(0x00300000, ea));
+
+        // Partial pages are rounded up to the whole page
+        iotable.map(0x0FF00000, 0x20000000, 0x1000);
+        Assert::IsTrue(iotable.translate(0x0FFFFFFC, ea) && ea == 0x200FFFFC);
+
+        iotable.unmap(0x00100000, 0x00100000);
+        Assert::IsFalse(iotable.translate(0x00100004, ea));
+        Assert::IsTrue(iotable.translate(0x00200004, ea) && ea == 0x30100004);
+    }
+
+    TEST_METHOD(RSX_IO_TranslateRange) {
+        IOTable iotable;
+        U32 ea = 0;
+        iotable.map(0x00000000, 0x30000000, 0x00200000);
+        iotable.map(0x00200000, 0x50000000, 0x00100000);
+
+        // Ranges crossing pages are only translated if they are contiguous in EA space
+        Assert::IsTrue(iotable.translateRange(0x000FFFF0, 0x20, ea) && ea == 0x300FFFF0);
+        Assert::IsFalse(iotable.translateRange(0x001FFFF0, 0x20, ea));
+        Assert::IsTrue(iotable.translateRange(0x00200000, 0x00100000, ea) && ea == 0x50000000);
+        Assert::IsFalse(iotable.translateRange(0x00200000, 0x00100004, ea));
+        Assert::IsFalse(iotable.translateRange(0x00000000, 0, ea));
+
+        // Ranges past the end of IO space are rejected
+        iotable.map(0xFFF00000, 0x40000000, 0x00100000);
+        Assert::IsTrue(iotable.translateRange(0xFFFFFFF0, 0x10, ea) && ea == 0x400FFFF0);
+        Assert::IsFalse(iotable.translateRange(0xFFFFFFF0, 0x20, ea));
+    }
+};
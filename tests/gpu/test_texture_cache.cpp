@@ -0,0 +1,99 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+// Visual Studio testing dependencies
+#include "CppUnitTest.h"
+
+// Nucleus testing dependencies
+#include "tests/gpu/mock_graphics.h"
+
+// Target
+#include "nucleus/gpu/texture_cache.h"
+#include "nucleus/memory/guest_virtual/guest_virtual_memory.h"
+
+#include <memory>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+// Target
+using namespace gpu;
+
+TEST_CLASS(TextureCacheTests) {
+    std::unique_ptr<mem::GuestVirtualMemory> memory;
+    MockGraphicsBackend graphics;
+    U32 buffer;
+
+    // Describe a square RGBA texture stored at the given guest address
+    gfx::TextureDesc getDesc(U32 addr, U32 width) {
+        gfx::TextureDesc desc = {};
+        desc.data = memory->ptr<Byte>(addr);
+        desc.size = width * width * 4;
+        desc.width = width;
+        desc.height = width;
+        desc.mipmapLevels = 1;
+        desc.format = gfx::FORMAT_R8G8B8A8_UNORM;
+        return desc;
+    }
+
+public:
+    TEST_METHOD_INITIALIZE(TextureCache_Initialize) {
+        memory = std::make_unique<mem::GuestVirtualMemory>(0x100000000ULL);
+        buffer = memory->getSegment(mem::SEG_MAIN_MEMORY).alloc(0x10000, 0x1000);
+        for (U32 i = 0; i < 0x10000; i += 4) {
+            memory->write32(buffer + i, i);
+        }
+    }
+
+    TEST_METHOD(TextureCache_Hit) {
+        TextureCache cache(0x10000);
+        auto* texture = cache.get(&graphics, memory.get(), buffer, getDesc(buffer, 32));
+        Assert::IsTrue(cache.get(&graphics, memory.get(), buffer, getDesc(buffer, 32)) == texture);
+        Assert::IsTrue(cache.getUploadCount() == 1);
+
+        // Textures at the same address with other properties are cached separately
+        auto* other = cache.get(&graphics, memory.get(), buffer, getDesc(buffer, 16));
+        Assert::IsTrue(other != texture);
+        Assert::IsTrue(cache.get(&graphics, memory.get(), buffer, getDesc(buffer, 32)) == texture);
+        Assert::IsTrue(cache.getUploadCount() == 2);
+    }
+
+    TEST_METHOD(TextureCache_Writes) {
+        TextureCache cache(0x10000);
+        auto* texture = cache.get(&graphics, memory.get(), buffer, getDesc(buffer, 32));
+
+        // Writes keeping the same contents do not upload the texture again
+        memory->write32(buffer + 0x100, memory->read32(buffer + 0x100));
+        Assert::IsTrue(cache.get(&graphics, memory.get(), buffer, getDesc(buffer, 32)) == texture);
+        Assert::IsTrue(cache.getUploadCount() == 1);
+
+        // Writes after the contents were validated again are still detected
+        memory->write32(buffer + 0x100, 0xDEADBEEF);
+        auto* updated = cache.get(&graphics, memory.get(), buffer, getDesc(buffer, 32));
+        Assert::IsTrue(cache.getUploadCount() == 2);
+        memory->write32(buffer + 0x200, 0xDEADBEEF);
+        cache.get(&graphics, memory.get(), buffer, getDesc(buffer, 32));
+        Assert::IsTrue(cache.getUploadCount() == 3);
+        Assert::IsTrue(graphics.textures == 3);
+        cache.trim();
+    }
+
+    TEST_METHOD(TextureCache_Trim) {
+        // Room for two 32x32 textures
+        TextureCache cache(2 * 32 * 32 * 4);
+        cache.get(&graphics, memory.get(), buffer + 0x0000, getDesc(buffer + 0x0000, 32));
+        cache.get(&graphics, memory.get(), buffer + 0x1000, getDesc(buffer + 0x1000, 32));
+        cache.get(&graphics, memory.get(), buffer + 0x2000, getDesc(buffer + 0x2000, 32));
+        cache.get(&graphics, memory.get(), buffer + 0x0000, getDesc(buffer + 0x0000, 32));
+        Assert::IsTrue(cache.getUploadCount() == 3);
+
+        // The least recently used texture is evicted and uploaded again when needed
+        cache.trim();
+        cache.get(&graphics, memory.get(), buffer + 0x0000, getDesc(buffer + 0x0000, 32));
+        cache.get(&graphics, memory.get(), buffer + 0x2000, getDesc(buffer + 0x2000, 32));
+        Assert::IsTrue(cache.getUploadCount() == 3);
+        cache.get(&graphics, memory.get(), buffer + 0x1000, getDesc(buffer + 0x1000, 32));
+        Assert::IsTrue(cache.getUploadCount() == 4);
+    }
+};
@@ -0,0 +1,191 @@
+/**
+ * (c) 2014-2016 Alexandro Sanchez Bach. All rights reserved.
+ * Released under GPL v2 license. Read LICENSE for more details.
+ */
+
+// Visual Studio testing dependencies
+#include "CppUnitTest.h"
+
+// Nucleus testing dependencies
+#include "tests/gpu/mock_graphics.h"
+
+// Target
+#include "nucleus/gpu/vertex_cache.h"
+#include "nucleus/memory/guest_virtual/guest_virtual_memory.h"
+
+#include <memory>
+#include <vector>
+
+using namespace Microsoft::VisualStudio::CppUnitTestFramework;
+
+// Target
+using namespace gpu;
+
+TEST_CLASS(VertexCacheTests) {
+    std::unique_ptr<mem::GuestVirtualMemory> memory;
+    MockGraphicsBackend graphics;
+    U32 buffer;
+
+    // Describe a stream of vertices with a float3 position and a 4-byte color
+    VertexStream getStream(U32 addr, U32 count) {
+        VertexStream stream;
+        stream.init(addr, 16, count);
+        stream.addElement(0, 3, 4);
+        stream.addElement(12, 4, 1);
+        return stream;
+    }
+
+    // Describe a stream of 16-bit indices
+    VertexStream getIndexStream(U32 addr, U32 count) {
+        VertexStream stream;
+        stream.init(addr, 2, count);
+        stream.addElement(0, 1, 2);
+        return stream;
+    }
+
+    const Byte* getData(gfx::VertexBuffer* vtxBuffer) {
+        return static_cast<MockVertexBuffer*>(vtxBuffer)->data.data();
+    }
+
+public:
+    TEST_METHOD_INITIALIZE(VertexCache_Initialize) {
+        memory = std::make_unique<mem::GuestVirtualMemory>(0x100000000ULL);
+        buffer = memory->getSegment(mem::SEG_MAIN_MEMORY).alloc(0x10000, 0x1000);
+        for (U32 i = 0; i < 0x10000; i += 4) {
+            memory->write32(buffer + i, i);
+        }
+    }
+
+    TEST_METHOD(VertexCache_Convert) {
+        // Any stride and length must match the scalar byte permutation
+        for (U32 count : { 1, 3, 7, 64 }) {
+            VertexStream stream;
+            stream.init(buffer, 20, count);
+            stream.addElement(0, 3, 4);
+            stream.addElement(12, 2, 2);
+            stream.addElement(16, 4, 1);
+
+            const Byte* src = memory->ptr<Byte>(buffer);
+            std::vector<Byte> dst(stream.getSize());
+            convertVertexStream(dst.data(), src, stream);
+            for (U32 i = 0; i < stream.getSize(); i++) {
+                Assert::IsTrue(dst[i] == src[(i / 20) * 20 + stream.permutation[i % 20]]);
+            }
+        }
+    }
+
+    TEST_METHOD(VertexCache_ScanIndexRange) {
+        // Indices beyond the vectorized blocks are scanned as well
+        std::vector<U16> indices16(37);
+        std::vector<U32> indices32(37);
+        for (U32 i = 0; i < 37; i++) {
+            indices16[i] = SE16(U16(100 + (i * 13) % 37));
+            indices32[i] = SE32(100000 + (i * 13) % 37);
+        }
+        indices16[36] = SE16(U16(7));
+        indices32[36] = SE32(200000);
+
+        const IndexRestart noRestart = { false, 0xFFFFFFFF };
+        U32 minIndex, maxIndex;
+        scanIndexRange(reinterpret_cast<Byte*>(indices16.data()), 37, 2, noRestart, minIndex, maxIndex);
+        Assert::IsTrue(minIndex == 7 && maxIndex == 136);
+        scanIndexRange(reinterpret_cast<Byte*>(indices32.data()), 37, 4, noRestart, minIndex, maxIndex);
+        Assert::IsTrue(minIndex == 100000 && maxIndex == 200000);
+        scanIndexRange(reinterpret_cast<Byte*>(indices32.data()), 0, 4, noRestart, minIndex, maxIndex);
+        Assert::IsTrue(minIndex == 0 && maxIndex == 0);
+    }
+
+    TEST_METHOD(VertexCache_ScanIndexRangeRestart) {
+        // Restart indices are skipped both in the vectorized blocks and in the remainder
+        std::vector<U16> indices16(19, SE16(U16(0xFFFF)));
+        std::vector<U32> indices32(19, SE32(0xFFFFFFFF));
+        indices16[3] = SE16(U16(40));
+        indices16[17] = SE16(U16(50));
+        indices32[2] = SE32(400);
+        indices32[18] = SE32(500);
+
+        const IndexRestart restart16 = { true, 0xFFFF };
+        const IndexRestart restart32 = { true, 0xFFFFFFFF };
+        U32 minIndex, maxIndex;
+        scanIndexRange(reinterpret_cast<Byte*>(indices16.data()), 19, 2, restart16, minIndex, maxIndex);
+        Assert::IsTrue(minIndex == 40 && maxIndex == 50);
+        scanIndexRange(reinterpret_cast<Byte*>(indices32.data()), 19, 4, restart32, minIndex, maxIndex);
+        Assert::IsTrue(minIndex == 400 && maxIndex == 500);
+
+        // Streams made only of restart indices reference no vertices
+        scanIndexRange(reinterpret_cast<Byte*>(indices16.data()), 3, 2, restart16, minIndex, maxIndex);
+        Assert::IsTrue(minIndex == 0 && maxIndex == 0);
+    }
+
+    TEST_METHOD(VertexCache_Hit) {
+        VertexCache cache(0x10000);
+        auto* vtxBuffer = cache.get(&graphics, memory.get(), getStream(buffer, 16));
+        Assert::IsTrue(cache.get(&graphics, memory.get(), getStream(buffer, 16)) == vtxBuffer);
+        Assert::IsTrue(cache.getUploadCount() == 1);
+
+        // The cached data is converted to the host byte order
+        Assert::IsTrue(*reinterpret_cast<const U32*>(getData(vtxBuffer) + 0x10) == 0x10);
+
+        // Streams growing beyond the cached vertices are uploaded again
+        cache.get(&graphics, memory.get(), getStream(buffer, 32));
+        Assert::IsTrue(cache.getUploadCount() == 2);
+        cache.trim();
+    }
+
+    TEST_METHOD(VertexCache_Writes) {
+        VertexCache cache(0x10000);
+        auto* vtxBuffer = cache.get(&graphics, memory.get(), getStream(buffer, 16));
+
+        // Writes keeping the same contents do not upload the stream again
+        memory->write32(buffer + 0x20, memory->read32(buffer + 0x20));
+        Assert::IsTrue(cache.get(&graphics, memory.get(), getStream(buffer, 16)) == vtxBuffer);
+        Assert::IsTrue(cache.getUploadCount() == 1);
+
+        // Writes after the contents were validated again are still detected
+        memory->write32(buffer + 0x20, 0xDEADBEEF);
+        vtxBuffer = cache.get(&graphics, memory.get(), getStream(buffer, 16));
+        Assert::IsTrue(cache.getUploadCount() == 2);
+        Assert::IsTrue(*reinterpret_cast<const U32*>(getData(vtxBuffer) + 0x20) == 0xDEADBEEF);
+        memory->write32(buffer + 0x30, 0xDEADBEEF);
+        cache.get(&graphics, memory.get(), getStream(buffer, 16));
+        Assert::IsTrue(cache.getUploadCount() == 3);
+        cache.trim();
+    }
+
+    TEST_METHOD(VertexCache_Indices) {
+        VertexCache cache(0x10000);
+        for (U32 i = 0; i < 8; i++) {
+            memory->write16(buffer + 2 * i, U16(10 + i));
+        }
+
+        const IndexRestart noRestart = { false, 0xFFFF };
+        U32 minIndex, maxIndex;
+        cache.getIndices(&graphics, memory.get(), getIndexStream(buffer, 8), noRestart, minIndex, maxIndex);
+        Assert::IsTrue(minIndex == 10 && maxIndex == 17);
+
+        // The range of cached indices is kept, and scanned again once they change
+        cache.getIndices(&graphics, memory.get(), getIndexStream(buffer, 8), noRestart, minIndex, maxIndex);
+        Assert::IsTrue(minIndex == 10 && maxIndex == 17);
+        memory->write16(buffer + 6, 3);
+        cache.getIndices(&graphics, memory.get(), getIndexStream(buffer, 8), noRestart, minIndex, maxIndex);
+        Assert::IsTrue(minIndex == 3 && maxIndex == 17);
+        Assert::IsTrue(cache.getUploadCount() == 2);
+
+        // Enabling primitive restart uploads the indices again, rewriting the restart index to all bits set
+        const IndexRestart restart = { true, 17 };
+        auto* idxBuffer = cache.getIndices(&graphics, memory.get(), getIndexStream(buffer, 8), restart, minIndex, maxIndex);
+        Assert::IsTrue(minIndex == 3 && maxIndex == 16);
+        Assert::IsTrue(cache.getUploadCount() == 3);
+        Assert::IsTrue(*reinterpret_cast<const U16*>(getData(idxBuffer) + 14) == 0xFFFF);
+        Assert::IsTrue(*reinterpret_cast<const U16*>(getData(idxBuffer) + 12) == 16);
+    }
+
+    TEST_METHOD(VertexCache_Recycle) {
+        // Buffers retired by uncached uploads are recycled after trimming
+        VertexCache cache(0x10000);
+        auto* vtxBuffer = cache.upload(&graphics, memory->ptr<Byte>(buffer), getStream(0, 16));
+        cache.trim();
+        Assert::IsTrue(cache.upload(&graphics, memory->ptr<Byte>(buffer), getStream(0, 16)) == vtxBuffer);
+        Assert::IsTrue(graphics.vertexBuffers == 1);
+    }
+};